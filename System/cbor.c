@@ -0,0 +1,155 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  cbor.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  CBOR编码器, 使用方法见cbor.h
+ **
+ ** 【实现说明】  每个数据项的头部 = 主类型(高3位) + 附加信息(低5位): 0~23直接放在附加信息中,
+ **               更大的值附加信息为24/25/26, 其后为1/2/4字节大端数值; 负整数n编码为主类型1、数值 -1-n
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "cbor.h"
+#include <string.h>
+
+
+
+/*****************************************************************************
+ ** 本地定义
+ *****************************************************************************/
+#define CBOR_MAJOR_UINT     0
+#define CBOR_MAJOR_NEGINT   1
+#define CBOR_MAJOR_TEXT     3
+#define CBOR_MAJOR_ARRAY    4
+#define CBOR_MAJOR_MAP      5
+#define CBOR_MAJOR_SIMPLE   7
+
+#define CBOR_SIMPLE_FALSE   20
+#define CBOR_SIMPLE_TRUE    21
+
+
+
+/******************************************************************************
+ * 函  数： Cbor_Put
+ * 功  能： 写入若干字节; 空间不足时标记溢出, 不写入
+ ******************************************************************************/
+static void Cbor_Put(CborWriter *w, const void *data, uint16_t n)
+{
+    if (w->overflow || w->cap - w->len < n)
+    {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, n);
+    w->len += n;
+}
+
+/******************************************************************************
+ * 函  数： Cbor_Head
+ * 功  能： 写入数据项头部, 数值按最短的形式编码
+ ******************************************************************************/
+static void Cbor_Head(CborWriter *w, uint8_t major, uint32_t v)
+{
+    uint8_t  head[5];
+    uint16_t n;
+
+    major <<= 5;
+    if (v < 24)
+    {
+        head[0] = major | (uint8_t)v;
+        n = 1;
+    }
+    else if (v <= 0xFF)
+    {
+        head[0] = major | 24;
+        head[1] = (uint8_t)v;
+        n = 2;
+    }
+    else if (v <= 0xFFFF)
+    {
+        head[0] = major | 25;
+        head[1] = (uint8_t)(v >> 8);
+        head[2] = (uint8_t)v;
+        n = 3;
+    }
+    else
+    {
+        head[0] = major | 26;
+        head[1] = (uint8_t)(v >> 24);
+        head[2] = (uint8_t)(v >> 16);
+        head[3] = (uint8_t)(v >> 8);
+        head[4] = (uint8_t)v;
+        n = 5;
+    }
+    Cbor_Put(w, head, n);
+}
+
+/******************************************************************************
+ * 函  数： Cbor_Init
+ * 功  能： 开始编码
+ * 参  数： CborWriter *w  编码器
+ *          void *buf      输出缓存
+ *          uint16_t cap   缓存大小
+ * 返回值： 无
+ ******************************************************************************/
+void Cbor_Init(CborWriter *w, void *buf, uint16_t cap)
+{
+    w->buf      = (uint8_t *)buf;
+    w->cap      = cap;
+    w->len      = 0;
+    w->overflow = false;
+}
+
+/******************************************************************************
+ * 函  数： Cbor_Uint / Cbor_Int / Cbor_Bool / Cbor_Text
+ * 功  能： 写入一个整数、布尔、文本数据项
+ ******************************************************************************/
+void Cbor_Uint(CborWriter *w, uint32_t v)
+{
+    Cbor_Head(w, CBOR_MAJOR_UINT, v);
+}
+
+void Cbor_Int(CborWriter *w, int32_t v)
+{
+    if (v >= 0)
+        Cbor_Head(w, CBOR_MAJOR_UINT, (uint32_t)v);
+    else
+        Cbor_Head(w, CBOR_MAJOR_NEGINT, (uint32_t)(-1 - v));
+}
+
+void Cbor_Bool(CborWriter *w, bool v)
+{
+    Cbor_Head(w, CBOR_MAJOR_SIMPLE, v ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE);
+}
+
+void Cbor_Text(CborWriter *w, const char *str)
+{
+    uint16_t n = (uint16_t)strlen(str);
+    Cbor_Head(w, CBOR_MAJOR_TEXT, n);
+    Cbor_Put(w, str, n);
+}
+
+/******************************************************************************
+ * 函  数： Cbor_Array / Cbor_Map
+ * 功  能： 写入定长数组、定长映射的头部, 之后由调用者写入各元素
+ ******************************************************************************/
+void Cbor_Array(CborWriter *w, uint16_t num)
+{
+    Cbor_Head(w, CBOR_MAJOR_ARRAY, num);
+}
+
+void Cbor_Map(CborWriter *w, uint16_t num)
+{
+    Cbor_Head(w, CBOR_MAJOR_MAP, num);
+}
+
+/******************************************************************************
+ * 函  数： Cbor_Ok
+ * 功  能： 编码是否完整(没有因缓存不足而丢弃数据)
+ * 参  数： const CborWriter *w  编码器
+ * 返回值： true=完整
+ ******************************************************************************/
+bool Cbor_Ok(const CborWriter *w)
+{
+    return !w->overflow;
+}
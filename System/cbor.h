@@ -0,0 +1,49 @@
+#ifndef __CBOR_H
+#define __CBOR_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  cbor.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  CBOR(RFC 8949)编码器, 只包含遥测需要的类型: 整数、文本、布尔、定长数组、定长映射;
+ **               直接写入调用者提供的缓存, 不分配内存; 小整数(-24~23)只占1字节, 适合按流量计费的蜂窝链路
+ **
+ ** 【使用说明】  1- CborWriter w;  Cbor_Init(&w, buf, sizeof(buf));
+ **               2- Cbor_Map(&w, 2);  Cbor_Uint(&w, 0); Cbor_Uint(&w, 1);  Cbor_Uint(&w, 1); Cbor_Int(&w, -235);
+ **                  数组、映射先写元素个数, 再依次写各元素(映射为键、值交替);
+ **               3- 编码结束后检查 Cbor_Ok(&w), 长度为 w.len; 缓存不足时后续写入全部忽略, Cbor_Ok()返回false
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "system_f103.h"
+#include <stdbool.h>
+
+
+
+/*****************************************************************************
+ ** 数据类型
+****************************************************************************/
+typedef struct
+{
+    uint8_t  *buf;                                  // 输出缓存
+    uint16_t  cap;                                  // 缓存大小
+    uint16_t  len;                                  // 已写入的字节数
+    bool      overflow;                             // 缓存不足, 编码结果无效
+} CborWriter;
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+void  Cbor_Init(CborWriter *w, void *buf, uint16_t cap);           // 开始编码
+void  Cbor_Uint(CborWriter *w, uint32_t v);                        // 无符号整数
+void  Cbor_Int(CborWriter *w, int32_t v);                          // 有符号整数
+void  Cbor_Bool(CborWriter *w, bool v);                            // 布尔
+void  Cbor_Text(CborWriter *w, const char *str);                   // UTF-8文本
+void  Cbor_Array(CborWriter *w, uint16_t num);                     // 定长数组, 其后写num个元素
+void  Cbor_Map(CborWriter *w, uint16_t num);                       // 定长映射, 其后写num对键、值
+bool  Cbor_Ok(const CborWriter *w);                                // 编码是否完整
+
+
+
+#endif
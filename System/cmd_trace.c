@@ -0,0 +1,167 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  cmd_trace.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  下行命令时延追踪, 使用方法见cmd_trace.h
+ **
+ ** 【实现说明】  CmdTrace_Begin()直接占用环形缓冲区中最旧的一条, 写满后覆盖; 导出时按序号跳过已导出的记录
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "cmd_trace.h"
+#include <stdio.h>
+#include <string.h>
+
+
+
+/*****************************************************************************
+ ** 本地变量
+ *****************************************************************************/
+#if CMD_TRACE_ENABLE
+static CmdTrace_Record  xTraceRing[CMD_TRACE_RING_SIZE];
+static CmdTrace_Record *pxCurrent    = NULL;        // 进行中的记录; NULL=没有
+static uint32_t         ulNextSeq    = 1;           // 下一条记录的序号
+static uint32_t         ulExportedSeq = 0;          // 已导出的最大序号
+
+static const char *const pcStageNames[CMD_TRACE_STAGE_NUM] = {
+    "first", "frame", "class", "parse", "act", "queued", "confirmed"
+};
+#endif
+
+
+
+/******************************************************************************
+ * 函  数： CmdTrace_Begin
+ * 功  能： 开始一条新记录; 上一条未结束的记录视为已结束
+ * 参  数： uint16_t msgid            下行报文标识符
+ *          uint32_t firstByteCycles  串口收到首字节的时刻
+ *          uint32_t completeCycles   本条记录接收完整的时刻
+ * 返回值： 无
+ ******************************************************************************/
+void CmdTrace_Begin(uint16_t msgid, uint32_t firstByteCycles, uint32_t completeCycles)
+{
+#if CMD_TRACE_ENABLE
+    if (pxCurrent != NULL)
+        pxCurrent->done = true;
+
+    pxCurrent = &xTraceRing[ulNextSeq % CMD_TRACE_RING_SIZE];
+    memset(pxCurrent, 0, sizeof(CmdTrace_Record));
+    pxCurrent->seq   = ulNextSeq++;
+    pxCurrent->msgid = msgid;
+    pxCurrent->cycles[CMD_TRACE_FIRST_BYTE]     = firstByteCycles;
+    pxCurrent->cycles[CMD_TRACE_FRAME_COMPLETE] = completeCycles;
+    pxCurrent->marked = (1U << CMD_TRACE_FIRST_BYTE) | (1U << CMD_TRACE_FRAME_COMPLETE);
+#endif
+}
+
+/******************************************************************************
+ * 函  数： CmdTrace_Mark
+ * 功  能： 记录当前命令到达某个追踪点的时刻; 没有进行中的记录时什么也不做
+ * 参  数： CmdTrace_Stage stage  追踪点
+ * 返回值： 无
+ ******************************************************************************/
+void CmdTrace_Mark(CmdTrace_Stage stage)
+{
+#if CMD_TRACE_ENABLE
+    if (pxCurrent == NULL || stage >= CMD_TRACE_STAGE_NUM)
+        return;
+    pxCurrent->cycles[stage] = System_GetCycles();
+    pxCurrent->marked |= 1U << stage;
+#endif
+}
+
+/******************************************************************************
+ * 函  数： CmdTrace_Tag
+ * 功  能： 设置当前命令的类型, 同时记录CMD_TRACE_CLASSIFIED
+ * 参  数： const char *tag  类型名称, 必须是常量字符串(只保存指针)
+ * 返回值： 无
+ ******************************************************************************/
+void CmdTrace_Tag(const char *tag)
+{
+#if CMD_TRACE_ENABLE
+    if (pxCurrent == NULL)
+        return;
+    pxCurrent->tag = tag;
+    CmdTrace_Mark(CMD_TRACE_CLASSIFIED);
+#endif
+}
+
+/******************************************************************************
+ * 函  数： CmdTrace_End
+ * 功  能： 结束当前记录, 之后可以被读取、导出
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void CmdTrace_End(void)
+{
+#if CMD_TRACE_ENABLE
+    if (pxCurrent == NULL)
+        return;
+    pxCurrent->done = true;
+    pxCurrent = NULL;
+#endif
+}
+
+/******************************************************************************
+ * 函  数： CmdTrace_Get
+ * 功  能： 读取一条已完成的记录
+ * 参  数： uint8_t age              0=最新的一条, 1=上一条, ...
+ *          CmdTrace_Record *record  记录的存放地址
+ * 返回值： true=成功; false=没有该记录(尚未产生、已被覆盖或尚未结束)
+ ******************************************************************************/
+bool CmdTrace_Get(uint8_t age, CmdTrace_Record *record)
+{
+#if CMD_TRACE_ENABLE
+    if (age >= CMD_TRACE_RING_SIZE || (uint32_t)age + 1 >= ulNextSeq)
+        return false;
+
+    const CmdTrace_Record *item = &xTraceRing[(ulNextSeq - 1 - age) % CMD_TRACE_RING_SIZE];
+    if (!item->done)
+        return false;
+    *record = *item;
+    return true;
+#else
+    return false;
+#endif
+}
+
+/******************************************************************************
+ * 函  数： CmdTrace_Export
+ * 功  能： 通过printf输出上次导出之后完成的记录, 每条一行, 各追踪点为相对首字节的微秒数, 未到达的追踪点输出'-'
+ *          例: CMDTRACE: seq=3 msgid=0 tag=invoke first=0 frame=1850 class=2210 parse=2264 act=2410 queued=2489 confirmed=14020
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void CmdTrace_Export(void)
+{
+#if CMD_TRACE_ENABLE
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000;
+    if (cyclesPerUs == 0)
+        return;
+
+    for (uint32_t seq = ulExportedSeq + 1; seq < ulNextSeq; seq++)
+    {
+        const CmdTrace_Record *item = &xTraceRing[seq % CMD_TRACE_RING_SIZE];
+        if (item->seq != seq)                       // 已被覆盖
+        {
+            ulExportedSeq = seq;
+            continue;
+        }
+        if (!item->done)
+            break;
+
+        printf("CMDTRACE: seq=%lu msgid=%u tag=%s", (unsigned long)item->seq, item->msgid,
+               item->tag ? item->tag : "-");
+        for (int i = 0; i < CMD_TRACE_STAGE_NUM; i++)
+        {
+            if (item->marked & (1U << i))
+                printf(" %s=%lu", pcStageNames[i],
+                       (unsigned long)((item->cycles[i] - item->cycles[CMD_TRACE_FIRST_BYTE]) / cyclesPerUs));
+            else
+                printf(" %s=-", pcStageNames[i]);
+        }
+        printf("\r\n");
+        ulExportedSeq = seq;
+    }
+#endif
+}
@@ -0,0 +1,72 @@
+#ifndef __CMD_TRACE_H
+#define __CMD_TRACE_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  cmd_trace.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  下行命令时延追踪: 用DWT周期计数器记录每条命令在各处理环节的时刻
+ **               (串口首字节 -> 帧接收完整 -> 主题分类 -> JSON解析 -> 执行动作 -> 回复发出 -> 回复被模组接受),
+ **               每条命令一条记录, 保存在RAM环形缓冲区中, 可以逐条读取或通过printf导出
+ **
+ ** 【使用说明】  1- 处理一条下行消息前调用 CmdTrace_Begin(msgid, 首字节时刻, 帧完整时刻);
+ **               2- 各环节完成时调用 CmdTrace_Mark(CMD_TRACE_xxx); 没有进行中的记录时调用无效, 因此回复函数中可以直接调用;
+ **               3- 处理完后调用 CmdTrace_End(), 记录才可以被导出;
+ **               4- 在main的while中周期调用CmdTrace_Export(), 输出上次导出之后完成的记录; 间隔不能超过50秒(CYCCNT溢出)
+ **
+ ** 【注意事项】  只能在主循环中使用; 串口首字节的时刻由空闲中断时刻和字节数按波特率倒推, 假设模组连续发送
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "system_f103.h"
+#include <stdbool.h>
+
+
+
+/*****************************************************************************
+ ** 移植配置
+****************************************************************************/
+#define CMD_TRACE_ENABLE          1                 // 1=启用追踪, 0=关闭(各函数为空)
+#define CMD_TRACE_RING_SIZE      16                 // 环形缓冲区保存的记录数
+
+
+
+/*****************************************************************************
+ ** 追踪点
+****************************************************************************/
+typedef enum
+{
+    CMD_TRACE_FIRST_BYTE = 0,                       // 串口收到本条 +QMTRECV 的第一个字节(估算)
+    CMD_TRACE_FRAME_COMPLETE,                       // 本条记录的最后一个字节到达
+    CMD_TRACE_CLASSIFIED,                           // 按主题判断出命令类型
+    CMD_TRACE_PARSED,                               // JSON参数解析完成
+    CMD_TRACE_ACTUATED,                             // 动作执行完成(修改状态、控制输出)
+    CMD_TRACE_REPLY_QUEUED,                         // 回复指令已构建, 开始写入串口
+    CMD_TRACE_REPLY_CONFIRMED,                      // 模组回复"OK", 回复已被接受
+    CMD_TRACE_STAGE_NUM                             // 数量, 不是追踪点
+} CmdTrace_Stage;
+
+typedef struct
+{
+    uint32_t    seq;                                // 记录序号, 从1开始递增
+    uint16_t    msgid;                              // 下行报文标识符
+    uint8_t     marked;                             // 已记录的追踪点, bit n = CmdTrace_Stage n
+    bool        done;                               // 已调用CmdTrace_End()
+    const char *tag;                                // 命令类型, 指向常量字符串; NULL=未分类
+    uint32_t    cycles[CMD_TRACE_STAGE_NUM];        // 各追踪点的DWT周期计数值
+} CmdTrace_Record;
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+void CmdTrace_Begin(uint16_t msgid, uint32_t firstByteCycles, uint32_t completeCycles);  // 开始一条记录
+void CmdTrace_Mark(CmdTrace_Stage stage);                   // 记录当前命令到达某个追踪点的时刻
+void CmdTrace_Tag(const char *tag);                         // 设置当前命令的类型, 并记录CMD_TRACE_CLASSIFIED
+void CmdTrace_End(void);                                    // 结束当前记录
+bool CmdTrace_Get(uint8_t age, CmdTrace_Record *record);    // 读取已完成的记录, age=0为最新的一条; false=没有该记录
+void CmdTrace_Export(void);                                 // 通过printf输出上次导出之后完成的记录(各追踪点相对首字节的微秒数)
+
+
+
+#endif
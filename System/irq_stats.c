@@ -0,0 +1,162 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  irq_stats.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  中断负载监控, 使用方法见irq_stats.h
+ **
+ ** 【实现说明】  1- 中断中只做加法和比较, 不做除法; 频率、负载、微秒的换算都在IrqStats_Snapshot()中完成;
+ **               2- 统计数据按周期清零, 因此各累计值用u32即可, 两次快照间隔不能超过CYCCNT溢出周期(72MHz时约59秒)
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "irq_stats.h"
+
+
+
+#if IRQ_STATS_ENABLE
+
+/*****************************************************************************
+ ** 本地变量
+ *****************************************************************************/
+volatile uint8_t  g_irqStatsNest      = 0;         // 中断嵌套深度
+volatile uint32_t g_irqStatsBusyStart = 0;         // 最外层中断的进入时刻
+
+static IrqStats_Item     xIrqItems[IRQ_ID_NUM];    // 各中断本周期的统计数据
+static volatile uint32_t ulBusyCycles    = 0;      // 本周期所有中断合计执行周期数(嵌套部分不重复计算)
+static volatile uint32_t ulMaxMaskCycles = 0;      // 本周期关中断的最长周期数
+static uint32_t          ulWindowStart   = 0;      // 本周期的起始时刻
+
+static const char *const pcIrqNames[IRQ_ID_NUM] =
+{
+    "SysTick", "USART1", "USART2", "USART3", "UART4", "UART5", "EXTI0", "EXTI1", "EXTI4", "ADC_DMA"
+};
+
+
+
+/******************************************************************************
+ * 函  数： IrqStats_Exit
+ * 功  能： 中断出口统计, 由IRQ_STATS_EXIT()调用
+ * 参  数： IrqStats_Id id       中断编号
+ *          uint32_t startCycles 中断的进入时刻
+ * 返回值： 无
+ ******************************************************************************/
+void IrqStats_Exit(IrqStats_Id id, uint32_t startCycles)
+{
+    uint32_t now     = System_GetCycles();
+    uint32_t elapsed = now - startCycles;
+    IrqStats_Item *item = &xIrqItems[id];
+
+    item->count++;
+    item->cycles += elapsed;
+    if (elapsed > item->maxCycles)
+        item->maxCycles = elapsed;
+
+    if (--g_irqStatsNest == 0)                      // 最外层中断退出时, 才累计总负载
+        ulBusyCycles += now - g_irqStatsBusyStart;
+}
+
+/******************************************************************************
+ * 函  数： IrqStats_MaskEnd
+ * 功  能： 临界区出口统计, 由IRQ_STATS_CRITICAL_EXIT()在开中断前调用
+ * 参  数： uint32_t startCycles 关中断的时刻
+ * 返回值： 无
+ ******************************************************************************/
+void IrqStats_MaskEnd(uint32_t startCycles)
+{
+    uint32_t elapsed = System_GetCycles() - startCycles;
+    if (elapsed > ulMaxMaskCycles)
+        ulMaxMaskCycles = elapsed;
+}
+
+#endif
+
+
+
+/******************************************************************************
+ * 函  数： IrqStats_Init
+ * 功  能： 使能DWT周期计数器, 清零统计数据, 开始第一个统计周期
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void IrqStats_Init(void)
+{
+    System_CycleCounterInit();
+#if IRQ_STATS_ENABLE
+    memset(xIrqItems, 0, sizeof(xIrqItems));
+    ulBusyCycles    = 0;
+    ulMaxMaskCycles = 0;
+    ulWindowStart   = System_GetCycles();
+#endif
+}
+
+/******************************************************************************
+ * 函  数： IrqStats_Snapshot
+ * 功  能： 取出本周期的统计数据, 换算成频率、负载、微秒, 并开始新的统计周期
+ * 参  数： IrqStats_Record *record  统计记录的存放地址
+ * 返回值： 无
+ ******************************************************************************/
+void IrqStats_Snapshot(IrqStats_Record *record)
+{
+    memset(record, 0, sizeof(IrqStats_Record));
+#if IRQ_STATS_ENABLE
+    IrqStats_Item items[IRQ_ID_NUM];
+    uint32_t busy, maxMask, window;
+
+    // 复制并清零, 关中断时间只有几十个周期
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t now = System_GetCycles();
+    memcpy(items, xIrqItems, sizeof(items));
+    memset(xIrqItems, 0, sizeof(xIrqItems));
+    busy            = ulBusyCycles;
+    maxMask         = ulMaxMaskCycles;
+    ulBusyCycles    = 0;
+    ulMaxMaskCycles = 0;
+    window          = now - ulWindowStart;
+    ulWindowStart   = now;
+    __set_PRIMASK(primask);
+
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000;
+    if (window == 0 || cyclesPerUs == 0)
+        return;
+
+    record->windowMs = window / (cyclesPerUs * 1000);
+    for (int i = 0; i < IRQ_ID_NUM; i++)
+    {
+        record->rateHz[i]       = (uint32_t)((u64)items[i].count * SystemCoreClock / window);
+        record->loadPermille[i] = (uint16_t)((u64)items[i].cycles * 1000 / window);
+        record->maxUs[i]        = items[i].maxCycles / cyclesPerUs;
+    }
+    record->totalLoadPermille = (uint16_t)((u64)busy * 1000 / window);
+    record->maxMaskedUs       = maxMask / cyclesPerUs;
+#endif
+}
+
+/******************************************************************************
+ * 函  数： IrqStats_Report
+ * 功  能： 生成一条统计记录, 并通过printf输出; 只输出本周期内触发过的中断
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void IrqStats_Report(void)
+{
+#if IRQ_STATS_ENABLE
+    IrqStats_Record record;
+    IrqStats_Snapshot(&record);
+
+    printf("IRQSTAT: window=%lums load=%u.%u%% masked_max=%luus\r\n",
+           (unsigned long)record.windowMs,
+           record.totalLoadPermille / 10, record.totalLoadPermille % 10,
+           (unsigned long)record.maxMaskedUs);
+    for (int i = 0; i < IRQ_ID_NUM; i++)
+    {
+        if (record.rateHz[i] == 0 && record.maxUs[i] == 0)
+            continue;
+        printf("IRQSTAT:   %-7s rate=%luHz load=%u.%u%% max=%luus\r\n",
+               pcIrqNames[i],
+               (unsigned long)record.rateHz[i],
+               record.loadPermille[i] / 10, record.loadPermille[i] % 10,
+               (unsigned long)record.maxUs[i]);
+    }
+#endif
+}
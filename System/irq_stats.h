@@ -0,0 +1,123 @@
+#ifndef __IRQ_STATS_H
+#define __IRQ_STATS_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  irq_stats.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  中断负载监控: 用DWT周期计数器记录各中断服务函数的进入、退出时刻,
+ **               统计每个中断的触发频率、总负载百分比、最长单次执行时间, 以及关中断(临界区)的最长时长
+ **
+ ** 【使用说明】  1- 上电后调用IrqStats_Init(), 使能DWT周期计数器;
+ **               2- 在中断服务函数的第一行写 IRQ_STATS_ENTER(); 在每个返回点前写 IRQ_STATS_EXIT(IRQ_ID_xxx);
+ **               3- 需要关中断保护的代码段, 使用 IRQ_STATS_CRITICAL_ENTER(); ... IRQ_STATS_CRITICAL_EXIT(); 可嵌套使用;
+ **               4- 在main的while中周期调用IrqStats_Report(), 输出一条统计记录; 两次调用间隔不能超过50秒(CYCCNT溢出);
+ **               5- IRQ_STATS_ENABLE 置0后, 以上宏全部展开为空(临界区宏仍然关中断), 不占用任何运行时间
+ **
+ ** 【注意事项】  中断可以嵌套, 单个中断的执行时间包含了被更高优先级中断抢占的时间;
+ **               总负载只在最外层中断退出时累计, 不会重复计算
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "system_f103.h"
+
+
+
+/*****************************************************************************
+ ** 移植配置
+****************************************************************************/
+#define IRQ_STATS_ENABLE          1                 // 1=启用中断负载统计, 0=关闭(宏展开为空)
+#define IRQ_STATS_REPORT_MS       10000             // 建议的统计记录输出周期(ms), 不能超过50000
+
+
+
+/*****************************************************************************
+ ** 被监控的中断编号
+****************************************************************************/
+typedef enum
+{
+    IRQ_ID_SYSTICK = 0,
+    IRQ_ID_USART1,
+    IRQ_ID_USART2,
+    IRQ_ID_USART3,
+    IRQ_ID_UART4,
+    IRQ_ID_UART5,
+    IRQ_ID_EXTI0,
+    IRQ_ID_EXTI1,
+    IRQ_ID_EXTI4,
+    IRQ_ID_DMA1_CH1,
+    IRQ_ID_NUM                                      // 数量, 不是中断
+} IrqStats_Id;
+
+// 单个中断在一个统计周期内的数据
+typedef struct
+{
+    uint32_t  count;                                // 触发次数
+    uint32_t  cycles;                               // 累计执行周期数
+    uint32_t  maxCycles;                            // 最长单次执行周期数
+} IrqStats_Item;
+
+// 一条统计记录, 由IrqStats_Snapshot()生成
+typedef struct
+{
+    uint32_t  windowMs;                             // 本统计周期的时长(ms)
+    uint32_t  rateHz[IRQ_ID_NUM];                   // 各中断的触发频率(次/秒)
+    uint16_t  loadPermille[IRQ_ID_NUM];             // 各中断的CPU占用(千分比)
+    uint32_t  maxUs[IRQ_ID_NUM];                    // 各中断最长单次执行时间(us)
+    uint16_t  totalLoadPermille;                    // 所有中断合计的CPU占用(千分比), 嵌套部分不重复计算
+    uint32_t  maxMaskedUs;                          // 关中断(临界区)的最长时长(us)
+} IrqStats_Record;
+
+
+
+#if IRQ_STATS_ENABLE
+
+extern volatile uint8_t  g_irqStatsNest;           // 中断嵌套深度
+extern volatile uint32_t g_irqStatsBusyStart;      // 最外层中断的进入时刻
+
+// 中断入口: 记录进入时刻, 最外层中断同时记录忙碌起点
+#define IRQ_STATS_ENTER()                                   \
+    uint32_t _irqStatsStart = System_GetCycles();           \
+    if (g_irqStatsNest++ == 0)  g_irqStatsBusyStart = _irqStatsStart
+
+// 中断出口: 每个return之前都要调用
+#define IRQ_STATS_EXIT(id)      IrqStats_Exit((id), _irqStatsStart)
+
+// 临界区: 关中断并记录时长, 可嵌套
+#define IRQ_STATS_CRITICAL_ENTER()                          \
+    uint32_t _irqStatsPrimask = __get_PRIMASK();            \
+    __disable_irq();                                        \
+    uint32_t _irqStatsMaskStart = System_GetCycles()
+
+#define IRQ_STATS_CRITICAL_EXIT()                           \
+    do {                                                    \
+        if (_irqStatsPrimask == 0)                          \
+            IrqStats_MaskEnd(_irqStatsMaskStart);           \
+        __set_PRIMASK(_irqStatsPrimask);                    \
+    } while (0)
+
+void IrqStats_Exit(IrqStats_Id id, uint32_t startCycles);
+void IrqStats_MaskEnd(uint32_t startCycles);
+
+#else
+
+#define IRQ_STATS_ENTER()
+#define IRQ_STATS_EXIT(id)
+#define IRQ_STATS_CRITICAL_ENTER()                          \
+    uint32_t _irqStatsPrimask = __get_PRIMASK();            \
+    __disable_irq()
+#define IRQ_STATS_CRITICAL_EXIT()    __set_PRIMASK(_irqStatsPrimask)
+
+#endif
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+void IrqStats_Init(void);                                   // 使能DWT周期计数器, 清零统计数据
+void IrqStats_Snapshot(IrqStats_Record *record);            // 生成一条统计记录, 并开始新的统计周期
+void IrqStats_Report(void);                                 // 生成统计记录, 并通过printf输出
+
+
+
+#endif
@@ -0,0 +1,95 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  msg_pool.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  消息缓存池, 使用方法见msg_pool.h
+ **
+ ** 【实现说明】  用一个32位掩码记录各块是否被占用, 申请时取最低的空闲位; 关中断只保护掩码的读写, 只有几条指令
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "msg_pool.h"
+#include "irq_stats.h"
+
+
+
+/*****************************************************************************
+ ** 本地变量
+ *****************************************************************************/
+static uint32_t ulPoolMem[MSG_POOL_BLOCK_NUM][MSG_POOL_BLOCK_SIZE / 4];   // 以u32定义, 保证4字节对齐
+static volatile uint32_t ulUsedMask = 0;           // 占用掩码, bit n = 第n块已被占用
+static MsgPool_Stats xPoolStats;
+
+
+
+/******************************************************************************
+ * 函  数： MsgPool_Acquire
+ * 功  能： 申请一块缓存
+ * 参  数： 无
+ * 返回值： 缓存地址(MSG_POOL_BLOCK_SIZE字节); 池空时返回NULL, 并计入失败次数
+ ******************************************************************************/
+void *MsgPool_Acquire(void)
+{
+    void *block = NULL;
+
+    IRQ_STATS_CRITICAL_ENTER();
+    for (uint8_t i = 0; i < MSG_POOL_BLOCK_NUM; i++)
+    {
+        if ((ulUsedMask & (1UL << i)) == 0)
+        {
+            ulUsedMask |= 1UL << i;
+            block = ulPoolMem[i];
+            xPoolStats.acquired++;
+            if (++xPoolStats.inUse > xPoolStats.highWater)
+                xPoolStats.highWater = xPoolStats.inUse;
+            break;
+        }
+    }
+    if (block == NULL)
+        xPoolStats.failures++;
+    IRQ_STATS_CRITICAL_EXIT();
+
+    return block;
+}
+
+/******************************************************************************
+ * 函  数： MsgPool_Release
+ * 功  能： 释放一块缓存
+ * 参  数： void *block  MsgPool_Acquire()返回的地址; NULL时什么也不做
+ * 返回值： 无
+ ******************************************************************************/
+void MsgPool_Release(void *block)
+{
+    if (block == NULL)
+        return;
+
+    uint32_t offset = (uint32_t)((uint8_t *)block - (uint8_t *)ulPoolMem);
+    uint32_t index  = offset / MSG_POOL_BLOCK_SIZE;
+    bool     valid  = ((uint8_t *)block >= (uint8_t *)ulPoolMem) && (index < MSG_POOL_BLOCK_NUM) &&
+                      (offset % MSG_POOL_BLOCK_SIZE == 0);
+
+    IRQ_STATS_CRITICAL_ENTER();
+    if (valid && (ulUsedMask & (1UL << index)))
+    {
+        ulUsedMask &= ~(1UL << index);
+        xPoolStats.inUse--;
+    }
+    else
+    {
+        xPoolStats.badRelease++;                    // 重复释放或野指针
+    }
+    IRQ_STATS_CRITICAL_EXIT();
+}
+
+/******************************************************************************
+ * 函  数： MsgPool_GetStats
+ * 功  能： 读取统计数据
+ * 参  数： MsgPool_Stats *stats  统计数据的存放地址
+ * 返回值： 无
+ ******************************************************************************/
+void MsgPool_GetStats(MsgPool_Stats *stats)
+{
+    IRQ_STATS_CRITICAL_ENTER();
+    *stats = xPoolStats;
+    IRQ_STATS_CRITICAL_EXIT();
+}
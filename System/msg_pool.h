@@ -0,0 +1,53 @@
+#ifndef __MSG_POOL_H
+#define __MSG_POOL_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  msg_pool.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  消息缓存池: 固定数量、固定大小的缓存块, 用于接收帧、JSON构建、待发送消息;
+ **               缓存块按指针在各处理环节之间传递, 谁持有指针谁负责释放(所有权转移), 不再共用全局大缓存
+ **
+ ** 【使用说明】  1- char *buf = MsgPool_Acquire();                  // 池空时返回NULL, 调用者必须检查
+ **               2- 把buf交给下一个环节(例如MQTT_Publish_QoS1())后, 由下一个环节负责释放, 本环节不能再使用;
+ **                  没有交出时, 用完调用 MsgPool_Release(buf);
+ **               3- 可以在中断中申请、释放(内部有临界区保护);
+ **               4- 周期调用MsgPool_GetStats(), 按最高占用数和申请失败次数调整MSG_POOL_BLOCK_NUM
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "system_f103.h"
+
+
+
+/*****************************************************************************
+ ** 移植配置
+****************************************************************************/
+#define MSG_POOL_BLOCK_NUM           8              // 缓存块数量, 不超过32
+#define MSG_POOL_BLOCK_SIZE        512              // 每块的字节数, 须为4的倍数
+
+
+
+/*****************************************************************************
+ ** 统计数据
+****************************************************************************/
+typedef struct
+{
+    uint8_t   inUse;                                // 当前占用的块数
+    uint8_t   highWater;                            // 上电以来的最高占用块数
+    uint32_t  acquired;                             // 申请成功次数
+    uint32_t  failures;                             // 池空导致的申请失败次数
+    uint32_t  badRelease;                           // 释放了不属于本池或未被占用的指针的次数
+} MsgPool_Stats;
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+void *MsgPool_Acquire(void);                        // 申请一块MSG_POOL_BLOCK_SIZE字节的缓存; 池空返回NULL
+void  MsgPool_Release(void *block);                 // 释放; 传入NULL时什么也不做
+void  MsgPool_GetStats(MsgPool_Stats *stats);       // 读取统计数据
+
+
+
+#endif
@@ -22,6 +22,7 @@
  **
 ***********************************************************************************************************************************/  
 #include "system_f103.h"
+#include "irq_stats.h"
 
 
 
@@ -67,12 +68,16 @@ void System_SysTickInit(void)
 *****************************************************************************/
 void SysTick_Handler(void)
 {
+    IRQ_STATS_ENTER();        // 中断负载统计: 入口
+    
     sysTickCnt++;             // 1ms 加1次    
     
     
     #ifdef __SCHEDULER_H     // 任务调度器;如果引用了scheduler.h文件，就调用下面的函数
         Scheduler_TickCnt();      
     #endif
+    
+    IRQ_STATS_EXIT(IRQ_ID_SYSTICK);
 }
 
 /*****************************************************************************
@@ -131,6 +136,20 @@ void System_DelayUS(u32 us)
     while(System_GetTimeUs() - nowUs < us);    
 }
 
+/*****************************************************************************
+ * 函  数： System_CycleCounterInit
+ * 功  能： 使能DWT周期计数器, 用于精确测量代码段、中断服务函数的运行周期数
+ * 使  用： 调用后，即可使用System_GetCycles()读取当前周期计数值
+ * 参  数：
+ * 返回值：
+*****************************************************************************/
+void System_CycleCounterInit(void)
+{
+    SYSTEM_DEMCR      |= 1 << 24;          // TRCENA: 使能DWT、ITM单元
+    SYSTEM_DWT_CYCCNT  = 0;                // 计数值清0
+    SYSTEM_DWT_CTRL   |= 1 << 0;           // CYCCNTENA: 开始周期计数
+}
+
 /*****************************************************************************
  * 函  数： System_GetTimeInterval
  * 功  能： 获取时间间隔，用于测试代码片段运行时间
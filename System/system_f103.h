@@ -216,6 +216,13 @@ typedef  volatile  uint32_t  vu32;
 #define PGout(n)   BIT_ADDR(GPIOG_ODR_Addr,n)  //输出 
 #define PGin(n)    BIT_ADDR(GPIOG_IDR_Addr,n)  //输入
 
+//DWT周期计数器, 用于测量代码段、中断的运行周期数
+//CMSIS V1.3的core_cm3.h没有定义DWT结构体, 这里直接按地址访问
+#define SYSTEM_DEMCR         (*(volatile u32 *)0xE000EDFC)  // 调试异常及监视控制寄存器, bit24:TRCENA, 使能DWT、ITM
+#define SYSTEM_DWT_CTRL      (*(volatile u32 *)0xE0001000)  // DWT控制寄存器, bit0:CYCCNTENA, 使能周期计数
+#define SYSTEM_DWT_CYCCNT    (*(volatile u32 *)0xE0001004)  // DWT周期计数值, 每个内核时钟加1, 72MHz时约59.6秒溢出一次
+#define System_GetCycles()   (SYSTEM_DWT_CYCCNT)            // 读取当前周期计数值; 两次读数相减(u32)即为经过的周期数, 自动处理溢出
+
 
 
 
@@ -231,6 +238,7 @@ void  System_DelayUS (u32);                                                  //
 u64   System_GetTimeMs (void);                                               // 获取 SysTick 计时数, 单位:ms
 u32   System_GetTimeInterval (void);                                         // 监察运行时间
 void  System_TestRunTimes (void);                                            // printf打印监察运行时间 
+void  System_CycleCounterInit (void);                                        // 使能DWT周期计数器, 配置后System_GetCycles()即可使用
 // 简化初始化代码的3大函数
 void  System_GPIOSet(GPIO_TypeDef* GPIOx, u32 allPin, u8 mode, u8 speed);    // GPIO初始化
 void  System_NVICSet (u8 NVIC_Channel, u8 Preemption);                       // NVIC优先级配置, 已分好组, 4位抢占级, 16级, 无子级
@@ -0,0 +1,180 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  fan_control.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  防霜风扇闭环控制, 使用方法见fan_control.h
+ **
+ ** 【实现说明】  1- 控制周期按截止时刻递增(next += period), 周期固定, 不随主循环耗时漂移; 主循环阻塞超过一个周期时只补算一次, 计入late;
+ **               2- 积分项以Q12保存, 限制在输出范围内; 输出饱和且误差同向时本周期不积分(条件积分抗饱和);
+ **               3- 微分作用于测量值, 设定值变化时不产生冲击; 关闭、手动期间积分项跟踪当前输出, 切回自动时无扰动
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "fan_control.h"
+
+
+
+/*****************************************************************************
+ ** 本地变量
+ *****************************************************************************/
+static uint16_t usMin = 0, usMax = 1000;           // 开启时的输出范围(千分比)
+static uint16_t usOutput = 0;                       // 当前输出
+static int32_t  lIntegralQ12 = 0;                   // 积分项, Q12
+static int16_t  sPrevDelta = 0;                     // 上一周期的逆温差, 用于微分
+static bool     bHavePrev = false;
+static bool     bManual = false;
+static uint16_t usManual = 0;                       // 手动覆盖的输出
+static u64      ullManualUntil = 0;                 // 手动覆盖的截止时刻
+static u64      ullNextRun = 0;                     // 下一个控制周期的截止时刻
+static uint32_t ulLate = 0;
+
+
+
+/******************************************************************************
+ * 函  数： FanCtrl_Slew
+ * 功  能： 输出变化率限制
+ ******************************************************************************/
+static uint16_t FanCtrl_Slew(int32_t target)
+{
+    int32_t prev = usOutput;
+    if (target > prev + FAN_CTRL_SLEW_PERMILLE)  target = prev + FAN_CTRL_SLEW_PERMILLE;
+    if (target < prev - FAN_CTRL_SLEW_PERMILLE)  target = prev - FAN_CTRL_SLEW_PERMILLE;
+    return (uint16_t)target;
+}
+
+/******************************************************************************
+ * 函  数： FanCtrl_Init
+ * 功  能： 设置风扇开启时的输出范围, 输出清0, 回到自动
+ * 参  数： uint16_t minPermille  最小输出(风扇低于此占空比可能堵转)
+ *          uint16_t maxPermille  最大输出
+ * 返回值： 无
+ ******************************************************************************/
+void FanCtrl_Init(uint16_t minPermille, uint16_t maxPermille)
+{
+    usMin        = minPermille;
+    usMax        = maxPermille > 1000 ? 1000 : maxPermille;
+    usOutput     = 0;
+    lIntegralQ12 = (int32_t)usMin << 12;
+    bHavePrev    = false;
+    bManual      = false;
+    ullNextRun   = 0;
+    ulLate       = 0;
+}
+
+/******************************************************************************
+ * 函  数： FanCtrl_Task
+ * 功  能： 到达控制周期时计算一次输出
+ * 参  数： u64 nowMs             当前时刻
+ *          bool enable           是否开启风扇(干预状态包含风扇); false时输出立即为0
+ *          bool sensorsValid     温度是否有效; 无效时保持当前输出, 不积分
+ *          int16_t topCenti      上部温度(0.01°C)
+ *          int16_t bottomCenti   下部温度(0.01°C)
+ * 返回值： true=本次运行了一个控制周期, 输出可能已变化
+ ******************************************************************************/
+bool FanCtrl_Task(u64 nowMs, bool enable, bool sensorsValid, int16_t topCenti, int16_t bottomCenti)
+{
+    if (nowMs < ullNextRun)
+        return false;
+    if (ullNextRun != 0 && nowMs - ullNextRun >= FAN_CTRL_PERIOD_MS)
+    {
+        ulLate++;
+        ullNextRun = nowMs;                         // 不补算错过的周期
+    }
+    ullNextRun = (ullNextRun == 0 ? nowMs : ullNextRun) + FAN_CTRL_PERIOD_MS;
+
+    if (bManual && nowMs >= ullManualUntil)
+        bManual = false;
+
+    if (!enable)
+    {
+        usOutput     = 0;                           // 关闭不需要缓降
+        lIntegralQ12 = (int32_t)usMin << 12;
+        bHavePrev    = false;
+        return true;
+    }
+
+    int16_t delta = (int16_t)(topCenti - bottomCenti);
+    int32_t error = delta - FAN_CTRL_SETPOINT_CENTI;
+    int32_t pQ12  = error * FAN_CTRL_KP_Q12;
+    int32_t dQ12  = (bHavePrev && sensorsValid) ? -(int32_t)(delta - sPrevDelta) * FAN_CTRL_KD_Q12 : 0;
+    int32_t target;
+
+    if (bManual)
+    {
+        target = usManual;
+        lIntegralQ12 = ((int32_t)usManual << 12) - pQ12;   // 跟踪手动输出, 恢复自动时无扰动
+    }
+    else if (!sensorsValid)
+    {
+        target = usOutput < usMin ? usMin : usOutput;      // 保持
+    }
+    else
+    {
+        int32_t integral = lIntegralQ12 + error * FAN_CTRL_KI_Q12;
+        int32_t u = (pQ12 + integral + dQ12) >> 12;
+        // 条件积分: 输出已饱和且误差会加深饱和时, 不更新积分项
+        if (!((u > usMax && error > 0) || (u < usMin && error < 0)))
+            lIntegralQ12 = integral;
+        if (lIntegralQ12 > ((int32_t)usMax << 12))  lIntegralQ12 = (int32_t)usMax << 12;
+        if (lIntegralQ12 < ((int32_t)usMin << 12))  lIntegralQ12 = (int32_t)usMin << 12;
+
+        target = (pQ12 + lIntegralQ12 + dQ12) >> 12;
+    }
+
+    if (target > usMax)  target = usMax;
+    if (target < usMin)  target = usMin;
+    usOutput = (usOutput < usMin) ? (uint16_t)target : FanCtrl_Slew(target);  // 从停止开启时直接到最小输出
+    if (sensorsValid)
+    {
+        sPrevDelta = delta;
+        bHavePrev  = true;
+    }
+    return true;
+}
+
+/******************************************************************************
+ * 函  数： FanCtrl_SetManual
+ * 功  能： 手动覆盖输出, 保持FAN_CTRL_OVERRIDE_MS后恢复自动; 仍受开启条件和变化率限制
+ * 参  数： uint16_t permille  输出(千分比), 限制在输出范围内
+ *          u64 nowMs          当前时刻
+ * 返回值： 无
+ ******************************************************************************/
+void FanCtrl_SetManual(uint16_t permille, u64 nowMs)
+{
+    usManual       = permille < usMin ? usMin : (permille > usMax ? usMax : permille);
+    bManual        = true;
+    ullManualUntil = nowMs + FAN_CTRL_OVERRIDE_MS;
+}
+
+/******************************************************************************
+ * 函  数： FanCtrl_Output
+ * 功  能： 读取当前输出
+ * 参  数： 无
+ * 返回值： 千分比, 0=风扇关闭
+ ******************************************************************************/
+uint16_t FanCtrl_Output(void)
+{
+    return usOutput;
+}
+
+/******************************************************************************
+ * 函  数： FanCtrl_IsManual
+ * 功  能： 是否处于手动覆盖
+ * 参  数： 无
+ * 返回值： true=手动
+ ******************************************************************************/
+bool FanCtrl_IsManual(void)
+{
+    return bManual;
+}
+
+/******************************************************************************
+ * 函  数： FanCtrl_LateCount
+ * 功  能： 读取错过控制周期的次数
+ * 参  数： 无
+ * 返回值： 次数
+ ******************************************************************************/
+uint32_t FanCtrl_LateCount(void)
+{
+    return ulLate;
+}
@@ -0,0 +1,50 @@
+#ifndef __FAN_CONTROL_H
+#define __FAN_CONTROL_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  fan_control.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  防霜风扇闭环控制: 以固定周期运行定点PID, 被控量为逆温差(上部温度 - 下部温度);
+ **               逆温差大说明上部有可利用的暖空气, 风扇加大功率向下混合; 混合充分后逆温差减小, 风扇随之降速;
+ **               积分抗饱和(输出饱和时停止同向积分)、输出变化率限制; 云端下发的fan_power作为手动覆盖, 保持一段时间后恢复自动
+ **
+ ** 【使用说明】  1- 上电后调用 FanCtrl_Init(最小输出, 最大输出);
+ **               2- 在main的while中调用 FanCtrl_Task(当前时刻, 是否开启风扇, 传感器是否有效, 上部温度, 下部温度),
+ **                  到达控制周期时计算一次, 返回true; 随后用FanCtrl_Output()设置PWM;
+ **               3- 云端设置fan_power时调用FanCtrl_SetManual(千分比, 当前时刻)
+ **
+ ** 【注意事项】  输出、增益的单位: 输出为千分比(0~1000); 误差为0.01°C; 增益为Q12定点, 即 千分比/0.01°C x 4096
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "system_f103.h"
+#include <stdbool.h>
+
+
+
+/*****************************************************************************
+ ** 移植配置
+****************************************************************************/
+#define FAN_CTRL_PERIOD_MS          1000            // 控制周期(ms), 增益按此周期整定
+#define FAN_CTRL_SETPOINT_CENTI       50            // 目标逆温差 0.50°C: 低于此值认为已混合充分
+#define FAN_CTRL_KP_Q12            12288            // 比例: 逆温差每高出1°C, 输出增加30.0%
+#define FAN_CTRL_KI_Q12              205            // 积分: 每高出1°C持续1分钟, 输出增加约30.0%
+#define FAN_CTRL_KD_Q12                0            // 微分(对测量值): 温度变化慢, 默认不用
+#define FAN_CTRL_SLEW_PERMILLE        50            // 每个周期输出最多变化5.0%
+#define FAN_CTRL_OVERRIDE_MS  (60UL * 60 * 1000)    // 手动覆盖保持60分钟, 之后恢复自动
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+void     FanCtrl_Init(uint16_t minPermille, uint16_t maxPermille);             // 设置开启时的输出范围, 输出为0
+bool     FanCtrl_Task(u64 nowMs, bool enable, bool sensorsValid, int16_t topCenti, int16_t bottomCenti);  // true=本次运行了一个控制周期
+void     FanCtrl_SetManual(uint16_t permille, u64 nowMs);                      // 手动覆盖
+uint16_t FanCtrl_Output(void);                                                  // 当前输出(千分比)
+bool     FanCtrl_IsManual(void);                                                // 是否处于手动覆盖
+uint32_t FanCtrl_LateCount(void);                                               // 错过控制周期的次数(主循环被阻塞)
+
+
+
+#endif
@@ -0,0 +1,183 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  frost_risk.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  本地霜冻风险判断, 使用方法见frost_risk.h
+ **
+ ** 【实现说明】  1- 样本等间隔, 最小二乘斜率只需 n*Σ(k*y) - Σk*Σy 与 n*Σk² - (Σk)² 两个整数之比, 不需要浮点;
+ **               2- 露点按Magnus公式, 用环境温度和湿度计算; 露点高于阈值(加回差)时, 降温到露点附近会因凝结放热而放缓,
+ **                  此时不按直线外推, 只在实际低于阈值时告警;
+ **               3- 告警解除需所有监测点都回升到阈值+FROST_HYST_CENTI以上, 避免在阈值附近反复告警;
+ **               4- 开路的NTC读数停在查找表端点-40°C, 不能当作真实温度: 故障的点不判断, 也不计入回差;
+ **                  样本照常写入窗口, 但该点的连续有效样本数清0, 斜率只用恢复之后的样本计算
+ **
+ ** 【更新记录】
+ **              2026-10-19  增加传感器故障位图, 各监测点分别记录连续有效样本数
+ **
+***********************************************************************************************************************************/
+#include "frost_risk.h"
+#include <math.h>
+#include <string.h>
+
+
+
+/*****************************************************************************
+ ** 本地变量
+ *****************************************************************************/
+static int16_t          sWindow[FROST_POINT_NUM][FROST_WINDOW];    // 各监测点的温度样本
+static uint8_t          ucWindowPos   = 0;         // 下一个样本写入的位置
+static uint8_t          ucSamples[FROST_POINT_NUM]; // 各监测点窗口中最近的连续有效样本数, 传感器故障时清0
+static int32_t          lSlope[FROST_POINT_NUM];   // 各监测点的降温速率(0.01°C/小时)
+static int16_t          sDewPoint     = INT16_MIN; // 露点(0.01°C)
+static u64              ullNextSampleMs = 0;       // 下一次取样本的时刻
+static FrostRisk_State  xState;
+
+
+
+/******************************************************************************
+ * 函  数： FrostRisk_Slope
+ * 功  能： 用窗口中该点最近的连续有效样本计算最小二乘斜率
+ * 参  数： uint8_t point  监测点
+ * 返回值： 斜率(0.01°C/小时)
+ ******************************************************************************/
+static int32_t FrostRisk_Slope(uint8_t point)
+{
+    int64_t n = ucSamples[point];
+    int64_t sumY = 0, sumKY = 0;
+    for (uint8_t k = 0; k < n; k++)                // k=0为最旧的样本
+    {
+        int32_t y = sWindow[point][(ucWindowPos + FROST_WINDOW - n + k) % FROST_WINDOW];
+        sumY  += y;
+        sumKY += (int64_t)k * y;
+    }
+    int64_t sumK  = n * (n - 1) / 2;
+    int64_t sxx   = n * (n * (n - 1) * (2 * n - 1) / 6) - sumK * sumK;
+    int64_t sxy   = n * sumKY - sumK * sumY;
+    if (sxx == 0)
+        return 0;
+    return (int32_t)(sxy * 3600000 / (sxx * FROST_SAMPLE_MS));
+}
+
+/******************************************************************************
+ * 函  数： FrostRisk_DewPoint
+ * 功  能： 按Magnus公式估算露点
+ * 参  数： int16_t tempCenti      环境温度(0.01°C)
+ *          int16_t humidityCenti  相对湿度(0.01%)
+ * 返回值： 露点(0.01°C); 湿度无效时返回INT16_MIN
+ ******************************************************************************/
+static int16_t FrostRisk_DewPoint(int16_t tempCenti, int16_t humidityCenti)
+{
+    if (humidityCenti <= 0 || humidityCenti > 10000)
+        return INT16_MIN;
+
+    float t = tempCenti / 100.0f;
+    float g = logf(humidityCenti / 10000.0f) + 17.62f * t / (243.12f + t);
+    return (int16_t)(243.12f * g / (17.62f - g) * 100.0f);
+}
+
+/******************************************************************************
+ * 函  数： FrostRisk_Init
+ * 功  能： 清空样本窗口, 等级恢复为无风险
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void FrostRisk_Init(void)
+{
+    memset(sWindow, 0, sizeof(sWindow));
+    memset(lSlope, 0, sizeof(lSlope));
+    memset(ucSamples, 0, sizeof(ucSamples));
+    ucWindowPos     = 0;
+    sDewPoint       = INT16_MIN;
+    ullNextSampleMs = 0;
+    memset(&xState, 0, sizeof(xState));
+    xState.minutesToThreshold = -1;
+    xState.dewPointCenti      = INT16_MIN;
+}
+
+/******************************************************************************
+ * 函  数： FrostRisk_Update
+ * 功  能： 用最新的传感器结果重新判断风险等级; 到达采样周期时加入样本窗口, 重新计算降温速率和露点
+ * 参  数： const int16_t tempCenti[]  各监测点温度(0.01°C), 顺序为temp1~temp4、环境温度
+ *          uint8_t faultMask          传感器故障的监测点, bit p = 监测点p; 故障的点不参与判断
+ *          int16_t humidityCenti      相对湿度(0.01%), 无湿度传感器时传0
+ *          u64 nowMs                  当前时刻(ms)
+ * 返回值： true=风险等级发生变化
+ ******************************************************************************/
+bool FrostRisk_Update(const int16_t tempCenti[FROST_POINT_NUM], uint8_t faultMask, int16_t humidityCenti, u64 nowMs)
+{
+    // 1. 采样: 加入窗口, 更新降温速率和露点; 故障的点重新积累样本
+    if (nowMs >= ullNextSampleMs)
+    {
+        ullNextSampleMs = nowMs + FROST_SAMPLE_MS;
+        for (uint8_t p = 0; p < FROST_POINT_NUM; p++)
+        {
+            sWindow[p][ucWindowPos] = tempCenti[p];
+            if (faultMask & (1U << p))
+                ucSamples[p] = 0;
+            else if (ucSamples[p] < FROST_WINDOW)
+                ucSamples[p]++;
+        }
+        ucWindowPos = (ucWindowPos + 1) % FROST_WINDOW;
+
+        for (uint8_t p = 0; p < FROST_POINT_NUM; p++)
+            lSlope[p] = FrostRisk_Slope(p);
+        sDewPoint = (faultMask & (1U << (FROST_POINT_NUM - 1))) ? INT16_MIN
+                  : FrostRisk_DewPoint(tempCenti[FROST_POINT_NUM - 1], humidityCenti);
+    }
+
+    // 2. 逐点判断, 取风险最高的点; 等级相同时取温度最低的点; 故障的点跳过
+    bool dewLimited = (sDewPoint != INT16_MIN) && (sDewPoint > FROST_THRESHOLD_CENTI + FROST_HYST_CENTI);
+    FrostRisk_State next = { FROST_RISK_NONE, 0, INT16_MAX, 0, -1, sDewPoint, faultMask };
+    int16_t coldest = INT16_MAX;
+    for (uint8_t p = 0; p < FROST_POINT_NUM; p++)
+    {
+        int16_t t = tempCenti[p];
+        int32_t minutes = -1;
+        FrostRisk_Level level = FROST_RISK_NONE;
+
+        if (faultMask & (1U << p))
+            continue;
+        if (t < coldest)
+            coldest = t;
+
+        if (t <= FROST_THRESHOLD_CENTI)
+        {
+            minutes = 0;
+            level   = FROST_RISK_ALERT;
+        }
+        else if (ucSamples[p] >= FROST_MIN_SAMPLES && lSlope[p] < 0 && !(dewLimited && sDewPoint < t))
+        {
+            minutes = (int32_t)(t - FROST_THRESHOLD_CENTI) * 60 / -lSlope[p];
+            if (minutes <= FROST_ALERT_MIN)       level = FROST_RISK_ALERT;
+            else if (minutes <= FROST_WATCH_MIN)  level = FROST_RISK_WATCH;
+        }
+
+        if (level > next.level || (level == next.level && t < next.tempCenti))
+        {
+            next.level              = level;
+            next.point              = p;
+            next.tempCenti          = t;
+            next.slopeCentiPerHour  = lSlope[p];
+            next.minutesToThreshold = minutes;
+        }
+    }
+
+    // 3. 回差: 告警中, 只要还有正常的监测点未回升到阈值+回差以上, 保持告警
+    if (xState.level == FROST_RISK_ALERT && next.level != FROST_RISK_ALERT &&
+        coldest <= FROST_THRESHOLD_CENTI + FROST_HYST_CENTI)
+        next.level = FROST_RISK_ALERT;
+
+    bool changed = (next.level != xState.level);
+    xState = next;
+    return changed;
+}
+
+/******************************************************************************
+ * 函  数： FrostRisk_Get
+ * 功  能： 读取最近一次的判断结果
+ * 参  数： 无
+ * 返回值： 判断结果, 只读
+ ******************************************************************************/
+const FrostRisk_State *FrostRisk_Get(void)
+{
+    return &xState;
+}
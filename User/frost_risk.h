@@ -0,0 +1,74 @@
+#ifndef __FROST_RISK_H
+#define __FROST_RISK_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  frost_risk.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  本地霜冻风险判断: 对四个监测点和环境温度分别做滑动窗口最小二乘, 得到降温速率,
+ **               外推到达霜冻阈值的时间; 用环境温度、湿度估算露点, 露点高于阈值时气温会在露点附近停止下降, 不按直线外推;
+ **               不依赖云端, 传感器数据更新后立即判断, 断网时同样有效
+ **
+ ** 【使用说明】  1- 上电后调用FrostRisk_Init();
+ **               2- 每次传感器结果更新后调用 FrostRisk_Update(各点温度, 故障位图, 湿度, 当前时刻), 返回true表示风险等级发生变化;
+ **                  温度低于阈值的判断每次调用都进行; 降温速率每FROST_SAMPLE_MS取一个样本计算;
+ **                  故障位图 bit p = 监测点p的传感器故障(开路、短路, 见SensorFilter_Valid()), 故障的点不参与判断;
+ **               3- FrostRisk_Get() 读取当前等级、最危险的监测点、降温速率、露点、预计到达阈值的分钟数
+ **
+ ** 【注意事项】  温度、湿度均为0.01单位的整数(sensor_filter.h的GetCenti); 露点计算使用一次logf, 每个样本周期只算一次
+ **
+ ** 【更新记录】
+ **              2026-10-19  增加传感器故障位图: 故障的监测点不告警、不外推, 恢复后重新积累样本; 环境温度故障时不计算露点
+ **
+***********************************************************************************************************************************/
+#include "system_f103.h"
+#include <stdbool.h>
+
+
+
+/*****************************************************************************
+ ** 移植配置
+****************************************************************************/
+#define FROST_SAMPLE_MS           15000             // 降温速率的采样周期(ms)
+#define FROST_WINDOW                 40             // 滑动窗口样本数, 40 x 15s = 10分钟
+#define FROST_MIN_SAMPLES             8             // 窗口中至少有8个样本(2分钟)才外推
+#define FROST_THRESHOLD_CENTI         0             // 霜冻阈值(0.01°C)
+#define FROST_HYST_CENTI            100             // 解除告警需回升到阈值以上1.00°C
+#define FROST_WATCH_MIN             120             // 预计120分钟内到达阈值: 关注
+#define FROST_ALERT_MIN              30             // 预计30分钟内到达阈值, 或已低于阈值: 告警
+
+
+
+/*****************************************************************************
+ ** 数据类型
+****************************************************************************/
+#define FROST_POINT_NUM               5             // 监测点数量: temp1~temp4、环境温度
+
+typedef enum
+{
+    FROST_RISK_NONE = 0,                            // 无风险
+    FROST_RISK_WATCH,                               // 关注: 降温趋势将在FROST_WATCH_MIN内到达阈值
+    FROST_RISK_ALERT,                               // 告警: 已低于阈值, 或将在FROST_ALERT_MIN内到达
+} FrostRisk_Level;
+
+typedef struct
+{
+    FrostRisk_Level level;                          // 各监测点中最高的风险等级
+    uint8_t  point;                                 // 最危险的监测点, 0~3=temp1~temp4, 4=环境温度
+    int16_t  tempCenti;                             // 该点当前温度(0.01°C)
+    int32_t  slopeCentiPerHour;                     // 该点降温速率(0.01°C/小时), 负数为降温
+    int32_t  minutesToThreshold;                    // 该点预计到达阈值的分钟数; -1=不会到达(回升、样本不足或受露点限制)
+    int16_t  dewPointCenti;                         // 露点(0.01°C); 湿度无效或环境温度故障时为INT16_MIN
+    uint8_t  faultMask;                             // 传感器故障的监测点, bit p = 监测点p; 这些点不参与判断
+} FrostRisk_State;
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+void  FrostRisk_Init(void);                                                         // 清空窗口, 等级恢复为无风险
+bool  FrostRisk_Update(const int16_t tempCenti[FROST_POINT_NUM], uint8_t faultMask, int16_t humidityCenti, u64 nowMs);  // true=风险等级变化
+const FrostRisk_State *FrostRisk_Get(void);                                        // 读取当前判断结果
+
+
+
+#endif
@@ -6,21 +6,49 @@
 #include "bsp_led.h"
 #include "stdlib.h"
 #include "bsp_usart.h"
+#include "irq_stats.h"
+#include "bsp_MQTT.h"
+#include "msg_pool.h"
+#include "cmd_trace.h"
+#include "bsp_adc.h"
+#include "sensor_filter.h"
+#include "frost_risk.h"
+#include "bsp_pwm.h"
+#include "fan_control.h"
+#include "bsp_actuator.h"
+#include "telemetry_agg.h"
+#include "cbor.h"
+#include "bsp_iwdg.h"
 #include "stdbool.h" // 引入布尔类型头文件
 #include <ctype.h>   // [新增] 包含此头文件以使用 isspace() 函数
 
 // 将 g_cmd_buffer 的大小从 1024 增加到 2048
 static char g_cmd_buffer[4096];
-static char g_json_payload[4096]; 
 static unsigned int g_message_id = 0;
 
 // --- [新增] 定义全局变量来存储从云端下发的状态 ---
 int g_crop_stage = 0;           // 作物生长时期 (默认为0)
 int g_intervention_status = 0;  // 人工干预状态 (默认为0)
+// --- [新增] 本地霜冻风险自动干预 ---
+#define FROST_AUTO_INTERVENTION  1                   // 1=霜冻风险时本地自动开启风扇/加热, 不等待云端; 0=只上报告警
+#define FROST_REALERT_MS         (30UL * 60 * 1000)  // 告警持续期间, 每30分钟重复上报一次
+static int g_frost_auto_status = 0;                  // 本地自动设置的干预状态; 0=当前状态不是本地自动设置的
+// --- [新增] 遥测聚合上报 ---
+#define TELEM_BURST_LEVEL        FROST_RISK_WATCH    // 霜冻风险达到此等级时, 摘要之外再上报最危险监测点的1Hz原始样本
+#define TELEM_REPORT_TOPIC       TOPIC_PROPERTY_POST // [新增] 周期上报使用的主题, 编码由主题决定: TOPIC_PROPERTY_POST=物模型JSON
+                                                     //        (点值走物模型, 统计和原始样本走TOPIC_TELEMETRY_STAT), TOPIC_TELEMETRY_BIN=CBOR
+                                                     //        (约为JSON的1/6, 由平台侧用tools/decode_telemetry.py的格式解码)
+#define TELEM_CBOR_VERSION       1                   // [新增] CBOR遥测格式的版本号, 格式变化时递增
+static uint8_t g_telem_closed = 0;                   // 已结束、尚未处理的聚合窗口, TELEM_WIN_BIT()位图
+static const char* const g_telem_names[TELEM_PROP_NUM] = {
+    "temp1", "temp2", "temp3", "temp4", "ambient_temp", "humidity"
+};
 // --- [新增] 风扇功率控制参数 ---
 #define FAN_MIN_POWER    20  // 最小功率 (%)
 #define FAN_MAX_POWER    80  // 最大功率 (%)
 #define FAN_BASE_POWER   50  // 基础功率 (%)
+#define FAN_TOP_CH       ADC_CH_TEMP1    // [新增] 逆温差的上部温度: 塔顶监测点
+#define FAN_BOTTOM_CH    ADC_CH_TEMP4    // [新增] 逆温差的下部温度: 作物高度的监测点
 
 
 // --- [新增] 定义一个结构体来统一存储所有设备属性的当前状态 ---
@@ -69,7 +97,7 @@ DeviceStatus g_device_status = {
     .fan_power = FAN_BASE_POWER,   // 初始化为50%
     
     // 设备可用性，假设设备启动时硬件均正常连接且可用
-    // 如果您有硬件自检逻辑，可以在自检后更新这些值
+    // [已更新] 运行中由执行器的电流/流量反馈自动更新, 见 Actuator_Control_Task()
     .sprinklers_available = true,
     .fans_available = true,
     .heaters_available = true
@@ -88,6 +116,58 @@ typedef enum {
 // --- 3. 设备的连接鉴权签名 (密码) ---
 #define MQTT_PASSWORD_SIGNATURE "version=2018-10-31&res=products%2F30w1g93kaf%2Fdevices%2FYushuang_Tower_007&et=1790671501&method=md5&sign=F48CON9W%2FTkD6dPXA%2FKxgQ%3D%3D"
 
+// --- 4. [新增] 主题表: 产品ID和设备名称都是编译期常量, 用字符串拼接在编译时展开完整主题, 存放在Flash中 ---
+//        发布和回复按编号引用主题, 长度也在编译时算出, 运行时不再格式化主题
+#define MQTT_TOPIC_PREFIX  "$sys/" MQTT_PRODUCT_ID "/" MQTT_DEVICE_NAME "/"
+#define MQTT_TOPIC(suffix) MQTT_TOPIC_PREFIX suffix
+// [新增] CBOR遥测的自定义主题, 须与平台上为本产品配置的自定义Topic(数据透传)一致
+#define MQTT_TELEM_BIN_SUFFIX "custome/up/telemetry"
+// [新增] 遥测统计(最小、最大、平均)和原始样本的自定义主题(JSON透传); 物模型中没有这些标识符, 不能放入 thing/property/post
+#define MQTT_TELEM_STAT_SUFFIX "custome/up/telemetry_stat"
+
+typedef enum {
+    TOPIC_PROPERTY_POST = 0,        // 属性上报
+    TOPIC_EVENT_POST,               // 事件上报
+    TOPIC_DESIRED_GET,              // 获取期望属性
+    TOPIC_PROPERTY_SET_REPLY,       // 属性设置的回复
+    TOPIC_PROPERTY_GET_REPLY,       // 属性获取的回复
+    TOPIC_TELEMETRY_BIN,            // [新增] CBOR遥测 (自定义主题, 透传)
+    TOPIC_TELEMETRY_STAT,           // [新增] 遥测统计和原始样本 (自定义主题, JSON透传)
+    TOPIC_CMD_REQUEST,              // 订阅: 命令下发
+    TOPIC_PROPERTY_SET,             // 订阅: 属性设置
+    TOPIC_SERVICE_INVOKE,           // 订阅: 服务调用
+    TOPIC_PROPERTY_GET,             // 订阅: 属性获取
+    TOPIC_DESIRED_GET_REPLY,        // 订阅: 获取期望属性的回复
+    TOPIC_NUM
+} TopicId;
+
+#define TOPIC_ENC_JSON  0           // [新增] 负载为JSON文本
+#define TOPIC_ENC_CBOR  1           // [新增] 负载为CBOR二进制, 以指定长度的提示符方式发送
+
+typedef struct {
+    const char* str;
+    uint8_t     len;
+    uint8_t     enc;                // [新增] 负载编码, TOPIC_ENC_xxx
+} TopicEntry;
+
+#define TOPIC_ENTRY(suffix)          { MQTT_TOPIC(suffix), (uint8_t)(sizeof(MQTT_TOPIC(suffix)) - 1), TOPIC_ENC_JSON }
+#define TOPIC_ENTRY_ENC(suffix, enc) { MQTT_TOPIC(suffix), (uint8_t)(sizeof(MQTT_TOPIC(suffix)) - 1), enc }
+
+static const TopicEntry g_topics[TOPIC_NUM] = {
+    [TOPIC_PROPERTY_POST]      = TOPIC_ENTRY("thing/property/post"),
+    [TOPIC_EVENT_POST]         = TOPIC_ENTRY("thing/event/post"),
+    [TOPIC_DESIRED_GET]        = TOPIC_ENTRY("thing/property/desired/get"),
+    [TOPIC_PROPERTY_SET_REPLY] = TOPIC_ENTRY("thing/property/set_reply"),
+    [TOPIC_PROPERTY_GET_REPLY] = TOPIC_ENTRY("thing/property/get_reply"),
+    [TOPIC_TELEMETRY_BIN]      = TOPIC_ENTRY_ENC(MQTT_TELEM_BIN_SUFFIX, TOPIC_ENC_CBOR),
+    [TOPIC_TELEMETRY_STAT]     = TOPIC_ENTRY(MQTT_TELEM_STAT_SUFFIX),
+    [TOPIC_CMD_REQUEST]        = TOPIC_ENTRY("cmd/request/+"),
+    [TOPIC_PROPERTY_SET]       = TOPIC_ENTRY("thing/property/set"),
+    [TOPIC_SERVICE_INVOKE]     = TOPIC_ENTRY("thing/service/+/invoke"),
+    [TOPIC_PROPERTY_GET]       = TOPIC_ENTRY("thing/property/get"),
+    [TOPIC_DESIRED_GET_REPLY]  = TOPIC_ENTRY("thing/property/desired/get/reply"),
+};
+
 
 
 
@@ -99,7 +179,45 @@ typedef enum {
 
 // 将 g_cmd_buffer 的大小从 1024 增加到 2048
 #define CMD_BUFFER_SIZE 4096
-#define JSON_PAYLOAD_SIZE 4096
+// [新增] 命令回复: g_cmd_buffer 的末尾部分存放带服务标识符的回复Topic, 其余存放JSON负载
+#define REPLY_TOPIC_MAX 128
+#define REPLY_JSON_MAX  (CMD_BUFFER_SIZE - REPLY_TOPIC_MAX)
+// [新增] 模组串口参数: 上电默认115200, 连接前按候选列表由高到低尝试提速; 模组不应答时回退
+#define MODEM_BAUD_DEFAULT 115200
+#define MODEM_USE_HW_FLOW  0     // 1=启用RTS/CTS硬件流控 (需PA11/PA12与模组的RTS/CTS相连)
+static const uint32_t g_modem_baud_candidates[] = { 921600, 460800 };
+#define MODEM_BAUD_CANDIDATE_NUM (sizeof(g_modem_baud_candidates) / sizeof(g_modem_baud_candidates[0]))
+// [新增] 连接监督: 断线后按带随机抖动的指数退避重连, 避免大量塔站同时失去信号后在同一时刻重连
+#define CONN_BACKOFF_BASE_MS   2000     // 第一次重连的退避上限
+#define CONN_BACKOFF_MAX_MS    300000   // 退避上限的最大值 (5分钟)
+#define CONN_RESUME_MAX_FAIL   3        // 快速恢复连续失败达到该次数后, 改为完整初始化
+#define MCU_UID_BASE           0x1FFFF7E8   // 96位芯片唯一ID, 用于生成各设备不同的随机数种子
+
+typedef enum
+{
+    CONN_FULL_INIT = 0,     // 需要完整初始化: 同步波特率、SIM卡、GPRS附着、MQTT配置, 然后连接
+    CONN_RESUME,            // 只有MQTT会话断开: 跳过入网步骤, 直接重新打开网络并连接
+    CONN_READY              // 已连接并完成订阅
+} ConnState;
+
+static ConnState g_conn_state       = CONN_FULL_INIT;
+static uint8_t   g_conn_fail_count  = 0;    // 连续失败次数, 决定退避时长
+static u64       g_conn_next_try_ms = 0;    // 下一次尝试连接的时刻
+
+// [新增] 命令-回复时延统计: 从下行消息接收完整, 到回复被模组接受("OK")
+#define CMD_LAT_BUCKET_NUM  6
+static const uint16_t g_cmd_lat_edges[CMD_LAT_BUCKET_NUM - 1] = { 20, 50, 100, 200, 1000 };   // 直方图各档的上限(ms)
+
+typedef struct
+{
+    uint32_t count;                         // 已回复的命令数
+    uint32_t sum_ms;                        // 时延总和, 用于计算平均值
+    uint32_t max_ms;                        // 最大时延
+    uint32_t last_ms;                       // 最近一次的时延
+    uint32_t hist[CMD_LAT_BUCKET_NUM];      // 时延直方图: <20, <50, <100, <200, <1000, >=1000 ms
+} CmdLatencyStats;
+
+static CmdLatencyStats g_cmd_latency;
 
 /*
  ===============================================================================
@@ -116,6 +234,78 @@ static void delay_ms(uint32_t ms)
     System_DelayMS(ms);
 }
 
+/**
+ * @brief  [新增] 从消息缓存池申请一块JSON构建缓存 (MSG_POOL_BLOCK_SIZE字节)
+ * @return char*: 缓存地址; 池空时返回NULL, 并输出错误信息
+ */
+static char* Json_Buffer_Acquire(void)
+{
+    char* buf = MsgPool_Acquire();
+    if (buf == NULL)
+        printf("ERROR: Message pool exhausted, message dropped.\r\n");
+    return buf;
+}
+
+/**
+ * @brief  [新增] 以QoS1向主题表中的主题发布消息
+ * @note   消息进入在途表后立即返回, 服务器确认由 MQTT_Urc_Scan() 异步匹配, 超时由 MQTT_Pub_Poll() 以原msgid重发
+ * @param  id: 主题编号
+ * @param  payload: JSON负载, 从消息缓存池申请的块; 所有权移交给发布流水线
+ * @return bool: true 代表已进入在途表，false 代表在途表已满或负载超过模组限制 (缓存块已释放)
+ */
+static bool MQTT_Publish_Topic(TopicId id, char* payload)
+{
+    return MQTT_Publish_QoS1(g_topics[id].str, g_topics[id].len, payload) != 0;
+}
+
+/**
+ * @brief  [新增] 以QoS1向主题表中的主题发布二进制消息 (CBOR)
+ * @param  id: 主题编号
+ * @param  payload: 从消息缓存池申请的块; 所有权移交给发布流水线
+ * @param  len: 负载字节数
+ * @return bool: true 代表已进入在途表，false 代表在途表已满 (缓存块已释放)
+ */
+static bool MQTT_Publish_Topic_Binary(TopicId id, char* payload, uint16_t len)
+{
+    return MQTT_Publish_QoS1_Binary(g_topics[id].str, g_topics[id].len, payload, len) != 0;
+}
+
+/**
+ * @brief  [新增] 记录一条命令从接收完整到回复被模组接受的时延
+ * @param  rx_ms: 下行消息放入接收队列的时刻
+ * @return uint32_t: 本次时延 (ms)
+ */
+static uint32_t CmdLatency_Record(u64 rx_ms)
+{
+    uint32_t ms = (uint32_t)(System_GetTimeMs() - rx_ms);
+    uint8_t  bucket = 0;
+
+    while (bucket < CMD_LAT_BUCKET_NUM - 1 && ms >= g_cmd_lat_edges[bucket])
+        bucket++;
+    g_cmd_latency.hist[bucket]++;
+    g_cmd_latency.count++;
+    g_cmd_latency.sum_ms += ms;
+    g_cmd_latency.last_ms = ms;
+    if (ms > g_cmd_latency.max_ms)
+        g_cmd_latency.max_ms = ms;
+    return ms;
+}
+
+/**
+ * @brief  [新增] 输出命令-回复时延统计
+ */
+static void CmdLatency_Report(void)
+{
+    const CmdLatencyStats* st = &g_cmd_latency;
+    if (st->count == 0)
+        return;
+    printf("CMDLAT: n=%lu last=%lu avg=%lu max=%lu ms, hist <20:%lu <50:%lu <100:%lu <200:%lu <1000:%lu >=1000:%lu\r\n",
+           (unsigned long)st->count, (unsigned long)st->last_ms, (unsigned long)(st->sum_ms / st->count),
+           (unsigned long)st->max_ms, (unsigned long)st->hist[0], (unsigned long)st->hist[1],
+           (unsigned long)st->hist[2], (unsigned long)st->hist[3], (unsigned long)st->hist[4],
+           (unsigned long)st->hist[5]);
+}
+
 /*
  ===============================================================================
                             公开函数实现
@@ -124,63 +314,95 @@ static void delay_ms(uint32_t ms)
 
 
 /**
- * @brief  [升级版] 发送AT指令并等待响应 (使用SysTick实现精确超时)
- * @param  cmd: 要发送的AT指令字符串。
- * @param  expected_response: 期望在模块的回复中找到的关键字字符串。
- * @param  timeout_ms: 等待响应的超时时间，单位毫秒。
- * @return bool: true 代表成功，false 代表失败。
+ * @brief  [新增] 以当前波特率检测模组是否应答 "AT"，最多尝试3次
+ * @return bool: true 代表模组应答
  */
-bool MQTT_Send_AT_Command(const char* cmd, const char* expected_response, uint32_t timeout_ms)
+static bool Modem_Probe(void)
 {
-    // 步骤1：清空串口接收缓冲区
-    memset(xUSART.USART1ReceivedBuffer, 0, sizeof(xUSART.USART1ReceivedBuffer));
-    xUSART.USART1ReceivedNum = 0;
-
-    // 步骤2：通过串口发送AT指令
-    printf("SEND: %s", cmd);
-    USART1_SendString((char*)cmd);
+    for (int i = 0; i < 3; i++)
+    {
+        if (MQTT_Send_AT_Command("AT\r\n", "OK", 300))
+            return true;
+    }
+    return false;
+}
 
-    // 步骤3：[核心升级] 使用SysTick获取当前时间作为超时判断的起点
-    u64 start_time = System_GetTimeMs();
+/**
+ * @brief  [新增] 找到模组当前使用的波特率，并把USART1切换过去
+ * @note   MCU复位后模组不会复位，可能仍停留在上次切换的高波特率，因此先试默认值，再试各候选值
+ * @return bool: true 代表已与模组同步
+ */
+static bool Modem_Sync_Baudrate(void)
+{
+    UART_SetBaudrate(UART_PORT_1, MODEM_BAUD_DEFAULT);
+    if (Modem_Probe())
+        return true;
 
-    // 步骤4：在超时时间内循环等待
-    while ((System_GetTimeMs() - start_time) < timeout_ms)
+    for (uint32_t i = 0; i < MODEM_BAUD_CANDIDATE_NUM; i++)
     {
-        // 检查串口是否收到了数据
-        if (xUSART.USART1ReceivedNum > 0)
+        UART_SetBaudrate(UART_PORT_1, g_modem_baud_candidates[i]);
+        if (Modem_Probe())
         {
-            xUSART.USART1ReceivedBuffer[xUSART.USART1ReceivedNum] = '\0';
-
-            // 检查收到的数据中是否包含期望的响应
-            if (strstr((char*)xUSART.USART1ReceivedBuffer, expected_response) != NULL)
-            {
-                printf("SUCCESS: Found response '%s'\r\n\r\n", expected_response);
-                return true; // 成功！
-            }
+            printf("INFO: Modem found at %lu baud.\r\n", (unsigned long)g_modem_baud_candidates[i]);
+            return true;
         }
-        
-        // 短暂延时，避免CPU空转，让出CPU给中断等其他任务
-        // 这里的 delay_ms() 已经是我们更新后的精确延时了
-        delay_ms(10); 
     }
 
-    // 如果循环结束，说明已经超过了指定的 timeout_ms
-    printf("FAIL: Timeout. Did not receive '%s' in %lu ms.\r\n\r\n", expected_response, timeout_ms);
-    printf("Last received data: %s\r\n", (char*)xUSART.USART1ReceivedBuffer);
-    return false; // 失败！
+    UART_SetBaudrate(UART_PORT_1, MODEM_BAUD_DEFAULT);
+    return false;
+}
+
+/**
+ * @brief  [新增] 开启硬件流控，并用 AT+IPR 把模组串口提速到候选列表中最高的可用档位
+ * @note   模组先以原波特率回复 "OK"，之后才切换；切换后不应答则重新同步，并尝试下一个档位；
+ *         所有档位都失败时保持原波特率，不影响后续流程
+ */
+static void Modem_Negotiate_Link(void)
+{
+    char cmd[32];
+
+#if MODEM_USE_HW_FLOW
+    if (MQTT_Send_AT_Command("AT+IFC=2,2\r\n", "OK", 500))
+        UART_SetFlowControl(UART_PORT_1, 1);
+#endif
+
+    for (uint32_t i = 0; i < MODEM_BAUD_CANDIDATE_NUM; i++)
+    {
+        uint32_t baud = g_modem_baud_candidates[i];
+        if (UART_GetBaudrate(UART_PORT_1) >= baud)      // 已经在该档位或更高
+            return;
+
+        snprintf(cmd, sizeof(cmd), "AT+IPR=%lu\r\n", (unsigned long)baud);
+        if (!MQTT_Send_AT_Command(cmd, "OK", 500))      // 模组不支持该波特率
+            continue;
+
+        UART_SetBaudrate(UART_PORT_1, baud);
+        delay_ms(20);                                   // 等待模组完成切换
+        if (Modem_Probe())
+        {
+            printf("INFO: Modem link switched to %lu baud.\r\n", (unsigned long)baud);
+            return;
+        }
+
+        printf("WARN: No answer at %lu baud, falling back.\r\n", (unsigned long)baud);
+        if (!Modem_Sync_Baudrate())
+            return;
+    }
 }
 
 
 
 /**
- * @brief [改造版] 使用同步发送-确认机制，可靠地初始化模块并连接到MQTT服务器
+ * @brief  [新增] 模组入网: 同步波特率、读取SIM卡、GPRS附着、配置MQTT协议版本
+ * @note   只在上电或网络(PDP)断开后执行; 仅MQTT会话断开时跳过此步骤
  * @return bool: true 代表所有步骤都成功，false 代表有任何一步失败。
  */
-bool Robust_Initialize_And_Connect_MQTT(void)
+static bool Modem_Attach_Network(void)
 {
-    // 1. 检查AT指令是否响应
-    if (!MQTT_Send_AT_Command("AT\r\n", "OK", 500)) 
+    // 1. 检查AT指令是否响应 (模组可能停留在之前切换过的波特率), 然后尝试提高波特率
+    if (!Modem_Sync_Baudrate()) 
         return false;
+    Modem_Negotiate_Link();
     
     // 2. 获取SIM卡信息 (IMSI)
     if (!MQTT_Send_AT_Command("AT+CIMI\r\n", "OK", 1000)) 
@@ -198,6 +420,18 @@ bool Robust_Initialize_And_Connect_MQTT(void)
     if (!MQTT_Send_AT_Command("AT+QMTCFG=\"version\",0,4\r\n", "OK", 1000)) 
         return false;
 
+    return true;
+}
+
+/**
+ * @brief  [新增] 打开MQTT网络并连接Broker
+ * @note   先关闭可能残留的旧会话 (会话未打开时模组回复ERROR, 忽略即可)
+ * @return bool: true 代表连接成功，false 代表失败。
+ */
+static bool MQTT_Open_Session(void)
+{
+    MQTT_Send_AT_Command("AT+QMTCLOSE=0\r\n", "OK", 1000);
+
     // 6. 打开MQTT网络 (连接到OneNET服务器)
     //    注意：网络操作需要更长的超时时间
     sprintf(g_cmd_buffer, "AT+QMTOPEN=0,\"mqtts.heclouds.com\",1883\r\n");
@@ -206,10 +440,20 @@ bool Robust_Initialize_And_Connect_MQTT(void)
 
     // 7. 使用三元组连接MQTT Broker
     //    注意：这是最关键的网络认证步骤，也需要较长超时
-    sprintf(g_cmd_buffer, "AT+QMTCONN=0,\"%s\",\"%s\",\"%s\"\r\n", MQTT_DEVICE_NAME, MQTT_PRODUCT_ID, MQTT_PASSWORD_SIGNATURE);
-    if (!MQTT_Send_AT_Command(g_cmd_buffer, "+QMTCONN: 0,0,0", 5000)) 
+    //    三元组都是编译期常量, 指令在编译时拼接完成 (签名中含有'%', 不能作为格式串使用)
+    if (!MQTT_Send_AT_Command("AT+QMTCONN=0,\"" MQTT_DEVICE_NAME "\",\"" MQTT_PRODUCT_ID "\",\"" MQTT_PASSWORD_SIGNATURE "\"\r\n",
+                              "+QMTCONN: 0,0,0", 5000)) 
         return false; 
-    return true; // 所有步骤都成功了！
+    return true;
+}
+
+/**
+ * @brief [改造版] 使用同步发送-确认机制，可靠地初始化模块并连接到MQTT服务器
+ * @return bool: true 代表所有步骤都成功，false 代表有任何一步失败。
+ */
+bool Robust_Initialize_And_Connect_MQTT(void)
+{
+    return Modem_Attach_Network() && MQTT_Open_Session();
 }
 
 
@@ -221,12 +465,14 @@ bool Robust_Initialize_And_Connect_MQTT(void)
  */
 void MQTT_Post_Frost_Alert_Event(float current_temp)
 {
-    char json_payload[256]; 
+    char* json_payload = Json_Buffer_Acquire();
+    if (json_payload == NULL)
+        return;
     g_message_id++;
 
     // 构建与日志完全一致的 'event post' JSON 负载
     // %.1f 表示将浮点数格式化为保留一位小数
-    sprintf(json_payload, 
+    snprintf(json_payload, MSG_POOL_BLOCK_SIZE,
         "{\"id\":\"%u\",\"version\":\"1.0\",\"params\":{"
         "\"frost_alert\":{\"value\":{\"current_temp\":%.1f}}"
         "}}",
@@ -234,14 +480,8 @@ void MQTT_Post_Frost_Alert_Event(float current_temp)
         current_temp
     );
 
-    // Topic 必须使用 'thing/event/post'
-    sprintf(g_cmd_buffer, "AT+QMTPUB=0,0,0,0,\"$sys/%s/%s/thing/event/post\",\"%s\"\r\n",
-            MQTT_PRODUCT_ID, 
-            MQTT_DEVICE_NAME,
-            json_payload);
-
-    USART1_SendString(g_cmd_buffer);
-    delay_ms(1000);
+    // Topic 必须使用 'thing/event/post'; 告警以QoS1发布, 未被服务器确认时自动重发
+    MQTT_Publish_Topic(TOPIC_EVENT_POST, json_payload);
 }
 
 
@@ -251,28 +491,24 @@ void MQTT_Post_Frost_Alert_Event(float current_temp)
  * @note  此函数仅负责发送“获取请求”。云平台的结果会通过一条新的 +QMTRECV 消息返回，
  *        其 Topic 为 "$sys/.../thing/property/desired/get/reply"。
  *        您需要在 Process_MQTT_Message 函数中添加对这个 reply 主题的处理逻辑。
+ * @note  [已更新] 改为经QoS1发布流水线发送, 立即返回; 不再发送后固定等待1秒
  */
  
 void MQTT_Get_Desired_Crop_Stage(void)
 {
-    char json_payload[256]; 
+    char* json_payload = Json_Buffer_Acquire();
+    if (json_payload == NULL) return;
     g_message_id++;
 
     // 构建与日志完全一致的 'desired/get' JSON 负载
     // params 是一个只包含字符串 "crop_stage" 的数组
-    sprintf(json_payload, 
+    snprintf(json_payload, MSG_POOL_BLOCK_SIZE,
         "{\"id\":\"%u\",\"version\":\"1.0\",\"params\":[\"crop_stage\"]}",
         g_message_id
     );
 
     // Topic 必须使用 'thing/property/desired/get'
-    sprintf(g_cmd_buffer, "AT+QMTPUB=0,0,0,0,\"$sys/%s/%s/thing/property/desired/get\",\"%s\"\r\n",
-            MQTT_PRODUCT_ID, 
-            MQTT_DEVICE_NAME,
-            json_payload);
-
-    USART1_SendString(g_cmd_buffer);
-    delay_ms(1000);
+    MQTT_Publish_Topic(TOPIC_DESIRED_GET, json_payload);
 }
 
 
@@ -283,12 +519,8 @@ void MQTT_Get_Desired_Crop_Stage(void)
 bool MQTT_Subscribe_Command_Topic(void)
 {
     // 目标Topic: $sys/{product_id}/{device_name}/cmd/request/+
-    sprintf(g_cmd_buffer, "AT+QMTSUB=0,1,\"$sys/%s/%s/cmd/request/+\",1\r\n", 
-            MQTT_PRODUCT_ID, 
-            MQTT_DEVICE_NAME);
-            
     // 发送指令并等待模块返回 "+QMTSUB: 0,1,0" 表示成功
-    return MQTT_Send_AT_Command(g_cmd_buffer, "+QMTSUB: 0,1,0", 3000);
+    return MQTT_Send_AT_Command("AT+QMTSUB=0,1,\"" MQTT_TOPIC("cmd/request/+") "\",1\r\n", "+QMTSUB: 0,1,0", 3000);
 }
 
 
@@ -299,11 +531,8 @@ bool MQTT_Subscribe_Command_Topic(void)
 bool MQTT_Subscribe_Property_Set_Topic(void)
 {
     // Topic: $sys/{product_id}/{device_name}/thing/property/set
-    sprintf(g_cmd_buffer, "AT+QMTSUB=0,1,\"$sys/%s/%s/thing/property/set\",1\r\n", 
-            MQTT_PRODUCT_ID, MQTT_DEVICE_NAME);
-
     // 发送指令并等待模块返回 "+QMTSUB: 0,1,0" 表示成功
-    return MQTT_Send_AT_Command(g_cmd_buffer, "+QMTSUB: 0,1,0", 3000);
+    return MQTT_Send_AT_Command("AT+QMTSUB=0,1,\"" MQTT_TOPIC("thing/property/set") "\",1\r\n", "+QMTSUB: 0,1,0", 3000);
 }
 
 /**
@@ -316,11 +545,8 @@ bool MQTT_Subscribe_Service_Invoke_Topic(void)
 {
     // 这个 '+' 通配符至关重要，它能匹配到云平台下发的所有具体服务
     // 例如 set_intervention, start_sprinkler 等。
-    sprintf(g_cmd_buffer, "AT+QMTSUB=0,1,\"$sys/%s/%s/thing/service/+/invoke\",1\r\n", 
-            MQTT_PRODUCT_ID, MQTT_DEVICE_NAME);
-
     // 发送指令并等待模块返回 "+QMTSUB: 0,1,0" 表示成功
-    return MQTT_Send_AT_Command(g_cmd_buffer, "+QMTSUB: 0,1,0", 3000);
+    return MQTT_Send_AT_Command("AT+QMTSUB=0,1,\"" MQTT_TOPIC("thing/service/+/invoke") "\",1\r\n", "+QMTSUB: 0,1,0", 3000);
 }
 
 /**
@@ -330,11 +556,8 @@ bool MQTT_Subscribe_Service_Invoke_Topic(void)
 bool MQTT_Subscribe_Property_Get_Topic(void)
 {
     // Topic: $sys/{product_id}/{device_name}/thing/property/get
-    sprintf(g_cmd_buffer, "AT+QMTSUB=0,1,\"$sys/%s/%s/thing/property/get\",1\r\n", 
-            MQTT_PRODUCT_ID, MQTT_DEVICE_NAME);
-
     // 发送指令并等待模块返回 "+QMTSUB: 0,1,0" 表示成功
-    return MQTT_Send_AT_Command(g_cmd_buffer, "+QMTSUB: 0,1,0", 3000);
+    return MQTT_Send_AT_Command("AT+QMTSUB=0,1,\"" MQTT_TOPIC("thing/property/get") "\",1\r\n", "+QMTSUB: 0,1,0", 3000);
 }
 
 
@@ -347,22 +570,39 @@ bool MQTT_Subscribe_Property_Get_Topic(void)
  bool MQTT_Subscribe_Desired_Property_Get_Reply_Topic(void)
  {
      // 回复主题的官方格式为: $sys/{product_id}/{device_name}/thing/property/desired/get/reply
-     sprintf(g_cmd_buffer, "AT+QMTSUB=0,1,\"$sys/%s/%s/thing/property/desired/get/reply\",1\r\n",
-             MQTT_PRODUCT_ID, MQTT_DEVICE_NAME);
- 
      // 发送指令并等待模块返回 "+QMTSUB: 0,1,0" 表示成功
-     return MQTT_Send_AT_Command(g_cmd_buffer, "+QMTSUB: 0,1,0", 3000);
+     return MQTT_Send_AT_Command("AT+QMTSUB=0,1,\"" MQTT_TOPIC("thing/property/desired/get/reply") "\",1\r\n", "+QMTSUB: 0,1,0", 3000);
  }
 
 
 /**
  * @brief [健壮版] 一次性订阅所有需要接收消息的主题，并检查每一步的结果
+ * @note  [已更新] 先用一条 AT+QMTSUB 批量订阅全部主题 (一次往返)，并检查每个主题的授予QoS;
+ *        模组不支持多主题订阅时，回退为逐个订阅
  * @return bool: true 代表所有主题都订阅成功, false 代表有任何一个失败
  */
 bool MQTT_Subscribe_All_Topics(void)
 {
+    // 订阅主题在主题表中连续排列: 命令下发、属性设置、服务调用、属性获取、获取期望属性的回复(实现同步的关键)
+    const uint8_t num = TOPIC_NUM - TOPIC_CMD_REQUEST;
+    const char* topics[TOPIC_NUM - TOPIC_CMD_REQUEST];
+    uint8_t granted[TOPIC_NUM - TOPIC_CMD_REQUEST];
+
     printf("INFO: Subscribing to all topics...\r\n");
 
+    for (uint8_t i = 0; i < num; i++)
+        topics[i] = g_topics[TOPIC_CMD_REQUEST + i].str;
+    memset(granted, 128, sizeof(granted));      // 128 = 未授予
+
+    if (MQTT_Subscribe_Batch(topics, num, 1, granted, 5000))
+    {
+        printf("INFO: All topics subscribed successfully.\r\n\r\n");
+        return true;
+    }
+    for (uint8_t i = 0; i < num; i++)
+        printf("INFO:   %s granted=%u\r\n", topics[i], granted[i]);
+    printf("WARN: Batch subscribe failed, subscribing one by one.\r\n");
+
     if (!MQTT_Subscribe_Command_Topic()) {
         printf("ERROR: Failed to subscribe to Command Topic.\r\n");
         return false;
@@ -396,103 +636,56 @@ bool MQTT_Subscribe_All_Topics(void)
 
 
 
-/**
- * @brief [新增][最可靠的] 使用“数据模式”发送MQTT消息
- * @param topic:   要发布到的主题
- * @param payload: 要发送的JSON负载 (注意：是干净的JSON，不带C语言转义符)
- * @return bool:   true 代表发布成功, false 代表失败
- * @note   此函数使用 AT+QMTPUB 的“提示符”模式，先发送指令头，等待模块返回">"，
- *         然后再发送数据负载。这是发送较长或包含特殊字符数据的最稳定方法。
- */
-bool MQTT_Publish_Message_Prompt_Mode(const char* topic, const char* payload)
-{
-    // 1. 计算负载的长度
-    size_t payload_len = strlen(payload);
-
-    // 2. 构建第一部分AT指令，包含主题和数据长度
-    snprintf(g_cmd_buffer, CMD_BUFFER_SIZE, "AT+QMTPUB=0,0,0,0,\"%s\",%u\r\n", topic, payload_len);
-
-    // 3. 发送指令头，并等待模块返回数据输入提示符 ">"
-    //    这是一个关键的握手步骤。我们给它1秒的超时时间。
-    if (!MQTT_Send_AT_Command(g_cmd_buffer, ">", 1000))
-    {
-        printf("ERROR: Did not receive prompt '>' from module for publishing.\r\n");
-        return false;
-    }
-
-    // 4. 成功收到了 ">"，现在直接发送原始的 payload 数据
-    //    注意：这里我们不再使用 MQTT_Send_AT_Command，因为我们不需要等待特定的回复，
-    //    而是要等待最终的发布确认 "+QMTPUB: 0,0,0"。
-    printf("SEND_PAYLOAD: %s\r\n", payload);
-    USART1_SendString((char*)payload);
-
-    // 5. 发送完数据后，模块会进行网络操作，并最终返回发布结果。
-    //    我们等待 "+QMTPUB: 0,0,0" 作为成功的标志。网络操作需要更长的时间。
-    if (!MQTT_Send_AT_Command("\r\n", "+QMTPUB: 0,0,0", 5000)) // 发送一个换行符触发模块响应
-    {
-        printf("ERROR: Did not receive publish confirmation after sending payload.\r\n");
-        return false;
-    }
-
-    printf("INFO: Message on topic '%s' published successfully using prompt mode.\r\n", topic);
-    return true;
-}
-
-
-
-
-
-
-
 /**
  * @brief [最终修正版 V5 - 遵从官方文档] 根据回复类型生成不同的JSON
  * @note  为服务调用回复添加了必须的 "data" 字段，以避免超时。
+ * @note  [已更新] request_id、identifier 是指向下行帧的片段, 回复直接格式化到 g_cmd_buffer, 不再经过中间缓存
+ * @note  [已更新] g_cmd_buffer 中只构建JSON负载, 由 MQTT_Publish_QoS0() 选择内联/提示符方式并转义, 不再在负载中直接嵌入引号
  */
-bool MQTT_Send_Reply(const char* request_id, ReplyType reply_type, const char* identifier, int code, const char* msg)
+bool MQTT_Send_Reply(MQTT_Slice request_id, ReplyType reply_type, MQTT_Slice identifier, int code, const char* msg)
 {
-    char reply_topic[128];
-    char clean_json_payload[256];
-
-    // 根据回复类型，智能构建JSON
-    if (reply_type == REPLY_TO_PROPERTY_SET) {
-        // 属性设置的回复，【不带】data字段
-        snprintf(clean_json_payload, sizeof(clean_json_payload),
-                 "{\"id\":\"%s\",\"code\":%d,\"msg\":\"%s\"}",
-                 request_id, code, (code == 200) ? "success" : msg);
-    } else { // 适用于 REPLY_TO_SERVICE_INVOKE
-        // 服务调用的回复，【带有】空的data字段，严格遵循文档规范
-        snprintf(clean_json_payload, sizeof(clean_json_payload),
-                 "{\"id\":\"%s\",\"code\":%d,\"msg\":\"%s\",\"data\":{}}",
-                 request_id, code, (code == 200) ? "success" : msg);
-    }
+    const char* reply_msg = (code == 200) ? "success" : msg;
+    const char* topic;
+    int topic_len;
+    int len;
 
-    // --- Topic构建部分 ---
+    // 根据回复类型，构建Topic和JSON
     switch (reply_type)
     {
         case REPLY_TO_PROPERTY_SET:
-            snprintf(reply_topic, sizeof(reply_topic),
-                     "$sys/%s/%s/thing/property/set_reply",
-                     MQTT_PRODUCT_ID, MQTT_DEVICE_NAME);
+            // 属性设置的回复，【不带】data字段
+            topic = g_topics[TOPIC_PROPERTY_SET_REPLY].str;
+            topic_len = g_topics[TOPIC_PROPERTY_SET_REPLY].len;
+            len = snprintf(g_cmd_buffer, CMD_BUFFER_SIZE, "{\"id\":\"%.*s\",\"code\":%d,\"msg\":\"%s\"}",
+                           MQTT_SLICE_ARG(request_id), code, reply_msg);
             break;
         case REPLY_TO_SERVICE_INVOKE:
-            if (identifier == NULL || identifier[0] == '\0') {
+            if (identifier.len == 0) {
                 return false;
             }
-            // 动态构建包含 identifier 的回复Topic，与文档一致
-            snprintf(reply_topic, sizeof(reply_topic),
-                     "$sys/%s/%s/thing/service/%s/invoke_reply",
-                     MQTT_PRODUCT_ID, MQTT_DEVICE_NAME, identifier);
+            // 服务调用的回复，Topic包含 identifier，JSON【带有】空的data字段，严格遵循文档规范
+            // Topic格式化到 g_cmd_buffer 末尾的 REPLY_TOPIC_MAX 字节, JSON使用前面的部分, 不占用栈
+            topic = g_cmd_buffer + REPLY_JSON_MAX;
+            topic_len = snprintf(g_cmd_buffer + REPLY_JSON_MAX, REPLY_TOPIC_MAX,
+                                 MQTT_TOPIC("thing/service/%.*s/invoke_reply"), MQTT_SLICE_ARG(identifier));
+            if (topic_len < 0 || topic_len >= REPLY_TOPIC_MAX) {
+                printf("ERROR: Service reply topic too long.\r\n");
+                return false;
+            }
+            len = snprintf(g_cmd_buffer, REPLY_JSON_MAX,
+                           "{\"id\":\"%.*s\",\"code\":%d,\"msg\":\"%s\",\"data\":{}}",
+                           MQTT_SLICE_ARG(request_id), code, reply_msg);
             break;
         default:
             return false;
     }
 
-    // --- AT指令发送部分 ---
-    snprintf(g_cmd_buffer, CMD_BUFFER_SIZE, 
-             "AT+QMTPUB=0,0,0,0,\"%s\",\"%s\"\r\n",
-             reply_topic, clean_json_payload);
-
-    return MQTT_Send_AT_Command(g_cmd_buffer, "OK", 5000);
+    if (len < 0 || len >= REPLY_JSON_MAX) {
+        printf("ERROR: Reply does not fit in the command buffer.\r\n");
+        return false;
+    }
+    CmdTrace_Mark(CMD_TRACE_REPLY_QUEUED);
+    return MQTT_Publish_QoS0(topic, (uint8_t)topic_len, g_cmd_buffer, 5000);
 }
 
 
@@ -502,43 +695,47 @@ bool MQTT_Send_Reply(const char* request_id, ReplyType reply_type, const char* i
 
 /**
  * @brief [优化后] 回复云端的“属性获取”请求
- * @param request_id 从请求中解析出的消息ID
- * @param params_str 从请求中解析出的 params 数组部分的字符串
+ * @param request_id 从请求中解析出的消息ID (指向下行帧的片段)
+ * @param params     请求中 params 数组部分 (指向下行帧的片段)
  * @return bool: true 代表回复发送成功, false 代表失败
  * @note  此函数安全地动态构建 data JSON 对象，防止缓冲区溢出。
+ * @note  [已更新] 整条AT指令直接在 g_cmd_buffer 中构建, 不再先构建data、再拼接完整JSON、最后拼接AT指令
+ * @note  [已更新] g_cmd_buffer 中只构建JSON负载, 发送方式和转义由 MQTT_Publish_QoS0() 处理
  */
-bool MQTT_Reply_To_Property_Get_Refactored(const char* request_id, const char* params_str)
+bool MQTT_Reply_To_Property_Get_Refactored(MQTT_Slice request_id, MQTT_Slice params)
 {
-    char data_payload[4096] = {0};
-    char final_json[2048] = {0};
-    char reply_topic[256] = {0};
+    // 结尾: data对象和回复对象的 '}'; 构建过程中为它预留空间
+    #define REPLY_GET_TAIL "}}"
 
     // --- 核心逻辑: 安全、高效地动态构建 data 对象 ---
-    char* p = data_payload;
-    size_t remaining_len = sizeof(data_payload);
+    char* p = g_cmd_buffer;
+    size_t remaining_len = CMD_BUFFER_SIZE - (sizeof(REPLY_GET_TAIL) - 1);
     int written_len = 0;
     bool first_item_added = false; // 用于控制逗号
 
-    // 写入起始的 '{'
-    written_len = snprintf(p, remaining_len, "{");
-    p += written_len;
-    remaining_len -= written_len;
-
     // 宏定义一个帮助函数，减少重复代码
     // __VA_ARGS__ 用于处理可变参数，比如 g_device_status.ambient_temp
+    // [已更新] snprintf 被截断时返回值大于剩余空间, 此时把剩余空间记为1, 避免 remaining_len 下溢
+    #define ADVANCE(n) \
+        if ((size_t)(n) >= remaining_len) { p += remaining_len - 1; remaining_len = 1; } \
+        else { p += (n); remaining_len -= (n); }
     #define ADD_PROPERTY(param_name, format, ...) \
-    if (remaining_len > 1 && strstr(params_str, "\"" param_name "\"") != NULL) { \
+    if (remaining_len > 1 && MQTT_Slice_Find(params, "\"" param_name "\"") != NULL) { \
         if (first_item_added) { \
             written_len = snprintf(p, remaining_len, ","); \
-            p += written_len; \
-            remaining_len -= written_len; \
+            ADVANCE(written_len); \
         } \
         written_len = snprintf(p, remaining_len, "\"" param_name "\":" format, __VA_ARGS__); \
-        p += written_len; \
-        remaining_len -= written_len; \
+        ADVANCE(written_len); \
         first_item_added = true; \
     }
 
+    // 回复对象的开头
+    written_len = snprintf(p, remaining_len,
+                           "{\"id\":\"%.*s\",\"code\":200,\"msg\":\"success\",\"data\":{",
+                           MQTT_SLICE_ARG(request_id));
+    ADVANCE(written_len);
+
     // 使用宏来添加各个属性
     ADD_PROPERTY("ambient_temp", "%.1f", g_device_status.ambient_temp);
     ADD_PROPERTY("humidity", "%.1f", g_device_status.humidity);
@@ -554,36 +751,20 @@ bool MQTT_Reply_To_Property_Get_Refactored(const char* request_id, const char* p
     ADD_PROPERTY("heaters_available", "%s", g_device_status.heaters_available ? "true" : "false");
     ADD_PROPERTY("intervention_status", "%d", g_device_status.intervention_status);
     ADD_PROPERTY("fan_power", "%d", g_device_status.fan_power);
+    #undef ADD_PROPERTY
+    #undef ADVANCE
 
-    // 检查缓冲区是否足够添加最后的 '}'
-    if (remaining_len > 1) {
-        snprintf(p, remaining_len, "}");
-    } else {
-        // 缓冲区已满，可能无法添加 '}'，这是一个错误情况
-        // 可以在这里添加日志或错误处理
-        // 为确保JSON格式正确，强制在末尾添加 '}'
-        data_payload[sizeof(data_payload) - 2] = '}';
-        data_payload[sizeof(data_payload) - 1] = '\0';
+    // 缓冲区被写满说明某个属性已被截断, JSON不完整, 不能发送
+    if (remaining_len <= 1) {
+        printf("ERROR: Property get reply does not fit in the command buffer.\r\n");
+        return false;
     }
+    memcpy(p, REPLY_GET_TAIL, sizeof(REPLY_GET_TAIL));
+    #undef REPLY_GET_TAIL
 
-    // --- 构建完整的回复JSON ---
-    snprintf(final_json, sizeof(final_json),
-        "{\"id\":\"%s\",\"code\":200,\"msg\":\"success\",\"data\":%s}",
-        request_id,
-        data_payload);
-
-    // --- 构建回复Topic ---
-    snprintf(reply_topic, sizeof(reply_topic),
-        "$sys/%s/%s/thing/property/get_reply",
-        MQTT_PRODUCT_ID, MQTT_DEVICE_NAME);
-
-    // --- 构建并发送AT指令 ---
-    snprintf(g_cmd_buffer, CMD_BUFFER_SIZE,
-             "AT+QMTPUB=0,0,0,0,\"%s\",\"%s\"\r\n",
-             reply_topic, final_json);
-
-    return MQTT_Send_AT_Command(g_cmd_buffer, "OK", 5000);
-
+    CmdTrace_Mark(CMD_TRACE_REPLY_QUEUED);
+    return MQTT_Publish_QoS0(g_topics[TOPIC_PROPERTY_GET_REPLY].str, g_topics[TOPIC_PROPERTY_GET_REPLY].len,
+                             g_cmd_buffer, 5000);
 }
 
 
@@ -593,105 +774,143 @@ bool MQTT_Reply_To_Property_Get_Refactored(const char* request_id, const char* p
 
 
 
-int find_and_parse_json_string(const char* buffer, const char* key, char* result, int max_len)
+/**
+ * @brief [新增] 在JSON片段中查找键, 返回其值的起始位置
+ * @param json:   JSON片段 (指向下行帧, 不以'\0'结尾)
+ * @param key:    要查找的JSON键名 (不带引号)
+ * @return const char*: 值的第一个字符(已跳过冒号和空格); 没找到返回NULL
+ * @note   直接在片段中比较键名, 不再用 snprintf 构造带引号的搜索串;
+ *         要求键名前后都是引号, 因此 "id" 不会误匹配 "request_id" 之类的键
+ */
+static const char* find_json_value(MQTT_Slice json, const char* key)
 {
-    char search_key[64];
-    snprintf(search_key, sizeof(search_key), "\"%s\":", key);
+    const char* end = json.ptr + json.len;
+    size_t key_len = strlen(key);
+    MQTT_Slice rest = json;
+    const char* p_key;
+
+    while ((p_key = MQTT_Slice_Find(rest, key)) != NULL)
+    {
+        const char* p_val = p_key + key_len;
+        rest.ptr = p_val;
+        rest.len = (uint16_t)(end - p_val);
 
-    char* p_key = strstr(buffer, search_key);
-    if (p_key == NULL) return 0;
+        if (p_key == json.ptr || p_key[-1] != '\"' || p_val >= end || *p_val != '\"') continue;
+        p_val++;
+        while (p_val < end && isspace((unsigned char)*p_val)) p_val++;
+        if (p_val >= end || *p_val != ':') continue;
+        p_val++;
+        while (p_val < end && isspace((unsigned char)*p_val)) p_val++;
+        return p_val;
+    }
+    return NULL;
+}
 
-    char* p_val_start = p_key + strlen(search_key);
 
-    while (*p_val_start && isspace((unsigned char)*p_val_start)) p_val_start++;
-    if (*p_val_start != '\"') return 0;
+/**
+ * @brief 从一个JSON片段中查找指定的键(key)，并解析其对应的字符串值。
+ * @param json:   JSON片段
+ * @param key:    要查找的JSON键名。
+ * @param result: 如果解析成功，存放指向原缓存中字符串值(不含引号)的片段。
+ * @return int:   如果成功找到并解析了字符串，返回1；否则返回0。
+ * @note   [已更新] 结果是片段, 不复制, 也不会因目标缓存太小而被截断
+ */
+int find_and_parse_json_string(MQTT_Slice json, const char* key, MQTT_Slice* result)
+{
+    const char* end = json.ptr + json.len;
+    const char* p_val_start = find_json_value(json, key);
+    if (p_val_start == NULL || p_val_start >= end || *p_val_start != '\"') return 0;
     p_val_start++;
 
-    char* p_val_end = strchr(p_val_start, '\"');
+    const char* p_val_end = memchr(p_val_start, '\"', end - p_val_start);
     if (p_val_end == NULL) return 0;
 
-    int val_len = p_val_end - p_val_start;
-    if (val_len >= max_len) val_len = max_len - 1;
-
-    memcpy(result, p_val_start, val_len);
-    result[val_len] = '\0';
-
+    result->ptr = p_val_start;
+    result->len = (uint16_t)(p_val_end - p_val_start);
     return 1;
 }
 
 
 /**
- * @brief 从一个JSON格式的字符串中查找指定的键(key)，并解析其对应的整数值。
- * @param buffer: 包含JSON内容的字符串。
+ * @brief 从一个JSON片段中查找指定的键(key)，并解析其对应的整数值。
+ * @param json:   JSON片段
  * @param key:    要查找的JSON键名。
  * @param result: 如果解析成功，整数值将被存放在这个指针指向的地址。
  * @return int:   如果成功找到并解析了整数，返回1；否则返回0。
  * @note   这是一个不依赖任何JSON库的安全解析实现。
  *         它能处理键和值周围的空格，并能验证值的合法性。
+ *         片段位于以'\0'结尾的接收缓存中, 且数字之后总有 ',' 或 '}', strtol 不会越过片段
  */
-int find_and_parse_json_int(const char* buffer, const char* key, int* result)
+int find_and_parse_json_int(MQTT_Slice json, const char* key, int* result)
 {
-    char search_key[64];
-    // 1. 构造要搜索的键格式，例如: "crop_stage"
-    snprintf(search_key, sizeof(search_key), "\"%s\"", key);
-
-    // 2. 查找键的位置
-    char* p_key = strstr(buffer, search_key);
-    if (p_key == NULL) {
-        return 0; // 没找到键
+    const char* p_val = find_json_value(json, key);
+    if (p_val == NULL || p_val >= json.ptr + json.len) {
+        return 0; // 没找到键，或者键后面没有值
     }
 
-    // 3. 移动指针到键的末尾
-    char* p_val = p_key + strlen(search_key);
-
-    // 4. 跳过键和冒号之间的所有空格
-    while (*p_val && isspace((unsigned char)*p_val)) {
-        p_val++;
-    }
-
-    // 5. 检查后面是否是冒号
-    if (*p_val != ':') {
-        return 0; // 格式错误，键后面不是冒号
-    }
-    p_val++; // 跳过冒号
-
-    // 6. 使用strtol进行安全的字符串到长整型转换
+    // 使用strtol进行安全的字符串到长整型转换
     char* end_ptr;
     long parsed_value = strtol(p_val, &end_ptr, 10);
 
-    // 7. 验证转换是否成功
+    // 验证转换是否成功
     // 如果p_val和end_ptr指向同一个地址，说明冒号后面第一个字符就不是数字，转换失败。
-    if (p_val == end_ptr) {
+    if (p_val == end_ptr || end_ptr > json.ptr + json.len) {
         return 0; // 转换失败
     }
 
-    // 8. 如果成功，将结果存入result指针
+    // 如果成功，将结果存入result指针
     *result = (int)parsed_value;
     return 1; // 成功
 }
 
 
+/**
+ * @brief [新增] 设置人工干预状态对应的执行器请求, 并记录到全局状态
+ * @param status: 0=全部关闭, 1=仅喷淋, 2=仅风扇, 3=仅加热, 4=风扇和加热; 其它值按全部关闭处理
+ * @note  云端 set_intervention 与本地霜冻自动干预共用
+ * @note  [已更新] 只设置请求, 立即返回; 软启动、喷淋与加热的互锁、反馈检测由主循环中的 Actuator_Control_Task() 执行,
+ *        不在消息解析过程中操作硬件; 风扇的功率由 Fan_Control_Task() 按干预状态请求
+ */
+static void Intervention_Apply(int status)
+{
+    g_intervention_status = status;
+    g_device_status.intervention_status = status;
+    switch (status)
+    {
+        case 0: printf("ACTION: Turning off all systems.\r\n"); break;
+        case 1: printf("ACTION: Activating Sprinklers ONLY.\r\n"); break;
+        case 2: printf("ACTION: Activating Fans ONLY.\r\n"); break;
+        case 3: printf("ACTION: Activating Heaters ONLY.\r\n"); break;
+        case 4: printf("ACTION: Activating Fans AND Heaters.\r\n"); break;
+        default: printf("WARN: Received unknown status %d. Turning off all systems.\r\n", status); break;
+    }
+    Actuator_Request(ACT_SPRINKLER, status == 1 ? 1000 : 0);
+    Actuator_Request(ACT_HEATER, (status == 3 || status == 4) ? 1000 : 0);
+}
+
+
 /**
  * @brief [最终修正版] 统一处理所有从云平台接收到的MQTT消息，并增加回复状态检查
- * @param buffer: 指向串口接收缓冲区的指针
+ * @param frame: 下行帧视图, 主题和负载都是指向接收队列中缓存块的片段
  * @note  此版本对每一次调用 MQTT_Send_Reply 都进行了返回值检查，
  *        并通过日志明确反馈回复指令是否成功发送给了4G模块。
+ * @note  [已更新] Topic按主题片段判断, id、服务标识符、params都是原缓存中的片段, 原样传给回复函数, 不再复制
+ * @note  [已更新] 去掉回复前固定的200ms延时: 回复指令在模组应答"OK"时立即完成, 并记录命令-回复时延
+ * @note  [已更新] 各处理环节调用CmdTrace_Mark()记录时刻, 命令-执行-回复的时延分解由CmdTrace_Export()导出
  */
-void Process_MQTT_Message_Robust(const char* buffer)
+void Process_MQTT_Message_Robust(const MQTT_FrameView* frame)
 {
     // 打印收到的原始消息，这是调试的第一步
-    printf("RECV: %s\r\n", buffer);
+    printf("RECV: topic '%.*s', payload %.*s\r\n", MQTT_SLICE_ARG(frame->topic), MQTT_SLICE_ARG(frame->payload));
 
     // 尝试从消息中解析出 "id"，这是所有回复的凭证
-    char request_id[32] = {0};
-    if (!find_and_parse_json_string(buffer, "id", request_id, sizeof(request_id)))
+    MQTT_Slice request_id;
+    if (!find_and_parse_json_string(frame->payload, "id", &request_id))
     {
         // 如果消息里连 "id" 字段都没有，说明它不是一条需要回复的命令，直接忽略
         printf("DEBUG: Message received, but it has no 'id' field. No reply needed.\r\n");
         return;
     }
-	
-	delay_ms(200); 
 
     // 定义一个布尔变量，用于统一记录回复指令的发送结果
     bool reply_sent_successfully = false;
@@ -699,26 +918,30 @@ void Process_MQTT_Message_Robust(const char* buffer)
     // --- 判断是哪种命令，并处理 ---
 
     // 1. 是不是“属性设置”命令？ (Topic 包含 /thing/property/set)
-    if (strstr(buffer, "/thing/property/set") != NULL)
+    if (MQTT_Slice_Find(frame->topic, "/thing/property/set") != NULL)
     {
+        CmdTrace_Tag("set");
         printf("DEBUG: Received a 'Property Set' command.\r\n");
         int parsed_value;
 
         // 尝试解析 crop_stage 参数
-        if (find_and_parse_json_int(buffer, "crop_stage", &parsed_value))
+        if (find_and_parse_json_int(frame->payload, "crop_stage", &parsed_value))
         {
+            CmdTrace_Mark(CMD_TRACE_PARSED);
 			LED3_TOGGLE;
             g_crop_stage = parsed_value; // 执行命令：更新全局变量
+            CmdTrace_Mark(CMD_TRACE_ACTUATED);
             printf("ACTION: Cloud set 'crop_stage' to %d\r\n", g_crop_stage);
             
             // 尝试发送“成功”的回复，并记录结果
-            reply_sent_successfully = MQTT_Send_Reply(request_id, REPLY_TO_PROPERTY_SET, NULL, 200, "Success");
+            reply_sent_successfully = MQTT_Send_Reply(request_id, REPLY_TO_PROPERTY_SET, MQTT_SLICE_NULL, 200, "Success");
         }
 
         // --- [核心新增] ---
         // 尝试解析 fan_power 参数
-        else if (find_and_parse_json_int(buffer, "fan_power", &parsed_value))
+        else if (find_and_parse_json_int(frame->payload, "fan_power", &parsed_value))
         {
+            CmdTrace_Mark(CMD_TRACE_PARSED);
             LED3_TOGGLE; // 使用LED提示收到指令
             
             // [健壮性设计] 对接收到的值进行范围检查和限制
@@ -730,15 +953,14 @@ void Process_MQTT_Message_Robust(const char* buffer)
                 printf("WARN: Fan power value above maximum, clamped to %d%%\r\n", FAN_MAX_POWER);
             }
 
-            // 执行命令：更新全局变量
+            // 执行命令：更新全局变量; [已更新] 作为手动覆盖交给风扇闭环控制, 保持FAN_CTRL_OVERRIDE_MS后恢复自动
             g_device_status.fan_power = parsed_value; 
+            FanCtrl_SetManual((uint16_t)(parsed_value * 10), System_GetTimeMs());
+            CmdTrace_Mark(CMD_TRACE_ACTUATED);
             printf("ACTION: Cloud set 'fan_power' to %d%%\r\n", g_device_status.fan_power);
-            
-            // 在这里可以添加实际控制风扇PWM输出的代码
-            // 例如: TIM3_SetFanPWM(g_device_status.fan_power);
 
             // 尝试发送“成功”的回复，并记录结果
-            reply_sent_successfully = MQTT_Send_Reply(request_id, REPLY_TO_PROPERTY_SET, NULL, 200, "Success");
+            reply_sent_successfully = MQTT_Send_Reply(request_id, REPLY_TO_PROPERTY_SET, MQTT_SLICE_NULL, 200, "Success");
         }
 
         else
@@ -746,33 +968,22 @@ void Process_MQTT_Message_Robust(const char* buffer)
             // 如果没找到 crop_stage 参数，这是客户端的请求错误
             printf("WARN: 'crop_stage' parameter not found in Property Set command.\r\n");
             // 尝试发送“请求错误”的回复，并记录结果
-            reply_sent_successfully = MQTT_Send_Reply(request_id, REPLY_TO_PROPERTY_SET, NULL, 400, "Bad Request");
+            reply_sent_successfully = MQTT_Send_Reply(request_id, REPLY_TO_PROPERTY_SET, MQTT_SLICE_NULL, 400, "Bad Request");
         }
     }
     // 2. --- [核心修改] --- 是不是“服务调用”命令？
     // 新的判断逻辑：只要同时包含 "/thing/service/" 和 "/invoke"，就认为是服务调用
-    else if (strstr(buffer, "/thing/service/") != NULL && strstr(buffer, "/invoke") != NULL)
+    else if (MQTT_Slice_Find(frame->topic, "/thing/service/") != NULL && MQTT_Slice_Find(frame->topic, "/invoke") != NULL)
     {
+        CmdTrace_Tag("invoke");
         printf("DEBUG: Received a 'Service Invoke' command.\r\n");
-        char method[64] = {0};
 
         // 尝试从 Topic 中提取 method (服务标识符)
-        // 这是一个更稳健的方法，直接从Topic获取服务名
-        const char *p_start = strstr(buffer, "/thing/service/");
-        if (p_start != NULL) {
-            p_start += strlen("/thing/service/"); // 移动指针到服务名开始的位置
-            const char *p_end = strstr(p_start, "/invoke");
-            if (p_end != NULL) {
-                int len = p_end - p_start;
-                if (len < sizeof(method)) {
-                    strncpy(method, p_start, len);
-                    method[len] = '\0';
-                }
-            }
-        }
+        // 这是一个更稳健的方法，直接从Topic获取服务名; [已更新] 得到的是主题中的片段, 不复制
+        MQTT_Slice method = MQTT_Slice_Between(frame->topic, "/thing/service/", "/invoke");
 
         // 判断具体是哪个服务
-        if (strcmp(method, "set_intervention") == 0)
+        if (MQTT_Slice_Equal(method, "set_intervention"))
         {
             printf("DEBUG: Service is 'set_intervention'.\r\n");
             int parsed_status;
@@ -781,28 +992,22 @@ void Process_MQTT_Message_Robust(const char* buffer)
             // 这是因为云平台下发的服务调用参数，键名通常是服务的标识符，而不是 "status"
             // 例如：{"id":"123","method":1} 中的 "method" 才是我们需要的状态值
             // 尝试解析该服务需要的参数，键名从 "status" 改为 "method"
-            if (find_and_parse_json_int(buffer, "method", &parsed_status))
+            if (find_and_parse_json_int(frame->payload, "method", &parsed_status))
             {
+                CmdTrace_Mark(CMD_TRACE_PARSED);
                 // ========================================================
-                // ▼▼▼ 这里的LED控制逻辑保持您之前的版本 ▼▼▼
+                // ▼▼▼ [已更新] 只设置执行器请求, 由主循环中的执行器任务动作 ▼▼▼
                 // ========================================================
-                g_intervention_status = parsed_status; 
-                printf("ACTION: Cloud invoked 'set_intervention' with status %d\r\n", g_intervention_status);
+                printf("ACTION: Cloud invoked 'set_intervention' with status %d\r\n", parsed_status);
 
                 printf("ACTION: Executing hardware control...\r\n");
-                switch (g_intervention_status)
-                {
-                    case 0: printf("ACTION: Turning off all systems.\r\n"); LED1_OFF; LED2_OFF; LED3_OFF; break;
-                    case 1: printf("ACTION: Activating Sprinklers ONLY.\r\n"); LED1_ON; LED2_OFF; LED3_OFF; break;
-                    case 2: printf("ACTION: Activating Fans ONLY.\r\n"); LED1_OFF; LED2_ON; LED3_OFF; break;
-                    case 3: printf("ACTION: Activating Heaters ONLY.\r\n"); LED1_OFF; LED2_OFF; LED3_ON; break;
-                    case 4: printf("ACTION: Activating Fans AND Heaters.\r\n"); LED1_OFF; LED2_ON; LED3_ON; break;
-                    default: printf("WARN: Received unknown status %d. Turning off all systems.\r\n", g_intervention_status); LED1_OFF; LED2_OFF; LED3_OFF; break;
-                }
+                Intervention_Apply(parsed_status);
+                g_frost_auto_status = 0;                // [新增] 云端指令优先, 本地霜冻自动干预不再接管
+                CmdTrace_Mark(CMD_TRACE_ACTUATED);
 
                 reply_sent_successfully = MQTT_Send_Reply(request_id, REPLY_TO_SERVICE_INVOKE, method, 200, "Intervention status updated");
                 // ========================================================
-                // ▲▲▲ 这里的LED控制逻辑保持您之前的版本 ▲▲▲
+                // ▲▲▲ [已更新] 只设置执行器请求, 由主循环中的执行器任务动作 ▲▲▲
                 // ========================================================
             }
             else
@@ -813,24 +1018,27 @@ void Process_MQTT_Message_Robust(const char* buffer)
         }
         else
         {
-            printf("WARN: Received invoke for an unknown or unparsed service: '%s'.\r\n", method);
+            printf("WARN: Received invoke for an unknown or unparsed service: '%.*s'.\r\n", MQTT_SLICE_ARG(method));
             reply_sent_successfully = MQTT_Send_Reply(request_id, REPLY_TO_SERVICE_INVOKE, method, 404, "Service not found");
         }
     }
 
     // 3. --- [新增] 是不是“属性获取”命令？ ---
-    else if (strstr(buffer, "/thing/property/get") != NULL)
+    else if (MQTT_Slice_Find(frame->topic, "/thing/property/get") != NULL)
     {
+        CmdTrace_Tag("get");
         printf("DEBUG: Received a 'Property Get' command.\r\n");
         // 对于“属性获取”命令，我们需要提取 "params" 字段
         // 该字段是一个数组，里面包含了客户端想要获取的属性名
         // "params" 字段是一个数组，我们直接将其作为字符串处理
-        // 我们只需要找到 "params" 的起始位置即可
-        char* params_start = strstr(buffer, "\"params\":");
+        // 我们只需要找到 "params" 的起始位置即可, 从该位置到负载末尾作为片段传给回复函数
+        const char* params_start = MQTT_Slice_Find(frame->payload, "\"params\":");
         if (params_start != NULL)
         {
+            MQTT_Slice params = { params_start, (uint16_t)(frame->payload.len - (params_start - frame->payload.ptr)) };
+            CmdTrace_Mark(CMD_TRACE_PARSED);
             // 调用新的专用回复函数
-            reply_sent_successfully = MQTT_Reply_To_Property_Get_Refactored(request_id, params_start);
+            reply_sent_successfully = MQTT_Reply_To_Property_Get_Refactored(request_id, params);
         }
         else
         {
@@ -841,17 +1049,20 @@ void Process_MQTT_Message_Robust(const char* buffer)
         }
     }
     // 4. --- [新增] 是不是“期望属性获取回复”消息？ ---
-    else if (strstr(buffer, "/thing/property/desired/get/reply") != NULL)
+    else if (MQTT_Slice_Find(frame->topic, "/thing/property/desired/get/reply") != NULL)
     {
+        CmdTrace_Tag("desired");
         printf("DEBUG: Received a 'Desired Property Get Reply'.\r\n");
         int parsed_value;
 
         // 尝试从回复的 data 对象中解析 crop_stage 的值
-        if (find_and_parse_json_int(buffer, "crop_stage", &parsed_value))
+        if (find_and_parse_json_int(frame->payload, "crop_stage", &parsed_value))
         {
             // 解析成功，立即更新本地状态
+            CmdTrace_Mark(CMD_TRACE_PARSED);
             g_crop_stage = parsed_value;
             g_device_status.crop_stage = parsed_value;
+            CmdTrace_Mark(CMD_TRACE_ACTUATED);
             printf("ACTION: Synchronized 'crop_stage' from cloud, new value is %d\r\n\r\n", g_crop_stage);
         }
         else
@@ -873,9 +1084,12 @@ void Process_MQTT_Message_Robust(const char* buffer)
     // --- [统一的最终状态报告] ---
     // 在函数的最后，根据 reply_sent_successfully 的值，打印最终的执行结果日志
     if (reply_sent_successfully) {
-        printf("INFO: Reply for request_id '%s' was successfully sent to the 4G module.\r\n\r\n", request_id);
+        CmdTrace_Mark(CMD_TRACE_REPLY_CONFIRMED);
+        uint32_t latency_ms = CmdLatency_Record(frame->rxMs);
+        printf("INFO: Reply for request_id '%.*s' was successfully sent to the 4G module (%lu ms after receipt).\r\n\r\n",
+               MQTT_SLICE_ARG(request_id), (unsigned long)latency_ms);
     } else {
-        printf("FATAL ERROR: FAILED to send reply for request_id '%s' to the 4G module. The module did not respond with 'OK' within the timeout period. This is the likely cause of the platform timeout!\r\n\r\n", request_id);
+        printf("FATAL ERROR: FAILED to send reply for request_id '%.*s' to the 4G module. The module did not respond with 'OK' within the timeout period. This is the likely cause of the platform timeout!\r\n\r\n", MQTT_SLICE_ARG(request_id));
     }
 }
 
@@ -885,11 +1099,14 @@ void Process_MQTT_Message_Robust(const char* buffer)
  */
 void MQTT_Publish_Only_Temperatures(float temp1, float temp2, float temp3, float temp4)
 {
+    char* json = Json_Buffer_Acquire();
+    if (json == NULL)
+        return;
     // 每次调用都增加消息ID，确保与云端同步
     g_message_id++;
 
     // 1. 构建只包含四个温度属性的 'params' JSON 负载
-    sprintf(g_json_payload, 
+    snprintf(json, MSG_POOL_BLOCK_SIZE,
         "{\"id\":\"%u\",\"version\":\"1.0\",\"params\":{"
         "\"temp1\":{\"value\":%.1f},"
         "\"temp2\":{\"value\":%.1f},"
@@ -900,18 +1117,8 @@ void MQTT_Publish_Only_Temperatures(float temp1, float temp2, float temp3, float
         temp1, temp2, temp3, temp4
     );
 
-    // 2. 构建 AT+QMTPUB 指令，Topic 保持不变
-    //    "$sys/{product_id}/{device_name}/thing/property/post"
-    sprintf(g_cmd_buffer, "AT+QMTPUB=0,0,0,0,\"$sys/%s/%s/thing/property/post\",\"%s\"\r\n",
-            MQTT_PRODUCT_ID, 
-            MQTT_DEVICE_NAME,
-            g_json_payload);
-
-    // 3. 通过串口发送指令
-    USART1_SendString(g_cmd_buffer);
-
-    // 4. 等待模块处理和发送
-    delay_ms(1000); // 因为报文变短了，延时可以适当缩短
+    // 2. 以QoS1发布, 缓存块随之交给发布流水线, 本函数不再使用
+    MQTT_Publish_Topic(TOPIC_PROPERTY_POST, json);
 }
 
 
@@ -923,12 +1130,15 @@ void MQTT_Publish_Only_Temperatures(float temp1, float temp2, float temp3, float
  */
 void MQTT_Publish_Environment_Data(float ambient_temp, float humidity, float pressure, float wind_speed)
 {
+    char* json = Json_Buffer_Acquire();
+    if (json == NULL)
+        return;
     // 每次调用都增加消息ID
     g_message_id++;
 
     // 1. 构建只包含四个环境属性的 'params' JSON 负载
     //    严格按照要求，仅使用 \" 进行转义
-    snprintf(g_json_payload, JSON_PAYLOAD_SIZE, 
+    snprintf(json, MSG_POOL_BLOCK_SIZE,
         "{\"id\":\"%u\",\"version\":\"1.0\",\"params\":{"
         "\"ambient_temp\":{\"value\":%.1f},"
         "\"humidity\":{\"value\":%.1f},"
@@ -939,21 +1149,210 @@ void MQTT_Publish_Environment_Data(float ambient_temp, float humidity, float pre
         ambient_temp, humidity, pressure, wind_speed
     );
 
-    // 2. 构建 AT+QMTPUB 指令
-    snprintf(g_cmd_buffer, CMD_BUFFER_SIZE, 
-            "AT+QMTPUB=0,0,0,0,\"$sys/%s/%s/thing/property/post\",\"%s\"\r\n",
-            MQTT_PRODUCT_ID, 
-            MQTT_DEVICE_NAME,
-            g_json_payload);
+    // 2. 以QoS1发布, 缓存块随之交给发布流水线, 本函数不再使用
+    MQTT_Publish_Topic(TOPIC_PROPERTY_POST, json);
+}
+
+
+
+/**
+ * @brief [新增] 以物模型上报各属性在上报窗口内的最后一个样本
+ * @note  [已更新] 只使用物模型中已有的标识符(temp1~4、ambient_temp、humidity), 含义与原来的点值相同;
+ *        统计摘要和原始样本改由 TOPIC_TELEMETRY_STAT 上报, 物模型校验不会因新增的标识符拒绝整条点值消息
+ */
+static void MQTT_Publish_Telemetry_Points(void)
+{
+    char* json = Json_Buffer_Acquire();
+    if (json == NULL)
+        return;
+    g_message_id++;
+
+    int len = snprintf(json, MSG_POOL_BLOCK_SIZE, "{\"id\":\"%u\",\"version\":\"1.0\",\"params\":{", g_message_id);
+    for (int p = 0; p < TELEM_PROP_NUM && len > 0 && len < MSG_POOL_BLOCK_SIZE; p++)
+    {
+        const TelemAgg_Stat* st = TelemAgg_Get(TELEM_WIN_REPORT, (TelemAgg_Prop)p);
+        len += snprintf(json + len, MSG_POOL_BLOCK_SIZE - len, "%s\"%s\":{\"value\":%.1f}",
+                        p ? "," : "", g_telem_names[p], st->last / 100.0f);
+    }
+    if (len > 0 && len < MSG_POOL_BLOCK_SIZE)
+        len += snprintf(json + len, MSG_POOL_BLOCK_SIZE - len, "}}");
+
+    if (len < 0 || len >= MSG_POOL_BLOCK_SIZE) {
+        printf("ERROR: Telemetry points JSON buffer overflow!\r\n");
+        MsgPool_Release(json);
+        return;
+    }
+    MQTT_Publish_Topic(TOPIC_PROPERTY_POST, json);
+}
+
+
+/**
+ * @brief [新增] 上报各属性在上报窗口内的统计摘要 (最小、最大、平均)
+ * @note  [已更新] 发布到自定义主题 TOPIC_TELEMETRY_STAT, 不经过物模型校验; 格式:
+ *        {"id":"n","window":15,"stat":{"temp1":{"min":..,"max":..,"avg":..},...}}, window 为窗口长度(秒)
+ */
+static void MQTT_Publish_Telemetry_Summary(void)
+{
+    char* json = Json_Buffer_Acquire();
+    if (json == NULL)
+        return;
+    g_message_id++;
+
+    int len = snprintf(json, MSG_POOL_BLOCK_SIZE, "{\"id\":\"%u\",\"window\":%u,\"stat\":{",
+                       g_message_id, TELEM_WIN_REPORT_MS / 1000);
+    for (int p = 0; p < TELEM_PROP_NUM && len > 0 && len < MSG_POOL_BLOCK_SIZE; p++)
+    {
+        const TelemAgg_Stat* st = TelemAgg_Get(TELEM_WIN_REPORT, (TelemAgg_Prop)p);
+        len += snprintf(json + len, MSG_POOL_BLOCK_SIZE - len, "%s\"%s\":{\"min\":%.1f,\"max\":%.1f,\"avg\":%.1f}",
+                        p ? "," : "", g_telem_names[p], st->min / 100.0f, st->max / 100.0f, st->mean / 100.0f);
+    }
+    if (len > 0 && len < MSG_POOL_BLOCK_SIZE)
+        len += snprintf(json + len, MSG_POOL_BLOCK_SIZE - len, "}}");
 
-    // 3. 通过串口发送指令
-    USART1_SendString(g_cmd_buffer);
+    if (len < 0 || len >= MSG_POOL_BLOCK_SIZE) {
+        printf("ERROR: Telemetry summary JSON buffer overflow!\r\n");
+        MsgPool_Release(json);
+        return;
+    }
+    MQTT_Publish_Topic(TOPIC_TELEMETRY_STAT, json);
+}
+
+
+/**
+ * @brief [新增] 上报某属性最近一个上报周期内的1Hz原始样本 (霜冻风险高时使用)
+ * @param prop: 属性
+ * @note  [已更新] 发布到自定义主题 TOPIC_TELEMETRY_STAT; 格式: {"id":"n","burst":{"point":"temp1","period":1,"values":[..]}},
+ *        point 为属性名, period 为样本间隔(秒), values 按时间先后排列
+ */
+static void MQTT_Publish_Telemetry_Burst(TelemAgg_Prop prop)
+{
+    int16_t samples[TELEM_WIN_REPORT_MS / TELEM_SAMPLE_MS];
+    uint8_t num = TelemAgg_Raw(prop, samples, (uint8_t)(sizeof(samples) / sizeof(samples[0])));
+    if (num == 0)
+        return;
+
+    char* json = Json_Buffer_Acquire();
+    if (json == NULL)
+        return;
+    g_message_id++;
 
-    // 4. 等待模块处理和发送
-    delay_ms(1500); // 这是一个中等长度的报文，延时1.5秒
+    int len = snprintf(json, MSG_POOL_BLOCK_SIZE,
+        "{\"id\":\"%u\",\"burst\":{\"point\":\"%s\",\"period\":%u,\"values\":[",
+        g_message_id, g_telem_names[prop], TELEM_SAMPLE_MS / 1000);
+    for (uint8_t k = 0; k < num && len > 0 && len < MSG_POOL_BLOCK_SIZE; k++)
+        len += snprintf(json + len, MSG_POOL_BLOCK_SIZE - len, "%s%.1f", k ? "," : "", samples[k] / 100.0f);
+    if (len > 0 && len < MSG_POOL_BLOCK_SIZE)
+        len += snprintf(json + len, MSG_POOL_BLOCK_SIZE - len, "]}}");
+
+    if (len < 0 || len >= MSG_POOL_BLOCK_SIZE) {
+        printf("ERROR: Telemetry burst JSON buffer overflow!\r\n");
+        MsgPool_Release(json);
+        return;
+    }
+    MQTT_Publish_Topic(TOPIC_TELEMETRY_STAT, json);
 }
 
 
+/**
+ * @brief [新增] 上报温度传感器故障状态 (开路、短路), 故障位图变化时调用
+ * @param fault_mask: 故障的监测点, bit p = 监测点p (顺序同 TelemAgg_Prop 的前 FROST_POINT_NUM 个); 0 表示全部恢复
+ * @note  发布到自定义主题 TOPIC_TELEMETRY_STAT, 不新增物模型事件; 格式: {"id":"n","sensor_fault":{"mask":1,"points":["temp1"]}}
+ */
+static void MQTT_Publish_Sensor_Fault(uint8_t fault_mask)
+{
+    char* json = Json_Buffer_Acquire();
+    if (json == NULL)
+        return;
+    g_message_id++;
+
+    int len = snprintf(json, MSG_POOL_BLOCK_SIZE, "{\"id\":\"%u\",\"sensor_fault\":{\"mask\":%u,\"points\":[",
+                       g_message_id, fault_mask);
+    for (int p = 0, n = 0; p < FROST_POINT_NUM && len > 0 && len < MSG_POOL_BLOCK_SIZE; p++)
+    {
+        if (fault_mask & (1U << p))
+            len += snprintf(json + len, MSG_POOL_BLOCK_SIZE - len, "%s\"%s\"", n++ ? "," : "", g_telem_names[p]);
+    }
+    if (len > 0 && len < MSG_POOL_BLOCK_SIZE)
+        len += snprintf(json + len, MSG_POOL_BLOCK_SIZE - len, "]}}");
+
+    if (len < 0 || len >= MSG_POOL_BLOCK_SIZE) {
+        printf("ERROR: Sensor fault JSON buffer overflow!\r\n");
+        MsgPool_Release(json);
+        return;
+    }
+    MQTT_Publish_Topic(TOPIC_TELEMETRY_STAT, json);
+}
+
+
+/**
+ * @brief [新增] 以CBOR格式上报一个上报窗口的全部遥测, 一条消息代替JSON的摘要、状态和原始样本
+ * @param burst_prop: 附带原始样本的属性; TELEM_PROP_NUM 表示不附带
+ * @note  映射的键为小整数, 数值为0.01单位的整数 (解码见 tools/decode_telemetry.py):
+ *          0: 格式版本 TELEM_CBOR_VERSION
+ *          1: 消息ID
+ *          2: 各属性 [最新, 最小, 最大, 平均], 顺序同 TelemAgg_Prop
+ *          3: [人工干预状态, 风扇功率(%), 可用性位图(bit0喷淋 bit1风扇 bit2加热), 霜冻风险等级]
+ *          4: (可选) [属性编号, 样本间隔(秒), [原始样本...]]
+ */
+static void MQTT_Publish_Telemetry_Cbor(TelemAgg_Prop burst_prop)
+{
+    int16_t samples[TELEM_WIN_REPORT_MS / TELEM_SAMPLE_MS];
+    uint8_t num = 0;
+    if (burst_prop < TELEM_PROP_NUM)
+        num = TelemAgg_Raw(burst_prop, samples, (uint8_t)(sizeof(samples) / sizeof(samples[0])));
+
+    char* buf = Json_Buffer_Acquire();
+    if (buf == NULL)
+        return;
+    g_message_id++;
+
+    CborWriter w;
+    Cbor_Init(&w, buf, MSG_POOL_BLOCK_SIZE);
+    Cbor_Map(&w, num ? 5 : 4);
+    Cbor_Uint(&w, 0);
+    Cbor_Uint(&w, TELEM_CBOR_VERSION);
+    Cbor_Uint(&w, 1);
+    Cbor_Uint(&w, g_message_id);
+
+    Cbor_Uint(&w, 2);
+    Cbor_Array(&w, TELEM_PROP_NUM);
+    for (int p = 0; p < TELEM_PROP_NUM; p++)
+    {
+        const TelemAgg_Stat* st = TelemAgg_Get(TELEM_WIN_REPORT, (TelemAgg_Prop)p);
+        Cbor_Array(&w, 4);
+        Cbor_Int(&w, st->last);
+        Cbor_Int(&w, st->min);
+        Cbor_Int(&w, st->max);
+        Cbor_Int(&w, st->mean);
+    }
+
+    Cbor_Uint(&w, 3);
+    Cbor_Array(&w, 4);
+    Cbor_Uint(&w, (uint32_t)g_device_status.intervention_status);
+    Cbor_Uint(&w, (uint32_t)g_device_status.fan_power);
+    Cbor_Uint(&w, (g_device_status.sprinklers_available ? 1U : 0U) | (g_device_status.fans_available ? 2U : 0U) |
+                  (g_device_status.heaters_available ? 4U : 0U));
+    Cbor_Uint(&w, FrostRisk_Get()->level);
+
+    if (num)
+    {
+        Cbor_Uint(&w, 4);
+        Cbor_Array(&w, 3);
+        Cbor_Uint(&w, burst_prop);
+        Cbor_Uint(&w, TELEM_SAMPLE_MS / 1000);
+        Cbor_Array(&w, num);
+        for (uint8_t k = 0; k < num; k++)
+            Cbor_Int(&w, samples[k]);
+    }
+
+    if (!Cbor_Ok(&w)) {
+        printf("ERROR: Telemetry CBOR buffer overflow!\r\n");
+        MsgPool_Release(buf);
+        return;
+    }
+    MQTT_Publish_Topic_Binary(TELEM_REPORT_TOPIC, buf, w.len);
+}
+
 
 /**
  * @brief [新] 仅上报系统的人工干预状态
@@ -962,11 +1361,14 @@ void MQTT_Publish_Environment_Data(float ambient_temp, float humidity, float pre
  */
 void MQTT_Publish_Intervention_Status(int intervention_status)
 {
+    char* json = Json_Buffer_Acquire();
+    if (json == NULL)
+        return;
     // 每次调用都增加消息ID，确保每个消息的ID唯一
     g_message_id++;
 
     // 1. 构建只包含 intervention_status 属性的 'params' JSON 负载
-    int json_len = snprintf(g_json_payload, JSON_PAYLOAD_SIZE, 
+    int json_len = snprintf(json, MSG_POOL_BLOCK_SIZE,
         "{\"id\":\"%u\",\"version\":\"1.0\",\"params\":{"
         "\"intervention_status\":{\"value\":%d}"
         "}}",
@@ -975,23 +1377,14 @@ void MQTT_Publish_Intervention_Status(int intervention_status)
     );
 
     // [健壮性检查] 确认JSON没有因为缓冲区太小而被截断
-    if (json_len < 0 || json_len >= JSON_PAYLOAD_SIZE) {
-        USART1_SendString("ERROR: Intervention status JSON buffer overflow!\r\n");
+    if (json_len < 0 || json_len >= MSG_POOL_BLOCK_SIZE) {
+        printf("ERROR: Intervention status JSON buffer overflow!\r\n");
+        MsgPool_Release(json);
         return;
     }
 
-    // 2. 构建 AT+QMTPUB 指令
-    snprintf(g_cmd_buffer, CMD_BUFFER_SIZE, 
-            "AT+QMTPUB=0,0,0,0,\"$sys/%s/%s/thing/property/post\",\"%s\"\r\n",
-            MQTT_PRODUCT_ID, 
-            MQTT_DEVICE_NAME,
-            g_json_payload);
-
-    // 3. 通过串口发送指令
-    USART1_SendString(g_cmd_buffer);
-
-    // 4. 等待模块处理和发送 (对于短报文，可以适当缩短延时)
-    delay_ms(1000); 
+    // 2. 以QoS1发布, 缓存块随之交给发布流水线, 本函数不再使用
+    MQTT_Publish_Topic(TOPIC_PROPERTY_POST, json);
 }
 
 
@@ -1013,6 +1406,9 @@ void MQTT_Publish_Devices_Availability(bool sprinklers_available, bool fans_avai
     const char* val_fans = fans_available ? "true" : "false";
     const char* val_heaters = heaters_available ? "true" : "false";
     
+    char* json = Json_Buffer_Acquire();
+    if (json == NULL)
+        return;
     // 每次调用都增加消息ID
     g_message_id++;
 
@@ -1021,7 +1417,7 @@ void MQTT_Publish_Devices_Availability(bool sprinklers_available, bool fans_avai
     // 注意观察下面的格式：{\"value\":%s}
     // %s 的两边【没有】加转义引号 \"。
     // 这样填充后就会变成 {"value":true} 或 {"value":false}，与截图一致。
-    int json_len = snprintf(g_json_payload, JSON_PAYLOAD_SIZE, 
+    int json_len = snprintf(json, MSG_POOL_BLOCK_SIZE,
         "{\"id\":\"%u\",\"version\":\"1.0\",\"params\":{"
         "\"sprinklers_available\":{\"value\":%s},"
         "\"fans_available\":{\"value\":%s},"
@@ -1032,26 +1428,17 @@ void MQTT_Publish_Devices_Availability(bool sprinklers_available, bool fans_avai
     );
 
     // [健壮性检查]
-    if (json_len < 0 || json_len >= JSON_PAYLOAD_SIZE) {
+    if (json_len < 0 || json_len >= MSG_POOL_BLOCK_SIZE) {
         printf("ERROR: Devices availability JSON buffer overflow!\r\n");
+        MsgPool_Release(json);
         return;
     }
 
     // 打印生成的Payload供调试查看，确保格式为 {"value":false}
-    printf("DEBUG: Generated Payload: %s\r\n", g_json_payload);
-
-    // 2. 构建 AT+QMTPUB 指令 (保持不变)
-    snprintf(g_cmd_buffer, CMD_BUFFER_SIZE, 
-            "AT+QMTPUB=0,0,0,0,\"$sys/%s/%s/thing/property/post\",\"%s\"\r\n",
-            MQTT_PRODUCT_ID, 
-            MQTT_DEVICE_NAME,
-            g_json_payload);
-
-    // 3. 通过串口发送指令
-    USART1_SendString(g_cmd_buffer);
+    printf("DEBUG: Generated Payload: %s\r\n", json);
 
-    // 4. 等待模块处理和发送
-    delay_ms(1500); 
+    // 2. 以QoS1发布, 缓存块随之交给发布流水线, 本函数不再使用
+    MQTT_Publish_Topic(TOPIC_PROPERTY_POST, json);
 }
 
 
@@ -1061,10 +1448,13 @@ void MQTT_Publish_Devices_Availability(bool sprinklers_available, bool fans_avai
  */
  void MQTT_Publish_Fan_Power(int fan_power)
  {
+     char* json = Json_Buffer_Acquire();
+     if (json == NULL)
+         return;
      g_message_id++;
  
      // 构建只包含 fan_power 属性的 'params' JSON 负载
-     snprintf(g_json_payload, JSON_PAYLOAD_SIZE, 
+     snprintf(json, MSG_POOL_BLOCK_SIZE,
          "{\"id\":\"%u\",\"version\":\"1.0\",\"params\":{"
          "\"fan_power\":{\"value\":%d}"
          "}}",
@@ -1072,16 +1462,8 @@ void MQTT_Publish_Devices_Availability(bool sprinklers_available, bool fans_avai
          fan_power
      );
  
-     // 构建 AT+QMTPUB 指令
-     snprintf(g_cmd_buffer, CMD_BUFFER_SIZE, 
-             "AT+QMTPUB=0,0,0,0,\"$sys/%s/%s/thing/property/post\",\"%s\"\r\n",
-             MQTT_PRODUCT_ID, 
-             MQTT_DEVICE_NAME,
-             g_json_payload);
- 
-     // 通过串口发送指令
-     USART1_SendString(g_cmd_buffer);
-     delay_ms(1000); 
+     // 2. 以QoS1发布, 缓存块随之交给发布流水线, 本函数不再使用
+     MQTT_Publish_Topic(TOPIC_PROPERTY_POST, json);
  }
 
 
@@ -1102,8 +1484,8 @@ void MQTT_Publish_Devices_Availability(bool sprinklers_available, bool fans_avai
  * @param sprinklers_available  喷淋系统是否可用
  * @param fans_available        风机系统是否可用
  * @param heaters_available     加热系统是否可用
- * @note  此函数按顺序调用各个独立的数据上报函数，并在每次调用后加入短暂延时，
- *        以确保4G模块有足够的时间处理和发送每条消息。
+ * @note  此函数按顺序调用各个独立的数据上报函数。[已更新] 各条消息以QoS1发布, 同时在途,
+ *        不再需要在两次发送之间延时等待4G模块。
  */
 void MQTT_Publish_All_Data(
     // 温度数据
@@ -1121,23 +1503,19 @@ void MQTT_Publish_All_Data(
     printf("INFO: Publishing environment data...\r\n");
     // 注意：我们调用的是 MQTT_Publish_Environment_Data 而不是带 _Random 的版本
     MQTT_Publish_Environment_Data(ambient_temp, humidity, pressure, wind_speed);
-    delay_ms(250); // 在两次发送之间加入短暂延时，给模块缓冲时间
 
     // 2. 上报四个监测点温度
     printf("INFO: Publishing point temperatures...\r\n");
     // 注意：我们调用的是 MQTT_Publish_Only_Temperatures 而不是带 _Random 的版本
     MQTT_Publish_Only_Temperatures(temp1, temp2, temp3, temp4);
-    delay_ms(250);
 
     // 3. 上报人工干预状态
     printf("INFO: Publishing intervention status...\r\n");
     MQTT_Publish_Intervention_Status(intervention_status);
-    delay_ms(250);
 
     // 4. 上报风扇功率
     printf("INFO: Publishing fan power...\r\n");
     MQTT_Publish_Fan_Power(fan_power);
-    delay_ms(250);
 
     // 5. 上报设备可用性
     printf("INFO: Publishing devices availability...\r\n");
@@ -1150,129 +1528,393 @@ void MQTT_Publish_All_Data(
 
 
 /**
- * @brief 主函数 (最终修正版：增加了串口空闲检测，确保接收完整的指令)
+ * @brief  [新增] 计算第 n 次重连前的等待时间 (带随机抖动的指数退避)
+ * @note   上限为 BASE*2^n, 不超过 MAX; 实际等待时间在 [上限/2, 上限] 内随机选取
+ * @param  fail_count: 连续失败次数, 0 表示会话刚刚断开
+ * @return uint32_t: 等待时间, 单位毫秒
  */
-int main(void)
+static uint32_t Conn_Backoff_Ms(uint8_t fail_count)
 {
-    // 1. 系统核心初始化 (不变)
-    NVIC_PriorityGroupConfig(NVIC_PriorityGroup_2);
-    System_SwdMode();
+    uint32_t cap = CONN_BACKOFF_BASE_MS;
+    while (fail_count-- > 0 && cap < CONN_BACKOFF_MAX_MS)
+        cap <<= 1;
+    if (cap > CONN_BACKOFF_MAX_MS)
+        cap = CONN_BACKOFF_MAX_MS;
 
-    // 2. 外设初始化 (不变)
-    System_SysTickInit();
-    USART1_Init(115200);
-    USART2_Init(115200);
-    Led_Init();
+    return cap / 2 + (uint32_t)rand() % (cap / 2 + 1);
+}
 
-    printf("System Initialized. Trying to connect to MQTT server...\r\n");
+/**
+ * @brief  [新增] 连接监督状态机，在主循环中周期调用
+ * @note   1. 已连接时检查 +QMTSTAT: 网络断开(err=7)时完整初始化, 其余原因只重建MQTT会话;
+ *         2. 未连接时到达退避时刻就尝试一次, 连接成功后一次性重新订阅全部主题, 并重发在途的QoS1消息;
+ *         3. 快速恢复连续失败 CONN_RESUME_MAX_FAIL 次后, 改为完整初始化
+ * @return bool: true 代表当前已连接
+ */
+static bool Conn_Supervisor_Task(void)
+{
+    uint8_t err = MQTT_Session_TakeError();
 
-    // 3. 连接与订阅 (不变)
-    if (Robust_Initialize_And_Connect_MQTT())
+    if (g_conn_state == CONN_READY)
+    {
+        if (err == 0)
+            return true;
+
+        g_conn_state       = (err == MQTT_STAT_LINK_DOWN) ? CONN_FULL_INIT : CONN_RESUME;
+        g_conn_fail_count  = 0;
+        g_conn_next_try_ms = System_GetTimeMs() + Conn_Backoff_Ms(0);
+        printf("WARN: MQTT session lost (err=%u), reconnecting...\r\n", err);
+        return false;
+    }
+
+    if (System_GetTimeMs() < g_conn_next_try_ms)
+        return false;
+
+    bool ok;
+    if (g_conn_state == CONN_FULL_INIT)
+        ok = Modem_Attach_Network() && MQTT_Open_Session();
+    else
+        ok = MQTT_Open_Session();
+
+    if (ok)
+        ok = MQTT_Subscribe_All_Topics();
+
+    if (ok)
     {
         printf("SUCCESS: MQTT Connected.\r\n");
-        
+        MQTT_Session_TakeError();                       // 丢弃连接过程中残留的旧会话通知
+        g_conn_state      = CONN_READY;
+        g_conn_fail_count = 0;
+        LED2_OFF;
+        MQTT_Pub_ResendAll();
+        MQTT_Get_Desired_Crop_Stage();
+        return true;
+    }
 
-        if (MQTT_Subscribe_All_Topics())
-        {
-            printf("Entering main loop...\r\n");
-            
-            MQTT_Get_Desired_Crop_Stage();
-            
-            
-            u64 last_report_time = 0;
-            const uint32_t report_interval_ms = 15000;
+    if (g_conn_fail_count < 255)
+        g_conn_fail_count++;
+    if (g_conn_state == CONN_RESUME && g_conn_fail_count >= CONN_RESUME_MAX_FAIL)
+        g_conn_state = CONN_FULL_INIT;
 
-            // --- [核心修改：增加用于空闲检测的变量] ---
-            unsigned int last_recv_num = 0;
-            u64 last_recv_time = 0;
-            const uint32_t recv_idle_timeout_ms = 50; // 定义50毫秒为总线空闲超时
+    uint32_t wait_ms = Conn_Backoff_Ms(g_conn_fail_count);
+    g_conn_next_try_ms = System_GetTimeMs() + wait_ms;
+    LED2_TOGGLE;
+    printf("ERROR: Connect attempt %u failed, retry in %lu ms.\r\n", g_conn_fail_count, (unsigned long)wait_ms);
+    return false;
+}
 
-            while (1)
-            {
-                // --- 任务1: [升级版] 检查并处理下行消息 (带空闲检测) ---
-                if (xUSART.USART1ReceivedNum > 0)
-                {
-                    // 如果接收计数器 > 上次记录的计数器，说明有新数据进来
-                    if (xUSART.USART1ReceivedNum > last_recv_num)
-                    {
-                        // 更新“上次接收到数据的时间”
-                        last_recv_time = System_GetTimeMs();
-                        // 更新“上次记录的计数器”
-                        last_recv_num = xUSART.USART1ReceivedNum;
-                    }
-                    
-                    // 检查“当前时间”与“上次接收到数据的时间”之差是否超过了空闲超时阈值
-                    // 并且确保接收缓冲区里确实有数据 (last_recv_num > 0)
-                    if ((last_recv_num > 0) && (System_GetTimeMs() - last_recv_time > recv_idle_timeout_ms))
-                    {
-                        // 如果超过了50ms没有新数据进来，我们判定这是一条完整的消息
-                        printf("INFO: Full message received after idle period.\r\n");
-                        
-                        // --- 开始处理 ---
-                        xUSART.USART1ReceivedBuffer[xUSART.USART1ReceivedNum] = '\0';
-                        Process_MQTT_Message_Robust((char*)xUSART.USART1ReceivedBuffer);                
-                        
-                        // --- 处理完毕后，彻底清零所有状态 ---
-                        xUSART.USART1ReceivedNum = 0;
-                        last_recv_num = 0;
-                    }
-                }
-                
-                // --- 任务2: [核心修改] 周期性上报数据 ---
-                if (System_GetTimeMs() - last_report_time > report_interval_ms)
-                {
-                    
-
-                    last_report_time = System_GetTimeMs();
-                }
-            }
-        }
-        else
-        {
-            // 订阅失败处理 (不变)
-            printf("FATAL ERROR: Failed to subscribe to topics. Halting.\r\n");
-            while(1)
-            {
-                LED1_TOGGLE;
-                delay_ms(200);
-            }
-        }
+
+
+/**
+ * @brief [新增] 本地霜冻风险处理: 等级变化时输出日志; 告警时立即上报 frost_alert 事件, 并按设备可用性自动干预
+ * @note  关注(WATCH)时预先开启风扇, 告警(ALERT)时开启风扇和加热; 只在当前无人工干预、或干预状态是本地自动设置时接管,
+ *        风险解除后恢复为全部关闭; 云端下发 set_intervention 后以云端为准
+ * @note  [已更新] 传感器故障(开路读数为-40°C)的监测点不参与判断, 不会因此告警或干预; 故障位图变化时输出日志并上报
+ * @param changed: 风险等级是否刚发生变化
+ */
+static void Frost_Risk_Task(bool changed)
+{
+    static u64 last_alert_ms = 0;
+    static uint8_t last_faults = 0;
+    const FrostRisk_State* risk = FrostRisk_Get();
+    u64 now = System_GetTimeMs();
+
+    if (risk->faultMask != last_faults)
+    {
+        printf("FROST: sensor fault mask 0x%02X -> 0x%02X, faulty points ignored\r\n", last_faults, risk->faultMask);
+        last_faults = risk->faultMask;
+        MQTT_Publish_Sensor_Fault(risk->faultMask);                 // 断线时留在QoS1在途表中, 重连后重发
     }
-    else
+
+    if (changed)
+        printf("FROST: level=%d point=%u temp=%d slope=%ld/h eta=%ldmin dew=%d\r\n",
+               risk->level, risk->point, risk->tempCenti, (long)risk->slopeCentiPerHour,
+               (long)risk->minutesToThreshold, risk->dewPointCenti);
+
+    if (risk->level == FROST_RISK_ALERT && (changed || now - last_alert_ms >= FROST_REALERT_MS))
     {
-        // 连接失败处理 (不变)
-        printf("FATAL ERROR: Failed to connect to MQTT server. Halting.\r\n");
-        while(1)
-        {
-            LED2_TOGGLE;
-            delay_ms(500);
-        }
+        last_alert_ms = now;
+        MQTT_Post_Frost_Alert_Event(risk->tempCenti / 100.0f);     // 断线时留在QoS1在途表中, 重连后重发
     }
-	
 
+    if (!FROST_AUTO_INTERVENTION || !changed)
+        return;
+    if (g_intervention_status != 0 && g_intervention_status != g_frost_auto_status)
+        return;                                                     // 云端已设置干预, 不接管
+
+    int status = 0;
+    bool fans    = g_device_status.fans_available;
+    bool heaters = g_device_status.heaters_available;
+    if (risk->level == FROST_RISK_ALERT)
+        status = (fans && heaters) ? 4 : (heaters ? 3 : (fans ? 2 : 0));
+    else if (risk->level == FROST_RISK_WATCH)
+        status = fans ? 2 : 0;
+
+    if (status == g_intervention_status)
+        return;
+    printf("FROST: local intervention %d -> %d\r\n", g_intervention_status, status);
+    Intervention_Apply(status);
+    g_frost_auto_status = status;
+    MQTT_Publish_Intervention_Status(status);
+}
+
+/**
+ * @brief [新增] 模拟量采集任务: 取走DMA刚填满的数据块, 经整数滤波流水线换算后写入 g_device_status, 并判断霜冻风险
+ * @note  [已更新] 同时以1Hz送入遥测聚合, 结束的窗口记录在 g_telem_closed 中, 由 Telemetry_Report_Task() 上报
+ * @note  滤波、校准、换算全部为整数运算, 只在写入 g_device_status 时做一次整数到float的转换(JSON构建函数使用%.1f);
+ *        滑动窗口填满前不写入, 保留初始值
+ */
+static void Analog_Sample_Task(void)
+{
+    if (!SensorFilter_Task() || !SensorFilter_Ready())
+        return;
+
+    g_device_status.temp1        = SensorFilter_GetDeci(ADC_CH_TEMP1)    / 10.0f;
+    g_device_status.temp2        = SensorFilter_GetDeci(ADC_CH_TEMP2)    / 10.0f;
+    g_device_status.temp3        = SensorFilter_GetDeci(ADC_CH_TEMP3)    / 10.0f;
+    g_device_status.temp4        = SensorFilter_GetDeci(ADC_CH_TEMP4)    / 10.0f;
+    g_device_status.ambient_temp = SensorFilter_GetDeci(ADC_CH_AMBIENT)  / 10.0f;
+    g_device_status.humidity     = SensorFilter_GetDeci(ADC_CH_HUMIDITY) / 10.0f;
+
+    // [新增] 每次结果更新都判断霜冻风险, 不等待上报周期和云端指令
+    // [已更新] 数组顺序同时符合霜冻判断的监测点(前5个)和遥测聚合的属性
+    const int16_t values[TELEM_PROP_NUM] = {
+        SensorFilter_GetCenti(ADC_CH_TEMP1), SensorFilter_GetCenti(ADC_CH_TEMP2),
+        SensorFilter_GetCenti(ADC_CH_TEMP3), SensorFilter_GetCenti(ADC_CH_TEMP4),
+        SensorFilter_GetCenti(ADC_CH_AMBIENT), SensorFilter_GetCenti(ADC_CH_HUMIDITY)
+    };
+    uint8_t faults = 0;                             // [新增] 开路、短路的温度传感器不参与霜冻判断
+    for (int p = 0; p < FROST_POINT_NUM; p++)
+    {
+        if (!SensorFilter_Valid((AdcSampler_Channel)(ADC_CH_TEMP1 + p)))
+            faults |= 1U << p;
+    }
+    u64 now = System_GetTimeMs();
+    bool changed = FrostRisk_Update(values, faults, values[TELEM_PROP_HUMIDITY], now);
+    Frost_Risk_Task(changed);
 
+    g_telem_closed |= TelemAgg_Sample(values, now);
+}
 
+/**
+ * @brief [新增] 遥测上报任务: 上报窗口结束时发布统计摘要, 霜冻风险达到 TELEM_BURST_LEVEL 时附带原始样本; 分钟窗口结束时输出日志
+ * @param connected: 当前是否已连接; 断线期间结束的上报窗口直接丢弃, 不积压到在途表中
+ * @note  上报周期由 TELEM_WIN_REPORT_MS 决定; 点值走物模型(thing/property/post), 整个窗口的最小、最大、平均值和原始样本
+ *        走自定义主题 TOPIC_TELEMETRY_STAT, 平台侧需配置该自定义Topic
+ * @note  [已更新] 编码由 TELEM_REPORT_TOPIC 主题决定; CBOR时摘要、状态、原始样本合为一条消息
+ */
+static void Telemetry_Report_Task(bool connected)
+{
+    uint8_t closed = g_telem_closed;
+    g_telem_closed = 0;
 
+    if (closed & TELEM_WIN_BIT(TELEM_WIN_MINUTE))
+    {
+        printf("TELEM: minute");
+        for (int p = 0; p < TELEM_PROP_NUM; p++)
+        {
+            const TelemAgg_Stat* st = TelemAgg_Get(TELEM_WIN_MINUTE, (TelemAgg_Prop)p);
+            printf(" %s=%d/%d/%d", g_telem_names[p], st->min, st->mean, st->max);
+        }
+        printf("\r\n");
+    }
 
+    if (!connected || !(closed & TELEM_WIN_BIT(TELEM_WIN_REPORT)))
+        return;
 
+    const FrostRisk_State* risk = FrostRisk_Get();
+    TelemAgg_Prop burst = (risk->level >= TELEM_BURST_LEVEL) ? (TelemAgg_Prop)risk->point : TELEM_PROP_NUM;   // 监测点编号与属性顺序相同
 
+    if (g_topics[TELEM_REPORT_TOPIC].enc == TOPIC_ENC_CBOR)
+    {
+        MQTT_Publish_Telemetry_Cbor(burst);
+        return;
+    }
 
+    MQTT_Publish_Telemetry_Points();            // 物模型点值, 与原来的上报相同
+    MQTT_Publish_Telemetry_Summary();           // 统计摘要, 自定义主题
+    if (burst < TELEM_PROP_NUM)
+        MQTT_Publish_Telemetry_Burst(burst);
+}
 
+/**
+ * @brief [新增] 风扇闭环控制任务: 干预状态包含风扇(2、4)时, 按固定周期运行PID, 输出作为风扇执行器的请求值
+ * @note  运行时 g_device_status.fan_power 反映控制输出(%); 云端设置的 fan_power 作为手动覆盖
+ * @note  [已更新] 不再直接写PWM, 由执行器层软启动
+ */
+static void Fan_Control_Task(void)
+{
+    bool enable = (g_intervention_status == 2 || g_intervention_status == 4);
+    if (!FanCtrl_Task(System_GetTimeMs(), enable, SensorFilter_Ready(),
+                      SensorFilter_GetCenti(FAN_TOP_CH), SensorFilter_GetCenti(FAN_BOTTOM_CH)))
+        return;
 
+    Actuator_Request(ACT_FAN, FanCtrl_Output());
+    if (enable)
+        g_device_status.fan_power = (FanCtrl_Output() + 5) / 10;
+}
 
+/**
+ * @brief [新增] 执行器任务: 按固定周期执行各执行器的请求(软启动、互锁、错开启动), 检测电流/流量反馈;
+ *        可用性变化时更新 g_device_status 并上报
+ * @note  每个周期只处理固定数量的通道, 不等待; 断线时上报消息留在QoS1在途表中, 重连后重发
+ */
+static void Actuator_Control_Task(void)
+{
+    if (!Actuator_Task(System_GetTimeMs()))
+        return;
 
+    g_device_status.sprinklers_available = Actuator_IsAvailable(ACT_SPRINKLER);
+    g_device_status.fans_available       = Actuator_IsAvailable(ACT_FAN);
+    g_device_status.heaters_available    = Actuator_IsAvailable(ACT_HEATER);
+    printf("ACT: availability sprinklers=%d fans=%d heaters=%d\r\n", g_device_status.sprinklers_available,
+           g_device_status.fans_available, g_device_status.heaters_available);
+    MQTT_Publish_Devices_Availability(g_device_status.sprinklers_available, g_device_status.fans_available,
+                                      g_device_status.heaters_available);
+}
 
+/**
+ * @brief [新增] 输出一条采集统计记录: 数据块处理数、跳过数、被覆盖数, VDDA和各通道的换算结果(0.1单位), 以及风扇控制的输出
+ * @note  [已更新] 增加各执行器的状态和实际输出(千分比)
+ */
+static void Analog_Report(void)
+{
+    AdcSampler_Stats adc;
+    AdcSampler_GetStats(&adc);
+    printf("ADCSTAT: blocks=%lu dropped=%lu overrun=%lu vdda=%umV t1=%d t2=%d t3=%d t4=%d amb=%d hum=%d\r\n",
+           (unsigned long)adc.blocks, (unsigned long)adc.dropped, (unsigned long)adc.overruns,
+           SensorFilter_VddaMv(),
+           SensorFilter_GetDeci(ADC_CH_TEMP1), SensorFilter_GetDeci(ADC_CH_TEMP2),
+           SensorFilter_GetDeci(ADC_CH_TEMP3), SensorFilter_GetDeci(ADC_CH_TEMP4),
+           SensorFilter_GetDeci(ADC_CH_AMBIENT), SensorFilter_GetDeci(ADC_CH_HUMIDITY));
+    printf("FANCTRL: output=%u%s late=%lu\r\n", FanCtrl_Output(), FanCtrl_IsManual() ? " manual" : "",
+           (unsigned long)FanCtrl_LateCount());
+    printf("ACTSTAT:");
+    for (uint8_t i = 0; i < ACT_NUM; i++)
+        printf(" %s=%s/%u", Actuator_Name((Actuator_Id)i), Actuator_StateName(Actuator_GetState((Actuator_Id)i)),
+               Actuator_GetOutput((Actuator_Id)i));
+    printf("\r\n");
+}
 
 
 
+/**
+ * @brief  [新增] 输出本次复位的原因和上次运行留在备份寄存器中的记录
+ * @note   看门狗复位时, last_task 是复位时正在运行的任务, missed 是超过期限的任务; 两者相同时即该任务卡死
+ */
+static void Watchdog_Report_Reset(void)
+{
+    const Iwdg_ResetInfo* reset = Iwdg_LastReset();
+    printf("RESET: cause=%s last_task=%s missed=%s watchdog_resets=%u\r\n",
+           Iwdg_ResetCauseName(reset->cause), Iwdg_TaskName(reset->lastTask),
+           Iwdg_TaskName(reset->missedTask), reset->watchdogResets);
+}
 
 
 
+/**
+ * @brief 主函数 (最终修正版：增加了串口空闲检测，确保接收完整的指令)
+ */
+int main(void)
+{
+    // 1. 系统核心初始化 (不变)
+    NVIC_PriorityGroupConfig(NVIC_PriorityGroup_2);
+    System_SwdMode();
 
+    // 2. 外设初始化 (不变)
+    System_SysTickInit();
+    IrqStats_Init();            // 使能DWT周期计数器, 开始统计中断负载
+    USART1_Init(115200);
+    USART2_Init(115200);
+    Iwdg_Init();                // [新增] 读取复位原因和上次的运行记录, 启动独立看门狗; 之后主循环必须在超时前开始运行
+    Watchdog_Report_Reset();
+    Led_Init();
+    AdcSampler_Init();          // [新增] TIM2触发ADC1扫描, DMA双缓冲连续采集, 不占用CPU
+    SensorFilter_Init();        // [新增] 整数滤波流水线: 中值、过采样抽取、滑动求和、定点校准
+    FrostRisk_Init();           // [新增] 本地霜冻风险判断
+    TelemAgg_Init();            // [新增] 遥测聚合: 1Hz取样, 上报窗口和分钟窗口的统计
+    Pwm_Init();                 // [新增] TIM3 PWM, 风扇调速
+    Actuator_Init();            // [新增] 执行器: 喷淋阀、风扇、加热器的输出和反馈, 需在Pwm_Init()之后
+    FanCtrl_Init(FAN_MIN_POWER * 10, FAN_MAX_POWER * 10);  // [新增] 风扇闭环控制, 开启时输出限制在最小~最大功率
+
+    // [新增] 随机数种子取自芯片唯一ID和周期计数器, 各塔站的重连退避时间互不相同
+    const volatile uint32_t* uid = (const volatile uint32_t*)MCU_UID_BASE;
+    srand(uid[0] ^ uid[1] ^ uid[2] ^ System_GetCycles());
 
+    printf("System Initialized. Trying to connect to MQTT server...\r\n");
 
+    // 3. 连接与订阅: [已更新] 由连接监督状态机在主循环中完成, 失败后退避重试, 不再停机
+    //    [已更新] 上报周期改由遥测聚合的上报窗口(TELEM_WIN_REPORT_MS)决定
+    u64 last_irq_stats_time = 0;
 
+    printf("Entering main loop...\r\n");
+    while (1)
+    {
+        // [新增] 每个任务运行前登记检查点, 所有任务都在期限内完成时才喂狗 (见 bsp_iwdg.h)
+        // --- 任务0: [新增] 连接监督 (断线检测、退避重连、重新订阅) ---
+        Iwdg_Checkpoint(IWDG_TASK_CONN);
+        bool connected = Conn_Supervisor_Task();
+
+        // --- 任务1: [已更新] 检查并处理下行消息 ---
+        // 接收层按 +QMTRECV 记录切分, 同一空闲窗口中的多条消息逐条入队, 跨越空闲中断的半条消息等待拼接完整,
+        // 不再用50ms空闲超时判断消息结束; 回复过程中新到达的消息也会入队, 在本循环中依次处理
+        Iwdg_Checkpoint(IWDG_TASK_RECV);
+        MQTT_Recv_Pump();
+
+        MQTT_FrameView frame;
+        while (MQTT_Recv_Get(&frame))
+        {
+            Iwdg_Checkpoint(IWDG_TASK_RECV);            // 时限按每条消息计算
+            CmdTrace_Begin(frame.msgid, frame.firstByteCycles, frame.completeCycles);
+            Process_MQTT_Message_Robust(&frame);
+            CmdTrace_End();
+            MQTT_Recv_Done();
+        }
+        
+        // --- 任务1.1: [新增] 模拟量采集: DMA每填满半个缓冲区(一个数据块)处理一次, 处理期间DMA写另一半, 结果写入g_device_status ---
+        Iwdg_Checkpoint(IWDG_TASK_SAMPLE);
+        Analog_Sample_Task();
+
+        // --- 任务1.2: [新增] 风扇闭环控制: 固定周期按逆温差计算风扇功率 ---
+        Iwdg_Checkpoint(IWDG_TASK_FAN);
+        Fan_Control_Task();
+
+        // --- 任务1.3: [新增] 执行器: 按固定周期执行干预请求, 检测反馈并更新设备可用性 ---
+        Iwdg_Checkpoint(IWDG_TASK_ACTUATOR);
+        Actuator_Control_Task();
+
+        // --- 任务2: [已更新] 周期性上报数据: 上报窗口结束时发布统计摘要, 霜冻风险高时附带1Hz原始样本 ---
+        Iwdg_Checkpoint(IWDG_TASK_REPORT);
+        Telemetry_Report_Task(connected);
+
+        // --- 任务2.1: [新增] QoS1在途消息超时重发 (断线期间暂停, 重连后统一重发) ---
+        Iwdg_Checkpoint(IWDG_TASK_PUB_POLL);
+        if (connected)
+            MQTT_Pub_Poll();
+
+        // --- 任务3: 周期性输出中断负载统计记录 ---
+        Iwdg_Checkpoint(IWDG_TASK_STATS);
+        if (System_GetTimeMs() - last_irq_stats_time > IRQ_STATS_REPORT_MS)
+        {
+            IrqStats_Report();
+            MsgPool_Stats pool;
+            MsgPool_GetStats(&pool);
+            printf("MEMSTAT: msgpool used=%u high=%u/%u fail=%lu bad_release=%lu\r\n",
+                   pool.inUse, pool.highWater, MSG_POOL_BLOCK_NUM,
+                   (unsigned long)pool.failures, (unsigned long)pool.badRelease);
+            CmdLatency_Report();
+            CmdTrace_Export();
+            MQTT_RecvStats recv;
+            MQTT_Recv_GetStats(&recv);
+            printf("MQTTRX: received=%lu dropped=%lu malformed=%lu timeout=%lu\r\n",
+                   (unsigned long)recv.received, (unsigned long)recv.dropped,
+                   (unsigned long)recv.malformed, (unsigned long)recv.timeouts);
+            Analog_Report();
+            last_irq_stats_time = System_GetTimeMs();
+        }
 
-    
+        // --- [新增] 一轮结束: 检查各任务的期限并喂狗 ---
+        Iwdg_LoopEnd();
+    }
 }
 
@@ -26,20 +26,20 @@
 /* Includes ------------------------------------------------------------------*/
 /* Uncomment/Comment the line below to enable/disable peripheral header file inclusion */
 //#include "stm32f10x_adc.h"
-//#include "stm32f10x_bkp.h"
+#include "stm32f10x_bkp.h"
 #include "stm32f10x_can.h"
 //#include "stm32f10x_cec.h"
 //#include "stm32f10x_crc.h"
 //#include "stm32f10x_dac.h"
-//#include "stm32f10x_dbgmcu.h"
+#include "stm32f10x_dbgmcu.h"
 #include "stm32f10x_dma.h"
 #include "stm32f10x_exti.h"
 //#include "stm32f10x_flash.h"
 //#include "stm32f10x_fsmc.h"
 #include "stm32f10x_gpio.h"
 //#include "stm32f10x_i2c.h"
-//#include "stm32f10x_iwdg.h"
-//#include "stm32f10x_pwr.h"
+#include "stm32f10x_iwdg.h"
+#include "stm32f10x_pwr.h"
 #include "stm32f10x_rcc.h"
 //#include "stm32f10x_rtc.h"
 //#include "stm32f10x_sdio.h"
@@ -0,0 +1,181 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  telemetry_agg.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  遥测数据的多速率聚合, 使用方法见telemetry_agg.h
+ **
+ ** 【实现说明】  1- 每个窗口每个属性保存一组累加量(最小、最大、累加和、最新值、个数), 每个样本只做比较和加法;
+ **                  窗口结束时计算一次平均值, 锁存结果后清零累加量;
+ **               2- 取样时刻和窗口的结束时刻都按固定步长递增, 每个窗口的样本数固定;
+ **                  主循环被推迟超过一个周期时, 从当前时刻重新对齐, 不补出空样本和空窗口
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "telemetry_agg.h"
+#include <string.h>
+
+
+
+/*****************************************************************************
+ ** 本地定义
+ *****************************************************************************/
+typedef struct
+{
+    int16_t   min;
+    int16_t   max;
+    int16_t   last;
+    uint16_t  count;
+    int32_t   sum;
+} TelemAgg_Acc;
+
+static const uint32_t ulWindowMs[TELEM_WIN_NUM] = { TELEM_WIN_REPORT_MS, TELEM_WIN_MINUTE_MS };
+
+
+
+/*****************************************************************************
+ ** 本地变量
+ *****************************************************************************/
+static TelemAgg_Acc   xAcc[TELEM_WIN_NUM][TELEM_PROP_NUM];       // 正在累加的窗口
+static TelemAgg_Stat  xStat[TELEM_WIN_NUM][TELEM_PROP_NUM];      // 最近一个已结束的窗口
+static u64            ullCloseMs[TELEM_WIN_NUM];                 // 各窗口的结束时刻
+static int16_t        sRaw[TELEM_PROP_NUM][TELEM_RAW_NUM];       // 原始样本环形缓冲区
+static uint8_t        ucRawPos   = 0;                            // 下一个样本写入的位置
+static uint8_t        ucRawCount = 0;                            // 缓冲区中的样本数
+static u64            ullNextSampleMs = 0;                       // 下一次取样的时刻
+static bool           bStarted   = false;                        // 已取过第一个样本, 窗口已对齐
+
+
+
+/******************************************************************************
+ * 函  数： TelemAgg_Close
+ * 功  能： 结束一个窗口: 锁存统计结果, 清零累加量
+ ******************************************************************************/
+static void TelemAgg_Close(uint8_t win)
+{
+    for (uint8_t p = 0; p < TELEM_PROP_NUM; p++)
+    {
+        TelemAgg_Acc  *acc  = &xAcc[win][p];
+        TelemAgg_Stat *stat = &xStat[win][p];
+        if (acc->count == 0)
+            continue;
+        int32_t half = acc->count / 2;
+        stat->min   = acc->min;
+        stat->max   = acc->max;
+        stat->mean  = (int16_t)((acc->sum >= 0 ? acc->sum + half : acc->sum - half) / acc->count);
+        stat->last  = acc->last;
+        stat->count = acc->count;
+        acc->count  = 0;
+    }
+}
+
+/******************************************************************************
+ * 函  数： TelemAgg_Init
+ * 功  能： 清空所有窗口和原始样本
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void TelemAgg_Init(void)
+{
+    memset(xAcc, 0, sizeof(xAcc));
+    memset(xStat, 0, sizeof(xStat));
+    memset(sRaw, 0, sizeof(sRaw));
+    ucRawPos        = 0;
+    ucRawCount      = 0;
+    ullNextSampleMs = 0;
+    bStarted        = false;
+}
+
+/******************************************************************************
+ * 函  数： TelemAgg_Sample
+ * 功  能： 到达取样周期时加入一个样本, 更新各窗口, 结束到期的窗口
+ * 参  数： const int16_t value[]  各属性值(0.01单位), 顺序见TelemAgg_Prop
+ *          u64 nowMs              当前时刻(ms)
+ * 返回值： 本次结束的窗口, TELEM_WIN_BIT()位图; 未取样时为0
+ ******************************************************************************/
+uint8_t TelemAgg_Sample(const int16_t value[TELEM_PROP_NUM], u64 nowMs)
+{
+    if (bStarted && nowMs < ullNextSampleMs)
+        return 0;
+    if (!bStarted)
+    {
+        ullNextSampleMs = nowMs;
+        for (uint8_t w = 0; w < TELEM_WIN_NUM; w++)
+            ullCloseMs[w] = nowMs + ulWindowMs[w];
+        bStarted = true;
+    }
+    ullNextSampleMs += TELEM_SAMPLE_MS;                             // 固定步长, 取样时刻不随调用时刻漂移
+    if (ullNextSampleMs <= nowMs)
+        ullNextSampleMs = nowMs + TELEM_SAMPLE_MS;
+
+    // 1. 原始样本
+    for (uint8_t p = 0; p < TELEM_PROP_NUM; p++)
+        sRaw[p][ucRawPos] = value[p];
+    ucRawPos = (ucRawPos + 1) % TELEM_RAW_NUM;
+    if (ucRawCount < TELEM_RAW_NUM)
+        ucRawCount++;
+
+    // 2. 各窗口的累加量: 先到期的窗口不包含本样本, 本样本计入下一个窗口
+    uint8_t closed = 0;
+    for (uint8_t w = 0; w < TELEM_WIN_NUM; w++)
+    {
+        if (nowMs >= ullCloseMs[w])
+        {
+            TelemAgg_Close(w);
+            closed |= TELEM_WIN_BIT(w);
+            ullCloseMs[w] += ulWindowMs[w];
+            if (ullCloseMs[w] <= nowMs)
+                ullCloseMs[w] = nowMs + ulWindowMs[w];
+        }
+
+        for (uint8_t p = 0; p < TELEM_PROP_NUM; p++)
+        {
+            TelemAgg_Acc *acc = &xAcc[w][p];
+            int16_t v = value[p];
+            if (acc->count == 0)
+            {
+                acc->min = v;
+                acc->max = v;
+                acc->sum = 0;
+            }
+            if (v < acc->min)  acc->min = v;
+            if (v > acc->max)  acc->max = v;
+            acc->sum  += v;
+            acc->last  = v;
+            acc->count++;
+        }
+    }
+    return closed;
+}
+
+/******************************************************************************
+ * 函  数： TelemAgg_Get
+ * 功  能： 读取最近一个已结束窗口的统计结果
+ * 参  数： TelemAgg_Window win  窗口
+ *          TelemAgg_Prop prop   属性
+ * 返回值： 统计结果, 只读; count为0表示该窗口尚未结束过
+ ******************************************************************************/
+const TelemAgg_Stat *TelemAgg_Get(TelemAgg_Window win, TelemAgg_Prop prop)
+{
+    if (win >= TELEM_WIN_NUM)   win  = TELEM_WIN_REPORT;
+    if (prop >= TELEM_PROP_NUM) prop = TELEM_PROP_TEMP1;
+    return &xStat[win][prop];
+}
+
+/******************************************************************************
+ * 函  数： TelemAgg_Raw
+ * 功  能： 取某属性最近的原始样本
+ * 参  数： TelemAgg_Prop prop  属性
+ *          int16_t *out        输出缓存, 按时间先后排列
+ *          uint8_t num         最多取的个数
+ * 返回值： 实际取得的个数
+ ******************************************************************************/
+uint8_t TelemAgg_Raw(TelemAgg_Prop prop, int16_t *out, uint8_t num)
+{
+    if (prop >= TELEM_PROP_NUM)
+        return 0;
+    if (num > ucRawCount)
+        num = ucRawCount;
+    for (uint8_t k = 0; k < num; k++)
+        out[k] = sRaw[prop][(ucRawPos + TELEM_RAW_NUM - num + k) % TELEM_RAW_NUM];
+    return num;
+}
@@ -0,0 +1,80 @@
+#ifndef __TELEMETRY_AGG_H
+#define __TELEMETRY_AGG_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  telemetry_agg.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  遥测数据的多速率聚合: 以1Hz取样, 每个样本O(1)更新各统计窗口的最小、最大、累加、最新值;
+ **               窗口结束时锁存为最小/最大/平均/最新值并重新开始; 最近TELEM_RAW_NUM个1Hz原始样本保存在环形缓冲区中,
+ **               霜冻风险高时可随摘要一起上报, 其余时间只上报摘要, 上报频率和消息数量不变, 不会漏掉两次上报之间的短时降温
+ **
+ ** 【使用说明】  1- 上电后调用TelemAgg_Init();
+ **               2- 每次传感器结果更新后调用 TelemAgg_Sample(各属性值, 当前时刻), 到达取样周期时加入一个样本,
+ **                  返回本次结束的窗口(TELEM_WIN_BIT()位图), 未到取样周期或没有窗口结束时返回0;
+ **               3- 窗口结束后用TelemAgg_Get(窗口, 属性)读取该窗口的统计结果, 到下一次该窗口结束前保持不变;
+ **               4- TelemAgg_Raw(属性, 缓存, 个数) 取最近的原始样本, 按时间先后排列
+ **
+ ** 【注意事项】  属性值为0.01单位的整数(sensor_filter.h的GetCenti); 窗口与取样时刻对齐, 窗口长度应为TELEM_SAMPLE_MS的整数倍
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "system_f103.h"
+#include <stdbool.h>
+
+
+
+/*****************************************************************************
+ ** 移植配置
+****************************************************************************/
+#define TELEM_SAMPLE_MS            1000             // 取样周期(ms), 1Hz
+#define TELEM_WIN_REPORT_MS       15000             // 上报窗口(ms): 每个窗口结束时上报一次摘要
+#define TELEM_WIN_MINUTE_MS       60000             // 分钟统计窗口(ms)
+#define TELEM_RAW_NUM                60             // 保存的原始样本数, 60 x 1s = 1分钟
+
+
+
+/*****************************************************************************
+ ** 数据类型
+****************************************************************************/
+typedef enum
+{
+    TELEM_PROP_TEMP1 = 0,                           // 监测点1温度
+    TELEM_PROP_TEMP2,                               // 监测点2温度
+    TELEM_PROP_TEMP3,                               // 监测点3温度
+    TELEM_PROP_TEMP4,                               // 监测点4温度
+    TELEM_PROP_AMBIENT,                             // 环境温度
+    TELEM_PROP_HUMIDITY,                            // 环境湿度
+    TELEM_PROP_NUM                                  // 数量, 不是属性
+} TelemAgg_Prop;
+
+typedef enum
+{
+    TELEM_WIN_REPORT = 0,                           // 上报窗口
+    TELEM_WIN_MINUTE,                               // 分钟统计窗口
+    TELEM_WIN_NUM                                   // 数量, 不是窗口
+} TelemAgg_Window;
+
+#define TELEM_WIN_BIT(win)      (1U << (win))
+
+typedef struct
+{
+    int16_t   min;                                  // 窗口内最小值
+    int16_t   max;                                  // 窗口内最大值
+    int16_t   mean;                                 // 窗口内平均值(四舍五入)
+    int16_t   last;                                 // 窗口内最后一个样本
+    uint16_t  count;                                // 窗口内样本数; 0=尚无结束的窗口, 其余字段无效
+} TelemAgg_Stat;
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+void     TelemAgg_Init(void);                                                       // 清空所有窗口和原始样本
+uint8_t  TelemAgg_Sample(const int16_t value[TELEM_PROP_NUM], u64 nowMs);           // 取样; 返回本次结束的窗口位图
+const TelemAgg_Stat *TelemAgg_Get(TelemAgg_Window win, TelemAgg_Prop prop);         // 最近一个已结束窗口的统计结果
+uint8_t  TelemAgg_Raw(TelemAgg_Prop prop, int16_t *out, uint8_t num);               // 最近num个原始样本, 返回实际个数
+
+
+
+#endif
@@ -0,0 +1,347 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  bsp_actuator.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  防霜执行器驱动, 使用方法见bsp_actuator.h
+ **
+ ** 【实现说明】  1- 每个执行周期对每个通道依次: 故障处理 -> 互锁、错开启动判断 -> 软启动 -> 写输出 -> 反馈检测, 没有等待和循环重试,
+ **                  耗时固定; 周期被主循环推迟时不补算, 各超时都按实际时刻计算;
+ **               2- 互锁仲裁: 互斥的两个通道都请求开启时, 先请求的优先; 已开启的通道不会被后请求的通道抢占;
+ **               3- 反馈检测: 输出状态与反馈不一致持续超过该通道的反馈超时, 判为故障; 超时包含了启动时间(水压建立、风扇起转)
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "bsp_actuator.h"
+#include "bsp_pwm.h"
+#include <string.h>
+
+
+
+/*****************************************************************************
+ ** 本地定义
+ *****************************************************************************/
+#define ACT_KIND_GPIO       0                       // 开关通道
+#define ACT_KIND_PWM        1                       // PWM通道
+#define ACT_RAMP_STEP       ((uint16_t)(ACT_RAMP_PERMILLE_PER_S * ACT_TICK_MS / 1000))     // 每个执行周期的软启动步长
+
+#define ACT_BIT(id)         (1U << (id))
+
+typedef enum
+{
+    ACT_FAULT_NONE = 0,
+    ACT_FAULT_NO_FEEDBACK,                          // 已开启, 没有电流/流量
+    ACT_FAULT_STUCK_ON,                             // 已关闭, 仍有电流/流量(继电器粘连、阀门卡住)
+} Actuator_Fault;
+
+// 各通道的硬件和参数; 顺序与Actuator_Id相同
+static const struct
+{
+    const char   *name;
+    uint8_t       kind;                             // ACT_KIND_GPIO / ACT_KIND_PWM
+    GPIO_TypeDef *gpio;                             // 开关通道的输出引脚, 高电平开启
+    uint16_t      pin;
+    Pwm_Channel   pwm;                              // PWM通道
+    GPIO_TypeDef *fbGpio;                           // 反馈输入引脚; NULL=没有反馈电路
+    uint16_t      fbPin;
+    uint8_t       fbActiveHigh;                     // 1=有电流/流量时为高电平
+    uint16_t      fbTimeoutMs;                      // 输出与反馈不一致超过此时间判为故障
+    uint8_t       interlock;                        // 互斥的通道, ACT_BIT()位图
+} xActCfg[ACT_NUM] =
+{
+    { "sprinkler", ACT_KIND_GPIO, GPIOB, GPIO_Pin_12, PWM_CH_NUM, GPIOB, GPIO_Pin_15, 0, 5000, ACT_BIT(ACT_HEATER)    },
+    { "fan",       ACT_KIND_PWM,  NULL,  0,           PWM_CH_FAN, GPIOC, GPIO_Pin_6,  1, 3000, 0                     },
+    { "heater",    ACT_KIND_GPIO, GPIOB, GPIO_Pin_13, PWM_CH_NUM, GPIOC, GPIO_Pin_7,  1, 2000, ACT_BIT(ACT_SPRINKLER) },
+};
+
+typedef struct
+{
+    uint16_t        request;                        // 请求值, 千分比
+    uint16_t        output;                         // 实际输出, 千分比
+    Actuator_State  state;
+    Actuator_Fault  fault;
+    bool            mismatch;                       // 输出与反馈不一致
+    u64             mismatchMs;                     // 开始不一致的时刻
+    u64             requestMs;                      // 请求由关闭变为开启的时刻, 用于互锁仲裁
+    u64             changeMs;                       // 输出上一次开、关切换的时刻
+    u64             faultUntilMs;                   // 故障自动清除的时刻
+} Actuator_Channel;
+
+
+
+/*****************************************************************************
+ ** 本地变量
+ *****************************************************************************/
+static Actuator_Channel  xChannel[ACT_NUM];
+static u64               ullNextTickMs  = 0;        // 下一个执行周期的时刻
+static u64               ullLastStartMs = 0;        // 最近一次有通道由关闭变为开启的时刻
+static bool              bAnyStarted    = false;    // 上电后是否已有通道开启过
+static uint8_t           ucAvailable    = 0;        // 可用的通道, ACT_BIT()位图
+
+static const char *const pcStateName[] = { "OFF", "WAIT", "RAMP", "ON", "FAULT" };
+static const char *const pcFaultName[] = { "none", "no feedback", "stuck on" };
+
+
+
+/******************************************************************************
+ * 函  数： Actuator_Write
+ * 功  能： 写某通道的输出
+ ******************************************************************************/
+static void Actuator_Write(uint8_t id, uint16_t permille)
+{
+    if (xActCfg[id].kind == ACT_KIND_PWM)
+        Pwm_SetPermille(xActCfg[id].pwm, permille);
+    else if (permille > 0)
+        xActCfg[id].gpio->BSRR = xActCfg[id].pin;
+    else
+        xActCfg[id].gpio->BRR  = xActCfg[id].pin;
+    xChannel[id].output = permille;
+}
+
+/******************************************************************************
+ * 函  数： Actuator_Feedback
+ * 功  能： 读取某通道的反馈
+ * 返回值： true=检测到电流/流量; 没有反馈电路的通道返回当前是否开启(即总是与输出一致)
+ ******************************************************************************/
+static bool Actuator_Feedback(uint8_t id)
+{
+    if (xActCfg[id].fbGpio == NULL)
+        return xChannel[id].output > 0;
+    bool high = (xActCfg[id].fbGpio->IDR & xActCfg[id].fbPin) != 0;
+    return high == (xActCfg[id].fbActiveHigh != 0);
+}
+
+/******************************************************************************
+ * 函  数： Actuator_InterlockFree
+ * 功  能： 判断某通道的互斥通道是否都已关闭、反馈已消失、死区已过, 且没有更早的请求
+ ******************************************************************************/
+static bool Actuator_InterlockFree(uint8_t id, u64 nowMs)
+{
+    for (uint8_t j = 0; j < ACT_NUM; j++)
+    {
+        if (!(xActCfg[id].interlock & ACT_BIT(j)))
+            continue;
+        const Actuator_Channel *other = &xChannel[j];
+        if (other->output > 0 || Actuator_Feedback(j))
+            return false;
+        if (nowMs - other->changeMs < ACT_INTERLOCK_DEAD_MS)
+            return false;
+        // 本通道尚未开启时, 让先请求的互斥通道优先; 时刻相同时编号小的优先
+        if (xChannel[id].output == 0 && other->request > 0 && other->fault == ACT_FAULT_NONE &&
+            (other->requestMs < xChannel[id].requestMs || (other->requestMs == xChannel[id].requestMs && j < id)))
+            return false;
+    }
+    return true;
+}
+
+/******************************************************************************
+ * 函  数： Actuator_Step
+ * 功  能： 执行一个通道的一个周期
+ ******************************************************************************/
+static void Actuator_Step(uint8_t id, u64 nowMs)
+{
+    Actuator_Channel *ch = &xChannel[id];
+    bool fb = Actuator_Feedback(id);
+
+    // 1. 故障: 保持关闭, 到时且反馈已消失后清除, 重新尝试
+    if (ch->fault != ACT_FAULT_NONE)
+    {
+        if (nowMs < ch->faultUntilMs || fb)
+            return;
+        printf("ACT: %s fault cleared, retry\r\n", xActCfg[id].name);
+        ch->fault    = ACT_FAULT_NONE;
+        ch->mismatch = false;
+    }
+
+    // 2. 目标输出: 互锁或错开启动未满足时暂不开启
+    uint16_t target = ch->request;
+    bool     wait   = false;
+    if (target > 0 && !Actuator_InterlockFree(id, nowMs))
+        wait = true;
+    else if (target > 0 && ch->output == 0 && bAnyStarted && nowMs - ullLastStartMs < ACT_STAGGER_MS)
+        wait = true;
+    if (wait)
+        target = 0;
+
+    // 3. 软启动: PWM通道按步长升高, 降低和开关通道立即生效
+    uint16_t next = target;
+    if (xActCfg[id].kind == ACT_KIND_GPIO)
+        next = target ? 1000 : 0;
+    else if (target > ch->output + ACT_RAMP_STEP)
+        next = ch->output + ACT_RAMP_STEP;
+
+    if ((next > 0) != (ch->output > 0))
+    {
+        ch->changeMs = nowMs;
+        if (next > 0)
+        {
+            ullLastStartMs = nowMs;
+            bAnyStarted    = true;
+        }
+    }
+    if (next != ch->output)
+        Actuator_Write(id, next);
+
+    if (next == 0)
+        ch->state = wait ? ACT_STATE_WAIT : ACT_STATE_OFF;
+    else
+        ch->state = (xActCfg[id].kind == ACT_KIND_PWM && next < target) ? ACT_STATE_RAMP : ACT_STATE_ON;
+
+    // 4. 反馈检测: 不一致从输出切换后开始计时, 超时判为故障
+    if (xActCfg[id].fbGpio == NULL)
+        return;
+    bool expect = ch->output > 0;
+    if (fb == expect)
+    {
+        ch->mismatch = false;
+        return;
+    }
+    if (!ch->mismatch)
+    {
+        ch->mismatch   = true;
+        ch->mismatchMs = nowMs;
+        return;
+    }
+    if (nowMs - ch->mismatchMs < xActCfg[id].fbTimeoutMs)
+        return;
+
+    ch->fault        = expect ? ACT_FAULT_NO_FEEDBACK : ACT_FAULT_STUCK_ON;
+    ch->faultUntilMs = nowMs + ACT_FAULT_RETRY_MS;
+    ch->state        = ACT_STATE_FAULT;
+    if (ch->output > 0)
+    {
+        ch->changeMs = nowMs;
+        Actuator_Write(id, 0);
+    }
+    printf("ACT: %s fault: %s\r\n", xActCfg[id].name, pcFaultName[ch->fault]);
+}
+
+/******************************************************************************
+ * 函  数： Actuator_Init
+ * 功  能： 配置输出引脚(先置为关闭再切换为输出, 上电不会误动作)、反馈输入引脚, 各通道关闭
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void Actuator_Init(void)
+{
+    GPIO_InitTypeDef GPIO_InitStructure;
+
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOB | RCC_APB2Periph_GPIOC, ENABLE);
+
+    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_2MHz;
+    for (uint8_t i = 0; i < ACT_NUM; i++)
+    {
+        memset(&xChannel[i], 0, sizeof(xChannel[i]));
+        if (xActCfg[i].kind == ACT_KIND_GPIO)
+        {
+            xActCfg[i].gpio->BRR          = xActCfg[i].pin;
+            GPIO_InitStructure.GPIO_Pin   = xActCfg[i].pin;
+            GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_Out_PP;
+            GPIO_Init(xActCfg[i].gpio, &GPIO_InitStructure);
+        }
+        Actuator_Write(i, 0);
+
+        if (xActCfg[i].fbGpio != NULL)
+        {
+            GPIO_InitStructure.GPIO_Pin   = xActCfg[i].fbPin;
+            GPIO_InitStructure.GPIO_Mode  = xActCfg[i].fbActiveHigh ? GPIO_Mode_IPD : GPIO_Mode_IPU;
+            GPIO_Init(xActCfg[i].fbGpio, &GPIO_InitStructure);
+        }
+    }
+
+    ullNextTickMs  = 0;
+    ullLastStartMs = 0;
+    bAnyStarted    = false;
+    ucAvailable    = (uint8_t)(ACT_BIT(ACT_NUM) - 1);
+
+    printf("执行器 初始化         %u通道, 周期%ums\r", ACT_NUM, ACT_TICK_MS);
+}
+
+/******************************************************************************
+ * 函  数： Actuator_Request
+ * 功  能： 设置某通道的请求值; 只记录, 由Actuator_Task在下一个执行周期执行
+ * 参  数： Actuator_Id id     通道
+ *          uint16_t permille  0=关闭; 开关通道非0即开启; PWM通道为占空比, 超过1000按1000
+ * 返回值： 无
+ ******************************************************************************/
+void Actuator_Request(Actuator_Id id, uint16_t permille)
+{
+    if (id >= ACT_NUM)
+        return;
+    if (permille > 1000)
+        permille = 1000;
+    if (xChannel[id].request == 0 && permille > 0)
+        xChannel[id].requestMs = System_GetTimeMs();
+    xChannel[id].request = permille;
+}
+
+/******************************************************************************
+ * 函  数： Actuator_Task
+ * 功  能： 到达执行周期时执行各通道一次
+ * 参  数： u64 nowMs  当前时刻
+ * 返回值： true=某通道的可用性发生变化
+ ******************************************************************************/
+bool Actuator_Task(u64 nowMs)
+{
+    if (nowMs < ullNextTickMs)
+        return false;
+    ullNextTickMs = nowMs + ACT_TICK_MS;
+
+    uint8_t available = 0;
+    for (uint8_t i = 0; i < ACT_NUM; i++)
+    {
+        Actuator_Step(i, nowMs);
+        if (xChannel[i].fault == ACT_FAULT_NONE)
+            available |= ACT_BIT(i);
+    }
+
+    bool changed = (available != ucAvailable);
+    ucAvailable = available;
+    return changed;
+}
+
+/******************************************************************************
+ * 函  数： Actuator_IsAvailable
+ * 功  能： 某通道是否可用(没有反馈故障)
+ * 参  数： Actuator_Id id  通道
+ * 返回值： true=可用
+ ******************************************************************************/
+bool Actuator_IsAvailable(Actuator_Id id)
+{
+    return (id < ACT_NUM) && (ucAvailable & ACT_BIT(id));
+}
+
+/******************************************************************************
+ * 函  数： Actuator_GetState
+ * 功  能： 读取某通道的当前状态
+ * 参  数： Actuator_Id id  通道
+ * 返回值： 状态
+ ******************************************************************************/
+Actuator_State Actuator_GetState(Actuator_Id id)
+{
+    return (id < ACT_NUM) ? xChannel[id].state : ACT_STATE_OFF;
+}
+
+/******************************************************************************
+ * 函  数： Actuator_GetOutput
+ * 功  能： 读取某通道的实际输出
+ * 参  数： Actuator_Id id  通道
+ * 返回值： 千分比; 开关通道为0或1000
+ ******************************************************************************/
+uint16_t Actuator_GetOutput(Actuator_Id id)
+{
+    return (id < ACT_NUM) ? xChannel[id].output : 0;
+}
+
+/******************************************************************************
+ * 函  数： Actuator_Name / Actuator_StateName
+ * 功  能： 通道、状态的名称, 用于日志
+ ******************************************************************************/
+const char *Actuator_Name(Actuator_Id id)
+{
+    return (id < ACT_NUM) ? xActCfg[id].name : "?";
+}
+
+const char *Actuator_StateName(Actuator_State state)
+{
+    return ((unsigned)state < sizeof(pcStateName) / sizeof(pcStateName[0])) ? pcStateName[state] : "?";
+}
@@ -0,0 +1,75 @@
+#ifndef __BSP__ACTUATOR_H
+#define __BSP__ACTUATOR_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  bsp_actuator.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  防霜执行器驱动: 喷淋电磁阀、风扇、加热器; 调用者只设置请求, 由周期任务执行:
+ **               风扇PWM软启动(按斜率逐步升高)、各通道错开启动(避免冲击电流叠加)、互斥通道互锁(喷淋与加热不同时开启, 切换时留死区),
+ **               电流/流量反馈检测: 开启后没有反馈、或关闭后仍有反馈, 判为故障, 关闭输出并标记为不可用, 一段时间后自动重试
+ **
+ ** 【硬件重点】  1- 喷淋电磁阀: PB12, 推挽输出, 高电平开启(经继电器/MOS驱动); 反馈为水流开关 PB15, 有水流时接地(低电平有效, 上拉输入);
+ **               2- 风扇: PWM_CH_FAN(TIM3_CH1 PA6), 见bsp_pwm.h; 反馈为电流检测比较器 PC6, 有电流时高电平(下拉输入);
+ **               3- 加热器: PB13, 推挽输出, 高电平开启(经固态继电器); 反馈为电流互感器比较器 PC7, 有电流时高电平(下拉输入);
+ **               4- 没有反馈电路的通道, 在bsp_actuator.c的通道表中把反馈引脚填NULL, 该通道不做反馈检测, 始终可用
+ **
+ ** 【使用说明】  1- 上电后先调用Pwm_Init(), 再调用Actuator_Init(), 各通道输出关闭;
+ **               2- Actuator_Request(ACT_HEATER, 1000);       // 请求开启; 开关通道非0即开, PWM通道为占空比千分比; 只记录请求, 立即返回
+ **               3- 在main的while中调用Actuator_Task(当前时刻), 每ACT_TICK_MS执行一次, 每次只处理ACT_NUM个通道, 不等待;
+ **                  返回true表示某通道的可用性发生变化, 用Actuator_IsAvailable()读取
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "system_f103.h"
+#include <stdbool.h>
+
+
+
+/*****************************************************************************
+ ** 移植配置
+****************************************************************************/
+#define ACT_TICK_MS                   20            // 执行周期(ms)
+#define ACT_RAMP_PERMILLE_PER_S      500            // PWM通道软启动斜率: 每秒最多升高50.0%, 从0到满功率2秒; 降低不限速
+#define ACT_STAGGER_MS               500            // 两个通道开启的最小间隔(ms), 错开冲击电流
+#define ACT_INTERLOCK_DEAD_MS       2000            // 互锁死区: 互斥通道关闭(且反馈消失)后, 再等待2秒才开启另一通道
+#define ACT_FAULT_RETRY_MS   (10UL * 60 * 1000)     // 故障后10分钟自动清除, 重新尝试
+
+
+
+/*****************************************************************************
+ ** 数据类型
+****************************************************************************/
+typedef enum
+{
+    ACT_SPRINKLER = 0,                              // 喷淋电磁阀   开关
+    ACT_FAN,                                        // 风扇         PWM
+    ACT_HEATER,                                     // 加热器       开关
+    ACT_NUM                                         // 数量, 不是通道
+} Actuator_Id;
+
+typedef enum
+{
+    ACT_STATE_OFF = 0,                              // 关闭, 没有请求
+    ACT_STATE_WAIT,                                 // 已请求, 等待互锁死区或错开启动
+    ACT_STATE_RAMP,                                 // 软启动中, 输出低于请求值
+    ACT_STATE_ON,                                   // 已按请求值输出
+    ACT_STATE_FAULT,                                // 反馈故障, 输出关闭, 不可用
+} Actuator_State;
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+void           Actuator_Init(void);                                     // 初始化输出、反馈引脚, 各通道关闭
+void           Actuator_Request(Actuator_Id id, uint16_t permille);     // 设置请求值, 0=关闭; 只记录, 由Actuator_Task执行
+bool           Actuator_Task(u64 nowMs);                                // 周期执行; true=某通道可用性变化
+bool           Actuator_IsAvailable(Actuator_Id id);                    // 没有故障
+Actuator_State Actuator_GetState(Actuator_Id id);                       // 当前状态
+uint16_t       Actuator_GetOutput(Actuator_Id id);                      // 当前实际输出, 千分比
+const char    *Actuator_Name(Actuator_Id id);                           // 通道名称, 用于日志
+const char    *Actuator_StateName(Actuator_State state);                // 状态名称, 用于日志
+
+
+
+#endif
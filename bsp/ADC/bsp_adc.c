@@ -0,0 +1,233 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  bsp_adc.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  模拟量连续采集, 使用方法见bsp_adc.h
+ **
+ ** 【实现说明】  DMA循环模式, 缓冲区分为前后两半: 半传输中断 = 前一半就绪, 传输完成中断 = 后一半就绪;
+ **               中断中只把就绪计数加1, 就绪的是哪一半由计数的奇偶决定; 主循环取走第n块时, DMA正在写另一半,
+ **               只要在第n+1块就绪前调用AdcSampler_Done(), 读到的数据就是完整的
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "bsp_adc.h"
+#include "irq_stats.h"
+#include <string.h>
+
+
+
+/*****************************************************************************
+ ** 本地变量
+ *****************************************************************************/
+// 各采集通道对应的引脚、ADC通道号; 顺序与AdcSampler_Channel相同
+static const struct
+{
+    GPIO_TypeDef *gpio;                             // NULL=内部通道, 没有引脚
+    uint16_t      pin;
+    uint8_t       adcChannel;
+} xAdcChannels[ADC_CH_NUM] =
+{
+    { GPIOC, GPIO_Pin_0, 10 },                      // ADC_CH_TEMP1
+    { GPIOC, GPIO_Pin_1, 11 },                      // ADC_CH_TEMP2
+    { GPIOC, GPIO_Pin_2, 12 },                      // ADC_CH_TEMP3
+    { GPIOC, GPIO_Pin_3, 13 },                      // ADC_CH_TEMP4
+    { GPIOC, GPIO_Pin_4, 14 },                      // ADC_CH_AMBIENT
+    { GPIOC, GPIO_Pin_5, 15 },                      // ADC_CH_HUMIDITY
+    { NULL,  0,          17 },                      // ADC_CH_VREFINT
+};
+
+static AdcSampler_Scan   xAdcBuf[2][ADC_BLOCK_SCANS];   // DMA双缓冲区
+static volatile uint32_t ulReadySeq = 0;           // 已就绪的数据块数, 由DMA中断递增
+static uint32_t          ulTakenSeq = 0;           // 主循环最近取走的数据块序号
+static bool              bHolding   = false;       // 主循环正在处理ulTakenSeq号数据块
+static AdcSampler_Stats  xAdcStats;
+
+
+
+/******************************************************************************
+ * 函  数： AdcSampler_Init
+ * 功  能： 配置引脚、ADC1扫描序列、DMA1通道1、TIM2触发, 并开始连续采集
+ *          采样时间取239.5周期(ADCCLK=12MHz时每通道21us), 适应分压电阻较大的热敏电阻电路, 内部参考电压要求不少于17.1us
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void AdcSampler_Init(void)
+{
+    GPIO_InitTypeDef  GPIO_InitStructure;
+    NVIC_InitTypeDef  NVIC_InitStructure;
+
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOC | RCC_APB2Periph_ADC1, ENABLE);
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+    RCC_ADCCLKConfig(RCC_PCLK2_Div6);                               // ADCCLK = 72MHz / 6 = 12MHz, 不能超过14MHz
+
+    // 引脚: 模拟输入
+    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_AIN;
+    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_2MHz;
+    for (uint8_t i = 0; i < ADC_CH_NUM; i++)
+    {
+        if (xAdcChannels[i].gpio == NULL)
+            continue;
+        GPIO_InitStructure.GPIO_Pin = xAdcChannels[i].pin;
+        GPIO_Init(xAdcChannels[i].gpio, &GPIO_InitStructure);
+    }
+
+    // ADC1: 上电、校准
+    ADC1->CR1 = 0;
+    ADC1->CR2 = ADC_CR2_ADON;
+    System_DelayMS(1);                                              // 上电稳定时间, 校准前至少2个ADC周期
+    ADC1->CR2 |= ADC_CR2_RSTCAL;
+    while (ADC1->CR2 & ADC_CR2_RSTCAL);
+    ADC1->CR2 |= ADC_CR2_CAL;
+    while (ADC1->CR2 & ADC_CR2_CAL);
+
+    // ADC1: 扫描序列、采样时间
+    ADC1->SMPR1 = 0;
+    ADC1->SMPR2 = 0;
+    ADC1->SQR1  = (uint32_t)(ADC_CH_NUM - 1) << 20;                 // 序列长度
+    ADC1->SQR2  = 0;
+    ADC1->SQR3  = 0;
+    for (uint8_t i = 0; i < ADC_CH_NUM; i++)
+    {
+        uint8_t ch = xAdcChannels[i].adcChannel;
+        if (ch >= 10)  ADC1->SMPR1 |= 7UL << (3 * (ch - 10));       // 239.5周期
+        else           ADC1->SMPR2 |= 7UL << (3 * ch);
+
+        if (i < 6)        ADC1->SQR3 |= (uint32_t)ch << (5 * i);
+        else if (i < 12)  ADC1->SQR2 |= (uint32_t)ch << (5 * (i - 6));
+        else              ADC1->SQR1 |= (uint32_t)ch << (5 * (i - 12));
+    }
+
+    // DMA1通道1: 外设到存储器, 16位, 循环, 半传输+传输完成中断
+    DMA1_Channel1->CCR   = 0;                                       // 失能， 清0整个寄存器, DMA必须失能才能配置
+    DMA1_Channel1->CPAR  = (uint32_t)&ADC1->DR;
+    DMA1_Channel1->CMAR  = (uint32_t)xAdcBuf;
+    DMA1_Channel1->CNDTR = sizeof(xAdcBuf) / sizeof(uint16_t);
+    DMA1->IFCR = DMA_IFCR_CGIF1;
+    DMA1_Channel1->CCR   = DMA_CCR1_MINC | DMA_CCR1_CIRC | DMA_CCR1_PSIZE_0 | DMA_CCR1_MSIZE_0 |
+                           DMA_CCR1_HTIE | DMA_CCR1_TCIE | DMA_CCR1_PL_0 | DMA_CCR1_EN;   // 中等优先级, 低于串口接收
+
+    NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel1_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 3;       // 只记录就绪计数, 不需要抢占其它中断
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 3;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+
+    // ADC1: 扫描模式, TIM2_CC2触发, DMA, 开启内部参考电压; 同时修改了ADON以外的位, 本次写入不会启动转换
+    ADC1->CR1 = ADC_CR1_SCAN;
+    ADC1->CR2 = ADC_CR2_ADON | ADC_CR2_DMA | ADC_CR2_EXTTRIG | (3UL << 17) | ADC_CR2_TSVREFE;
+
+    // TIM2: 计数时钟1MHz(APB1分频后定时器时钟为2倍, 即SystemCoreClock), 每个周期CC2产生一次上升沿, 触发一次扫描
+    TIM2->CR1   = 0;
+    TIM2->PSC   = SystemCoreClock / 1000000 - 1;
+    TIM2->ARR   = 1000000 / ADC_SCAN_RATE_HZ - 1;
+    TIM2->CCR2  = (1000000 / ADC_SCAN_RATE_HZ) / 2;
+    TIM2->CCMR1 = TIM_CCMR1_OC2M_2 | TIM_CCMR1_OC2M_1;              // PWM模式1
+    TIM2->CCER  = TIM_CCER_CC2E;                                    // PA1未配置为复用功能, 不会输出到引脚
+    TIM2->EGR   = TIM_EGR_UG;
+    TIM2->CR1   = TIM_CR1_CEN;
+
+    printf("ADC1 初始化           %u通道, 扫描%uHz, DMA双缓冲%u次/块\r", ADC_CH_NUM, ADC_SCAN_RATE_HZ, ADC_BLOCK_SCANS);
+}
+
+/******************************************************************************
+ * 函  数： AdcSampler_Get
+ * 功  能： 取最新就绪的数据块; 上一块未调用AdcSampler_Done()时视为已处理完
+ * 参  数： AdcSampler_Block *block  数据块的存放地址
+ * 返回值： true=取到新数据块; false=自上次以来没有新数据块
+ ******************************************************************************/
+bool AdcSampler_Get(AdcSampler_Block *block)
+{
+    if (bHolding)
+        AdcSampler_Done();
+
+    uint32_t seq = ulReadySeq;
+    if (seq == ulTakenSeq)
+        return false;
+
+    xAdcStats.dropped += seq - ulTakenSeq - 1;      // 更早的数据块所在的一半已被DMA重新写入
+    ulTakenSeq = seq;
+    bHolding   = true;
+
+    block->scans = xAdcBuf[(seq - 1) & 1];
+    block->seq   = seq;
+    return true;
+}
+
+/******************************************************************************
+ * 函  数： AdcSampler_Done
+ * 功  能： 数据块处理完毕; 处理期间下一块已就绪时, DMA已开始覆盖本块, 计入overruns
+ * 参  数： 无
+ * 返回值： true=处理期间数据完整; false=已被覆盖, 本次处理结果应丢弃
+ ******************************************************************************/
+bool AdcSampler_Done(void)
+{
+    if (!bHolding)
+        return false;
+    bHolding = false;
+
+    xAdcStats.blocks++;
+    if (ulReadySeq != ulTakenSeq)
+    {
+        xAdcStats.overruns++;
+        return false;
+    }
+    return true;
+}
+
+/******************************************************************************
+ * 函  数： AdcSampler_Mean
+ * 功  能： 计算数据块中某通道的平均原始值
+ * 参  数： const AdcSampler_Block *block  数据块
+ *          AdcSampler_Channel ch          通道
+ * 返回值： 平均值, 0~4095
+ ******************************************************************************/
+uint16_t AdcSampler_Mean(const AdcSampler_Block *block, AdcSampler_Channel ch)
+{
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < ADC_BLOCK_SCANS; i++)
+        sum += block->scans[i][ch];
+    return (uint16_t)((sum + ADC_BLOCK_SCANS / 2) / ADC_BLOCK_SCANS);
+}
+
+/******************************************************************************
+ * 函  数： AdcSampler_ToMillivolts
+ * 功  能： 按内部参考电压的读数, 把原始值换算成电压; 不依赖VDDA的实际值
+ * 参  数： uint32_t code      原始值(可以是多次采样之和, 与vrefCode同倍数即可)
+ *          uint32_t vrefCode  同时刻内部参考电压的原始值
+ * 返回值： 电压(mV); vrefCode为0时返回0
+ ******************************************************************************/
+uint32_t AdcSampler_ToMillivolts(uint32_t code, uint32_t vrefCode)
+{
+    if (vrefCode == 0)
+        return 0;
+    return (uint32_t)(((uint64_t)code * ADC_VREFINT_MV + vrefCode / 2) / vrefCode);
+}
+
+/******************************************************************************
+ * 函  数： AdcSampler_GetStats
+ * 功  能： 读取统计数据
+ * 参  数： AdcSampler_Stats *stats  统计数据的存放地址
+ * 返回值： 无
+ ******************************************************************************/
+void AdcSampler_GetStats(AdcSampler_Stats *stats)
+{
+    *stats = xAdcStats;
+}
+
+
+
+// DMA1通道1中断服务函数: 半传输 = 前一半就绪, 传输完成 = 后一半就绪
+void DMA1_Channel1_IRQHandler(void)
+{
+    IRQ_STATS_ENTER();
+
+    uint32_t isr = DMA1->ISR;
+    DMA1->IFCR = DMA_IFCR_CGIF1;                    // 清除本通道全部标志
+    if (isr & DMA_ISR_HTIF1)
+        ulReadySeq++;
+    if (isr & DMA_ISR_TCIF1)
+        ulReadySeq++;
+
+    IRQ_STATS_EXIT(IRQ_ID_DMA1_CH1);
+}
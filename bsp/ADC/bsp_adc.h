@@ -0,0 +1,81 @@
+#ifndef __BSP__ADC_H
+#define __BSP__ADC_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  bsp_adc.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  模拟量连续采集: TIM2按固定频率触发ADC1扫描全部通道, DMA循环写入双缓冲区,
+ **               每填满半个缓冲区(一个数据块)产生一次中断; 中断中只记录哪一半已就绪, 数据在主循环中处理
+ **
+ ** 【硬件重点】  1- 温度1~4: PC0~PC3 (ADC通道10~13), 环境温度: PC4 (通道14), 湿度: PC5 (通道15), 内部参考电压 (通道17);
+ **               2- 占用TIM2(CC2作为ADC触发, 不输出到引脚)、ADC1、DMA1通道1
+ **
+ ** 【使用说明】  1- 上电后调用AdcSampler_Init(), 之后采样在后台持续进行, 不占用CPU;
+ **               2- 在main的while中调用 AdcSampler_Get(&block), 返回true时 block.scans[i][ch] 为第i次扫描、通道ch的原始值;
+ **               3- 处理完后调用 AdcSampler_Done(), 返回false表示处理期间数据块已被DMA覆盖, 本次结果应丢弃;
+ **               4- 两次AdcSampler_Get()的间隔超过一个数据块的时长(ADC_BLOCK_SCANS / ADC_SCAN_RATE_HZ)时, 中间的数据块会被跳过, 计入dropped
+ **
+ ** 【注意事项】  扫描顺序与 AdcSampler_Channel 的顺序相同; 内部参考电压用于换算实际的VDDA, 不依赖3.3V电源的精度
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "system_f103.h"
+#include <stdbool.h>
+
+
+
+/*****************************************************************************
+ ** 移植配置
+****************************************************************************/
+#define ADC_SCAN_RATE_HZ         1000               // 每秒扫描次数(每次扫描转换全部通道); 须使 1000000 / ADC_SCAN_RATE_HZ 为整数
+#define ADC_BLOCK_SCANS            32               // 每个数据块(半个缓冲区)包含的扫描次数; 数据块时长 = 32ms
+#define ADC_VREFINT_MV           1200               // 内部参考电压的典型值(mV), 见数据手册
+
+
+
+/*****************************************************************************
+ ** 采集通道, 顺序即扫描顺序
+****************************************************************************/
+typedef enum
+{
+    ADC_CH_TEMP1 = 0,                               // 温度1      PC0
+    ADC_CH_TEMP2,                                   // 温度2      PC1
+    ADC_CH_TEMP3,                                   // 温度3      PC2
+    ADC_CH_TEMP4,                                   // 温度4      PC3
+    ADC_CH_AMBIENT,                                 // 环境温度   PC4
+    ADC_CH_HUMIDITY,                                // 湿度       PC5
+    ADC_CH_VREFINT,                                 // 内部参考电压
+    ADC_CH_NUM                                      // 数量, 不是通道
+} AdcSampler_Channel;
+
+typedef uint16_t AdcSampler_Scan[ADC_CH_NUM];       // 一次扫描的结果, 12位原始值
+
+// 一个已就绪的数据块
+typedef struct
+{
+    const AdcSampler_Scan *scans;                   // ADC_BLOCK_SCANS次扫描的结果, 指向DMA缓冲区, 不复制
+    uint32_t               seq;                     // 数据块序号, 从1开始递增; 不连续说明中间有数据块被跳过
+} AdcSampler_Block;
+
+typedef struct
+{
+    uint32_t  blocks;                               // 已处理的数据块数
+    uint32_t  dropped;                              // 主循环来不及取走而被跳过的数据块数
+    uint32_t  overruns;                             // 处理期间被DMA覆盖的数据块数
+} AdcSampler_Stats;
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+void     AdcSampler_Init(void);                                         // 初始化并开始连续采集
+bool     AdcSampler_Get(AdcSampler_Block *block);                       // 取最新就绪的数据块; false=没有新数据块
+bool     AdcSampler_Done(void);                                         // 处理完毕; false=处理期间已被覆盖
+uint16_t AdcSampler_Mean(const AdcSampler_Block *block, AdcSampler_Channel ch);  // 数据块中某通道的平均原始值
+uint32_t AdcSampler_ToMillivolts(uint32_t code, uint32_t vrefCode);    // 按内部参考电压把原始值换算成mV
+void     AdcSampler_GetStats(AdcSampler_Stats *stats);                  // 读取统计数据
+
+
+
+#endif
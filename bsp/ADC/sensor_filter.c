@@ -0,0 +1,297 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  sensor_filter.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  传感器数据的整数滤波流水线, 使用方法见sensor_filter.h
+ **
+ ** 【实现说明】  1- 每个数据块的每个采样只做一次3点中值和一次累加, 一个数据块(7通道x32次)约几千个周期;
+ **               2- 滑动求和只保存各数据块的码值和当前总和, 每次加入新值、减去最旧的值, 不重新求和;
+ **               3- 校准用32x32->64位乘法(SMULL), 温度查表插值只需一次移位、一次乘法(见sensor_lut.c), 都不需要软件浮点;
+ **               4- 查找表两端按量程限幅(NTC: 开路为-40°C, 短路为125°C), 结果等于或超出端点值即视为传感器故障
+ **
+ ** 【更新记录】
+ **              2026-10-19  各通道增加有效标志, 温度通道达到查找表端点时为无效
+ **              2026-10-19  温度换算改用tools/gen_sensor_lut.py生成的查找表(码值每256一格), 各通道可选不同传感器; 结果改为0.01单位
+ **
+***********************************************************************************************************************************/
+#include "sensor_filter.h"
+#include <string.h>
+
+#if (1 << SENSOR_BLOCK_SCANS_LOG2) != ADC_BLOCK_SCANS || SENSOR_BLOCK_SCANS_LOG2 < 4
+#error "SENSOR_BLOCK_SCANS_LOG2 must equal log2(ADC_BLOCK_SCANS), and ADC_BLOCK_SCANS must be at least 16"
+#endif
+
+#define SENSOR_MOVSUM_LEN       (1 << SENSOR_MOVSUM_LOG2)
+
+
+
+/*****************************************************************************
+ ** 本地类型、变量
+ *****************************************************************************/
+typedef enum
+{
+    SENSOR_CONV_NONE = 0,                           // 不换算, 只提供码值
+    SENSOR_CONV_LUT,                                // 温度传感器, 查表插值(sensor_lut.c), 单位0.01°C
+    SENSOR_CONV_LINEAR_MV,                          // 电压输出, 按mV线性换算
+} SensorFilter_Conv;
+
+typedef struct
+{
+    SensorFilter_Conv conv;
+    const SensorLut  *lut;                          // SENSOR_CONV_LUT      : 查找表
+    int16_t   mv0, mv1;                             // SENSOR_CONV_LINEAR_MV: 两个标定点的电压(mV)
+    int16_t   out0, out1;                           //                        对应的输出(0.01单位), 结果限制在两者之间
+} SensorFilter_ChannelDef;
+
+// 各通道的换算方式, 顺序与AdcSampler_Channel相同
+static const SensorFilter_ChannelDef xChannelDefs[ADC_CH_NUM] =
+{
+    { SENSOR_CONV_LUT,  &SENSOR_LUT_TEMP1,   0, 0, 0, 0 },                 // ADC_CH_TEMP1
+    { SENSOR_CONV_LUT,  &SENSOR_LUT_TEMP2,   0, 0, 0, 0 },                 // ADC_CH_TEMP2
+    { SENSOR_CONV_LUT,  &SENSOR_LUT_TEMP3,   0, 0, 0, 0 },                 // ADC_CH_TEMP3
+    { SENSOR_CONV_LUT,  &SENSOR_LUT_TEMP4,   0, 0, 0, 0 },                 // ADC_CH_TEMP4
+    { SENSOR_CONV_LUT,  &SENSOR_LUT_AMBIENT, 0, 0, 0, 0 },                 // ADC_CH_AMBIENT
+    { SENSOR_CONV_LINEAR_MV, NULL, SENSOR_HUMIDITY_MV_0, SENSOR_HUMIDITY_MV_100, 0, 10000 },  // ADC_CH_HUMIDITY
+    { SENSOR_CONV_NONE, NULL,                0, 0, 0, 0 },                 // ADC_CH_VREFINT
+};
+
+typedef struct
+{
+    uint16_t          hist[2];                      // 上一个数据块最后两个采样, 用于跨块的3点中值
+    uint16_t          window[SENSOR_MOVSUM_LEN];    // 最近各数据块的码值
+    uint32_t          windowSum;                    // window[]之和
+    SensorFilter_Cal  cal;
+    uint16_t          code;                         // 滤波、校准后的16位码值
+    int16_t           centi;                        // 换算结果, 0.01单位
+    bool              valid;                        // 结果可信; false=窗口未满或传感器故障
+} SensorFilter_State;
+
+static SensorFilter_State xFilter[ADC_CH_NUM];
+static uint8_t  ucWindowPos   = 0;                  // 下一个码值写入window[]的位置
+static uint8_t  ucWindowCount = 0;                  // window[]中的有效数据块数, 最多SENSOR_MOVSUM_LEN
+
+
+
+/******************************************************************************
+ * 函  数： Median3
+ * 功  能： 3个数的中值
+ ******************************************************************************/
+static inline uint16_t Median3(uint16_t a, uint16_t b, uint16_t c)
+{
+    if (a > b) { uint16_t t = a; a = b; b = t; }    // a <= b
+    if (b > c)  b = (a > c) ? a : c;                // 中值 = min(b, max(a, c))
+    return b;
+}
+
+/******************************************************************************
+ * 函  数： SensorFilter_Convert
+ * 功  能： 把滤波、校准后的码值换算成0.01单位的整数
+ * 参  数： const SensorFilter_ChannelDef *def  换算方式
+ *          uint16_t code                        16位码值
+ *          uint16_t vrefCode                    同一时刻内部参考电压的16位码值
+ * 返回值： 换算结果
+ ******************************************************************************/
+static int16_t SensorFilter_Convert(const SensorFilter_ChannelDef *def, uint16_t code, uint16_t vrefCode)
+{
+    switch (def->conv)
+    {
+    case SENSOR_CONV_LUT:
+        return SensorLut_Convert(def->lut, code);
+    case SENSOR_CONV_LINEAR_MV:
+    {
+        int32_t mv  = (int32_t)AdcSampler_ToMillivolts(code, vrefCode);
+        int32_t out = def->out0 + (mv - def->mv0) * (def->out1 - def->out0) / (def->mv1 - def->mv0);
+        int32_t lo  = def->out0 < def->out1 ? def->out0 : def->out1;
+        int32_t hi  = def->out0 < def->out1 ? def->out1 : def->out0;
+        return (int16_t)(out < lo ? lo : (out > hi ? hi : out));
+    }
+    default:
+        return 0;
+    }
+}
+
+/******************************************************************************
+ * 函  数： SensorFilter_InRange
+ * 功  能： 判断换算结果是否在传感器的有效范围内; 查表的通道达到表的任一端点值时为故障(开路、短路)
+ * 参  数： const SensorFilter_ChannelDef *def  换算方式
+ *          int16_t centi                        换算结果
+ * 返回值： true=有效; 不查表的通道总是有效
+ ******************************************************************************/
+static bool SensorFilter_InRange(const SensorFilter_ChannelDef *def, int16_t centi)
+{
+    if (def->conv != SENSOR_CONV_LUT)
+        return true;
+    int16_t first = def->lut->centi[0];
+    int16_t last  = def->lut->centi[SENSOR_LUT_POINTS - 1];
+    int16_t lo    = first < last ? first : last;
+    int16_t hi    = first < last ? last : first;
+    return centi > lo && centi < hi;
+}
+
+/******************************************************************************
+ * 函  数： SensorFilter_Init
+ * 功  能： 清空各通道状态, 校准参数恢复为不校准(偏移0, 增益1.0)
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void SensorFilter_Init(void)
+{
+    memset(xFilter, 0, sizeof(xFilter));
+    for (uint8_t ch = 0; ch < ADC_CH_NUM; ch++)
+        xFilter[ch].cal.gainQ15 = 32768;
+    ucWindowPos   = 0;
+    ucWindowCount = 0;
+}
+
+/******************************************************************************
+ * 函  数： SensorFilter_Task
+ * 功  能： 取走一个新的ADC数据块: 逐个采样做3点中值、累加得到16位码值, 加入滑动窗口, 校准并换算
+ *          数据块在处理期间被DMA覆盖时丢弃, 各通道状态不变
+ * 参  数： 无
+ * 返回值： true=输出已更新; false=没有新数据块, 或数据块被丢弃
+ ******************************************************************************/
+bool SensorFilter_Task(void)
+{
+    AdcSampler_Block block;
+    uint16_t code[ADC_CH_NUM];
+    uint16_t tail[ADC_CH_NUM][2];
+
+    if (!AdcSampler_Get(&block))
+        return false;
+
+    // 中值去尖峰 + 过采样抽取: 32个12位采样之和为17位, 右移1位得到16位满量程码值
+    for (uint8_t ch = 0; ch < ADC_CH_NUM; ch++)
+    {
+        uint16_t a = xFilter[ch].hist[0];
+        uint16_t b = xFilter[ch].hist[1];
+        if (ucWindowCount == 0)                     // 第一个数据块没有历史, 用第一个采样代替
+            a = b = block.scans[0][ch];
+        uint32_t sum = 0;
+        for (uint16_t i = 0; i < ADC_BLOCK_SCANS; i++)
+        {
+            uint16_t c = block.scans[i][ch];
+            sum += Median3(a, b, c);
+            a = b;
+            b = c;
+        }
+        code[ch]    = (uint16_t)(sum >> (SENSOR_BLOCK_SCANS_LOG2 - 4));
+        tail[ch][0] = a;
+        tail[ch][1] = b;
+    }
+    if (!AdcSampler_Done())                         // 处理期间已被覆盖
+        return false;
+
+    // 滑动求和: 加入新值, 减去被替换的最旧值
+    for (uint8_t ch = 0; ch < ADC_CH_NUM; ch++)
+    {
+        SensorFilter_State *f = &xFilter[ch];
+        f->hist[0] = tail[ch][0];
+        f->hist[1] = tail[ch][1];
+        f->windowSum += code[ch];
+        if (ucWindowCount == SENSOR_MOVSUM_LEN)
+            f->windowSum -= f->window[ucWindowPos];
+        f->window[ucWindowPos] = code[ch];
+    }
+    ucWindowPos = (ucWindowPos + 1) % SENSOR_MOVSUM_LEN;
+    if (ucWindowCount < SENSOR_MOVSUM_LEN && ++ucWindowCount < SENSOR_MOVSUM_LEN)
+        return false;                               // 窗口未满
+
+    // 定点校准: 16位码值 x Q15增益, 限制在0~65535
+    for (uint8_t ch = 0; ch < ADC_CH_NUM; ch++)
+    {
+        SensorFilter_State *f = &xFilter[ch];
+        int32_t v = (int32_t)(f->windowSum >> SENSOR_MOVSUM_LOG2) - f->cal.offset;
+        v = (int32_t)(((int64_t)v * f->cal.gainQ15) >> 15);
+        f->code = (uint16_t)(v < 0 ? 0 : (v > 0xFFFF ? 0xFFFF : v));
+    }
+
+    // 换算
+    uint16_t vref = xFilter[ADC_CH_VREFINT].code;
+    for (uint8_t ch = 0; ch < ADC_CH_NUM; ch++)
+    {
+        xFilter[ch].centi = SensorFilter_Convert(&xChannelDefs[ch], xFilter[ch].code, vref);
+        xFilter[ch].valid = SensorFilter_InRange(&xChannelDefs[ch], xFilter[ch].centi);
+    }
+
+    return true;
+}
+
+/******************************************************************************
+ * 函  数： SensorFilter_Ready
+ * 功  能： 滑动窗口是否已填满
+ * 参  数： 无
+ * 返回值： true=各通道的结果可用
+ ******************************************************************************/
+bool SensorFilter_Ready(void)
+{
+    return ucWindowCount == SENSOR_MOVSUM_LEN;
+}
+
+/******************************************************************************
+ * 函  数： SensorFilter_GetCenti
+ * 功  能： 读取某通道的换算结果
+ * 参  数： AdcSampler_Channel ch  通道
+ * 返回值： 0.01°C或0.01%RH为单位的整数; 窗口未满时为0
+ ******************************************************************************/
+int16_t SensorFilter_GetCenti(AdcSampler_Channel ch)
+{
+    return (ch < ADC_CH_NUM) ? xFilter[ch].centi : 0;
+}
+
+/******************************************************************************
+ * 函  数： SensorFilter_GetDeci
+ * 功  能： 读取某通道的换算结果, 四舍五入到0.1
+ * 参  数： AdcSampler_Channel ch  通道
+ * 返回值： 0.1°C或0.1%RH为单位的整数; 窗口未满时为0
+ ******************************************************************************/
+int16_t SensorFilter_GetDeci(AdcSampler_Channel ch)
+{
+    int16_t centi = SensorFilter_GetCenti(ch);
+    return (int16_t)((centi >= 0 ? centi + 5 : centi - 5) / 10);
+}
+
+/******************************************************************************
+ * 函  数： SensorFilter_GetCode
+ * 功  能： 读取某通道滤波、校准后的码值
+ * 参  数： AdcSampler_Channel ch  通道
+ * 返回值： 16位码值, 0~65535对应0~VDDA
+ ******************************************************************************/
+uint16_t SensorFilter_GetCode(AdcSampler_Channel ch)
+{
+    return (ch < ADC_CH_NUM) ? xFilter[ch].code : 0;
+}
+
+/******************************************************************************
+ * 函  数： SensorFilter_Valid
+ * 功  能： 某通道的结果是否可信
+ * 参  数： AdcSampler_Channel ch  通道
+ * 返回值： true=可信; false=窗口未满, 或传感器故障(温度通道开路、短路)
+ ******************************************************************************/
+bool SensorFilter_Valid(AdcSampler_Channel ch)
+{
+    return (ch < ADC_CH_NUM) ? xFilter[ch].valid : false;
+}
+
+/******************************************************************************
+ * 函  数： SensorFilter_VddaMv
+ * 功  能： 按内部参考电压的码值换算VDDA
+ * 参  数： 无
+ * 返回值： VDDA(mV); 窗口未满时为0
+ ******************************************************************************/
+uint16_t SensorFilter_VddaMv(void)
+{
+    return (uint16_t)AdcSampler_ToMillivolts(0xFFFF, xFilter[ADC_CH_VREFINT].code);
+}
+
+/******************************************************************************
+ * 函  数： SensorFilter_SetCal
+ * 功  能： 修改某通道的校准参数, 下一个数据块开始生效
+ * 参  数： AdcSampler_Channel ch      通道
+ *          const SensorFilter_Cal *cal  校准参数
+ * 返回值： 无
+ ******************************************************************************/
+void SensorFilter_SetCal(AdcSampler_Channel ch, const SensorFilter_Cal *cal)
+{
+    if (ch >= ADC_CH_NUM || cal == NULL)
+        return;
+    xFilter[ch].cal = *cal;
+}
@@ -0,0 +1,74 @@
+#ifndef __SENSOR_FILTER_H
+#define __SENSOR_FILTER_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  sensor_filter.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  传感器数据的整数滤波流水线, 全程不使用浮点:
+ **               中值去尖峰(滑动3点中值) -> 过采样抽取(每个数据块求和, 得到16位满量程码值) -> 滑动求和(一阶CIC, 多个数据块平均)
+ **               -> Q15定点校准(偏移、增益) -> 换算成0.01单位的整数(温度传感器查表插值, 或电压线性换算)
+ **
+ ** 【使用说明】  1- 先调用AdcSampler_Init()开始采集, 再调用SensorFilter_Init();
+ **               2- 在main的while中调用SensorFilter_Task(), 内部取走ADC数据块并处理; 返回true表示输出已更新;
+ **               3- SensorFilter_GetDeci(ch) 取某通道的结果, 单位为0.1°C或0.1%RH, 例: 235 = 23.5; SensorFilter_GetCenti(ch) 单位为0.01;
+ **                  JSON构建函数使用%.1f, 赋值时除以10.0f即可, 只有这一次浮点运算;
+ **               4- SensorFilter_Ready() 为false时, 滑动窗口尚未填满, 结果不可用;
+ **               5- SensorFilter_Valid(ch) 为false时, 该通道的传感器故障(开路、短路), 结果停在查找表的端点, 不能用于控制和告警
+ **
+ ** 【注意事项】  温度传感器电路: 传感器接地, 上拉电阻接VDDA, 与ADC参考电压同源, 按比例换算, 不受VDDA波动影响;
+ **               湿度传感器为电压输出, 按内部参考电压换算成mV后再线性换算
+ **
+ ** 【更新记录】
+ **              2026-10-19  增加SensorFilter_Valid(): 温度通道的结果达到查找表端点时视为传感器故障
+ **              2026-10-19  温度换算改用生成的查找表, 各通道可选传感器型号(SENSOR_LUT_xxx); 增加SensorFilter_GetCenti()
+ **
+***********************************************************************************************************************************/
+#include "bsp_adc.h"
+#include "sensor_lut.h"
+
+
+
+/*****************************************************************************
+ ** 移植配置
+****************************************************************************/
+#define SENSOR_BLOCK_SCANS_LOG2     5               // log2(ADC_BLOCK_SCANS), 每个数据块求和后右移得到16位码值
+#define SENSOR_MOVSUM_LOG2          3               // 滑动窗口长度 = 2^3 = 8个数据块(256ms)
+
+// 各温度通道使用的查找表, 见sensor_lut.h; 更换传感器型号时修改tools/gen_sensor_lut.py后重新生成
+#define SENSOR_LUT_TEMP1         xSensorLut_NTC10K_B3950
+#define SENSOR_LUT_TEMP2         xSensorLut_NTC10K_B3950
+#define SENSOR_LUT_TEMP3         xSensorLut_NTC10K_B3950
+#define SENSOR_LUT_TEMP4         xSensorLut_NTC10K_B3950
+#define SENSOR_LUT_AMBIENT       xSensorLut_NTC10K_B3950
+
+#define SENSOR_HUMIDITY_MV_0        0               // 湿度传感器 0%RH 时的输出电压(mV)
+#define SENSOR_HUMIDITY_MV_100   3000               // 湿度传感器 100%RH 时的输出电压(mV)
+
+
+
+/*****************************************************************************
+ ** 通道校准参数: 码值 = (原始码值 - offset) * gainQ15 / 32768
+****************************************************************************/
+typedef struct
+{
+    int16_t   offset;                               // 零点偏移, 16位满量程码值
+    uint16_t  gainQ15;                              // 增益, Q15格式, 32768 = 1.0
+} SensorFilter_Cal;
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+void     SensorFilter_Init(void);                                       // 清空状态, 校准参数恢复默认
+bool     SensorFilter_Task(void);                                       // 处理一个新的ADC数据块; true=输出已更新
+bool     SensorFilter_Ready(void);                                      // 滑动窗口已填满, 输出可用
+int16_t  SensorFilter_GetDeci(AdcSampler_Channel ch);                   // 某通道的结果, 0.1°C或0.1%RH
+int16_t  SensorFilter_GetCenti(AdcSampler_Channel ch);                  // 某通道的结果, 0.01°C或0.01%RH
+uint16_t SensorFilter_GetCode(AdcSampler_Channel ch);                   // 某通道滤波、校准后的16位码值
+bool     SensorFilter_Valid(AdcSampler_Channel ch);                     // 某通道的结果可信; false=窗口未满或传感器故障
+uint16_t SensorFilter_VddaMv(void);                                     // 按内部参考电压换算的VDDA(mV)
+void     SensorFilter_SetCal(AdcSampler_Channel ch, const SensorFilter_Cal *cal);  // 修改某通道的校准参数
+
+
+
+#endif
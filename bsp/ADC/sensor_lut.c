@@ -0,0 +1,146 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  sensor_lut.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  温度传感器查找表, 由 tools/gen_sensor_lut.py 生成, 不要手工修改
+ **
+***********************************************************************************************************************************/
+#include "sensor_lut.h"
+
+
+
+// NTC 10k B3950, 上拉10k: -40~125°C, 插值误差 <= 0.070°C
+const SensorLut xSensorLut_NTC10K_B3950 =
+{
+    "NTC10K_B3950",
+    {
+         12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12439,  12006,  11620,
+         11274,  10959,  10671,  10406,  10160,   9931,   9717,   9516,   9326,   9147,   8977,   8815,
+          8661,   8513,   8372,   8237,   8107,   7982,   7862,   7745,   7633,   7525,   7419,   7317,
+          7218,   7122,   7028,   6937,   6849,   6762,   6678,   6596,   6515,   6437,   6360,   6284,
+          6211,   6138,   6068,   5998,   5930,   5863,   5797,   5733,   5669,   5607,   5545,   5485,
+          5425,   5367,   5309,   5252,   5196,   5141,   5086,   5032,   4979,   4926,   4874,   4823,
+          4772,   4722,   4673,   4624,   4575,   4528,   4480,   4433,   4387,   4341,   4295,   4250,
+          4205,   4161,   4117,   4073,   4030,   3987,   3944,   3902,   3860,   3819,   3777,   3736,
+          3696,   3655,   3615,   3575,   3536,   3496,   3457,   3418,   3379,   3341,   3302,   3264,
+          3226,   3189,   3151,   3114,   3077,   3039,   3003,   2966,   2929,   2893,   2857,   2820,
+          2784,   2748,   2713,   2677,   2641,   2606,   2570,   2535,   2500,   2465,   2430,   2395,
+          2360,   2325,   2290,   2256,   2221,   2186,   2152,   2117,   2083,   2048,   2014,   1979,
+          1945,   1911,   1876,   1842,   1807,   1773,   1739,   1704,   1670,   1635,   1601,   1566,
+          1532,   1497,   1463,   1428,   1393,   1358,   1323,   1288,   1253,   1218,   1183,   1148,
+          1113,   1077,   1041,   1006,    970,    934,    898,    862,    825,    789,    752,    715,
+           678,    641,    604,    566,    528,    490,    452,    413,    375,    336,    296,    257,
+           217,    177,    136,     96,     54,     13,    -29,    -71,   -114,   -157,   -200,   -244,
+          -288,   -333,   -379,   -425,   -471,   -518,   -566,   -614,   -663,   -713,   -763,   -815,
+          -867,   -920,   -973,  -1028,  -1084,  -1141,  -1199,  -1258,  -1318,  -1380,  -1443,  -1508,
+         -1575,  -1643,  -1713,  -1785,  -1859,  -1936,  -2015,  -2097,  -2182,  -2271,  -2363,  -2459,
+         -2560,  -2666,  -2778,  -2897,  -3023,  -3159,  -3304,  -3463,  -3637,  -3831,  -4000,  -4000,
+         -4000,  -4000,  -4000,  -4000,  -4000,
+    }
+};
+
+// NTC 10k B3435, 上拉10k: -40~125°C, 插值误差 <= 0.035°C
+const SensorLut xSensorLut_NTC10K_B3435 =
+{
+    "NTC10K_B3435",
+    {
+         12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,
+         12500,  12500,  12299,  11968,  11662,  11377,  11111,  10863,  10628,  10407,  10198,  10000,
+          9811,   9630,   9458,   9293,   9135,   8983,   8836,   8695,   8559,   8428,   8300,   8177,
+          8057,   7941,   7829,   7719,   7613,   7509,   7407,   7309,   7212,   7118,   7026,   6936,
+          6848,   6762,   6677,   6595,   6513,   6434,   6356,   6279,   6203,   6129,   6056,   5985,
+          5914,   5845,   5776,   5709,   5643,   5577,   5513,   5449,   5386,   5325,   5263,   5203,
+          5143,   5084,   5026,   4969,   4912,   4856,   4800,   4745,   4690,   4636,   4583,   4530,
+          4478,   4426,   4374,   4323,   4273,   4223,   4173,   4124,   4075,   4027,   3978,   3931,
+          3883,   3836,   3789,   3743,   3697,   3651,   3606,   3560,   3516,   3471,   3426,   3382,
+          3338,   3295,   3251,   3208,   3165,   3122,   3079,   3037,   2995,   2953,   2911,   2869,
+          2827,   2786,   2745,   2704,   2663,   2622,   2581,   2540,   2500,   2460,   2419,   2379,
+          2339,   2299,   2259,   2219,   2180,   2140,   2100,   2061,   2021,   1982,   1942,   1903,
+          1864,   1824,   1785,   1746,   1706,   1667,   1628,   1589,   1549,   1510,   1471,   1431,
+          1392,   1353,   1313,   1274,   1234,   1195,   1155,   1115,   1075,   1036,    996,    956,
+           916,    875,    835,    795,    754,    713,    672,    631,    590,    549,    508,    466,
+           424,    382,    340,    297,    255,    212,    169,    125,     82,     38,     -6,    -51,
+           -96,   -141,   -186,   -232,   -278,   -325,   -371,   -419,   -467,   -515,   -563,   -612,
+          -662,   -712,   -763,   -814,   -866,   -919,   -972,  -1026,  -1080,  -1136,  -1192,  -1249,
+         -1307,  -1366,  -1426,  -1486,  -1548,  -1611,  -1676,  -1741,  -1808,  -1877,  -1946,  -2018,
+         -2091,  -2167,  -2244,  -2323,  -2405,  -2490,  -2577,  -2667,  -2760,  -2857,  -2958,  -3064,
+         -3174,  -3290,  -3413,  -3542,  -3680,  -3827,  -3985,  -4000,  -4000,  -4000,  -4000,  -4000,
+         -4000,  -4000,  -4000,  -4000,  -4000,
+    }
+};
+
+// NTC 10k Steinhart-Hart(常见3950料号系数), 上拉10k: -40~125°C, 插值误差 <= 0.038°C
+const SensorLut xSensorLut_NTC10K_SH =
+{
+    "NTC10K_SH",
+    {
+         12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,
+         12188,  11847,  11535,  11248,  10981,  10732,  10498,  10279,  10072,   9876,   9690,   9513,
+          9345,   9183,   9029,   8880,   8738,   8600,   8468,   8340,   8216,   8096,   7980,   7868,
+          7759,   7652,   7549,   7448,   7350,   7254,   7161,   7070,   6980,   6893,   6808,   6724,
+          6642,   6562,   6483,   6406,   6330,   6256,   6183,   6111,   6040,   5970,   5902,   5834,
+          5768,   5702,   5638,   5574,   5511,   5450,   5388,   5328,   5269,   5210,   5152,   5094,
+          5037,   4981,   4925,   4871,   4816,   4762,   4709,   4656,   4604,   4552,   4501,   4450,
+          4400,   4350,   4300,   4251,   4202,   4154,   4106,   4058,   4011,   3964,   3917,   3871,
+          3825,   3779,   3734,   3689,   3644,   3599,   3555,   3511,   3467,   3423,   3380,   3337,
+          3294,   3251,   3209,   3166,   3124,   3082,   3040,   2998,   2957,   2915,   2874,   2833,
+          2792,   2751,   2710,   2670,   2629,   2589,   2548,   2508,   2468,   2428,   2388,   2348,
+          2308,   2269,   2229,   2189,   2150,   2110,   2071,   2031,   1992,   1952,   1913,   1873,
+          1834,   1795,   1755,   1716,   1676,   1637,   1598,   1558,   1519,   1479,   1439,   1400,
+          1360,   1320,   1281,   1241,   1201,   1161,   1121,   1080,   1040,   1000,    959,    918,
+           878,    837,    796,    755,    713,    672,    630,    588,    546,    504,    462,    419,
+           376,    333,    290,    246,    202,    158,    114,     69,     24,    -21,    -66,   -112,
+          -158,   -205,   -252,   -299,   -347,   -396,   -444,   -493,   -543,   -593,   -644,   -695,
+          -747,   -799,   -852,   -906,   -960,  -1015,  -1071,  -1127,  -1185,  -1243,  -1302,  -1362,
+         -1423,  -1485,  -1548,  -1613,  -1678,  -1745,  -1813,  -1883,  -1954,  -2027,  -2101,  -2177,
+         -2256,  -2336,  -2419,  -2504,  -2592,  -2683,  -2777,  -2874,  -2975,  -3080,  -3190,  -3304,
+         -3425,  -3551,  -3685,  -3826,  -3978,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,
+         -4000,  -4000,  -4000,  -4000,  -4000,
+    }
+};
+
+// PT1000, 上拉1k: -40~125°C, 插值误差 <= 0.016°C
+const SensorLut xSensorLut_PT1000 =
+{
+    "PT1000",
+    {
+         -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,
+         -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,
+         -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,
+         -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,
+         -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,
+         -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,
+         -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,
+         -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,
+         -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,
+         -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -4000,  -3687,  -3345,
+         -2997,  -2643,  -2283,  -1918,  -1547,  -1170,   -786,   -396,      0,    403,    813,   1230,
+          1655,   2087,   2526,   2973,   3429,   3893,   4365,   4846,   5336,   5835,   6344,   6862,
+          7391,   7930,   8480,   9041,   9613,  10197,  10793,  11401,  12023,  12500,  12500,  12500,
+         12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,
+         12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,
+         12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,
+         12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,
+         12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,
+         12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,
+         12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,
+         12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,  12500,
+         12500,  12500,  12500,  12500,  12500,
+    }
+};
+
+
+
+/******************************************************************************
+ * 函  数： SensorLut_Convert
+ * 功  能： 查表并线性插值, 约十几个周期
+ * 参  数： const SensorLut *lut  查找表
+ *          uint16_t code         16位码值, 0~65535对应0~VDDA
+ * 返回值： 温度(0.01°C)
+ ******************************************************************************/
+int16_t SensorLut_Convert(const SensorLut *lut, uint16_t code)
+{
+    uint32_t idx  = code >> SENSOR_LUT_STEP_LOG2;
+    int32_t  frac = code & ((1U << SENSOR_LUT_STEP_LOG2) - 1);
+    int32_t  t0   = lut->centi[idx];
+    return (int16_t)(t0 + (((int32_t)lut->centi[idx + 1] - t0) * frac >> SENSOR_LUT_STEP_LOG2));
+}
@@ -0,0 +1,34 @@
+#ifndef __SENSOR_LUT_H
+#define __SENSOR_LUT_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  sensor_lut.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  温度传感器查找表: 16位码值 -> 0.01°C, 由 tools/gen_sensor_lut.py 生成, 不要手工修改
+ **
+ ** 【使用说明】  int16_t centi = SensorLut_Convert(&xSensorLut_NTC10K_B3950, code);   // 2350 = 23.50°C
+ **
+***********************************************************************************************************************************/
+#include <stdint.h>
+
+
+
+#define SENSOR_LUT_STEP_LOG2      8                 // 码值每256一格
+#define SENSOR_LUT_POINTS       257                 // 表项数
+
+typedef struct
+{
+    const char *name;
+    int16_t     centi[SENSOR_LUT_POINTS];       // 码值 i << SENSOR_LUT_STEP_LOG2 对应的温度(0.01°C)
+} SensorLut;
+
+
+extern const SensorLut xSensorLut_NTC10K_B3950;            // NTC 10k B3950, 上拉10k, 插值误差 <= 0.070°C
+extern const SensorLut xSensorLut_NTC10K_B3435;            // NTC 10k B3435, 上拉10k, 插值误差 <= 0.035°C
+extern const SensorLut xSensorLut_NTC10K_SH;               // NTC 10k Steinhart-Hart(常见3950料号系数), 上拉10k, 插值误差 <= 0.038°C
+extern const SensorLut xSensorLut_PT1000;                  // PT1000, 上拉1k, 插值误差 <= 0.016°C
+
+int16_t SensorLut_Convert(const SensorLut *lut, uint16_t code);   // 查表并线性插值
+
+
+
+#endif
@@ -0,0 +1,213 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  bsp_iwdg.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  独立看门狗监督主循环, 使用方法见bsp_iwdg.h
+ **
+ ** 【实现说明】  1- 只在Iwdg_Poll()中喂狗, 且要求: 正在运行的任务未超过自己的时限, 其余任务距上次完成不超过一轮的最长时间;
+ **                  一旦有任务超过期限就锁定为不再喂狗, 之后即使该任务恢复也不再喂狗, 保证复位一定发生;
+ **               2- 等待模组回复的循环也调用Iwdg_Poll(), 有超时的阻塞等待不会被误判; 没有超时的死循环不调用它, 由IWDG直接复位;
+ **               3- 备份寄存器: DR1=有效标志, DR2=正在运行的任务, DR3=超过期限的任务, DR4=最近一次复位原因, DR5=看门狗复位次数;
+ **                  每个检查点只写DR2一个寄存器
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "bsp_iwdg.h"
+#include <stdio.h>
+
+
+
+/*****************************************************************************
+ ** 本地定义
+ *****************************************************************************/
+#define IWDG_LSI_HZ             40000               // LSI标称频率
+#define IWDG_RELOAD             (IWDG_TIMEOUT_MS * (IWDG_LSI_HZ / 64) / 1000)   // 预分频64: 1.6ms/计数
+#if IWDG_RELOAD > 0xFFF
+#error "IWDG_TIMEOUT_MS too long for prescaler 64"
+#endif
+
+#define IWDG_BKP_MAGIC          0x5744              // "WD": 备份寄存器中的记录有效
+#define IWDG_BKP_REG_MAGIC      BKP_DR1
+#define IWDG_BKP_REG_TASK       BKP_DR2
+#define IWDG_BKP_REG_MISSED     BKP_DR3
+#define IWDG_BKP_REG_CAUSE      BKP_DR4
+#define IWDG_BKP_REG_COUNT      BKP_DR5
+
+
+
+/*****************************************************************************
+ ** 本地变量
+ *****************************************************************************/
+static const uint32_t ulBudgetMs[IWDG_TASK_NUM] = IWDG_TASK_BUDGETS;
+static const char *const pcTaskName[IWDG_TASK_NUM] = { "conn", "recv", "sample", "fan", "actuator", "report", "pub_poll", "stats" };
+static const char *const pcCauseName[] = { "unknown", "power-on", "pin", "software", "watchdog", "window-watchdog", "low-power" };
+
+static Iwdg_ResetInfo xLastReset;
+static uint32_t       ulLoopDeadlineMs = 0;         // 一轮的最长时间: 所有任务时限之和
+static u64            ullDoneMs[IWDG_TASK_NUM];     // 各任务上一次完成的时刻
+static u64            ullStartMs  = 0;              // 当前任务开始运行的时刻
+static uint8_t        ucCurrent   = IWDG_TASK_NONE; // 当前正在运行的任务
+static bool           bMissed     = false;          // 已有任务超过期限, 不再喂狗
+
+
+
+/******************************************************************************
+ * 函  数： Iwdg_ReadResetCause
+ * 功  能： 读取RCC_CSR中的复位标志; 上电复位、看门狗复位时PINRSTF也会置位, 因此引脚复位最后判断
+ ******************************************************************************/
+static Iwdg_ResetCause Iwdg_ReadResetCause(void)
+{
+    if (RCC_GetFlagStatus(RCC_FLAG_IWDGRST) == SET)  return IWDG_RESET_WATCHDOG;
+    if (RCC_GetFlagStatus(RCC_FLAG_WWDGRST) == SET)  return IWDG_RESET_WINDOW_WATCHDOG;
+    if (RCC_GetFlagStatus(RCC_FLAG_SFTRST) == SET)   return IWDG_RESET_SOFTWARE;
+    if (RCC_GetFlagStatus(RCC_FLAG_LPWRRST) == SET)  return IWDG_RESET_LOW_POWER;
+    if (RCC_GetFlagStatus(RCC_FLAG_PORRST) == SET)   return IWDG_RESET_POWER_ON;
+    if (RCC_GetFlagStatus(RCC_FLAG_PINRST) == SET)   return IWDG_RESET_PIN;
+    return IWDG_RESET_UNKNOWN;
+}
+
+/******************************************************************************
+ * 函  数： Iwdg_Init
+ * 功  能： 读取复位原因和上次运行留在备份寄存器中的记录, 清空记录, 然后启动IWDG
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void Iwdg_Init(void)
+{
+    // 1. 复位原因: 标志在清除前一直保持, 读取后清除, 下次复位时只留下新的标志
+    xLastReset.cause = Iwdg_ReadResetCause();
+    RCC_ClearFlag();
+
+    // 2. 上次运行的记录
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR | RCC_APB1Periph_BKP, ENABLE);
+    PWR_BackupAccessCmd(ENABLE);                    // 允许写备份寄存器
+    if (BKP_ReadBackupRegister(IWDG_BKP_REG_MAGIC) == IWDG_BKP_MAGIC)
+    {
+        xLastReset.lastTask       = (uint8_t)BKP_ReadBackupRegister(IWDG_BKP_REG_TASK);
+        xLastReset.missedTask     = (uint8_t)BKP_ReadBackupRegister(IWDG_BKP_REG_MISSED);
+        xLastReset.watchdogResets = BKP_ReadBackupRegister(IWDG_BKP_REG_COUNT);
+    }
+    else                                            // 备份域刚上电(无电池), 没有记录
+    {
+        xLastReset.lastTask       = IWDG_TASK_NONE;
+        xLastReset.missedTask     = IWDG_TASK_NONE;
+        xLastReset.watchdogResets = 0;
+        BKP_WriteBackupRegister(IWDG_BKP_REG_MAGIC, IWDG_BKP_MAGIC);
+    }
+    if (xLastReset.cause == IWDG_RESET_WATCHDOG && xLastReset.watchdogResets < 0xFFFF)
+        xLastReset.watchdogResets++;
+
+    BKP_WriteBackupRegister(IWDG_BKP_REG_TASK, IWDG_TASK_NONE);
+    BKP_WriteBackupRegister(IWDG_BKP_REG_MISSED, IWDG_TASK_NONE);
+    BKP_WriteBackupRegister(IWDG_BKP_REG_CAUSE, (uint16_t)xLastReset.cause);
+    BKP_WriteBackupRegister(IWDG_BKP_REG_COUNT, xLastReset.watchdogResets);
+
+    // 3. 各任务的期限从现在开始计算
+    u64 now = System_GetTimeMs();
+    ulLoopDeadlineMs = 0;
+    for (uint8_t t = 0; t < IWDG_TASK_NUM; t++)
+    {
+        ulLoopDeadlineMs += ulBudgetMs[t];
+        ullDoneMs[t] = now;
+    }
+    ucCurrent = IWDG_TASK_NONE;
+    bMissed   = false;
+
+    // 4. 启动IWDG: 预分频64, 超时IWDG_TIMEOUT_MS; 调试器暂停内核时IWDG同时暂停
+#if IWDG_ENABLE
+    DBGMCU_Config(DBGMCU_IWDG_STOP, ENABLE);
+    IWDG_WriteAccessCmd(IWDG_WriteAccess_Enable);
+    IWDG_SetPrescaler(IWDG_Prescaler_64);
+    IWDG_SetReload((uint16_t)IWDG_RELOAD);
+    IWDG_ReloadCounter();
+    IWDG_Enable();
+#endif
+}
+
+/******************************************************************************
+ * 函  数： Iwdg_Checkpoint
+ * 功  能： 登记任务开始运行; 上一个任务视为完成, 记录完成时刻
+ * 参  数： Iwdg_Task task  即将运行的任务
+ * 返回值： 无
+ ******************************************************************************/
+void Iwdg_Checkpoint(Iwdg_Task task)
+{
+    u64 now = System_GetTimeMs();
+    if (ucCurrent < IWDG_TASK_NUM)
+        ullDoneMs[ucCurrent] = now;
+    ucCurrent  = (task < IWDG_TASK_NUM) ? (uint8_t)task : IWDG_TASK_NONE;
+    ullStartMs = now;
+    BKP_WriteBackupRegister(IWDG_BKP_REG_TASK, ucCurrent);
+}
+
+/******************************************************************************
+ * 函  数： Iwdg_LoopEnd
+ * 功  能： 一轮结束: 最后一个任务视为完成, 检查期限并喂狗
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void Iwdg_LoopEnd(void)
+{
+    Iwdg_Checkpoint(IWDG_TASK_NONE);
+    Iwdg_Poll();
+}
+
+/******************************************************************************
+ * 函  数： Iwdg_Poll
+ * 功  能： 检查各任务的期限, 全部满足时喂狗; 有任务超过期限时记录该任务, 之后不再喂狗
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void Iwdg_Poll(void)
+{
+    if (bMissed)
+        return;
+
+    u64     now    = System_GetTimeMs();
+    uint8_t missed = IWDG_TASK_NONE;
+    if (ucCurrent < IWDG_TASK_NUM && now - ullStartMs > ulBudgetMs[ucCurrent])
+        missed = ucCurrent;                         // 当前任务运行超时
+    for (uint8_t t = 0; t < IWDG_TASK_NUM && missed == IWDG_TASK_NONE; t++)
+    {
+        if (t != ucCurrent && now - ullDoneMs[t] > ulLoopDeadlineMs)
+            missed = t;                             // 超过一轮的最长时间没有被调度
+    }
+
+    if (missed != IWDG_TASK_NONE)
+    {
+        bMissed = true;
+        BKP_WriteBackupRegister(IWDG_BKP_REG_MISSED, missed);
+        printf("WDG: task '%s' missed its deadline, watchdog reset within %u ms\r\n", pcTaskName[missed], IWDG_TIMEOUT_MS);
+        return;
+    }
+#if IWDG_ENABLE
+    IWDG_ReloadCounter();
+#endif
+}
+
+/******************************************************************************
+ * 函  数： Iwdg_LastReset
+ * 功  能： 本次复位的记录(Iwdg_Init()时读取)
+ * 参  数： 无
+ * 返回值： 复位记录, 只读
+ ******************************************************************************/
+const Iwdg_ResetInfo *Iwdg_LastReset(void)
+{
+    return &xLastReset;
+}
+
+/******************************************************************************
+ * 函  数： Iwdg_TaskName / Iwdg_ResetCauseName
+ * 功  能： 任务、复位原因的名称, 用于日志
+ ******************************************************************************/
+const char *Iwdg_TaskName(uint8_t task)
+{
+    if (task == IWDG_TASK_NONE)
+        return "none";
+    return (task < IWDG_TASK_NUM) ? pcTaskName[task] : "?";
+}
+
+const char *Iwdg_ResetCauseName(Iwdg_ResetCause cause)
+{
+    return ((unsigned)cause < sizeof(pcCauseName) / sizeof(pcCauseName[0])) ? pcCauseName[cause] : "?";
+}
@@ -0,0 +1,103 @@
+#ifndef __BSP__IWDG_H
+#define __BSP__IWDG_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  bsp_iwdg.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  独立看门狗(IWDG)监督主循环: 各任务在运行前登记检查点, 只有所有任务都在期限内完成时才喂狗;
+ **               某个任务卡死(死循环、等待模组回复不返回)或长时间没有被调度时停止喂狗, 由IWDG复位;
+ **               复位原因、复位时正在运行的任务、超时的任务记录在备份寄存器中, 复位后可读取, 用于事后分析
+ **
+ ** 【硬件重点】  1- IWDG由LSI(标称40kHz, 实际30~60kHz)驱动, 实际超时时间为IWDG_TIMEOUT_MS的0.67~1.33倍;
+ **               2- 备份寄存器 BKP_DR1~DR5 由本文件使用; 无VBAT电池时断电后内容丢失, 复位时保持;
+ **               3- 调试器暂停内核时IWDG同时暂停(DBGMCU_IWDG_STOP), 单步调试不会被复位
+ **
+ ** 【使用说明】  1- 上电后尽早调用Iwdg_Init(): 读取复位原因和上次运行的记录, 然后启动IWDG;
+ **                  Iwdg_LastReset() 返回复位记录, 由调用者输出或上报;
+ **               2- 主循环中, 每个任务运行前调用 Iwdg_Checkpoint(任务编号), 上一个任务即视为完成; 一轮结束时调用Iwdg_LoopEnd();
+ **               3- 可能等待较长时间的循环(等待模组回复等)中调用Iwdg_Poll(): 当前任务未超过运行时限时继续喂狗;
+ **               4- 任务超过运行时限(IWDG_TASK_BUDGETS), 或超过一轮最长时间(所有任务时限之和)没有完成过, 停止喂狗,
+ **                  最迟 时限 + IWDG_TIMEOUT_MS 后复位
+ **
+ ** 【注意事项】  1- IWDG一旦启动就不能停止; 两次Iwdg_Poll()/Iwdg_LoopEnd()的间隔必须小于IWDG_TIMEOUT_MS;
+ **               2- 增加任务时, 同时修改Iwdg_Task和IWDG_TASK_BUDGETS, 顺序相同
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "system_f103.h"
+#include <stdbool.h>
+
+
+
+/*****************************************************************************
+ ** 移植配置
+****************************************************************************/
+#define IWDG_ENABLE                    1            // 1=启动IWDG; 0=只记录检查点和复位原因, 不启动看门狗(调试用)
+#define IWDG_TIMEOUT_MS             4000            // IWDG超时(ms), 预分频64时最大6553ms; 应大于两次喂狗的最长间隔(串口发送等待1秒)
+// 各任务一次运行的时限(ms), 顺序同Iwdg_Task; 取正常情况下最长运行时间(含所有有超时的阻塞等待)的1.5倍左右
+#define IWDG_TASK_BUDGETS                                                                                             \
+{                                                                                                                     \
+    60000,      /* IWDG_TASK_CONN:     完整入网 + 打开会话 + 订阅 + 重发在途消息, 各步骤的AT等待合计约40秒 */          \
+    8000,       /* IWDG_TASK_RECV:     处理一条下行消息, 回复等待模组接受最长5秒 */                                   \
+    8000,       /* IWDG_TASK_SAMPLE:   采集和霜冻判断, 告警时发布事件和干预状态, 每条最长约2秒 */                      \
+    1000,       /* IWDG_TASK_FAN:      风扇闭环控制, 只计算, 不等待 */                                                \
+    6000,       /* IWDG_TASK_ACTUATOR: 执行器, 可用性变化时发布一条消息 */                                            \
+    8000,       /* IWDG_TASK_REPORT:   遥测上报, 一个窗口最多发布3条消息 */                                           \
+    20000,      /* IWDG_TASK_PUB_POLL: 重发超时的在途消息, 最多MQTT_INFLIGHT_MAX条, 每条最长约2秒 */                   \
+    3000,       /* IWDG_TASK_STATS:    统计输出, 只写调试串口 */                                                      \
+}
+
+
+
+/*****************************************************************************
+ ** 数据类型
+****************************************************************************/
+typedef enum
+{
+    IWDG_TASK_CONN = 0,                             // 连接监督
+    IWDG_TASK_RECV,                                 // 下行消息处理
+    IWDG_TASK_SAMPLE,                               // 模拟量采集、霜冻判断
+    IWDG_TASK_FAN,                                  // 风扇闭环控制
+    IWDG_TASK_ACTUATOR,                             // 执行器
+    IWDG_TASK_REPORT,                               // 遥测上报
+    IWDG_TASK_PUB_POLL,                             // QoS1在途消息重发
+    IWDG_TASK_STATS,                                // 统计输出
+    IWDG_TASK_NUM,                                  // 数量, 不是任务
+    IWDG_TASK_NONE = 0xFF                           // 没有任务在运行
+} Iwdg_Task;
+
+typedef enum
+{
+    IWDG_RESET_UNKNOWN = 0,                         // 没有复位标志(不应出现)
+    IWDG_RESET_POWER_ON,                            // 上电/掉电复位
+    IWDG_RESET_PIN,                                 // NRST引脚复位(按键、调试器)
+    IWDG_RESET_SOFTWARE,                            // 软件复位(NVIC_SystemReset)
+    IWDG_RESET_WATCHDOG,                            // 独立看门狗复位
+    IWDG_RESET_WINDOW_WATCHDOG,                     // 窗口看门狗复位
+    IWDG_RESET_LOW_POWER,                           // 低功耗管理复位
+} Iwdg_ResetCause;
+
+typedef struct
+{
+    Iwdg_ResetCause  cause;                         // 本次复位的原因
+    uint8_t          lastTask;                      // 复位前最后一个开始运行的任务; IWDG_TASK_NONE=复位时不在任务中, 或没有记录
+    uint8_t          missedTask;                    // 复位前超过期限的任务; IWDG_TASK_NONE=没有
+    uint16_t         watchdogResets;                // 累计的看门狗复位次数(保存在备份寄存器中)
+} Iwdg_ResetInfo;
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+void                  Iwdg_Init(void);                      // 读取复位原因和上次的记录, 启动IWDG
+void                  Iwdg_Checkpoint(Iwdg_Task task);      // 任务开始运行; 上一个任务视为完成
+void                  Iwdg_LoopEnd(void);                   // 一轮结束: 最后一个任务视为完成, 检查期限并喂狗
+void                  Iwdg_Poll(void);                      // 检查期限, 全部满足时喂狗; 可在等待循环中调用
+const Iwdg_ResetInfo *Iwdg_LastReset(void);                 // 本次复位的记录
+const char           *Iwdg_TaskName(uint8_t task);          // 任务名称, 用于日志
+const char           *Iwdg_ResetCauseName(Iwdg_ResetCause cause);  // 复位原因名称, 用于日志
+
+
+
+#endif
@@ -0,0 +1,995 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  bsp_MQTT.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  通信模组的MQTT传输层, 使用方法见bsp_MQTT.h
+ **
+ ** 【实现说明】  1- QoS1消息发出后, 负载缓存块由在途表持有(主题只保存指针), 直到收到 +QMTPUB: 0,<msgid>,0 或放弃重发时才归还缓存池;
+ **                  result=1 表示模组正在自行重发, 只刷新计时; result=2 表示模组放弃发送, 立即以原msgid重发;
+ **                  AT+QMTPUB的第4个字段是<retain>, 不是DUP; AT指令没有DUP标志(模组自身重发时自动置DUP), 本模块重发时retain始终为0,
+ **                  否则服务器会把重发的遥测、告警作为保留消息, 推送给之后的每个订阅者;
+ **               2- 模组自身的重发(AT+QMTCFG="timeout")先于本模块的超时生效, 因此MQTT_PUB_ACK_TIMEOUT_MS取得较长;
+ **               3- 发布指令分段写入串口发送缓冲区(指令头、主题、负载), 不需要再拼接一份完整的AT指令;
+ **                  发送方式在入表时扫描一遍负载确定(MQTT_Tx_Plan); 默认含引号的负载走提示符方式;
+ **                  启用MQTT_INLINE_ESCAPE时, 内联方式的转义在写入串口时逐段完成, 不生成转义后的副本;
+ **               4- 已处理的 +QMTPUB 确认和 +QMTSTAT 通知, 把开头的'+'改写为'#'作废, 主循环与MQTT_Send_AT_Command()重复扫描同一缓存也不会重复处理
+ **               5- 下行消息按记录切分: 带长度字段时按声明的长度截取负载, 否则以 "\"\r\n" 作为负载的结束(负载是未转义的JSON, 含有'"');
+ **                  同一空闲窗口中的多条记录逐条入队; 记录跨越空闲中断或缓存切换时, 未完整的部分用UART_RxConsume()保留在缓存开头,
+ **                  与后续数据拼接后再切分; 入队时复制到缓存块一次, 之后按帧视图处理, 每条消息只入队一次
+ **               6- 所有等待模组回复的循环都调用Iwdg_Poll(), 等待期间由看门狗监督判断当前任务是否超过时限(见bsp_iwdg.h)
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "bsp_MQTT.h"
+#include "bsp_iwdg.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+
+
+/*****************************************************************************
+ ** 本地变量
+ *****************************************************************************/
+typedef struct
+{
+    uint16_t  msgid;                                // MQTT报文标识符, 0=空闲
+    uint8_t   retries;                              // 已重发次数
+    uint8_t   topicLen;                             // 主题长度
+    uint16_t  payloadLen;                           // 负载字节数(文本不含结尾的'\0')
+    uint8_t   txMode;                               // 发送方式, MQTT_TX_INLINE / MQTT_TX_PROMPT, 入表时确定
+    u64       sentMs;                               // 最近一次发送(或模组报告重发)的时刻
+    const char *topic;                              // 主题, 指向Flash中的常量主题表, 不复制
+    char     *payload;                              // 负载, 消息缓存池中的块, 由本模块负责释放
+} MQTT_InFlight;
+
+static MQTT_InFlight xInFlight[MQTT_INFLIGHT_MAX];  // QoS1在途表
+static uint16_t      usNextMsgId = 1;               // 下一个待分配的报文标识符
+static MQTT_PubStats xPubStats;                     // 发布统计
+static char          cTxScratch[32];                // 发布指令头等短字符串的格式化缓存
+static uint8_t       ucSessionError = 0;            // 最近一次 +QMTSTAT 报告的错误码, 0=无
+
+#define MQTT_TX_REJECT                 0            // 超过模组限制, 不发送
+#define MQTT_TX_INLINE                 1            // 内联方式: 负载作为AT指令的字符串参数
+#define MQTT_TX_PROMPT                 2            // 提示符方式: 指定长度, 等待'>'后写入原始数据
+#define MQTT_TX_PROMPT_TIMEOUT_MS    1000           // 等待提示符'>'的超时
+
+#define MQTT_RECV_FRAME                0            // 完整的记录
+#define MQTT_RECV_PARTIAL              1            // 记录尚未接收完整
+#define MQTT_RECV_BAD                  2            // 格式错误, 或超过缓存块容量
+
+typedef struct
+{
+    char     *block;                                // 主题和负载, 消息缓存池中的块
+    uint16_t  msgid;
+    uint16_t  topicLen;
+    uint16_t  payloadLen;
+    u64       rxMs;                                 // 入队时刻
+    uint32_t  firstByteCycles;                      // 首字节到达时刻(估算)
+    uint32_t  completeCycles;                       // 最后一个字节到达时刻(估算)
+} MQTT_RecvItem;
+
+static MQTT_RecvItem  xRecvQueue[MQTT_RECV_QUEUE_MAX];  // 下行消息队列(先进先出)
+static uint8_t        ucRecvHead  = 0;              // 队首
+static uint8_t        ucRecvCount = 0;              // 队列中的消息数
+static u64            ullRecvPendingMs = 0;         // 缓存开头的未完整数据开始等待的时刻, 0=没有
+static MQTT_RecvStats xRecvStats;                   // 接收统计
+
+
+
+/*****************************************************************************
+ ** 内部函数
+ *****************************************************************************/
+// 解析十进制数, 指针移到数字之后; 返回 MQTT_RECV_xxx
+static uint8_t MQTT_Recv_Uint(const char **pp, const char *end, uint32_t *val)
+{
+    const char *q = *pp;
+    uint32_t    v = 0;
+
+    if (q >= end)
+        return MQTT_RECV_PARTIAL;
+    if (!isdigit((unsigned char)*q))
+        return MQTT_RECV_BAD;
+    while (q < end && isdigit((unsigned char)*q))
+        v = v * 10 + (uint32_t)(*q++ - '0');
+    if (q >= end)
+        return MQTT_RECV_PARTIAL;                   // 数字之后的分隔符尚未到达, 数字可能还没有接收完
+    *pp  = q;
+    *val = v;
+    return MQTT_RECV_FRAME;
+}
+
+// 解析一条 +QMTRECV: <client>,<msgid>,"<topic>"[,<len>],"<payload>"
+// p指向'+', end为已接收数据的末尾; 成功时view指向原缓存, *next为本记录之后的位置
+static uint8_t MQTT_Recv_Record(const char *p, const char *end, MQTT_FrameView *view, const char **next)
+{
+    const char *q = p + 10;                         // 跳过 "+QMTRECV: "
+    uint32_t    client, msgid, declared = 0;
+    bool        has_len = false;
+    uint8_t     r;
+
+    #define EXPECT(ch)  do { if (q >= end) return MQTT_RECV_PARTIAL; if (*q++ != (ch)) return MQTT_RECV_BAD; } while (0)
+
+    if ((r = MQTT_Recv_Uint(&q, end, &client)) != MQTT_RECV_FRAME)
+        return r;
+    EXPECT(',');
+    if ((r = MQTT_Recv_Uint(&q, end, &msgid)) != MQTT_RECV_FRAME)
+        return r;
+    EXPECT(',');
+    EXPECT('"');
+
+    const char *topic = q;
+    const char *topic_end = memchr(q, '"', end - q);
+    if (topic_end == NULL)
+        return MQTT_RECV_PARTIAL;
+    q = topic_end + 1;
+    EXPECT(',');
+
+    if (q < end && isdigit((unsigned char)*q))      // 带有负载长度字段: 按声明的长度截取负载, 负载中的引号、换行都不影响切分
+    {
+        if ((r = MQTT_Recv_Uint(&q, end, &declared)) != MQTT_RECV_FRAME)
+            return r;
+        if (declared + (uint32_t)(topic_end - topic) >= MSG_POOL_BLOCK_SIZE)
+            return MQTT_RECV_BAD;                   // 超过缓存块容量, 不可能放入队列, 不必等待接收完整
+        has_len = true;
+        EXPECT(',');
+    }
+    EXPECT('"');
+    #undef EXPECT
+
+    const char *payload = q;
+    const char *payload_end;
+    if (has_len)
+    {
+        if ((uint32_t)(end - payload) <= declared)
+            return MQTT_RECV_PARTIAL;
+        payload_end = payload + declared;
+        if (*payload_end != '"')
+            return MQTT_RECV_BAD;
+    }
+    else                                            // 不带长度字段的固件版本: 负载以 "\r\n 结束
+    {
+        MQTT_Slice rest = { payload, (uint16_t)(end - payload) };
+        payload_end = MQTT_Slice_Find(rest, "\"\r\n");
+        if (payload_end == NULL)
+            return MQTT_RECV_PARTIAL;
+    }
+
+    q = payload_end + 1;
+    while (q < end && (*q == '\r' || *q == '\n'))
+        q++;
+
+    view->msgid       = (uint16_t)msgid;
+    view->topic.ptr   = topic;
+    view->topic.len   = (uint16_t)(topic_end - topic);
+    view->payload.ptr = payload;
+    view->payload.len = (uint16_t)(payload_end - payload);
+    view->rxMs        = 0;
+    view->firstByteCycles = 0;
+    view->completeCycles  = 0;
+    *next = q;
+    return MQTT_RECV_FRAME;
+}
+
+// 把一条完整的下行消息复制到缓存块, 放入接收队列; 队列满、缓存池空或消息过长时丢弃并计数
+static void MQTT_Recv_Enqueue(const MQTT_FrameView *view)
+{
+    uint32_t need  = (uint32_t)view->topic.len + view->payload.len + 1;
+    char    *block = NULL;
+
+    if (ucRecvCount < MQTT_RECV_QUEUE_MAX && need <= MSG_POOL_BLOCK_SIZE)
+        block = MsgPool_Acquire();
+    if (block == NULL)
+    {
+        xRecvStats.dropped++;
+        printf("MQTT: downlink msgid=%u dropped (queue %u, len %lu)\r\n", view->msgid, ucRecvCount, (unsigned long)need);
+        return;
+    }
+
+    memcpy(block, view->topic.ptr, view->topic.len);
+    memcpy(block + view->topic.len, view->payload.ptr, view->payload.len);
+    block[need - 1] = '\0';                        // 负载之后以0结尾, 解析数字时strtol不会越界
+
+    MQTT_RecvItem *item = &xRecvQueue[(ucRecvHead + ucRecvCount) % MQTT_RECV_QUEUE_MAX];
+    item->block      = block;
+    item->msgid      = view->msgid;
+    item->topicLen   = view->topic.len;
+    item->payloadLen = view->payload.len;
+    item->rxMs       = System_GetTimeMs();
+    item->firstByteCycles = view->firstByteCycles;
+    item->completeCycles  = view->completeCycles;
+    ucRecvCount++;
+    xRecvStats.received++;
+}
+
+// 在接收数据中逐条切分 +QMTRECV 记录并放入队列; 返回可以释放的字节数(之后是尚未接收完整的部分)
+// idleCycles为buf[len-1]之后的空闲中断时刻, cyclesPerByte为每个字节的传输时间, 用于倒推各记录首、尾字节的到达时刻
+static uint16_t MQTT_Recv_Extract(const char *buf, uint16_t len, uint32_t idleCycles, uint32_t cyclesPerByte)
+{
+    const char *end = buf + len;
+    const char *pos = buf;
+    const char *keep;                               // 需要保留的部分的开头
+
+    while (1)
+    {
+        MQTT_Slice      rest = { pos, (uint16_t)(end - pos) };
+        const char     *p    = MQTT_Slice_Find(rest, "+QMTRECV: ");
+        MQTT_FrameView  view;
+        const char     *next;
+
+        if (p == NULL)
+        {
+            // 没有更多记录: 完整的行都可以释放; 末尾以'+'开头的半行可能是记录或确认的开头, 保留
+            const char *line = end;
+            while (line > pos && line[-1] != '\n')
+                line--;
+            keep = (line < end && *line == '+') ? line : end;
+            break;
+        }
+
+        uint8_t r = MQTT_Recv_Record(p, end, &view, &next);
+        if (r == MQTT_RECV_FRAME)
+        {
+            view.firstByteCycles = idleCycles - (uint32_t)(end - p + 1) * cyclesPerByte;
+            view.completeCycles  = idleCycles - (uint32_t)(end - next + 1) * cyclesPerByte;
+            MQTT_Recv_Enqueue(&view);
+            pos = next;
+            continue;
+        }
+        if (r == MQTT_RECV_BAD)
+        {
+            xRecvStats.malformed++;
+            pos = p + 1;                            // 跳过记录头, 其余部分按普通数据释放
+            continue;
+        }
+        keep = p;                                   // MQTT_RECV_PARTIAL: 等待后续数据
+        break;
+    }
+
+    // 保留的部分长时间没有接收完整(例如模组在发送中途复位), 整体丢弃, 避免阻塞之后的数据
+    if (keep == end)
+    {
+        ullRecvPendingMs = 0;
+    }
+    else if (ullRecvPendingMs == 0 || keep != buf)
+    {
+        ullRecvPendingMs = System_GetTimeMs();
+    }
+    else if (System_GetTimeMs() - ullRecvPendingMs > MQTT_RECV_PARTIAL_TIMEOUT_MS)
+    {
+        xRecvStats.timeouts++;
+        printf("MQTT: incomplete downlink discarded after %u ms\r\n", MQTT_RECV_PARTIAL_TIMEOUT_MS);
+        ullRecvPendingMs = 0;
+        keep = end;
+    }
+    return (uint16_t)(keep - buf);
+}
+
+// 分配一个未被在途消息占用的报文标识符, 范围1~65535
+static uint16_t MQTT_AllocMsgId(void)
+{
+    for (;;)
+    {
+        uint16_t id = usNextMsgId++;
+        if (usNextMsgId == 0)
+            usNextMsgId = 1;
+
+        bool used = false;
+        for (int i = 0; i < MQTT_INFLIGHT_MAX; i++)
+        {
+            if (xInFlight[i].msgid == id)
+            {
+                used = true;
+                break;
+            }
+        }
+        if (!used)
+            return id;
+    }
+}
+
+// 按报文标识符查找在途消息, msgid不能为0
+static MQTT_InFlight *MQTT_FindInFlight(uint16_t msgid)
+{
+    for (int i = 0; i < MQTT_INFLIGHT_MAX; i++)
+    {
+        if (xInFlight[i].msgid == msgid)
+            return &xInFlight[i];
+    }
+    return NULL;
+}
+
+// 释放在途消息: 归还负载缓存块, 腾出表项
+static void MQTT_FreeInFlight(MQTT_InFlight *item)
+{
+    MsgPool_Release(item->payload);
+    item->payload = NULL;
+    item->msgid   = 0;
+}
+
+// 在timeout_ms内等待模组回复中出现expect; 出现"ERROR"时立即返回false
+static bool MQTT_Tx_WaitFor(const char *expect, uint32_t timeout_ms)
+{
+    u64 start = System_GetTimeMs();
+    while ((System_GetTimeMs() - start) < timeout_ms)
+    {
+        if (xUSART.USART1ReceivedNum > 0)
+        {
+            char *rx = (char *)xUSART.USART1ReceivedBuffer;
+            if (strstr(rx, expect) != NULL)
+                return true;
+            if (strstr(rx, "ERROR") != NULL)
+                return false;
+        }
+        Iwdg_Poll();
+        System_DelayMS(2);
+    }
+    return false;
+}
+
+// 内联方式中需要转义的字符: 引号会结束字符串参数, 反斜杠是转义符本身
+static bool MQTT_Tx_NeedEscape(char c)
+{
+    return c == '"' || c == '\\';
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Tx_Plan
+ * 功  能： 扫描一遍负载, 选择发送方式并检查长度:
+ *          1- 二进制负载, 或文本中有控制字符、非ASCII字符(字符集转换后不可靠): 提示符方式;
+ *          2- 有引号、反斜杠而内联转义未启用(MQTT_INLINE_ESCAPE=0): 提示符方式;
+ *          3- 内联方式的整条指令(转义后)超过MQTT_AT_LINE_MAX: 提示符方式;
+ *          4- 其余用内联方式, 一条指令完成, 不需要等待提示符
+ * 参  数： const char *payload  负载
+ *          uint16_t len         二进制负载的字节数; 0=负载是以'\0'结尾的文本
+ *          uint8_t topic_len    主题长度
+ *          uint16_t *out_len    负载字节数的存放地址
+ * 返回值： MQTT_TX_INLINE / MQTT_TX_PROMPT; 超过模组限制时返回MQTT_TX_REJECT
+ ******************************************************************************/
+static uint8_t MQTT_Tx_Plan(const char *payload, uint16_t len, uint8_t topic_len, uint16_t *out_len)
+{
+    bool     prompt = (len != 0);
+    uint32_t escaped = 0;
+
+    if (len == 0)
+    {
+        const char *p = payload;
+        for (; *p; p++)
+        {
+            unsigned char c = (unsigned char)*p;
+            if (c < 0x20 || c >= 0x7F)
+                prompt = true;
+            else if (MQTT_Tx_NeedEscape((char)c))
+                escaped++;
+        }
+        len = (uint16_t)(p - payload);
+    }
+    *out_len = len;
+
+    if (len == 0 || len > MQTT_PUB_PAYLOAD_MAX)
+        return MQTT_TX_REJECT;
+    if (escaped && !MQTT_INLINE_ESCAPE)
+        prompt = true;
+    // AT+QMTPUB=0,65535,1,1,"<topic>","<payload>"\r\n: 指令头最长22字节, 引号、逗号、换行共5字节, 每个转义字符多2字节
+    if (!prompt && 22 + topic_len + 5 + len + 2 * escaped > MQTT_AT_LINE_MAX)
+        prompt = true;
+    return prompt ? MQTT_TX_PROMPT : MQTT_TX_INLINE;
+}
+
+// 单趟转义写入: 连续的普通字符整段写入串口, 引号、反斜杠写为 \HH; 不需要转义后的副本
+static bool MQTT_Tx_WriteEscaped(const char *payload, uint16_t len)
+{
+    const char *run = payload;
+    const char *end = payload + len;
+    for (const char *p = payload; p < end; p++)
+    {
+        if (!MQTT_Tx_NeedEscape(*p))
+            continue;
+        char esc[4];
+        snprintf(esc, sizeof(esc), "\\%02X", (unsigned char)*p);
+        if (!MQTT_AT_Write(run, (size_t)(p - run)) || !MQTT_AT_Write(esc, 3))
+            return false;
+        run = p + 1;
+    }
+    return MQTT_AT_Write(run, (size_t)(end - run));
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Tx_Publish
+ * 功  能： 按选定的方式发送一条 AT+QMTPUB, 等待模组回复"OK"(模组已接受, 不是服务器确认)
+ *          内联:   AT+QMTPUB=0,<msgid>,<qos>,0,"<topic>","<转义后的负载>"
+ *          提示符: AT+QMTPUB=0,<msgid>,<qos>,0,"<topic>",<len>, 等待'>'后写入len字节原始数据
+ *          第4个字段<retain>始终为0: 首次发送和重发都不是保留消息
+ * 参  数： uint16_t msgid, uint8_t qos                报文标识符(QoS0为0)、QoS
+ *          const char *topic, uint8_t topic_len       主题
+ *          const char *payload, uint16_t len          负载及其字节数
+ *          uint8_t mode                               MQTT_Tx_Plan()的结果
+ *          uint32_t timeout_ms                        等待"OK"的超时
+ * 返回值： true=模组已接受
+ ******************************************************************************/
+static bool MQTT_Tx_Publish(uint16_t msgid, uint8_t qos, const char *topic, uint8_t topic_len,
+                            const char *payload, uint16_t len, uint8_t mode, uint32_t timeout_ms)
+{
+    char *head = cTxScratch;                        // 指令头和提示符方式的结尾先后使用同一块缓存, 不占用栈
+    snprintf(head, sizeof(cTxScratch), "AT+QMTPUB=0,%u,%u,0,\"", msgid, qos);
+
+    MQTT_Recv_Pump();                               // 释放接收缓存前, 先取出已到达的确认和下行消息
+
+    if (mode == MQTT_TX_INLINE)
+    {
+        printf("SEND: %s%.*s\",\"%.*s\"\r\n", head, topic_len, topic, len, payload);
+        return MQTT_AT_Send(head) && MQTT_AT_Write(topic, topic_len) && MQTT_AT_Send("\",\"") &&
+               MQTT_Tx_WriteEscaped(payload, len) && MQTT_AT_Send("\"\r\n") && MQTT_Tx_WaitFor("OK", timeout_ms);
+    }
+
+    printf("SEND: %s%.*s\",%u <%u bytes, prompt mode>\r\n", head, topic_len, topic, len, len);
+    if (!MQTT_AT_Send(head) || !MQTT_AT_Write(topic, topic_len))
+        return false;
+    snprintf(cTxScratch, sizeof(cTxScratch), "\",%u\r\n", len);
+    if (!MQTT_AT_Send(cTxScratch) ||
+        !MQTT_Tx_WaitFor(">", MQTT_TX_PROMPT_TIMEOUT_MS))
+        return false;
+    MQTT_Recv_Pump();                               // 取走提示符, 之后只查找本次的"OK"
+    return MQTT_AT_Write(payload, len) && MQTT_Tx_WaitFor("OK", timeout_ms);
+}
+
+// 发送(或重发)一条在途消息, 只等待模组回复"OK"
+static bool MQTT_Pub_Transmit(MQTT_InFlight *item)
+{
+    item->sentMs = System_GetTimeMs();
+    if (MQTT_Tx_Publish(item->msgid, 1, item->topic, item->topicLen, item->payload, item->payloadLen,
+                        item->txMode, 1000))
+        return true;
+
+    printf("MQTT: QMTPUB msgid=%u not accepted by modem, will retry\r\n", item->msgid);
+    return false;
+}
+
+
+
+/******************************************************************************
+ * 函  数： MQTT_AT_Write
+ * 功  能： 向通信模组(USART1)发送指定长度的数据, 阻塞等待直到全部写入串口发送缓冲区或超时
+ *          超过发送缓冲区容量的长指令会分段写入, 不会被截断
+ * 参  数： const char *data  要发送的数据
+ *          size_t      len   字节数
+ * 返回值： true=全部写入; false=超时, 只写入了一部分
+ ******************************************************************************/
+bool MQTT_AT_Write(const char *data, size_t len)
+{
+    size_t sent = UART_WriteTimeout(UART_PORT_1, data, len, MQTT_AT_TX_TIMEOUT_MS);
+    if (sent != len)
+    {
+        printf("ERROR: UART1 TX timeout, %u of %u bytes sent.\r\n", (unsigned int)sent, (unsigned int)len);
+        return false;
+    }
+    return true;
+}
+
+/******************************************************************************
+ * 函  数： MQTT_AT_Send
+ * 功  能： 向通信模组(USART1)发送字符串, 见MQTT_AT_Write()
+ * 参  数： const char *data  要发送的字符串
+ * 返回值： true=全部写入; false=超时, 只写入了一部分
+ ******************************************************************************/
+bool MQTT_AT_Send(const char *data)
+{
+    return MQTT_AT_Write(data, strlen(data));
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Send_AT_Command
+ * 功  能： 清空接收缓存, 发送AT指令, 在超时时间内等待回复中出现期望的关键字
+ *          清空前先取出缓存中已到达的 +QMTPUB 确认和 +QMTRECV 下行消息, 不会因此丢失
+ * 参  数： const char *cmd                要发送的AT指令字符串
+ *          const char *expected_response  期望在模组回复中找到的关键字
+ *          uint32_t    timeout_ms         等待回复的超时时间, 单位ms
+ * 返回值： true=成功; false=超时
+ ******************************************************************************/
+bool MQTT_Send_AT_Command(const char *cmd, const char *expected_response, uint32_t timeout_ms)
+{
+    // 步骤1：清空串口接收缓冲区 (已到达的确认和下行消息先被取出, 未接收完整的记录保留)
+    MQTT_Recv_Pump();
+
+    // 步骤2：通过串口发送AT指令
+    printf("SEND: %s", cmd);
+    MQTT_AT_Send(cmd);
+
+    // 步骤3：使用SysTick获取当前时间作为超时判断的起点
+    u64 start_time = System_GetTimeMs();
+
+    // 步骤4：在超时时间内循环等待; 只在空闲中断交付了新数据时才查找, 回复到达后1ms内返回
+    uint16_t checked = 0;
+    while ((System_GetTimeMs() - start_time) < timeout_ms)
+    {
+        // 串口驱动在每次空闲中断时已把缓存以'\0'结尾, 这里直接按字符串查找
+        uint16_t num = xUSART.USART1ReceivedNum;
+        if (num != checked)
+        {
+            checked = num;
+            if (num > 0 && strstr((char *)xUSART.USART1ReceivedBuffer, expected_response) != NULL)
+            {
+                printf("SUCCESS: Found response '%s' in %lu ms\r\n\r\n", expected_response,
+                       (unsigned long)(System_GetTimeMs() - start_time));
+                return true;
+            }
+        }
+        Iwdg_Poll();
+        System_DelayMS(1);
+    }
+
+    printf("FAIL: Timeout. Did not receive '%s' in %lu ms.\r\n\r\n", expected_response, (unsigned long)timeout_ms);
+    printf("Last received data: %s\r\n", (char *)xUSART.USART1ReceivedBuffer);
+    return false;
+}
+
+
+
+/******************************************************************************
+ * 函  数： MQTT_Subscribe_Batch
+ * 功  能： 用一条 AT+QMTSUB=0,<msgid>,"t1",qos,"t2",qos,... 订阅多个主题, 只需一次往返;
+ *          并解析回复 +QMTSUB: 0,<msgid>,<result>,<q1>,<q2>,... 中各主题的授予QoS
+ * 参  数： const char *const *topics   主题数组
+ *          uint8_t            num      主题数量, 1~MQTT_SUB_TOPIC_MAX
+ *          uint8_t            qos      请求的QoS
+ *          uint8_t           *granted  各主题的授予QoS存放地址(128=被拒绝); 不需要时传NULL
+ *          uint32_t        timeout_ms  等待回复的超时时间, 单位ms
+ * 返回值： true=全部主题订阅成功; false=超时、模组报错或有主题被拒绝
+ ******************************************************************************/
+bool MQTT_Subscribe_Batch(const char *const *topics, uint8_t num, uint8_t qos, uint8_t *granted, uint32_t timeout_ms)
+{
+    char     tmp[32];
+    char     expect[24];
+    uint16_t msgid = MQTT_AllocMsgId();
+
+    if (num == 0 || num > MQTT_SUB_TOPIC_MAX)
+        return false;
+
+    MQTT_Recv_Pump();
+
+    // 分段写入, 不需要拼接完整指令
+    printf("SEND: AT+QMTSUB=0,%u", msgid);
+    snprintf(tmp, sizeof(tmp), "AT+QMTSUB=0,%u", msgid);
+    bool sent = MQTT_AT_Send(tmp);
+    for (uint8_t i = 0; i < num && sent; i++)
+    {
+        printf(",\"%s\",%u", topics[i], qos);
+        snprintf(tmp, sizeof(tmp), "\",%u", qos);
+        sent = MQTT_AT_Send(",\"") && MQTT_AT_Send(topics[i]) && MQTT_AT_Send(tmp);
+    }
+    printf("\r\n");
+    if (!sent || !MQTT_AT_Send("\r\n"))
+        return false;
+
+    snprintf(expect, sizeof(expect), "+QMTSUB: 0,%u,", msgid);
+    u64 start = System_GetTimeMs();
+    while ((System_GetTimeMs() - start) < timeout_ms)
+    {
+        char *rx = (char *)xUSART.USART1ReceivedBuffer;
+        char *p  = (xUSART.USART1ReceivedNum > 0) ? strstr(rx, expect) : NULL;
+        if (p == NULL)
+        {
+            if (xUSART.USART1ReceivedNum > 0 && strstr(rx, "ERROR") != NULL)
+                break;
+            Iwdg_Poll();
+            System_DelayMS(10);
+            continue;
+        }
+        if (strchr(p, '\n') == NULL)               // 回复尚未接收完整
+        {
+            Iwdg_Poll();
+            System_DelayMS(10);
+            continue;
+        }
+
+        char *end;
+        unsigned long result = strtoul(p + strlen(expect), &end, 10);
+        bool ok = (result == 0);
+        for (uint8_t i = 0; i < num; i++)           // 授予QoS列表, 128表示该主题被拒绝
+        {
+            unsigned long q = 128;
+            if (*end == ',')
+                q = strtoul(end + 1, &end, 10);
+            if (granted)
+                granted[i] = (uint8_t)q;
+            if (q == 128)
+                ok = false;
+        }
+        printf("%s: +QMTSUB msgid=%u result=%lu\r\n\r\n", ok ? "SUCCESS" : "FAIL", msgid, result);
+        return ok;
+    }
+
+    printf("FAIL: No +QMTSUB reply for msgid=%u in %lu ms.\r\n\r\n", msgid, (unsigned long)timeout_ms);
+    return false;
+}
+
+
+
+/******************************************************************************
+ * 函  数： MQTT_Publish_QoS1
+ * 功  能： 以QoS1发布一条消息; 消息进入在途表后立即返回, 不等待服务器确认
+ * 参  数： const char *topic      主题; 只保存指针, 必须在收到确认前一直有效(常量主题表)
+ *          uint8_t     topic_len  主题长度
+ *          char       *payload    负载, 必须是MsgPool_Acquire()申请的缓存块(以0结尾);
+ *                                 无论发布成功与否, 缓存块都交给本模块, 调用者不能再使用或释放
+ * 返回值： 本条消息的msgid; 0=在途表已满, 未能发布(缓存块已释放)
+ ******************************************************************************/
+uint16_t MQTT_Publish_QoS1(const char *topic, uint8_t topic_len, char *payload)
+{
+    return MQTT_Publish_QoS1_Binary(topic, topic_len, payload, 0);
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Publish_QoS1_Binary
+ * 功  能： 以QoS1发布一条二进制消息(CBOR等), 用指定长度的提示符方式发送, 负载中可以有'\0'、引号等任意字节;
+ *          其余与MQTT_Publish_QoS1()相同
+ * 参  数： const char *topic      主题; 只保存指针, 必须在收到确认前一直有效(常量主题表)
+ *          uint8_t     topic_len  主题长度
+ *          char       *payload    负载, 必须是MsgPool_Acquire()申请的缓存块, 所有权移交给本模块
+ *          uint16_t    len        负载字节数, 不超过MSG_POOL_BLOCK_SIZE; 0=负载是以'\0'结尾的文本
+ * 返回值： 本条消息的msgid; 0=在途表已满, 未能发布(缓存块已释放)
+ ******************************************************************************/
+uint16_t MQTT_Publish_QoS1_Binary(const char *topic, uint8_t topic_len, char *payload, uint16_t len)
+{
+    uint16_t payloadLen;
+    uint8_t  mode = MQTT_Tx_Plan(payload, len, topic_len, &payloadLen);
+    if (mode == MQTT_TX_REJECT)
+    {
+        printf("ERROR: Payload of %u bytes exceeds modem limit (%u), message dropped.\r\n", payloadLen, MQTT_PUB_PAYLOAD_MAX);
+        xPubStats.rejected++;
+        MsgPool_Release(payload);
+        return 0;
+    }
+
+    MQTT_InFlight *item = NULL;
+    for (int i = 0; i < MQTT_INFLIGHT_MAX && item == NULL; i++)
+    {
+        if (xInFlight[i].msgid == 0)
+            item = &xInFlight[i];
+    }
+    if (item == NULL)
+    {
+        printf("ERROR: QoS1 in-flight window full (%u), message dropped.\r\n", MQTT_INFLIGHT_MAX);
+        xPubStats.rejected++;
+        MsgPool_Release(payload);
+        return 0;
+    }
+
+    item->msgid   = MQTT_AllocMsgId();
+    item->retries  = 0;
+    item->topic    = topic;
+    item->topicLen = topic_len;
+    item->payloadLen = payloadLen;
+    item->txMode   = mode;
+    item->payload  = payload;
+    xPubStats.sent++;
+
+    MQTT_Pub_Transmit(item);                        // 模组未接受时保留在表中, 由MQTT_Pub_Poll()超时重发
+    return item->msgid;
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Publish_QoS0
+ * 功  能： 以QoS0发布一条文本消息(命令回复等), 发送方式与QoS1相同地自动选择, 等待模组接受后返回
+ * 参  数： const char *topic      主题
+ *          uint8_t     topic_len  主题长度
+ *          const char *payload    以'\0'结尾的文本负载; 调用者的缓存, 返回后即可复用
+ *          uint32_t    timeout_ms 等待模组回复"OK"的超时
+ * 返回值： true=模组已接受; false=超过模组限制、模组未接受或超时
+ ******************************************************************************/
+bool MQTT_Publish_QoS0(const char *topic, uint8_t topic_len, const char *payload, uint32_t timeout_ms)
+{
+    uint16_t len;
+    uint8_t  mode = MQTT_Tx_Plan(payload, 0, topic_len, &len);
+    if (mode == MQTT_TX_REJECT)
+    {
+        printf("ERROR: Payload of %u bytes exceeds modem limit (%u), not sent.\r\n", len, MQTT_PUB_PAYLOAD_MAX);
+        xPubStats.rejected++;
+        return false;
+    }
+    if (MQTT_Tx_Publish(0, 0, topic, topic_len, payload, len, mode, timeout_ms))
+        return true;
+
+    printf("FAIL: QoS0 publish to '%.*s' not accepted by modem.\r\n", topic_len, topic);
+    return false;
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Pub_Poll
+ * 功  能： 在途消息的超时处理: 超时未确认的以原msgid重发, 超过重发次数的丢弃
+ *          在main的while中周期调用
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void MQTT_Pub_Poll(void)
+{
+    for (int i = 0; i < MQTT_INFLIGHT_MAX; i++)
+    {
+        MQTT_InFlight *item = &xInFlight[i];
+        if (item->msgid == 0 || (System_GetTimeMs() - item->sentMs) < MQTT_PUB_ACK_TIMEOUT_MS)
+            continue;
+
+        if (item->retries >= MQTT_PUB_RETRY_MAX)
+        {
+            printf("MQTT: QoS1 msgid=%u not acknowledged after %u retries, dropped\r\n", item->msgid, item->retries);
+            MQTT_FreeInFlight(item);
+            xPubStats.failed++;
+            continue;
+        }
+
+        item->retries++;
+        xPubStats.retransmitted++;
+        MQTT_Pub_Transmit(item);
+    }
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Urc_Scan
+ * 功  能： 在接收缓存中查找完整的 +QMTPUB: 0,<msgid>,<result> 确认, 按msgid更新在途表
+ *          msgid=0 的(QoS0发布的结果)保持原样, 留给等待它的调用者;
+ *          同时查找 +QMTSTAT: 0,<err> 会话断开通知, 错误码由MQTT_Session_TakeError()取出
+ * 参  数： char *buffer  以'\0'结尾的接收缓存
+ * 返回值： 无
+ ******************************************************************************/
+void MQTT_Urc_Scan(char *buffer)
+{
+    char *p = buffer;
+
+    while ((p = strstr(p, "+QMTPUB: ")) != NULL)
+    {
+        char *end;
+        char *field = p + 9;
+        unsigned long client = strtoul(field, &end, 10);
+        if (end == field || *end != ',')
+        {
+            p = field;
+            continue;
+        }
+        field = end + 1;
+        unsigned long msgid = strtoul(field, &end, 10);
+        if (end == field || *end != ',')
+        {
+            p = field;
+            continue;
+        }
+        field = end + 1;
+        unsigned long result = strtoul(field, &end, 10);
+        if (end == field || (*end != '\r' && *end != '\n' && *end != ','))
+            break;                                  // 确认尚未接收完整, 留到下次扫描
+
+        if (client == 0 && msgid != 0)
+        {
+            MQTT_InFlight *item = MQTT_FindInFlight((uint16_t)msgid);
+            if (item != NULL)
+            {
+                if (result == 0)                    // 服务器已确认(PUBACK)
+                {
+                    MQTT_FreeInFlight(item);
+                    xPubStats.acked++;
+                }
+                else if (result == 1)               // 模组正在重发
+                {
+                    item->sentMs = System_GetTimeMs();
+                }
+                else                                // 模组放弃发送, 立即以原msgid重发
+                {
+                    item->sentMs = System_GetTimeMs() - MQTT_PUB_ACK_TIMEOUT_MS;
+                }
+            }
+            *p = '#';                               // 作废已处理的确认
+        }
+        p = end;
+    }
+
+    p = buffer;
+    while ((p = strstr(p, "+QMTSTAT: 0,")) != NULL)     // 会话断开: +QMTSTAT: 0,<err_code>
+    {
+        char *end;
+        unsigned long err = strtoul(p + 12, &end, 10);
+        if (end == p + 12 || (*end != '\r' && *end != '\n'))
+            break;
+        if (err != 0)
+        {
+            ucSessionError = (uint8_t)err;
+            printf("MQTT: +QMTSTAT err=%lu, session closed\r\n", err);
+        }
+        *p = '#';
+        p = end;
+    }
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Pub_ResendAll
+ * 功  能： 会话重新建立后, 以原msgid立即重发全部在途消息; 不计入重发次数
+ *          (旧会话中未确认的消息, 服务器可能已收到, 也可能没有)
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void MQTT_Pub_ResendAll(void)
+{
+    for (int i = 0; i < MQTT_INFLIGHT_MAX; i++)
+    {
+        if (xInFlight[i].msgid == 0)
+            continue;
+        xPubStats.retransmitted++;
+        MQTT_Pub_Transmit(&xInFlight[i]);
+    }
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Session_TakeError
+ * 功  能： 取出 MQTT_Urc_Scan() 记录的 +QMTSTAT 错误码, 并清零
+ * 参  数： 无
+ * 返回值： 0=会话正常; 1~8=模组报告的断开原因, 见 MQTT_STAT_xxx
+ ******************************************************************************/
+uint8_t MQTT_Session_TakeError(void)
+{
+    uint8_t err = ucSessionError;
+    ucSessionError = 0;
+    return err;
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Pub_InFlight
+ * 功  能： 返回当前在途(等待服务器确认)的QoS1消息数
+ * 参  数： 无
+ * 返回值： 在途消息数
+ ******************************************************************************/
+uint8_t MQTT_Pub_InFlight(void)
+{
+    uint8_t n = 0;
+    for (int i = 0; i < MQTT_INFLIGHT_MAX; i++)
+    {
+        if (xInFlight[i].msgid != 0)
+            n++;
+    }
+    return n;
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Pub_GetStats
+ * 功  能： 读取QoS1发布统计
+ * 参  数： MQTT_PubStats *stats  统计数据的存放地址
+ * 返回值： 无
+ ******************************************************************************/
+void MQTT_Pub_GetStats(MQTT_PubStats *stats)
+{
+    *stats = xPubStats;
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Recv_Pump
+ * 功  能： 处理USART1接收缓存中已到达的数据:
+ *          1- 取出 +QMTPUB 确认和 +QMTSTAT 通知(MQTT_Urc_Scan);
+ *          2- 按记录切分 +QMTRECV, 每条完整的下行消息复制到一个缓存块, 放入接收队列;
+ *          3- 释放已处理的数据; 尚未接收完整的记录(或以'+'开头的半行)保留在缓存开头, 与后续数据拼接
+ *          发送AT指令之前必须调用, 代替直接清空接收缓存
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void MQTT_Recv_Pump(void)
+{
+    uint32_t idle = UART_RxIdleCycles(UART_PORT_1);
+    uint16_t num  = xUSART.USART1ReceivedNum;       // 先取长度: 之后到达的数据不在本次处理范围内
+    char    *buf  = (char *)xUSART.USART1ReceivedBuffer;
+
+    if (num == 0)
+        return;
+
+    uint32_t baud = UART_GetBaudrate(UART_PORT_1);
+    uint32_t cyclesPerByte = baud ? SystemCoreClock / (baud / 10) : 0;     // 1个起始位+8个数据位+1个停止位
+
+    MQTT_Urc_Scan(buf);
+    UART_RxConsume(UART_PORT_1, MQTT_Recv_Extract(buf, num, idle, cyclesPerByte));
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Recv_Get
+ * 功  能： 取接收队列中最早的一条下行消息; 处理完后调用MQTT_Recv_Done()
+ *          视图指向缓存块, 处理期间可以发送AT指令, 视图不受影响
+ * 参  数： MQTT_FrameView *view   帧视图的存放地址
+ * 返回值： true=有消息; false=队列为空
+ ******************************************************************************/
+bool MQTT_Recv_Get(MQTT_FrameView *view)
+{
+    if (ucRecvCount == 0)
+        return false;
+
+    const MQTT_RecvItem *item = &xRecvQueue[ucRecvHead];
+    view->msgid       = item->msgid;
+    view->topic.ptr   = item->block;
+    view->topic.len   = item->topicLen;
+    view->payload.ptr = item->block + item->topicLen;
+    view->payload.len = item->payloadLen;
+    view->rxMs        = item->rxMs;
+    view->firstByteCycles = item->firstByteCycles;
+    view->completeCycles  = item->completeCycles;
+    return true;
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Recv_Done
+ * 功  能： 最早的一条下行消息已处理完, 归还其缓存块并出队
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void MQTT_Recv_Done(void)
+{
+    if (ucRecvCount == 0)
+        return;
+
+    MsgPool_Release(xRecvQueue[ucRecvHead].block);
+    xRecvQueue[ucRecvHead].block = NULL;
+    ucRecvHead = (ucRecvHead + 1) % MQTT_RECV_QUEUE_MAX;
+    ucRecvCount--;
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Recv_GetStats
+ * 功  能： 读取下行接收统计
+ * 参  数： MQTT_RecvStats *stats  统计数据的存放地址
+ * 返回值： 无
+ ******************************************************************************/
+void MQTT_Recv_GetStats(MQTT_RecvStats *stats)
+{
+    *stats = xRecvStats;
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Slice_Find
+ * 功  能： 在片段中查找字符串
+ * 参  数： MQTT_Slice s          片段
+ *          const char *needle    要查找的字符串
+ * 返回值： 第一次出现的位置(指向片段所在的缓存); 没找到返回NULL
+ ******************************************************************************/
+const char *MQTT_Slice_Find(MQTT_Slice s, const char *needle)
+{
+    size_t n = strlen(needle);
+    if (n == 0 || n > s.len)
+        return NULL;
+
+    const char *last = s.ptr + s.len - n;
+    for (const char *p = s.ptr; p <= last; p++)
+    {
+        if (*p == *needle && memcmp(p, needle, n) == 0)
+            return p;
+    }
+    return NULL;
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Slice_Equal
+ * 功  能： 判断片段内容是否与字符串完全相同
+ * 参  数： MQTT_Slice s        片段
+ *          const char *str     字符串
+ * 返回值： true=相同
+ ******************************************************************************/
+bool MQTT_Slice_Equal(MQTT_Slice s, const char *str)
+{
+    return strlen(str) == s.len && memcmp(s.ptr, str, s.len) == 0;
+}
+
+/******************************************************************************
+ * 函  数： MQTT_Slice_Between
+ * 功  能： 取片段中 head 之后、其后第一个 tail 之前的部分, 例如从主题中取出服务标识符
+ * 参  数： MQTT_Slice s        片段
+ *          const char *head    起始标记
+ *          const char *tail    结束标记
+ * 返回值： 两个标记之间的片段; 任一标记没找到时返回空片段
+ ******************************************************************************/
+MQTT_Slice MQTT_Slice_Between(MQTT_Slice s, const char *head, const char *tail)
+{
+    const char *start = MQTT_Slice_Find(s, head);
+    if (start == NULL)
+        return MQTT_SLICE_NULL;
+    start += strlen(head);
+
+    MQTT_Slice rest = { start, (uint16_t)(s.len - (start - s.ptr)) };
+    const char *stop = MQTT_Slice_Find(rest, tail);
+    if (stop == NULL)
+        return MQTT_SLICE_NULL;
+
+    MQTT_Slice out = { start, (uint16_t)(stop - start) };
+    return out;
+}
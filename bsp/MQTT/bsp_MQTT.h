@@ -0,0 +1,156 @@
+#ifndef __BSP_MQTT_H
+#define __BSP_MQTT_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  bsp_MQTT.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  通信模组(USART1, Quectel AT指令)的MQTT传输层:
+ **               1- AT指令收发: MQTT_AT_Send()、MQTT_Send_AT_Command();
+ **               2- QoS1发布流水线: 在途表以MQTT报文标识符(msgid)为键, 异步匹配 +QMTPUB: 0,<msgid>,<result>,
+ **                  超时或模组报告发送失败时以原msgid重发(retain=0; AT指令没有DUP字段, DUP由模组在自身重发时设置); 多条消息可同时在途, 发布时只等待模组的"OK", 不等待服务器确认
+ **               3- 会话监视: 识别 +QMTSTAT 断开通知, 供main中的连接监督状态机重连
+ **               4- 批量订阅: 一条 AT+QMTSUB 订阅多个主题, 解析各主题的授予QoS
+ **               5- 下行接收: 按记录切分 +QMTRECV(同一空闲窗口中的多条、跨越空闲中断的半条都能正确处理), 逐条放入接收队列;
+ **                  以帧视图(指针+长度的片段)交给应用程序, 主题、id、参数都不再复制
+ **
+ ** 【使用说明】  1- 发布: MQTT_Publish_QoS1(topic, topic_len, payload); 返回本条消息的msgid, 返回0表示在途表已满或发送失败;
+ **                  主题只保存指针(重发时使用), 应传入常量主题表中的字符串; 负载是从消息缓存池申请的块, 所有权随之移交;
+ **                  二进制负载(CBOR等)用MQTT_Publish_QoS1_Binary(topic, topic_len, payload, len), 以提示符方式发送, 不需要转义;
+ **                  文本负载按内容和长度自动选择内联或提示符方式(见MQTT_AT_LINE_MAX、MQTT_INLINE_ESCAPE), 超过MQTT_PUB_PAYLOAD_MAX的不发送;
+ **                  默认不转义: JSON负载都含有引号, 以提示符方式按长度原样发送, 只有不含引号、反斜杠的短文本使用内联方式;
+ **                  命令回复等不需要重发的消息用MQTT_Publish_QoS0(topic, topic_len, payload, timeout_ms), 同样自动选择;
+ **               2- 在main的while中周期调用MQTT_Pub_Poll(), 处理超时重发;
+ **               3- 处理USART1收到的数据之前, 先调用MQTT_Urc_Scan(), 从中取出 +QMTPUB 确认; 同一缓存重复扫描不会重复处理;
+ **                  MQTT_Send_AT_Command()在清空接收缓存之前已自动调用, 不会丢失确认
+ **               4- 下行: 主循环中调用MQTT_Recv_Pump()(发送AT指令前也会自动调用), 然后
+ **                      while (MQTT_Recv_Get(&view)) { 处理view; MQTT_Recv_Done(); }
+ **                  片段不以'\0'结尾, 用printf("%.*s", MQTT_SLICE_ARG(s))输出; 处理期间可以发送AT指令, 视图不受影响;
+ **               5- 不要直接调用UART_RxRelease(UART_PORT_1), 否则会丢弃尚未取出的下行消息
+ **
+ ** 【更新记录】
+ **              2026-10-19  MQTT_INLINE_ESCAPE默认改为0: 模组文档未说明QMTPUB支持\HH转义, 含引号的负载改用提示符方式
+ **              2026-10-19  修正重发: AT+QMTPUB的第4个字段是<retain>, 重发时不再置1(之前重发的消息成为保留消息)
+ **              2026-10-19  等待模组回复的循环中调用Iwdg_Poll(), 由看门狗监督判断等待是否超过任务时限
+ **              2026-10-19  增加发布传输层: 按负载内容和长度自动选择内联/提示符方式, 内联时单趟转义, 发送前按模组限制检查长度; 增加MQTT_Publish_QoS0()
+ **              2026-10-19  增加MQTT_Publish_QoS1_Binary(): 二进制负载以指定长度的提示符方式发送, 同样进入QoS1在途表
+ **              2026-10-19  识别 +QMTSTAT 会话断开通知; 会话重建后重发全部在途消息
+ **              2026-10-19  增加MQTT_Subscribe_Batch(): 一条AT+QMTSUB订阅多个主题
+ **              2026-10-19  MQTT_Publish_QoS1()改为传入主题长度, 在途表只保存主题指针, 不再复制主题
+ **              2026-10-19  QoS1负载改用消息缓存池的块, 按指针移交所有权, 不再复制到在途表
+ **              2026-10-19  增加下行帧视图MQTT_FrameView和片段操作函数, 下行处理不再复制字段
+ **              2026-10-19  帧视图增加首字节、接收完整的时刻(DWT周期计数值), 用于命令时延追踪
+ **              2026-10-19  增加 +QMTRECV 记录切分和下行接收队列, MQTT_Recv_Parse()改为MQTT_Recv_Pump()/MQTT_Recv_Get()/MQTT_Recv_Done()
+ **
+***********************************************************************************************************************************/
+#include "system_f103.h"
+#include "bsp_usart.h"
+#include "msg_pool.h"
+#include <stdbool.h>
+
+
+
+/*****************************************************************************
+ ** 移植配置
+****************************************************************************/
+#define MQTT_AT_TX_TIMEOUT_MS       1000            // 向模组发送一条数据时, 串口发送缓冲区满的最长等待时间 (4KB@115200约需360ms)
+#define MQTT_INFLIGHT_MAX              7            // QoS1在途表大小: 同时等待服务器确认的消息数(一轮上报5条+告警1条+获取期望属性1条)
+#define MQTT_PUB_ACK_TIMEOUT_MS     8000            // 等待 +QMTPUB 确认的超时, 超时后以原msgid重发
+#define MQTT_PUB_RETRY_MAX             3            // 最多重发次数, 超过后丢弃并计入失败
+#define MQTT_SUB_TOPIC_MAX             5            // 一条AT+QMTSUB最多携带的主题数(模组限制)
+#define MQTT_AT_LINE_MAX            1024            // 模组一条AT指令的最大长度; 内联方式的发布指令超过时改用提示符方式
+#define MQTT_PUB_PAYLOAD_MAX        1024            // 模组一条消息的最大负载字节数(提示符方式); 超过时不发送, 计入rejected
+#define MQTT_INLINE_ESCAPE             0            // 0=含'"'、'\'的负载(所有JSON)用提示符方式发送, 负载原样写入;
+                                                    // 1=内联方式中转义为\22、\5C(3GPP TS 27.007字符串转义), BC26的QMTPUB文档未说明支持, 须在模组上验证后才能启用
+#define MQTT_RECV_QUEUE_MAX            4            // 下行消息队列长度, 每条占用一个消息缓存块
+#define MQTT_RECV_PARTIAL_TIMEOUT_MS 2000           // 未接收完整的下行记录最长等待时间, 超时丢弃
+
+
+
+/*****************************************************************************
+ ** +QMTSTAT: 0,<err_code> 会话断开原因
+****************************************************************************/
+#define MQTT_STAT_PEER_CLOSED          1            // 连接被服务器关闭或复位
+#define MQTT_STAT_PING_TIMEOUT         2            // PINGREQ超时
+#define MQTT_STAT_CONNECT_FAIL         3            // CONNECT报文发送失败
+#define MQTT_STAT_CONNACK_TIMEOUT      4            // CONNACK超时
+#define MQTT_STAT_SERVER_DISCONNECT    5            // 服务器发送DISCONNECT
+#define MQTT_STAT_RETRY_EXHAUSTED      6            // 报文多次重发失败, 模组主动断开
+#define MQTT_STAT_LINK_DOWN            7            // 网络(PDP)已断开, 需要重新附着
+#define MQTT_STAT_SERVER_REJECT        8            // 服务器拒绝连接
+
+
+
+/*****************************************************************************
+ ** QoS1发布统计
+****************************************************************************/
+typedef struct
+{
+    uint32_t  sent;                                 // 首次发送的消息数
+    uint32_t  acked;                                // 收到服务器确认的消息数
+    uint32_t  retransmitted;                        // 本模块重发的次数
+    uint32_t  failed;                               // 超过重发次数被丢弃的消息数
+    uint32_t  rejected;                             // 在途表已满或消息过长, 未能发布的消息数
+} MQTT_PubStats;
+
+
+
+/*****************************************************************************
+ ** 片段与下行帧视图
+****************************************************************************/
+typedef struct
+{
+    const char *ptr;                                // 片段起始地址, 指向原缓存, 不以'\0'结尾
+    uint16_t    len;                                // 片段长度; 0=空片段
+} MQTT_Slice;
+
+typedef struct
+{
+    uint16_t    msgid;                              // 下行报文标识符(QoS0时为0)
+    MQTT_Slice  topic;                              // 主题
+    MQTT_Slice  payload;                            // 负载(JSON)
+    u64         rxMs;                               // 接收完整(放入接收队列)的时刻, 用于统计命令处理时延
+    uint32_t    firstByteCycles;                    // 串口收到本条记录首字节的时刻(DWT周期计数值, 按波特率估算)
+    uint32_t    completeCycles;                     // 本条记录最后一个字节到达的时刻(同上)
+} MQTT_FrameView;
+
+typedef struct
+{
+    uint32_t  received;                             // 放入接收队列的下行消息数
+    uint32_t  dropped;                              // 队列满、缓存池空或消息过长而丢弃的消息数
+    uint32_t  malformed;                            // 格式错误的记录数
+    uint32_t  timeouts;                             // 长时间未接收完整而丢弃的次数
+} MQTT_RecvStats;
+
+#define MQTT_SLICE_NULL         ((MQTT_Slice){ NULL, 0 })
+#define MQTT_SLICE_ARG(s)       (int)(s).len, (s).ptr         // 配合 "%.*s" 输出片段
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+bool     MQTT_AT_Write(const char *data, size_t len);                                // 向模组发送指定长度的数据, 阻塞直到全部写入串口发送缓冲区或超时
+bool     MQTT_AT_Send(const char *data);                                             // 向模组发送字符串, 同上
+bool     MQTT_Send_AT_Command(const char *cmd, const char *expected_response, uint32_t timeout_ms);   // 发送AT指令并等待响应
+bool     MQTT_Subscribe_Batch(const char *const *topics, uint8_t num, uint8_t qos, uint8_t *granted, uint32_t timeout_ms);  // 一条指令订阅多个主题
+
+uint16_t MQTT_Publish_QoS1(const char *topic, uint8_t topic_len, char *payload);         // 以QoS1发布, 负载缓存块交给本模块; 返回msgid, 0=未能发布
+uint16_t MQTT_Publish_QoS1_Binary(const char *topic, uint8_t topic_len, char *payload, uint16_t len);  // 同上, 负载为len字节的二进制数据
+bool     MQTT_Publish_QoS0(const char *topic, uint8_t topic_len, const char *payload, uint32_t timeout_ms);  // 以QoS0发布文本, 等待模组接受
+void     MQTT_Pub_Poll(void);                                                        // 主循环中调用: 超时重发、超过重发次数丢弃
+void     MQTT_Urc_Scan(char *buffer);                                                // 从接收到的数据中取出 +QMTPUB 确认(已处理的确认就地作废)
+void     MQTT_Pub_ResendAll(void);                                                   // 会话重新建立后, 以原msgid重发全部在途消息
+uint8_t  MQTT_Session_TakeError(void);                                               // 取出并清除 +QMTSTAT 错误码; 0=会话正常
+uint8_t  MQTT_Pub_InFlight(void);                                                    // 当前在途的消息数
+void     MQTT_Pub_GetStats(MQTT_PubStats *stats);                                    // 读取发布统计
+
+void     MQTT_Recv_Pump(void);                                                       // 取出接收缓存中的确认、通知和完整的下行消息, 释放已处理的数据
+bool     MQTT_Recv_Get(MQTT_FrameView *view);                                        // 取接收队列中最早的一条下行消息; false=队列为空
+void     MQTT_Recv_Done(void);                                                       // 最早的一条下行消息处理完毕, 出队并归还缓存块
+void     MQTT_Recv_GetStats(MQTT_RecvStats *stats);                                  // 读取下行接收统计
+const char *MQTT_Slice_Find(MQTT_Slice s, const char *needle);                       // 在片段中查找字符串, 返回位置, 没找到返回NULL
+bool     MQTT_Slice_Equal(MQTT_Slice s, const char *str);                            // 片段内容是否与字符串相同
+MQTT_Slice MQTT_Slice_Between(MQTT_Slice s, const char *head, const char *tail);     // 取片段中 head 与其后第一个 tail 之间的部分; 没找到返回空片段
+
+
+
+#endif
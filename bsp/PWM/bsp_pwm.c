@@ -0,0 +1,119 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  bsp_pwm.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  TIM3 PWM输出, 使用方法见bsp_pwm.h
+ **
+ ** 【实现说明】  PWM模式1, 比较寄存器预装载: 新的占空比在计数器溢出时才生效, 修改时不会出现半个周期的毛刺
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "bsp_pwm.h"
+
+
+
+/*****************************************************************************
+ ** 本地变量
+ *****************************************************************************/
+// 各PWM通道的引脚、定时器通道号(1~4); 顺序与Pwm_Channel相同
+static const struct
+{
+    GPIO_TypeDef *gpio;
+    uint16_t      pin;
+    uint8_t       timChannel;
+} xPwmChannels[PWM_CH_NUM] =
+{
+    { GPIOA, GPIO_Pin_6, 1 },                       // PWM_CH_FAN
+};
+
+static uint16_t usPeriod = 0;                       // 一个PWM周期的计数值(ARR + 1)
+static uint16_t usPermille[PWM_CH_NUM];
+
+
+
+/******************************************************************************
+ * 函  数： Pwm_CCR
+ * 功  能： 返回定时器通道对应的比较寄存器
+ ******************************************************************************/
+static volatile uint16_t *Pwm_CCR(uint8_t timChannel)
+{
+    switch (timChannel)
+    {
+    case 1:  return &TIM3->CCR1;
+    case 2:  return &TIM3->CCR2;
+    case 3:  return &TIM3->CCR3;
+    default: return &TIM3->CCR4;
+    }
+}
+
+/******************************************************************************
+ * 函  数： Pwm_Init
+ * 功  能： 配置TIM3为PWM_FREQ_HZ的PWM输出, 各通道占空比为0
+ * 参  数： 无
+ * 返回值： 无
+ ******************************************************************************/
+void Pwm_Init(void)
+{
+    GPIO_InitTypeDef GPIO_InitStructure;
+
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM3, ENABLE);
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA | RCC_APB2Periph_GPIOB | RCC_APB2Periph_AFIO, ENABLE);
+
+    // TIM3: 不分频, 定时器时钟为SystemCoreClock(APB1分频后定时器时钟为2倍)
+    usPeriod   = (uint16_t)(SystemCoreClock / PWM_FREQ_HZ);
+    TIM3->CR1  = 0;
+    TIM3->PSC  = 0;
+    TIM3->ARR  = usPeriod - 1;
+    TIM3->CCER = 0;
+
+    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_AF_PP;
+    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_2MHz;                // 25kHz, 低速即可, 减小边沿干扰
+    for (uint8_t i = 0; i < PWM_CH_NUM; i++)
+    {
+        uint8_t n = xPwmChannels[i].timChannel;
+        *Pwm_CCR(n) = 0;
+        usPermille[i] = 0;
+
+        // PWM模式1 + 比较预装载; CH1、CH3在CCMRx的低8位, CH2、CH4在高8位
+        uint16_t mode = TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1PE;
+        if (n == 1 || n == 2)  TIM3->CCMR1 |= (n == 1) ? mode : (uint16_t)(mode << 8);
+        else                   TIM3->CCMR2 |= (n == 3) ? mode : (uint16_t)(mode << 8);
+        TIM3->CCER |= TIM_CCER_CC1E << (4 * (n - 1));
+
+        GPIO_InitStructure.GPIO_Pin = xPwmChannels[i].pin;
+        GPIO_Init(xPwmChannels[i].gpio, &GPIO_InitStructure);
+    }
+
+    TIM3->EGR = TIM_EGR_UG;                                         // 装载ARR、CCR
+    TIM3->CR1 = TIM_CR1_ARPE | TIM_CR1_CEN;
+
+    printf("TIM3 PWM 初始化       %u通道, %luHz, %u级\r", PWM_CH_NUM, (unsigned long)PWM_FREQ_HZ, usPeriod);
+}
+
+/******************************************************************************
+ * 函  数： Pwm_SetPermille
+ * 功  能： 设置某通道的占空比, 下一个PWM周期生效
+ * 参  数： Pwm_Channel ch     通道
+ *          uint16_t permille  占空比, 0~1000; 超过1000按1000
+ * 返回值： 无
+ ******************************************************************************/
+void Pwm_SetPermille(Pwm_Channel ch, uint16_t permille)
+{
+    if (ch >= PWM_CH_NUM)
+        return;
+    if (permille > 1000)
+        permille = 1000;
+    usPermille[ch] = permille;
+    *Pwm_CCR(xPwmChannels[ch].timChannel) = (uint16_t)((uint32_t)usPeriod * permille / 1000);
+}
+
+/******************************************************************************
+ * 函  数： Pwm_GetPermille
+ * 功  能： 读取某通道当前设置的占空比
+ * 参  数： Pwm_Channel ch  通道
+ * 返回值： 占空比, 0~1000
+ ******************************************************************************/
+uint16_t Pwm_GetPermille(Pwm_Channel ch)
+{
+    return (ch < PWM_CH_NUM) ? usPermille[ch] : 0;
+}
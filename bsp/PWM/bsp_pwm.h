@@ -0,0 +1,48 @@
+#ifndef __BSP__PWM_H
+#define __BSP__PWM_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  bsp_pwm.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  TIM3 PWM输出: 25kHz(4线风扇PWM输入的标准频率, 人耳听不到), 占空比以千分比设置
+ **
+ ** 【硬件重点】  1- 风扇: TIM3_CH1 = PA6, 推挽复用输出; 接4线风扇的PWM输入时, 按风扇要求加开漏或电平转换;
+ **               2- TIM3_CH4的默认引脚PB1是LED1, 不要在本文件中启用CH4
+ **
+ ** 【使用说明】  1- 上电后调用Pwm_Init(), 各通道输出占空比0;
+ **               2- Pwm_SetPermille(PWM_CH_FAN, 500);     // 50.0%, 下一个PWM周期生效(预装载), 不会产生毛刺
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "system_f103.h"
+
+
+
+/*****************************************************************************
+ ** 移植配置
+****************************************************************************/
+#define PWM_FREQ_HZ              25000              // PWM频率; 定时器时钟72MHz时, 分辨率 = 72MHz / 25kHz = 2880级
+
+
+
+/*****************************************************************************
+ ** PWM通道
+****************************************************************************/
+typedef enum
+{
+    PWM_CH_FAN = 0,                                 // 风扇    TIM3_CH1 PA6
+    PWM_CH_NUM                                      // 数量, 不是通道
+} Pwm_Channel;
+
+
+
+/*****************************************************************************
+ ** 声明全局函数
+****************************************************************************/
+void     Pwm_Init(void);                                        // 初始化TIM3和各通道引脚, 占空比为0
+void     Pwm_SetPermille(Pwm_Channel ch, uint16_t permille);    // 设置占空比(0~1000, 超出按1000)
+uint16_t Pwm_GetPermille(Pwm_Channel ch);                       // 读取当前设置的占空比
+
+
+
+#endif
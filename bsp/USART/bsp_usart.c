@@ -9,21 +9,19 @@
  **
  **【适用平台】  STM32F103 + 标准库v3.5 + keil5
  **
- ** 【代码说明】  本文件的收发机制, 经多次修改, 已比较完善.
- **               初始化: 只需调用：USARTx_Init(波特率), 函数内已做好引脚及时钟配置；
- **               发 送 : 两个函数, 字符串: USARTx_SendString (char* stringTemp)、 数据: USARTx_SendData (uint8_t* buf, uint8_t cnt);
- **               接 收 : 方式1：通过全局函数USARTx_GetBuffer (uint8_t* buffer, uint8_t* cnt);　本函数已清晰地示例了接收机制；
- **                       方式2：通过判断: xUSART.USARTxReceivedNum > 0;
- **                              如在while中不断轮询，或在任何一个需要的地方判断接收到的字节数是否大于0．示例：
- **                              while(1){
- **                                  if(xUSART1.USART1ReceivedNum>0){
- **                                      printf((char*)xUSART.USART1ReceivedBuffer);          // 示例1: 如何输出成字符串
- **                                      uint16_t GPS_Value = xUSART.USART1ReceivedBuffer[1]; // 示例2: 如何读写其中某个成员的数据
- **                                      xUSART1.USART1ReceivedNum = 0;                     // 重要：处理完数据后
- **                                  }
- **                              }
+ ** 【代码说明】  五个串口共用一套代码, 差异全部写在描述表xUartPorts[]中, 收发机制见bsp_usart.h
+ **               接 收 : DMA(正常模式)写入当前缓存, 空闲中断时停止DMA, 切换到另一个缓存后重新启动, 交付只交换指针;
+ **                       UART5没有DMA通道, 由RXNE中断逐字节写入, 其余流程相同;
+ **               发 送 : 数据写入环形缓冲区; DMA每次发送缓冲区中一段连续的数据, 发送完成(TC)中断中推进读指针并启动下一段;
+ **                       UART5没有DMA通道, 由TXE中断逐字节发送;
+ **               修改收发机制时只需修改UART_xxx()通用函数, 五个串口同时生效
  **
  **【更新记录】
+ **              2026-10-19  流模式释放缓存时, 关中断期间只切换缓存、重新使能DMA, 保留的数据在开中断后搬移, 避免高波特率下溢出丢字节
+ **              2026-10-19  增加UART_SetBaudrate()/UART_SetFlowControl(): 运行中切换波特率, RTS/CTS硬件流控(USART1: PA11/PA12)
+ **              2026-10-19  增加UART_Write()/UART_WriteTimeout(): size_t长度, 返回实际写入的字节数; USARTx_SendData()的长度改为uint16_t, 不再按256截断
+ **              2026-10-19  五个串口合并为一套描述表驱动: DMA接收+乒乓缓存, 环形缓冲区+DMA发送; USART1改为流模式; printf改为写入发送环形缓冲区
+ **              2026-10-19  USART2~UART5接收改为乒乓缓存, 空闲中断中交换指针交付一帧, 去除每帧2KB的memcpy、memset
  **              2021-12-16  完善接收机制：取消接收标志，判断接收字节数>0即为接收到新数据
  **              2021-12-15  完善接收机制，新帧数据包，可覆盖旧数据
  **              2021-11-03  完善接收函数返回值处理
@@ -38,887 +36,927 @@
 ************************************************************************************************************************************/
 #include "bsp_usart.h"
 #include "stm32f10x.h"
+#include "irq_stats.h"
+#include "system_f103.h"
 
 
 
-xUSATR_TypeDef  xUSART;         // 声明为全局变量,方便记录信息、状态
+xUSATR_TypeDef  xUSART;                              // 声明为全局变量,方便记录信息、状态
+volatile uint8_t g_usart1_new_line_received = 0;     // 当接收到一行完整的指令时，此标志位置1
 
 
 
+/*****************************************************************************
+ ** 串口描述表
+ ** 每个串口一项, 描述寄存器、时钟、引脚、中断、DMA通道、收发缓存, 以及应用程序读取的xUSART成员
+ ** 运行状态放在xUART_State中, 描述表本身为const, 存放在Flash
+ ****************************************************************************/
+#define UART_RX_FRAME             0                 // 接收方式: 帧模式, 每次空闲中断交付一帧
+#define UART_RX_STREAM            1                 // 接收方式: 流模式, 数据持续累加, 由应用程序清空
 
-//////////////////////////////////////////////////////////////   USART-1   //////////////////////////////////////////////////////////////
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/******************************************************************************
- * 函  数： vUSART1_Init
- * 功  能： 初始化USART1的GPIO、通信参数配置、中断优先级
- *          (8位数据、无校验、1个停止位)
- * 参  数： uint32_t baudrate  通信波特率
- * 返回值： 无
- ******************************************************************************/
-void USART1_Init(uint32_t baudrate)
+typedef struct
 {
-    GPIO_InitTypeDef  GPIO_InitStructure;
-    NVIC_InitTypeDef  NVIC_InitStructure;
-    USART_InitTypeDef USART_InitStructure;
-
-    // 时钟使能
-    RCC->APB2ENR |= RCC_APB2ENR_USART1EN;                           // 使能USART1时钟
-    RCC->APB2ENR |= RCC_APB2ENR_IOPAEN;                             // 使能GPIOA时钟
-
-    // GPIO_TX引脚配置
-    GPIO_InitStructure.GPIO_Pin   = GPIO_Pin_9;
-    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
-    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_AF_PP;                // TX引脚工作模式：复用推挽
-    GPIO_Init(GPIOA, &GPIO_InitStructure);
-    // GPIO_RX引脚配置
-    GPIO_InitStructure.GPIO_Pin   = GPIO_Pin_10;
-    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_IPU;                  // RX引脚工作模式：上拉输入; 如果使用浮空输入，引脚空置时可能产生误输入; 当电路上为一主多从电路时，可以使用复用开漏模式
-    GPIO_Init(GPIOA, &GPIO_InitStructure);
-
-    // 中断配置
-    NVIC_InitStructure .NVIC_IRQChannel = USART1_IRQn;
-    NVIC_InitStructure .NVIC_IRQChannelPreemptionPriority = 2 ;     // 抢占优先级
-    NVIC_InitStructure .NVIC_IRQChannelSubPriority = 2;             // 子优先级
-    NVIC_InitStructure .NVIC_IRQChannelCmd = ENABLE;                // IRQ通道使能
-    NVIC_Init(&NVIC_InitStructure);
-
-    //USART 初始化设置
-    USART_DeInit(USART1);
-    USART_InitStructure.USART_BaudRate   = baudrate;                // 串口波特率
-    USART_InitStructure.USART_WordLength = USART_WordLength_8b;     // 字长为8位数据格式
-    USART_InitStructure.USART_StopBits   = USART_StopBits_1;        // 一个停止位
-    USART_InitStructure.USART_Parity     = USART_Parity_No;         // 无奇偶校验位
-    USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
-    USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx; // 使能收、发模式
-    USART_Init(USART1, &USART_InitStructure);                       // 初始化串口
+    uint8_t            rxIndex;                     // 正在写入的接收缓存编号: 0或1
+    volatile uint16_t  rxCnt;                       // 无DMA时: 当前缓存已接收的字节数
+    volatile uint16_t  rxIdleCnt;                   // 最近一次空闲中断时, 当前缓存的字节数; 与当前字节数相等, 表示其后没有新数据, 即为完整的帧
+    volatile uint32_t  rxIdleCycles;                // 最近一次空闲中断的时刻(DWT周期计数值), 用于估算数据到达的时刻
+    volatile uint16_t  txHead;                      // 发送环形缓冲区写入位置, 只由应用程序修改
+    volatile uint16_t  txTail;                      // 发送环形缓冲区读取位置, 只由中断修改
+    volatile uint16_t  txDmaLen;                    // DMA正在发送的字节数; 0=DMA空闲
+    uint32_t           baudrate;                    // 当前波特率
+    uint16_t           flowCtrl;                    // 当前硬件流控: USART_HardwareFlowControl_None 或 _RTS_CTS
+} xUART_State;
+
+typedef struct
+{
+    USART_TypeDef        *USARTx;                   // 串口
+    uint32_t              rccApb1;                  // APB1时钟: USART2~UART5
+    uint32_t              rccApb2;                  // APB2时钟: USART1, 及引脚所在的GPIO
+    uint32_t              rccAhb;                   // AHB时钟:  DMA1或DMA2; 0=不使用DMA
+    GPIO_TypeDef         *txGPIOx;                  // TX引脚
+    uint16_t              txPin;
+    GPIO_TypeDef         *rxGPIOx;                  // RX引脚
+    uint16_t              rxPin;
+    GPIO_TypeDef         *ctsGPIOx;                 // CTS引脚; NULL=该串口不支持硬件流控
+    uint16_t              ctsPin;
+    GPIO_TypeDef         *rtsGPIOx;                 // RTS引脚
+    uint16_t              rtsPin;
+    IRQn_Type             irqn;                     // 串口中断
+    DMA_Channel_TypeDef  *dmaRx;                    // 接收DMA通道; NULL=由RXNE中断逐字节接收
+    DMA_Channel_TypeDef  *dmaTx;                    // 发送DMA通道; NULL=由TXE中断逐字节发送
+    uint8_t              *rxBuf[2];                 // 乒乓接收缓存, 大小均为rxSize+1, 多出的1字节用于存放结尾的0
+    uint16_t              rxSize;
+    uint8_t              *txBuf;                    // 发送环形缓冲区
+    uint16_t              txSize;
+    uint8_t               rxMode;                   // 接收方式: UART_RX_FRAME 或 UART_RX_STREAM
+    uint8_t              *initFlag;                 // xUSART.USARTxInitFlag
+    volatile uint16_t    *rxNum;                    // xUSART.USARTxReceivedNum
+    uint8_t             **rxFrame;                  // xUSART.USARTxReceivedBuffer
+    xUART_State          *state;                    // 运行状态
+    const char           *name;                     // 名称, 用于输出初始化信息
+} xUART_PortDef;
+
+static uint8_t U1RxBuffer[2][U1_RX_BUF_SIZE + 1];
+static uint8_t U2RxBuffer[2][U2_RX_BUF_SIZE + 1];
+static uint8_t U3RxBuffer[2][U3_RX_BUF_SIZE + 1];
+static uint8_t U1TxBuffer[U1_TX_BUF_SIZE];
+static uint8_t U2TxBuffer[U2_TX_BUF_SIZE];
+static uint8_t U3TxBuffer[U3_TX_BUF_SIZE];
+#ifdef STM32F10X_HD
+static uint8_t U4RxBuffer[2][U4_RX_BUF_SIZE + 1];
+static uint8_t U5RxBuffer[2][U5_RX_BUF_SIZE + 1];
+static uint8_t U4TxBuffer[U4_TX_BUF_SIZE];
+static uint8_t U5TxBuffer[U5_TX_BUF_SIZE];
+#endif
 
-    USART_ITConfig(USART1, USART_IT_TXE, DISABLE);
-    USART_ITConfig(USART1, USART_IT_RXNE, ENABLE);                  // 使能接受中断
-    USART_ITConfig(USART1, USART_IT_IDLE, ENABLE);                  // 使能空闲中断
+static xUART_State xUartState[UART_PORT_NUM];
 
-    USART_Cmd(USART1, ENABLE);                                      // 使能串口, 开始工作
+static const xUART_PortDef xUartPorts[UART_PORT_NUM] =
+{
+    [UART_PORT_1] = {
+        .USARTx  = USART1,  .rccApb1 = 0,  .rccApb2 = RCC_APB2Periph_USART1 | RCC_APB2Periph_GPIOA,  .rccAhb = RCC_AHBPeriph_DMA1,
+        .txGPIOx = GPIOA,   .txPin = GPIO_Pin_9,   .rxGPIOx = GPIOA,  .rxPin = GPIO_Pin_10,  .irqn = USART1_IRQn,
+        .ctsGPIOx = GPIOA,  .ctsPin = GPIO_Pin_11, .rtsGPIOx = GPIOA, .rtsPin = GPIO_Pin_12,
+        .dmaRx   = DMA1_Channel5,  .dmaTx = DMA1_Channel4,
+        .rxBuf   = {U1RxBuffer[0], U1RxBuffer[1]},  .rxSize = U1_RX_BUF_SIZE,  .txBuf = U1TxBuffer,  .txSize = U1_TX_BUF_SIZE,
+        .rxMode  = UART_RX_STREAM,
+        .initFlag = &xUSART.USART1InitFlag,  .rxNum = &xUSART.USART1ReceivedNum,  .rxFrame = &xUSART.USART1ReceivedBuffer,
+        .state   = &xUartState[UART_PORT_1],  .name = "USART1"
+    },
+    [UART_PORT_2] = {
+        .USARTx  = USART2,  .rccApb1 = RCC_APB1Periph_USART2,  .rccApb2 = RCC_APB2Periph_GPIOA,  .rccAhb = RCC_AHBPeriph_DMA1,
+        .txGPIOx = GPIOA,   .txPin = GPIO_Pin_2,   .rxGPIOx = GPIOA,  .rxPin = GPIO_Pin_3,   .irqn = USART2_IRQn,
+        .ctsGPIOx = GPIOA,  .ctsPin = GPIO_Pin_0,  .rtsGPIOx = GPIOA, .rtsPin = GPIO_Pin_1,
+        .dmaRx   = DMA1_Channel6,  .dmaTx = DMA1_Channel7,
+        .rxBuf   = {U2RxBuffer[0], U2RxBuffer[1]},  .rxSize = U2_RX_BUF_SIZE,  .txBuf = U2TxBuffer,  .txSize = U2_TX_BUF_SIZE,
+        .rxMode  = UART_RX_FRAME,
+        .initFlag = &xUSART.USART2InitFlag,  .rxNum = &xUSART.USART2ReceivedNum,  .rxFrame = &xUSART.USART2ReceivedBuffer,
+        .state   = &xUartState[UART_PORT_2],  .name = "USART2"
+    },
+    [UART_PORT_3] = {
+        .USARTx  = USART3,  .rccApb1 = RCC_APB1Periph_USART3,  .rccApb2 = RCC_APB2Periph_GPIOB,  .rccAhb = RCC_AHBPeriph_DMA1,
+        .txGPIOx = GPIOB,   .txPin = GPIO_Pin_10,  .rxGPIOx = GPIOB,  .rxPin = GPIO_Pin_11,  .irqn = USART3_IRQn,
+        .ctsGPIOx = GPIOB,  .ctsPin = GPIO_Pin_13, .rtsGPIOx = GPIOB, .rtsPin = GPIO_Pin_14,
+        .dmaRx   = DMA1_Channel3,  .dmaTx = DMA1_Channel2,
+        .rxBuf   = {U3RxBuffer[0], U3RxBuffer[1]},  .rxSize = U3_RX_BUF_SIZE,  .txBuf = U3TxBuffer,  .txSize = U3_TX_BUF_SIZE,
+        .rxMode  = UART_RX_FRAME,
+        .initFlag = &xUSART.USART3InitFlag,  .rxNum = &xUSART.USART3ReceivedNum,  .rxFrame = &xUSART.USART3ReceivedBuffer,
+        .state   = &xUartState[UART_PORT_3],  .name = "USART3"
+    },
+#ifdef STM32F10X_HD  // STM32F103R，及以上，才有UART4和UART5
+    [UART_PORT_4] = {
+        .USARTx  = UART4,   .rccApb1 = RCC_APB1Periph_UART4,   .rccApb2 = RCC_APB2Periph_GPIOC,  .rccAhb = RCC_AHBPeriph_DMA2,
+        .txGPIOx = GPIOC,   .txPin = GPIO_Pin_10,  .rxGPIOx = GPIOC,  .rxPin = GPIO_Pin_11,  .irqn = UART4_IRQn,
+        .ctsGPIOx = NULL,                          // UART4、UART5没有RTS/CTS
+        .dmaRx   = DMA2_Channel3,  .dmaTx = DMA2_Channel5,
+        .rxBuf   = {U4RxBuffer[0], U4RxBuffer[1]},  .rxSize = U4_RX_BUF_SIZE,  .txBuf = U4TxBuffer,  .txSize = U4_TX_BUF_SIZE,
+        .rxMode  = UART_RX_FRAME,
+        .initFlag = &xUSART.UART4InitFlag,   .rxNum = &xUSART.UART4ReceivedNum,   .rxFrame = &xUSART.UART4ReceivedBuffer,
+        .state   = &xUartState[UART_PORT_4],  .name = "UART4 "
+    },
+    [UART_PORT_5] = {                                                                       // UART5没有DMA通道
+        .USARTx  = UART5,   .rccApb1 = RCC_APB1Periph_UART5,   .rccApb2 = RCC_APB2Periph_GPIOC | RCC_APB2Periph_GPIOD,  .rccAhb = 0,
+        .txGPIOx = GPIOC,   .txPin = GPIO_Pin_12,  .rxGPIOx = GPIOD,  .rxPin = GPIO_Pin_2,   .irqn = UART5_IRQn,
+        .ctsGPIOx = NULL,
+        .dmaRx   = NULL,           .dmaTx = NULL,
+        .rxBuf   = {U5RxBuffer[0], U5RxBuffer[1]},  .rxSize = U5_RX_BUF_SIZE,  .txBuf = U5TxBuffer,  .txSize = U5_TX_BUF_SIZE,
+        .rxMode  = UART_RX_FRAME,
+        .initFlag = &xUSART.UART5InitFlag,   .rxNum = &xUSART.UART5ReceivedNum,   .rxFrame = &xUSART.UART5ReceivedBuffer,
+        .state   = &xUartState[UART_PORT_5],  .name = "UART5 "
+    },
+#endif
+};
 
-    USART1->SR = ~(0x00F0);                                         // 清理中断
 
-    xUSART.USART1InitFlag = 1;                                      // 标记初始化标志
-    xUSART.USART1ReceivedNum = 0;                                   // 接收字节数清零
 
-    printf("\r\r\r=========== 魔女开发板 STM32F103 外设初始报告 ===========\r");
-    printf("USART1初始化配置      接收中断、空闲中断, 发送中断\r");
+/******************************************************************************
+ * 函  数： UART_RxCount
+ * 功  能： 当前接收缓存中已接收的字节数
+ ******************************************************************************/
+static inline uint16_t UART_RxCount(const xUART_PortDef *port)
+{
+    if (port->dmaRx)
+        return port->rxSize - port->dmaRx->CNDTR;   // DMA从缓存偏移处开始时, CNDTR也相应减少, 因此该值始终是从缓存开头算起的字节数
+    return port->state->rxCnt;
 }
 
 /******************************************************************************
- * 函  数： USART1_IRQHandler
- * 功  能： USART1的接收中断、空闲中断、发送中断
- * 参  数： 无
- * 返回值： 无
- *
-******************************************************************************/
-static uint16_t U1TxBuffer[4096] ;    // 用于中断发送：环形缓冲区，4096个字节
-static uint16_t U1TxCounter = 0 ;    // 用于中断发送：标记已发送的字节数(环形)
-static uint16_t U1TxCount   = 0 ;    // 用于中断发送：标记将要发送的字节数(环形)
-
-void USART1_IRQHandler(void)
+ * 函  数： UART_RxSwitch
+ * 功  能： 停止写入当前接收缓存, 切换到另一个缓存继续接收
+ *          当前缓存在from处截断, from之后的数据(属于下一帧)留给UART_RxMoveTail()搬到另一个缓存的开头;
+ *          DMA(或接收中断)从另一个缓存的keep处开始写入, 与搬移的区域不重叠, 因此搬移可以在开中断后进行
+ *          须在中断中, 或关中断后调用
+ * 参  数： uint16_t from   截断位置; 大于已接收字节数时, 不截断
+ *          uint16_t *keep  返回需要搬移的字节数
+ * 返回值： 当前缓存截断后的字节数
+ ******************************************************************************/
+static uint16_t UART_RxSwitch(const xUART_PortDef *port, uint16_t from, uint16_t *keep)
 {
-    // static uint16_t cnt = 0;  //<-- 不再需要这个静态的cnt
-    // static uint8_t  RxTemp[U1_RX_BUF_SIZE]; //<-- 也不再需要这个临时数组
-
-    // 接收中断
-    if (USART_GetITStatus(USART1, USART_IT_RXNE) != RESET)
+    xUART_State *st   = port->state;
+    uint8_t     *next = port->rxBuf[st->rxIndex ^ 1];
+    uint16_t     cnt;
+
+    if (port->dmaRx)
+        port->dmaRx->CCR &= ~DMA_CCR1_EN;           // 先停止DMA, 再读取字节数, 之后到达的字节暂存在DR中, DMA重新使能后取走
+    cnt = UART_RxCount(port);
+    if (from > cnt)
+        from = cnt;
+    *keep = cnt - from;
+
+    st->rxIndex  ^= 1;
+    st->rxIdleCnt = 0;
+    if (port->dmaRx)
     {
-        // 检查缓冲区是否已满，防止溢出
-        if(xUSART.USART1ReceivedNum < U1_RX_BUF_SIZE)
-        {
-            // 直接将接收到的数据追加到全局缓冲区的末尾
-            xUSART.USART1ReceivedBuffer[xUSART.USART1ReceivedNum++] = USART_ReceiveData(USART1);
-        }
-        else
-        {
-            // 缓冲区满了，丢弃数据，但要读一下DR来清除中断标志
-            USART_ReceiveData(USART1);
-        }
-        // 注意：RXNE标志在读取DR后会自动清除
+        port->dmaRx->CMAR  = (uint32_t)(next + *keep);
+        port->dmaRx->CNDTR = port->rxSize - *keep;
+        port->dmaRx->CCR  |= DMA_CCR1_EN;           // 立即恢复接收, DMA停止的时间与保留的字节数无关
     }
-
-    // 空闲中断, 在这种模式下，空闲中断可以什么都不做，或者只用于一些特殊逻辑
-    // 为了兼容您原来的设计，我们保留空闲中断的清除操作
-    if(USART_GetITStatus(USART1, USART_IT_IDLE) != RESET)
+    else
     {
-        // 空闲中断的清除方法是先读SR再读DR
-        // 因为上面的RXNE中断可能没发生，所以这里需要安全地读一下
-        volatile uint16_t temp;
-        temp = USART1->SR;
-        temp = USART1->DR;
+        st->rxCnt = *keep;
     }
+    return from;
+}
 
-    // 发送中断 (这部分逻辑不变)
-    if ((USART1->SR & 1 << 7) && (USART1->CR1 & 1 << 7))
-    {
-        USART1->DR = U1TxBuffer[U1TxCounter++];
-        if (U1TxCounter == U1TxCount)
-            USART1->CR1 &= ~(1 << 7);
-    }
+/******************************************************************************
+ * 函  数： UART_RxMoveTail
+ * 功  能： UART_RxSwitch()之后, 把旧缓存from之后的keep字节搬到新缓存的开头, 旧缓存在from处以0结尾
+ *          新缓存的写入从keep处开始, 不与本函数冲突, 可以在开中断时调用
+ ******************************************************************************/
+static void UART_RxMoveTail(const xUART_PortDef *port, uint16_t from, uint16_t keep)
+{
+    uint8_t *next = port->rxBuf[port->state->rxIndex];
+    uint8_t *old  = port->rxBuf[port->state->rxIndex ^ 1];
+
+    if (keep)
+        memcpy(next, old + from, keep);
+    old[from] = 0;                                  // 以0结尾, 方便按字符串处理
 }
 
 /******************************************************************************
- * 函  数： vUSART1_GetBuffer
- * 功  能： 获取UART所接收到的数据
- * 参  数： uint8_t* buffer   数据存放缓存地址
- *          uint8_t* cnt      接收到的字节数
- * 返回值： 0_没有接收到新数据， 非0_所接收到新数据的字节数
+ * 函  数： UART_RxStreamConsume
+ * 功  能： 流模式: 释放缓存开头的len字节, 其后的数据搬到另一个缓存的开头继续累加;
+ *          最近一次空闲中断之前到达的部分仍计入接收字节数, 不需要等下一次空闲中断
+ *          关中断期间只切换缓存、重新设置DMA, 保留的数据(可能接近整个缓存)在开中断后搬移,
+ *          高波特率、无硬件流控时也不会因DMA停止过久而溢出(ORE)丢失字节
  ******************************************************************************/
-uint8_t USART1_GetBuffer(uint8_t *buffer, uint8_t *cnt)
+static void UART_RxStreamConsume(const xUART_PortDef *port, uint16_t len)
 {
-    if (xUSART.USART1ReceivedNum > 0)                                           // 判断是否有新数据
-    {
-        memcpy(buffer, xUSART.USART1ReceivedBuffer, xUSART.USART1ReceivedNum);  // 把新数据复制到指定位置
-        *cnt = xUSART.USART1ReceivedNum;                                        // 把新数据的字节数，存放指定变量
-        xUSART.USART1ReceivedNum = 0;                                           // 接收标记置0
-        return *cnt;                                                            // 返回所接收到新数据的字节数
-    }
-    return 0;                                                                   // 返回0, 表示没有接收到新数据
+    uint16_t keep;
+
+    // 另一个缓存先整体清零, 使strstr等按字符串查找时不会读到上次残留的数据; 流模式下中断不会访问另一个缓存, 无需关中断
+    memset(port->rxBuf[port->state->rxIndex ^ 1], 0, port->rxSize + 1);
+
+    IRQ_STATS_CRITICAL_ENTER();
+    uint16_t idleCnt = port->state->rxIdleCnt;
+    uint16_t from    = UART_RxSwitch(port, len, &keep);
+    uint16_t left    = (idleCnt > from) ? idleCnt - from : 0;
+    port->state->rxIdleCnt = left;                  // UART_RxSwitch()已清零, 改为保留下来的完整部分
+    *port->rxFrame = port->rxBuf[port->state->rxIndex];
+    *port->rxNum   = left;
+    IRQ_STATS_CRITICAL_EXIT();
+
+    // 空闲中断只会在keep之后写结尾的0, 读取接收缓存的只有调用者本身, 本函数返回前搬移完成
+    UART_RxMoveTail(port, from, keep);
 }
 
 /******************************************************************************
- * 函  数： vUSART1_SendData
- * 功  能： UART通过中断发送数据,适合各种数据类型
- *         【适合场景】本函数可发送各种数据，而不限于字符串，如int,char
- *         【不 适 合】注意环形缓冲区容量4096字节，如果发送频率太高，注意波特率
- * 参  数： uint16_t* buffer   需发送数据的首地址
- *          uint16_t  cnt      发送的字节数 ，限于中断发送的缓存区大小，不能大于4096个字节
- * 返回值：
+ * 函  数： UART_RxPublish
+ * 功  能： 帧模式: 当前缓存中是完整的帧(最近一次空闲中断之后没有新数据), 且应用程序已释放上一帧时, 交换指针交付本帧
+ *          只操作指针和长度, 执行时间与帧长度无关; 须在中断中, 或关中断后调用
  ******************************************************************************/
-void USART1_SendData(uint8_t *buf, uint8_t cnt)
+static void UART_RxPublish(const xUART_PortDef *port)
 {
-    for (uint16_t i = 0; i < cnt; i++)
-        U1TxBuffer[U1TxCount++] = buf[i];
+    xUART_State *st    = port->state;
+    uint8_t     *frame = port->rxBuf[st->rxIndex];
+    uint16_t     idleCnt = st->rxIdleCnt;
 
-    if ((USART1->CR1 & 1 << 7) == 0)       // 检查发送缓冲区空置中断(TXEIE)是否已打开
-        USART1->CR1 |= 1 << 7;
+    if (*port->rxNum != 0 || idleCnt == 0)          // 应用程序还持有上一帧, 新数据继续留在当前缓存中累加; 或没有完整的帧
+        return;
+
+    uint16_t keep;
+    *port->rxNum   = UART_RxSwitch(port, idleCnt, &keep);   // 空闲之后才到达的字节属于下一帧, 搬到另一个缓存
+    UART_RxMoveTail(port, *port->rxNum, keep);              // 空闲后到达的字节很少, 在中断中直接搬移
+    *port->rxFrame = frame;
 }
 
 /******************************************************************************
- * 函  数： vUSART1_SendString
- * 功  能： UART通过中断发送输出字符串,无需输入数据长度
- *         【适合场景】字符串，长度<=4096字节
- *         【不 适 合】int,float等数据类型
- * 参  数： char* stringTemp   需发送数据的缓存首地址
- * 返回值： 元
+ * 函  数： UART_TxStartDma
+ * 功  能： DMA空闲时, 启动发送环形缓冲区中的下一段连续数据; 须在中断中, 或关中断后调用
  ******************************************************************************/
-void USART1_SendString(char *stringTemp)
+static void UART_TxStartDma(const xUART_PortDef *port)
 {
-    u16 num = 0;                                 // 字符串长度
-    char *t = stringTemp ;                       // 用于配合计算发送的数量
-    while (*t++ != 0)  num++;                    // 计算要发送的数目，这步比较耗时，测试发现每多6个字节，增加1us，单位：8位
-    USART1_SendData((u8 *)stringTemp, num);      // 注意调用函数所需要的真实数据长度; 如果目标需要以0作结尾判断，需num+1：字符串以0结尾，即多发一个:0
+    xUART_State *st   = port->state;
+    uint16_t     head = st->txHead;
+    uint16_t     tail = st->txTail;
+    uint16_t     len;
+
+    if (st->txDmaLen != 0 || head == tail)          // DMA正在发送, 或没有数据
+        return;
+
+    len = (head > tail) ? (head - tail) : (port->txSize - tail);   // 数据跨越缓冲区末尾时, 先发到末尾, 余下的在下一段发送
+    port->dmaTx->CCR  &= ~DMA_CCR1_EN;
+    port->dmaTx->CMAR  = (uint32_t)&port->txBuf[tail];
+    port->dmaTx->CNDTR = len;
+    st->txDmaLen       = len;
+    port->USARTx->SR   = (uint16_t)~USART_SR_TC;    // 清除TC, 使TC中断只在本段发送完成后发生
+    port->dmaTx->CCR  |= DMA_CCR1_EN;
+    port->USARTx->CR1 |= USART_CR1_TCIE;
 }
 
 /******************************************************************************
- * 函  数： vUSART1_SendStringForDMA
- * 功  能： UART通过DMA发送数据，省了占用中断的时间
- *         【适合场景】字符串，字节数非常多，
- *         【不 适 合】1:只适合发送字符串，不适合发送可能含0的数值类数据; 2-时间间隔要足够
- * 参  数： char strintTemp  要发送的字符串首地址
- * 返回值： 无
+ * 函  数： UART_TxPut
+ * 功  能： 把数据写入发送环形缓冲区, 并启动发送
+ * 参  数： const uint8_t *buf   数据
+ *          uint16_t cnt         字节数
+ * 返回值： 实际写入的字节数; 缓冲区空间不足时, 只写入放得下的部分
  ******************************************************************************/
-void USART1_SendStringForDMA(char *stringTemp)
+static uint16_t UART_TxPut(const xUART_PortDef *port, const uint8_t *buf, uint16_t cnt)
 {
-    static u8 Flag_DmaTxInit = 0;                // 用于标记是否已配置DMA发送
-    u32   num = 0;                               // 发送的数量，注意发送的单位不是必须8位的
-    char *t = stringTemp ;                       // 用于配合计算发送的数量
+    xUART_State *st    = port->state;
+    uint16_t     head  = st->txHead;
+    uint16_t     space = (st->txTail + port->txSize - head - 1) % port->txSize;
+    uint16_t     first;
+
+    if (cnt > space)
+        cnt = space;
+    if (cnt == 0)
+        return 0;
+
+    first = port->txSize - head;                    // 缓冲区末尾之前可连续写入的字节数
+    if (first > cnt)
+        first = cnt;
+    memcpy(&port->txBuf[head], buf, first);
+    memcpy(port->txBuf, buf + first, cnt - first);
+    st->txHead = (head + cnt) % port->txSize;
+
+    IRQ_STATS_CRITICAL_ENTER();                     // 与本串口中断同时修改CR1、DMA, 需关中断
+    if (port->dmaTx)
+        UART_TxStartDma(port);
+    else
+        port->USARTx->CR1 |= USART_CR1_TXEIE;       // 打开TXE中断, 由中断逐字节发送
+    IRQ_STATS_CRITICAL_EXIT();
+    return cnt;
+}
 
-    while (*t++ != 0)  num++;                    // 计算要发送的数目，这步比较耗时，测试发现每多6个字节，增加1us，单位：8位
+/******************************************************************************
+ * 函  数： UART_IRQHandler
+ * 功  能： 所有串口共用的中断处理: 接收(无DMA时)、空闲、发送完成(DMA)、发送缓冲区空(无DMA时)
+ ******************************************************************************/
+static void UART_IRQHandler(const xUART_PortDef *port)
+{
+    USART_TypeDef *USARTx = port->USARTx;
+    xUART_State   *st     = port->state;
+    uint16_t       sr     = USARTx->SR;
 
-    while (DMA1_Channel4->CNDTR > 0);            // 重要：如果DMA还在进行上次发送，就等待; 得进完成中断清标志，F4不用这么麻烦，发送完后EN自动清零
-    if (Flag_DmaTxInit == 0)                     // 是否已进行过USAART_TX的DMA传输配置
+    // 接收中断: 仅无DMA的串口; 把新收到的字节存入当前缓存, 缓存已满时舍弃, 直到帧结束(空闲中断)
+    if ((sr & USART_SR_RXNE) && port->dmaRx == NULL)
     {
-        Flag_DmaTxInit  = 1;                     // 设置标记，下次调用本函数就不再进行配置了
-        USART1 ->CR3   |= 1 << 7;                // 使能DMA发送
-        RCC->AHBENR    |= 1 << 0;                // 开启DMA1时钟  [0]DMA1   [1]DMA2
-
-        DMA1_Channel4->CCR   = 0;                // 失能， 清0整个寄存器, DMA必须失能才能配置
-        DMA1_Channel4->CNDTR = num;              // 传输数据量
-        DMA1_Channel4->CMAR  = (u32)stringTemp;  // 存储器地址
-        DMA1_Channel4->CPAR  = (u32)&USART1->DR; // 外设地址
-
-        DMA1_Channel4->CCR |= 1 << 4;            // 数据传输方向   0:从外设读   1:从存储器读
-        DMA1_Channel4->CCR |= 0 << 5;            // 循环模式       0:不循环     1：循环
-        DMA1_Channel4->CCR |= 0 << 6;            // 外设地址非增量模式
-        DMA1_Channel4->CCR |= 1 << 7;            // 存储器增量模式
-        DMA1_Channel4->CCR |= 0 << 8;            // 外设数据宽度为8位
-        DMA1_Channel4->CCR |= 0 << 10;           // 存储器数据宽度8位
-        DMA1_Channel4->CCR |= 0 << 12;           // 中等优先级
-        DMA1_Channel4->CCR |= 0 << 14;           // 非存储器到存储器模式
+        uint8_t data = USARTx->DR;                  // 读DR时自动清零RXNE
+        if (st->rxCnt < port->rxSize)
+            port->rxBuf[st->rxIndex][st->rxCnt++] = data;
     }
-    DMA1_Channel4->CCR  &= ~((u32)(1 << 0));     // 失能，DMA必须失能才能配置
-    DMA1_Channel4->CNDTR = num;                  // 传输数据量
-    DMA1_Channel4->CMAR  = (u32)stringTemp;      // 存储器地址
-    DMA1_Channel4->CCR  |= 1 << 0;               // 开启DMA传输
+
+    // 空闲中断, 判断一帧数据的接收完成
+    if (sr & USART_SR_IDLE)
+    {
+        USARTx->DR;                                 // 清零IDLE中断标志位!! 序列清零: 先读SR(上面已读), 再读DR; 同时清除溢出标志ORE
+        st->rxIdleCnt    = UART_RxCount(port);
+        st->rxIdleCycles = System_GetCycles();
+        if (port->rxMode == UART_RX_STREAM)
+        {
+            uint8_t *cur = port->rxBuf[st->rxIndex];
+            cur[st->rxIdleCnt] = 0;                 // 以0结尾; 之后到达的数据会覆盖它, 由下一次空闲中断重新以0结尾
+            *port->rxFrame = cur;
+            *port->rxNum   = st->rxIdleCnt;
+        }
+        else
+        {
+            UART_RxPublish(port);                   // 交换指针交付本帧; 上一帧未处理时, 本帧数据继续保留在当前缓存中
+        }
+    }
+
+    // 发送完成中断: DMA发送完一段, 推进读指针, 启动下一段
+    if (port->dmaTx)
+    {
+        if ((sr & USART_SR_TC) && (USARTx->CR1 & USART_CR1_TCIE))
+        {
+            USARTx->SR = (uint16_t)~USART_SR_TC;
+            if (st->txDmaLen != 0 && port->dmaTx->CNDTR == 0)
+            {
+                st->txTail   = (st->txTail + st->txDmaLen) % port->txSize;
+                st->txDmaLen = 0;
+                UART_TxStartDma(port);
+            }
+            if (st->txDmaLen == 0)
+                USARTx->CR1 &= ~USART_CR1_TCIE;     // 已全部发送完成, 关闭TC中断
+        }
+    }
+    // 发送缓冲区空中断: 无DMA的串口逐字节发送
+    else if ((sr & USART_SR_TXE) && (USARTx->CR1 & USART_CR1_TXEIE))
+    {
+        if (st->txTail != st->txHead)
+        {
+            USARTx->DR = port->txBuf[st->txTail];
+            st->txTail = (st->txTail + 1) % port->txSize;
+        }
+        if (st->txTail == st->txHead)
+            USARTx->CR1 &= ~USART_CR1_TXEIE;        // 已发送完成，关闭发送缓冲区空置中断 TXEIE
+    }
+}
+
+
+
+/******************************************************************************
+ * 函  数： UART_Config
+ * 功  能： 按运行状态中的波特率、硬件流控, 配置串口通信参数(8位数据、无校验、1个停止位)
+ *          USART_Init()只修改通信参数相关的位, 中断使能、DMA使能保持不变
+ ******************************************************************************/
+static void UART_Config(const xUART_PortDef *port)
+{
+    USART_InitTypeDef USART_InitStructure;
+
+    USART_InitStructure.USART_BaudRate   = port->state->baudrate;   // 串口波特率
+    USART_InitStructure.USART_WordLength = USART_WordLength_8b;     // 字长为8位数据格式
+    USART_InitStructure.USART_StopBits   = USART_StopBits_1;        // 一个停止位
+    USART_InitStructure.USART_Parity     = USART_Parity_No;         // 无奇偶校验位
+    USART_InitStructure.USART_HardwareFlowControl = port->state->flowCtrl;
+    USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx; // 使能收、发模式
+    USART_Init(port->USARTx, &USART_InitStructure);                 // 初始化串口
 }
 
+/******************************************************************************
+ * 函  数： UART_Reconfig
+ * 功  能： 运行中修改通信参数: 等待发送缓冲区中的数据全部发出, 暂停串口, 重新配置后恢复
+ *          切换期间正在接收的字节可能丢失, 应在通信空闲时调用
+ ******************************************************************************/
+static void UART_Reconfig(const xUART_PortDef *port)
+{
+    xUART_State *st    = port->state;
+    u64          start = System_GetTimeMs();
 
+    while ((st->txHead != st->txTail || st->txDmaLen != 0 || (port->USARTx->SR & USART_SR_TC) == 0)
+           && (System_GetTimeMs() - start) < UART_DRAIN_TIMEOUT_MS)
+        ;                                           // 对方用CTS暂停接收时可能一直发不完, 超时后直接切换
 
+    USART_Cmd(port->USARTx, DISABLE);
+    UART_Config(port);
+    USART_Cmd(port->USARTx, ENABLE);
+}
 
 
 
-//////////////////////////////////////////////////////////////   USART-2   //////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////   通用函数   ////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /******************************************************************************
- * 函  数： vUSART2_Init
- * 功  能： 初始化USART的GPIO、通信参数配置、中断优先级
+ * 函  数： UART_Init
+ * 功  能： 按描述表初始化串口的GPIO、通信参数、DMA、中断优先级
  *          (8位数据、无校验、1个停止位)
- * 参  数： uint32_t baudrate  通信波特率
+ * 参  数： UART_Port port     串口编号
+ *          uint32_t baudrate  通信波特率
  * 返回值： 无
  ******************************************************************************/
-void USART2_Init(uint32_t baudrate)
+void UART_Init(UART_Port port, uint32_t baudrate)
 {
     GPIO_InitTypeDef  GPIO_InitStructure;
     NVIC_InitTypeDef  NVIC_InitStructure;
-    USART_InitTypeDef USART_InitStructure;
+    const xUART_PortDef *p;
+
+    if (port >= UART_PORT_NUM || xUartPorts[port].USARTx == NULL)     // 本型号没有该串口
+        return;
+    p = &xUartPorts[port];
 
     // 时钟使能
-    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;                           // 使能USART2时钟
-    RCC->APB2ENR |= RCC_APB2ENR_IOPAEN;                             // 使能GPIOA时钟
+    if (p->rccApb1)  RCC_APB1PeriphClockCmd(p->rccApb1, ENABLE);
+    RCC_APB2PeriphClockCmd(p->rccApb2, ENABLE);
+    if (p->rccAhb)   RCC_AHBPeriphClockCmd(p->rccAhb, ENABLE);
 
     // GPIO_TX引脚配置
-    GPIO_InitStructure.GPIO_Pin   = GPIO_Pin_2;
+    GPIO_InitStructure.GPIO_Pin   = p->txPin;
     GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
     GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_AF_PP;                // TX引脚工作模式：复用推挽
-    GPIO_Init(GPIOA, &GPIO_InitStructure);
+    GPIO_Init(p->txGPIOx, &GPIO_InitStructure);
     // GPIO_RX引脚配置
-    GPIO_InitStructure.GPIO_Pin   = GPIO_Pin_3;
-    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_IPU;                  // RX引脚工作模式：上拉输入; 如果使用浮空输入，引脚空置时可能产生误输入; 当电路上为一主多从电路时，可以使用复用开漏模式
-    GPIO_Init(GPIOA, &GPIO_InitStructure);
+    GPIO_InitStructure.GPIO_Pin   = p->rxPin;
+    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_IPU;                  // RX引脚工作模式：上拉输入; 如果使用浮空输入，引脚空置时可能产生误输入
+    GPIO_Init(p->rxGPIOx, &GPIO_InitStructure);
 
-    // NVIC_PriorityGroupConfig(NVIC_PriorityGroup_2);
     // 中断配置
-    NVIC_InitStructure .NVIC_IRQChannel = USART2_IRQn;
+    NVIC_InitStructure .NVIC_IRQChannel = p->irqn;
     NVIC_InitStructure .NVIC_IRQChannelPreemptionPriority = 2 ;     // 抢占优先级
     NVIC_InitStructure .NVIC_IRQChannelSubPriority = 2;             // 子优先级
     NVIC_InitStructure .NVIC_IRQChannelCmd = ENABLE;                // IRQ通道使能
     NVIC_Init(&NVIC_InitStructure);
 
-    //USART 初始化设置
-    //USART_DeInit(USART2);
-    USART_InitStructure.USART_BaudRate   = baudrate;                // 串口波特率
-    USART_InitStructure.USART_WordLength = USART_WordLength_8b;     // 字长为8位数据格式
-    USART_InitStructure.USART_StopBits   = USART_StopBits_1;        // 一个停止位
-    USART_InitStructure.USART_Parity     = USART_Parity_No;         // 无奇偶校验位
-    USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
-    USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx; // 使能收、发模式
-    USART_Init(USART2, &USART_InitStructure);                       // 初始化串口
+    //USART 初始化设置; 硬件流控默认关闭, 需要时调用UART_SetFlowControl()
+    USART_DeInit(p->USARTx);
+    memset(p->state, 0, sizeof(xUART_State));
+    p->state->baudrate = baudrate;
+    p->state->flowCtrl = USART_HardwareFlowControl_None;
+    UART_Config(p);
+
+    // 接收: 两个缓存都以0开头; 帧模式下应用程序先指向空的缓存, 流模式下始终指向正在累加的缓存
+    p->rxBuf[0][0] = 0;
+    p->rxBuf[1][0] = 0;
+    *p->rxFrame = (p->rxMode == UART_RX_STREAM) ? p->rxBuf[0] : p->rxBuf[1];
+    *p->rxNum   = 0;
+    if (p->dmaRx)
+    {
+        p->dmaRx->CCR   = 0;                                        // 失能， 清0整个寄存器, DMA必须失能才能配置
+        p->dmaRx->CPAR  = (uint32_t)&p->USARTx->DR;                 // 外设地址
+        p->dmaRx->CMAR  = (uint32_t)p->rxBuf[0];                    // 存储器地址
+        p->dmaRx->CNDTR = p->rxSize;                                // 传输数据量
+        p->dmaRx->CCR   = DMA_CCR1_MINC | DMA_CCR1_PL_1 | DMA_CCR1_EN;  // 从外设读, 非循环, 存储器增量, 8位, 高优先级
+        p->USARTx->CR3 |= USART_CR3_DMAR;                           // 使能DMA接收
+    }
+    else
+    {
+        USART_ITConfig(p->USARTx, USART_IT_RXNE, ENABLE);           // 使能接受中断
+    }
+    USART_ITConfig(p->USARTx, USART_IT_IDLE, ENABLE);               // 使能空闲中断
 
-    USART_ITConfig(USART2, USART_IT_TXE, ENABLE);                   // 使能发送中断
-    USART_ITConfig(USART2, USART_IT_RXNE, ENABLE);                  // 使能接受中断
-    USART_ITConfig(USART2, USART_IT_IDLE, ENABLE);                  // 使能空闲中断
+    // 发送: DMA通道只需配置一次, 每段数据发送时再填写地址、数量
+    USART_ITConfig(p->USARTx, USART_IT_TXE, DISABLE);
+    if (p->dmaTx)
+    {
+        p->dmaTx->CCR   = 0;
+        p->dmaTx->CPAR  = (uint32_t)&p->USARTx->DR;
+        p->dmaTx->CCR   = DMA_CCR1_DIR | DMA_CCR1_MINC | DMA_CCR1_PL_0; // 从存储器读, 非循环, 存储器增量, 8位, 中等优先级
+        p->USARTx->CR3 |= USART_CR3_DMAT;                           // 使能DMA发送
+    }
 
-    USART_Cmd(USART2, ENABLE);                                      // 使能串口, 开始工作
+    USART_Cmd(p->USARTx, ENABLE);                                   // 使能串口, 开始工作
 
-    USART2->SR = ~(0x00F0);                                         // 清理中断
+    p->USARTx->SR = ~(0x00F0);                                      // 清理中断
 
-    xUSART.USART2InitFlag = 1;                                      // 标记初始化标志
-    xUSART.USART2ReceivedNum = 0;                                   // 接收字节数清零
+    *p->initFlag = 1;                                               // 标记初始化标志
 
-    printf("\rUSART2初始化配置      接收中断、空闲中断, 发送中断\r");
+    printf("\r%s初始化配置      %s, 空闲中断, %s\r", p->name,
+           p->dmaRx ? "DMA接收" : "接收中断", p->dmaTx ? "DMA发送" : "发送中断");
 }
 
 /******************************************************************************
- * 函  数： USART2_IRQHandler
- * 功  能： USART2的接收中断、空闲中断、发送中断
- * 参  数： 无
- * 返回值： 无
+ * 函  数： UART_Write
+ * 功  能： 非阻塞发送: 把数据写入发送环形缓冲区, 由DMA或中断在后台发出, 本函数不等待
+ *          缓冲区空间不足时只写入放得下的部分, 调用者可根据返回值, 稍后发送余下的数据
+ * 参  数： UART_Port port       串口编号
+ *          const void* data     需发送数据的首地址
+ *          size_t len           发送的字节数, 不受8位、16位长度限制
+ * 返回值： 实际写入发送缓冲区的字节数; 串口未初始化时返回0
  ******************************************************************************/
-static uint8_t U2TxBuffer[256] ;    // 用于中断发送：环形缓冲区，256个字节
-static uint8_t U2TxCounter = 0 ;    // 用于中断发送：标记已发送的字节数(环形)
-static uint8_t U2TxCount   = 0 ;    // 用于中断发送：标记将要发送的字节数(环形)
-
-void USART2_IRQHandler(void)
+size_t UART_Write(UART_Port port, const void *data, size_t len)
 {
-    static uint16_t cnt = 0;                                         // 接收字节数累计：每一帧数据已接收到的字节数
-    static uint8_t  RxTemp[U2_RX_BUF_SIZE];                          // 接收数据缓存数组：每新接收１个字节，先顺序存放到这里，当一帧接收完(发生空闲中断), 再转存到全局变量：xUSART.USARTxReceivedBuffer[xx]中；
-
-    // 接收中断
-    if (USART2->SR & (1 << 5))                                       // 检查RXNE(读数据寄存器非空标志位); RXNE中断清理方法：读DR时自动清理；
-    {
-        if ((cnt >= U2_RX_BUF_SIZE))//||xUSART.USART2ReceivedFlag==1 // 判断1: 当前帧已接收到的数据量，已满(缓存区), 为避免溢出，本包后面接收到的数据直接舍弃．
-        {
-            // 判断2: 如果之前接收好的数据包还没处理，就放弃新数据，即，新数据帧不能覆盖旧数据帧，直至旧数据帧被处理．缺点：数据传输过快于处理速度时会掉包；好处：机制清晰，易于调试
-            USART2->DR;                                              // 读取数据寄存器的数据，但不保存．主要作用：读DR时自动清理接收中断标志；
-            return;
-        }
-        RxTemp[cnt++] = USART2->DR ;                                 // 把新收到的字节数据，顺序存放到RXTemp数组中；注意：读取DR时自动清零中断位；
-    }
+    const xUART_PortDef *p;
+    const uint8_t *buf = (const uint8_t *)data;
+    size_t done = 0;
+    uint16_t n;
 
-    // 空闲中断, 用于配合接收中断，以判断一帧数据的接收完成
-    if (USART2->SR & (1 << 4))                                       // 检查IDLE(空闲中断标志位); IDLE中断标志清理方法：序列清零，USART1 ->SR;  USART1 ->DR;
-    {
-        xUSART.USART2ReceivedNum  = 0;                               // 把接收到的数据字节数清0
-        memcpy(xUSART.USART2ReceivedBuffer, RxTemp, U2_RX_BUF_SIZE); // 把本帧接收到的数据，存放到全局变量xUSART.USARTxReceivedBuffer中, 等待处理; 注意：复制的是整个数组，包括0值，以方便字符串数据
-        xUSART.USART2ReceivedNum  = cnt;                             // 把接收到的字节数，存放到全局变量xUSART.USARTxReceivedCNT中；
-        cnt = 0;                                                     // 接收字节数累计器，清零; 准备下一次的接收
-        memset(RxTemp, 0, U2_RX_BUF_SIZE);                           // 接收数据缓存数组，清零; 准备下一次的接收
-        USART2 ->SR;
-        USART2 ->DR;                                 // 清零IDLE中断标志位!! 序列清零，顺序不能错!!
-    }
+    if (port >= UART_PORT_NUM || xUartPorts[port].USARTx == NULL || *xUartPorts[port].initFlag == 0)
+        return 0;
+    p = &xUartPorts[port];
 
-    // 发送中断
-    if ((USART2->SR & 1 << 7) && (USART2->CR1 & 1 << 7))             // 检查TXE(发送数据寄存器空)、TXEIE(发送缓冲区空中断使能)
+    while (done < len)                              // 每次最多写入65535字节; 实际受缓冲区空间限制, 写满即停止
     {
-        USART2->DR = U2TxBuffer[U2TxCounter++];                      // 读取数据寄存器值；注意：读取DR时自动清零中断位；
-        if (U2TxCounter == U2TxCount)
-            USART2->CR1 &= ~(1 << 7);                                // 已发送完成，关闭发送缓冲区空置中断 TXEIE
+        n = UART_TxPut(p, buf + done, (len - done > 0xFFFF) ? 0xFFFF : (uint16_t)(len - done));
+        if (n == 0)
+            break;
+        done += n;
     }
+    return done;
 }
 
 /******************************************************************************
- * 函  数： vUSART2_GetBuffer
- * 功  能： 获取UART所接收到的数据
- * 参  数： uint8_t* buffer   数据存放缓存地址
- *          uint8_t* cnt      接收到的字节数
- * 返回值： 0_没有接收到新数据， 非0_所接收到新数据的字节数
+ * 函  数： UART_WriteTimeout
+ * 功  能： 阻塞发送: 缓冲区空间不足时, 等待后台发送腾出空间, 直到全部写入发送缓冲区或超时
+ *          适合AT指令层: 多KB的数据也能完整地以线速发出, 而不会被截断
+ *          在中断中或关中断时调用, 不等待, 与UART_Write()相同
+ * 参  数： UART_Port port       串口编号
+ *          const void* data     需发送数据的首地址
+ *          size_t len           发送的字节数
+ *          uint32_t timeout_ms  最长等待时间(ms)
+ * 返回值： 实际写入发送缓冲区的字节数; 小于len表示超时
  ******************************************************************************/
-uint8_t USART2_GetBuffer(uint8_t *buffer, uint8_t *cnt)
+size_t UART_WriteTimeout(UART_Port port, const void *data, size_t len, uint32_t timeout_ms)
 {
-    if (xUSART.USART2ReceivedNum > 0)                                          // 判断是否有新数据
-    {
-        memcpy(buffer, xUSART.USART2ReceivedBuffer, xUSART.USART2ReceivedNum); // 把新数据复制到指定位置
-        *cnt = xUSART.USART2ReceivedNum;                                       // 把新数据的字节数，存放指定变量
-        xUSART.USART2ReceivedNum = 0;                                          // 接收标记置0
-        return *cnt;                                                           // 返回所接收到新数据的字节数
-    }
-    return 0;                                                                  // 返回0, 表示没有接收到新数据
+    const uint8_t *buf = (const uint8_t *)data;
+    size_t done = UART_Write(port, buf, len);
+    u64    start;
+
+    if (done == len || *xUartPorts[port].initFlag == 0 || (SCB->ICSR & 0x1FF) != 0 || __get_PRIMASK() != 0)   // ICSR[8:0]=VECTACTIVE, 非0表示正在执行中断
+        return done;
+
+    start = System_GetTimeMs();
+    while (done < len && (System_GetTimeMs() - start) < timeout_ms)
+        done += UART_Write(port, buf + done, len - done);
+    return done;
 }
 
 /******************************************************************************
- * 函  数： vUSART2_SendData
- * 功  能： UART通过中断发送数据,适合各种数据类型
- *         【适合场景】本函数可发送各种数据，而不限于字符串，如int,char
- *         【不 适 合】注意环形缓冲区容量256字节，如果发送频率太高，注意波特率
- * 参  数： uint8_t* buffer   需发送数据的首地址
- *          uint8_t  cnt      发送的字节数 ，限于中断发送的缓存区大小，不能大于256个字节
- * 返回值：
+ * 函  数： UART_SendData
+ * 功  能： 把数据写入发送环形缓冲区, 由DMA或中断在后台发出, 本函数不等待
+ *         【不 适 合】缓冲区空间不足时, 放不下的部分将被舍弃; 需要知道写入了多少时, 使用UART_Write()
+ * 参  数： UART_Port port       串口编号
+ *          const uint8_t* buf   需发送数据的首地址
+ *          uint16_t cnt         发送的字节数
+ * 返回值： 无
  ******************************************************************************/
-void USART2_SendData(uint8_t *buf, uint8_t cnt)
+void UART_SendData(UART_Port port, const uint8_t *buf, uint16_t cnt)
 {
-    for (uint8_t i = 0; i < cnt; i++)
-        U2TxBuffer[U2TxCount++] = buf[i];
-
-    if ((USART2->CR1 & 1 << 7) == 0)       // 检查发送缓冲区空置中断(TXEIE)是否已打开
-        USART2->CR1 |= 1 << 7;
+    UART_Write(port, buf, cnt);
 }
 
 /******************************************************************************
- * 函  数： vUSART2_SendString
- * 功  能： UART通过中断发送输出字符串,无需输入数据长度
- *         【适合场景】字符串，长度<=256字节
- *         【不 适 合】int,float等数据类型
- * 参  数： char* stringTemp   需发送数据的缓存首地址
- * 返回值： 元
+ * 函  数： UART_SendString
+ * 功  能： 发送字符串, 无需输入数据长度
+ * 参  数： UART_Port port            串口编号
+ *          const char* stringTemp    需发送的字符串
+ * 返回值： 无
  ******************************************************************************/
-void USART2_SendString(char *stringTemp)
+void UART_SendString(UART_Port port, const char *stringTemp)
 {
-    u16 num = 0;                                 // 字符串长度
-    char *t = stringTemp ;                       // 用于配合计算发送的数量
-    while (*t++ != 0)  num++;                    // 计算要发送的数目，这步比较耗时，测试发现每多6个字节，增加1us，单位：8位
-    USART2_SendData((u8 *)stringTemp, num);      // 注意调用函数所需要的真实数据长度; 如果目标需要以0作结尾判断，需num+1：字符串以0结尾，即多发一个:0
+    UART_Write(port, stringTemp, strlen(stringTemp));
 }
 
+/******************************************************************************
+ * 函  数： UART_GetBuffer
+ * 功  能： 复制接收到的数据, 并释放
+ * 参  数： UART_Port port      串口编号
+ *          uint8_t* buffer     数据存放缓存地址
+ *          uint16_t* cnt       接收到的字节数
+ * 返回值： 0_没有接收到新数据， 非0_所接收到新数据的字节数
+ ******************************************************************************/
+uint16_t UART_GetBuffer(UART_Port port, uint8_t *buffer, uint16_t *cnt)
+{
+    const xUART_PortDef *p;
+    uint16_t num;
+
+    if (port >= UART_PORT_NUM || xUartPorts[port].USARTx == NULL)
+        return 0;
+    p   = &xUartPorts[port];
+    num = *p->rxNum;
+    if (num == 0)                                   // 判断是否有新数据
+        return 0;
+
+    memcpy(buffer, *p->rxFrame, num);               // 把新数据复制到指定位置
+    *cnt = num;
+    UART_RxRelease(port);                           // 释放; 帧模式下期间已累积的新帧立即交付
+    return num;
+}
 
-
-
-
-//////////////////////////////////////////////////////////////   USART-3   //////////////////////////////////////////////////////////////
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /******************************************************************************
- * 函  数： vUSART3_Init
- * 功  能： 初始化USART的GPIO、通信参数配置、中断优先级
- *          (8位数据、无校验、1个停止位)
- * 参  数： uint32_t baudrate  通信波特率
+ * 函  数： UART_RxRelease
+ * 功  能： 应用程序处理完数据后调用
+ *          帧模式: 释放当前帧, 如果期间已累积了完整的新帧, 立即交付
+ *          流模式: 清空已交付的数据; 最近一次空闲中断之后到达的数据(尚未完整)保留
+ * 参  数： UART_Port port   串口编号
  * 返回值： 无
  ******************************************************************************/
-void USART3_Init(uint32_t baudrate)
+void UART_RxRelease(UART_Port port)
 {
-    GPIO_InitTypeDef  GPIO_InitStructure;
-    NVIC_InitTypeDef  NVIC_InitStructure;
-    USART_InitTypeDef USART_InitStructure;
+    const xUART_PortDef *p;
 
-    // 时钟使能
-    RCC->APB1ENR |= RCC_APB1ENR_USART3EN;                           // 使能USART3时钟
-    RCC->APB2ENR |= RCC_APB2ENR_IOPBEN;                             // 使能GPIOB时钟
+    if (port >= UART_PORT_NUM || xUartPorts[port].USARTx == NULL)
+        return;
+    p = &xUartPorts[port];
 
-    // GPIO_TX引脚配置
-    GPIO_InitStructure.GPIO_Pin   = GPIO_Pin_10;
-    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
-    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_AF_PP;                // TX引脚工作模式：复用推挽
-    GPIO_Init(GPIOB, &GPIO_InitStructure);
-    // GPIO_RX引脚配置
-    GPIO_InitStructure.GPIO_Pin   = GPIO_Pin_11;
-    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_IPU;                  // RX引脚工作模式：上拉输入; 如果使用浮空输入，引脚空置时可能产生误输入; 当电路上为一主多从电路时，可以使用复用开漏模式
-    GPIO_Init(GPIOB, &GPIO_InitStructure);
+    if (p->rxMode == UART_RX_STREAM)
+    {
+        UART_RxStreamConsume(p, *p->rxNum);
+    }
+    else
+    {
+        IRQ_STATS_CRITICAL_ENTER();
+        *p->rxNum = 0;
+        if (UART_RxCount(p) == p->state->rxIdleCnt) // 已累积的数据之后发生过空闲中断, 是完整的帧, 立即交付; 否则等待本帧的空闲中断
+            UART_RxPublish(p);
+        IRQ_STATS_CRITICAL_EXIT();
+    }
+}
 
-    // NVIC_PriorityGroupConfig(NVIC_PriorityGroup_2);
-    // 中断配置
-    NVIC_InitStructure .NVIC_IRQChannel = USART3_IRQn;
-    NVIC_InitStructure .NVIC_IRQChannelPreemptionPriority = 2 ;     // 抢占优先级
-    NVIC_InitStructure .NVIC_IRQChannelSubPriority = 2;             // 子优先级
-    NVIC_InitStructure .NVIC_IRQChannelCmd = ENABLE;                // IRQ通道使能
-    NVIC_Init(&NVIC_InitStructure);
 
-    //USART 初始化设置
-    USART_DeInit(USART3);
-    USART_InitStructure.USART_BaudRate   = baudrate;                // 串口波特率
-    USART_InitStructure.USART_WordLength = USART_WordLength_8b;     // 字长为8位数据格式
-    USART_InitStructure.USART_StopBits   = USART_StopBits_1;        // 一个停止位
-    USART_InitStructure.USART_Parity     = USART_Parity_No;         // 无奇偶校验位
-    USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
-    USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx; // 使能收、发模式
-    USART_Init(USART3, &USART_InitStructure);                       // 初始化串口
 
-    USART_ITConfig(USART3, USART_IT_TXE, DISABLE);
-    USART_ITConfig(USART3, USART_IT_RXNE, ENABLE);                  // 使能接受中断
-    USART_ITConfig(USART3, USART_IT_IDLE, ENABLE);                  // 使能空闲中断
+/******************************************************************************
+ * 函  数： UART_RxConsume
+ * 功  能： 流模式: 只释放缓存开头已处理的len字节, 其后的数据(例如尚未接收完整的报文)搬到另一个缓存的开头继续累加;
+ *          帧模式: 与UART_RxRelease()相同
+ * 参  数： UART_Port port   串口编号
+ *          uint16_t  len    已处理的字节数; 大于已接收字节数时, 全部释放
+ * 返回值： 无
+ ******************************************************************************/
+void UART_RxConsume(UART_Port port, uint16_t len)
+{
+    if (port >= UART_PORT_NUM || xUartPorts[port].USARTx == NULL)
+        return;
 
-    USART_Cmd(USART3, ENABLE);  
-    
-    USART3->SR = ~(0x00F0);                                         // 清理中断
+    if (xUartPorts[port].rxMode == UART_RX_STREAM)
+        UART_RxStreamConsume(&xUartPorts[port], len);
+    else
+        UART_RxRelease(port);
+}
 
-    xUSART.USART3InitFlag = 1;                                      // 标记初始化标志
-    xUSART.USART3ReceivedNum = 0;                                   // 接收字节数清零
 
-    printf("\rUSART3初始化配置      接收中断、空闲中断, 发送中断\r");
-}
 
 /******************************************************************************
- * 函  数： USART3_IRQHandler
- * 功  能： USART的接收中断、空闲中断、发送中断
- * 参  数： 无
- * 返回值： 无
+ * 函  数： UART_RxIdleCycles
+ * 功  能： 读取最近一次空闲中断的时刻; 空闲中断在最后一个字节之后约1个字节的时间产生
+ * 参  数： UART_Port port   串口编号
+ * 返回值： DWT周期计数值
  ******************************************************************************/
-static uint8_t U3TxBuffer[256] ;    // 用于中断发送：环形缓冲区，256个字节
-static uint8_t U3TxCounter = 0 ;    // 用于中断发送：标记已发送的字节数(环形)
-static uint8_t U3TxCount   = 0 ;    // 用于中断发送：标记将要发送的字节数(环形)
-
-void USART3_IRQHandler(void)
+uint32_t UART_RxIdleCycles(UART_Port port)
 {
-    static uint16_t cnt = 0;                                         // 接收字节数累计：每一帧数据已接收到的字节数
-    static uint8_t  RxTemp[U3_RX_BUF_SIZE];                          // 接收数据缓存数组：每新接收１个字节，先顺序存放到这里，当一帧接收完(发生空闲中断), 再转存到全局变量：xUSART.USARTxReceivedBuffer[xx]中；
-   
-    // 接收中断
-    if (USART3->SR & (1 << 5))                                       // 检查RXNE(读数据寄存器非空标志位); RXNE中断清理方法：读DR时自动清理；
-    {
-        if ((cnt >= U3_RX_BUF_SIZE))//||xUSART.USART3ReceivedFlag==1 // 判断1: 当前帧已接收到的数据量，已满(缓存区), 为避免溢出，本包后面接收到的数据直接舍弃．
-        {
-            // 判断2: 如果之前接收好的数据包还没处理，就放弃新数据，即，新数据帧不能覆盖旧数据帧，直至旧数据帧被处理．缺点：数据传输过快于处理速度时会掉包；好处：机制清晰，易于调试
-            USART3->DR;                                              // 读取数据寄存器的数据，但不保存．主要作用：读DR时自动清理接收中断标志；
-            return;
-        }
-        RxTemp[cnt++] = USART3->DR ;                                 // 把新收到的字节数据，顺序存放到RXTemp数组中；注意：读取DR时自动清零中断位；
-    }
+    if (port >= UART_PORT_NUM || xUartPorts[port].USARTx == NULL)
+        return 0;
+    return xUartPorts[port].state->rxIdleCycles;
+}
 
-    // 空闲中断, 用于配合接收中断，以判断一帧数据的接收完成
-    if (USART3->SR & (1 << 4))                                       // 检查IDLE(空闲中断标志位); IDLE中断标志清理方法：序列清零，USART1 ->SR;  USART1 ->DR;
-    {
-        xUSART.USART3ReceivedNum  = 0;                               // 把接收到的数据字节数清0
-        memcpy(xUSART.USART3ReceivedBuffer, RxTemp, U3_RX_BUF_SIZE); // 把本帧接收到的数据，存放到全局变量xUSART.USARTxReceivedBuffer中, 等待处理; 注意：复制的是整个数组，包括0值，以方便字符串数据
-        xUSART.USART3ReceivedNum  = cnt;                             // 把接收到的字节数，存放到全局变量xUSART.USARTxReceivedCNT中；
-        cnt = 0;                                                     // 接收字节数累计器，清零; 准备下一次的接收
-        memset(RxTemp, 0, U3_RX_BUF_SIZE);                           // 接收数据缓存数组，清零; 准备下一次的接收
-        USART3 ->SR;
-        USART3 ->DR;                                                 // 清零IDLE中断标志位!! 序列清零，顺序不能错!!
-    }
 
-    // 发送中断
-    if ((USART3->SR & 1 << 7) && (USART3->CR1 & 1 << 7))             // 检查TXE(发送数据寄存器空)、TXEIE(发送缓冲区空中断使能)
-    {
-        USART3->DR = U3TxBuffer[U3TxCounter++];                      // 读取数据寄存器值；注意：读取DR时自动清零中断位；
-        if (U3TxCounter == U3TxCount)
-            USART3->CR1 &= ~(1 << 7);                                // 已发送完成，关闭发送缓冲区空置中断 TXEIE
-    }
-}
 
 /******************************************************************************
- * 函  数： vUSART3_GetBuffer
- * 功  能： 获取UART所接收到的数据
- * 参  数： uint8_t* buffer   数据存放缓存地址
- *          uint8_t* cnt      接收到的字节数
- * 返回值： 0_没有接收到新数据， 非0_所接收到新数据的字节数
+ * 函  数： UART_SetBaudrate
+ * 功  能： 运行中修改波特率; 先等待已写入发送缓冲区的数据全部发出, 再切换
+ * 参  数： UART_Port port      串口编号
+ *          uint32_t baudrate   新的波特率
+ * 返回值： 无
  ******************************************************************************/
-uint8_t USART3_GetBuffer(uint8_t *buffer, uint8_t *cnt)
+void UART_SetBaudrate(UART_Port port, uint32_t baudrate)
 {
-    if (xUSART.USART3ReceivedNum > 0)                                          // 判断是否有新数据
-    {
-        memcpy(buffer, xUSART.USART3ReceivedBuffer, xUSART.USART3ReceivedNum); // 把新数据复制到指定位置
-        *cnt = xUSART.USART3ReceivedNum;                                       // 把新数据的字节数，存放指定变量
-        xUSART.USART3ReceivedNum = 0;                                          // 接收标记置0
-        return *cnt;                                                           // 返回所接收到新数据的字节数
-    }
-    return 0;                                                                  // 返回0, 表示没有接收到新数据
+    if (port >= UART_PORT_NUM || xUartPorts[port].USARTx == NULL || *xUartPorts[port].initFlag == 0)
+        return;
+    xUartPorts[port].state->baudrate = baudrate;
+    UART_Reconfig(&xUartPorts[port]);
 }
 
 /******************************************************************************
- * 函  数： vUSART3_SendData
- * 功  能： UART通过中断发送数据,适合各种数据类型
- *         【适合场景】本函数可发送各种数据，而不限于字符串，如int,char
- *         【不 适 合】注意环形缓冲区容量256字节，如果发送频率太高，注意波特率
- * 参  数： uint8_t* buffer   需发送数据的首地址
- *          uint8_t  cnt      发送的字节数 ，限于中断发送的缓存区大小，不能大于256个字节
- * 返回值：
+ * 函  数： UART_GetBaudrate
+ * 功  能： 读取当前波特率
+ * 参  数： UART_Port port      串口编号
+ * 返回值： 当前波特率; 串口未初始化时返回0
  ******************************************************************************/
-void USART3_SendData(uint8_t *buf, uint8_t cnt)
+uint32_t UART_GetBaudrate(UART_Port port)
 {
-    for (uint8_t i = 0; i < cnt; i++)
-        U3TxBuffer[U3TxCount++] = buf[i];
-
-    if ((USART3->CR1 & 1 << 7) == 0)       // 检查发送缓冲区空置中断(TXEIE)是否已打开
-        USART3->CR1 |= 1 << 7;
+    if (port >= UART_PORT_NUM || xUartPorts[port].USARTx == NULL)
+        return 0;
+    return xUartPorts[port].state->baudrate;
 }
 
 /******************************************************************************
- * 函  数： vUSART3_SendString
- * 功  能： UART通过中断发送输出字符串,无需输入数据长度
- *         【适合场景】字符串，长度<=256字节
- *         【不 适 合】int,float等数据类型
- * 参  数： char* stringTemp   需发送数据的缓存首地址
- * 返回值： 元
+ * 函  数： UART_SetFlowControl
+ * 功  能： 开启或关闭RTS/CTS硬件流控
+ *          开启后: 对方拉高CTS时暂停发送, 本机接收来不及处理时拉高RTS; 用于高波特率下防止溢出
+ *          仅描述表中配置了RTS/CTS引脚的串口有效(USART1: CTS=PA11, RTS=PA12)
+ * 参  数： UART_Port port      串口编号
+ *          uint8_t enable      1=开启, 0=关闭
+ * 返回值： 1_已设置;  0_该串口不支持硬件流控, 或未初始化
  ******************************************************************************/
-void USART3_SendString(char *stringTemp)
+uint8_t UART_SetFlowControl(UART_Port port, uint8_t enable)
 {
-    u16 num = 0;                                 // 字符串长度
-    char *t = stringTemp ;                       // 用于配合计算发送的数量
-    while (*t++ != 0)  num++;                    // 计算要发送的数目，这步比较耗时，测试发现每多6个字节，增加1us，单位：8位
-    USART3_SendData((u8 *)stringTemp, num);      // 注意调用函数所需要的真实数据长度; 如果目标需要以0作结尾判断，需num+1：字符串以0结尾，即多发一个:0
-}
+    GPIO_InitTypeDef GPIO_InitStructure;
+    const xUART_PortDef *p;
 
+    if (port >= UART_PORT_NUM || xUartPorts[port].ctsGPIOx == NULL || *xUartPorts[port].initFlag == 0)
+        return 0;
+    p = &xUartPorts[port];
 
+    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+    GPIO_InitStructure.GPIO_Pin   = p->rtsPin;
+    GPIO_InitStructure.GPIO_Mode  = enable ? GPIO_Mode_AF_PP : GPIO_Mode_IN_FLOATING;    // RTS: 复用推挽输出
+    GPIO_Init(p->rtsGPIOx, &GPIO_InitStructure);
+    GPIO_InitStructure.GPIO_Pin   = p->ctsPin;
+    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_IN_FLOATING;                              // CTS: 浮空输入, 由对方驱动
+    GPIO_Init(p->ctsGPIOx, &GPIO_InitStructure);
+
+    p->state->flowCtrl = enable ? USART_HardwareFlowControl_RTS_CTS : USART_HardwareFlowControl_None;
+    UART_Reconfig(p);
+    return 1;
+}
 
 
-#ifdef STM32F10X_HD  // STM32F103R，及以上，才有UART4和UART5
 
-//////////////////////////////////////////////////////////////   UART-4   //////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////   USART-1   //////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /******************************************************************************
- * 函  数： vUART4_Init
- * 功  能： 初始化USART的GPIO、通信参数配置、中断优先级
- *          (8位数据、无校验、1个停止位)
+ * 函  数： USART1_Init
+ * 功  能： 初始化USART1; 流模式接收, 适合与通信模组之间的AT指令交互
  * 参  数： uint32_t baudrate  通信波特率
  * 返回值： 无
  ******************************************************************************/
-void UART4_Init(uint32_t baudrate)
+void USART1_Init(uint32_t baudrate)
 {
-    GPIO_InitTypeDef  GPIO_InitStructure;
-    NVIC_InitTypeDef  NVIC_InitStructure;
-    USART_InitTypeDef USART_InitStructure;
+    printf("\r\r\r=========== 魔女开发板 STM32F103 外设初始报告 ===========\r");
+    UART_Init(UART_PORT_1, baudrate);
+}
 
-    // 时钟使能
-    RCC->APB1ENR |= RCC_APB1ENR_UART4EN;                            // 使能UART4时钟
-    RCC->APB2ENR |= RCC_APB2ENR_IOPCEN;                             // 使能GPIOC时钟
+void USART1_IRQHandler(void)
+{
+    IRQ_STATS_ENTER();                                               // 中断负载统计: 入口
+    UART_IRQHandler(&xUartPorts[UART_PORT_1]);
+    IRQ_STATS_EXIT(IRQ_ID_USART1);
+}
 
-    // GPIO_TX引脚配置
-    GPIO_InitStructure.GPIO_Pin   = GPIO_Pin_10;
-    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
-    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_AF_PP;                // TX引脚工作模式：复用推挽    GPIO_Init(GPIOC, &GPIO_InitStructure);
-    GPIO_Init(GPIOC, &GPIO_InitStructure);
-    // GPIO_RX引脚配置
-    GPIO_InitStructure.GPIO_Pin   = GPIO_Pin_11;
-    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_IPU;                  // RX引脚工作模式：上拉输入; 如果使用浮空输入，引脚空置时可能产生误输入; 当电路上为一主多从电路时，可以使用复用开漏模式
-    GPIO_Init(GPIOC, &GPIO_InitStructure);
+uint8_t USART1_GetBuffer(uint8_t *buffer, uint8_t *cnt)
+{
+    uint16_t num;
+    if (UART_GetBuffer(UART_PORT_1, buffer, &num) == 0)
+        return 0;
+    *cnt = num;
+    return *cnt;
+}
 
-    // NVIC_PriorityGroupConfig(NVIC_PriorityGroup_2);
-    // 中断配置
-    NVIC_InitStructure .NVIC_IRQChannel = UART4_IRQn;
-    NVIC_InitStructure .NVIC_IRQChannelPreemptionPriority = 2 ;     // 抢占优先级
-    NVIC_InitStructure .NVIC_IRQChannelSubPriority = 2;             // 子优先级
-    NVIC_InitStructure .NVIC_IRQChannelCmd = ENABLE;                // IRQ通道使能
-    NVIC_Init(&NVIC_InitStructure);
+void USART1_SendData(uint8_t *buf, uint16_t cnt)
+{
+    UART_SendData(UART_PORT_1, buf, cnt);
+}
 
-    //USART 初始化设置
-    USART_DeInit(UART4);
-    USART_InitStructure.USART_BaudRate   = baudrate;                // 串口波特率
-    USART_InitStructure.USART_WordLength = USART_WordLength_8b;     // 字长为8位数据格式
-    USART_InitStructure.USART_StopBits   = USART_StopBits_1;        // 一个停止位
-    USART_InitStructure.USART_Parity     = USART_Parity_No;         // 无奇偶校验位
-    USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
-    USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx; // 使能收、发模式
-    USART_Init(UART4, &USART_InitStructure);                        // 初始化串口
+void USART1_SendString(char *stringTemp)
+{
+    UART_SendString(UART_PORT_1, stringTemp);
+}
 
-    USART_ITConfig(UART4, USART_IT_TXE, DISABLE);
-    USART_ITConfig(UART4, USART_IT_RXNE, ENABLE);                   // 使能接受中断
-    USART_ITConfig(UART4, USART_IT_IDLE, ENABLE);                   // 使能空闲中断
-    
-    USART_Cmd(UART4, ENABLE);                                       // 使能串口, 开始工作
+void USART1_SendStringForDMA(char *stringTemp)
+{
+    UART_SendString(UART_PORT_1, stringTemp);        // 所有发送均已通过DMA完成
+}
 
-    UART4->SR = ~(0x00F0);                                          // 清理中断
 
-    xUSART.UART4InitFlag = 1;                                       // 标记初始化标志
-    xUSART.UART4ReceivedNum = 0;                                    // 接收字节数清零
 
-    printf("\rUART4 初始化配置      接收中断、空闲中断, 发送中断\r");
+//////////////////////////////////////////////////////////////   USART-2   //////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void USART2_Init(uint32_t baudrate)
+{
+    UART_Init(UART_PORT_2, baudrate);
 }
 
-/******************************************************************************
- * 函  数： UART4_IRQHandler
- * 功  能： USART2的接收中断、空闲中断、发送中断
- * 参  数： 无
- * 返回值： 无
- ******************************************************************************/
-static uint8_t U4TxBuffer[256] ;    // 用于中断发送：环形缓冲区，256个字节
-static uint8_t U4TxCounter = 0 ;    // 用于中断发送：标记已发送的字节数(环形)
-static uint8_t U4TxCount   = 0 ;    // 用于中断发送：标记将要发送的字节数(环形)
+void USART2_IRQHandler(void)
+{
+    IRQ_STATS_ENTER();
+    UART_IRQHandler(&xUartPorts[UART_PORT_2]);
+    IRQ_STATS_EXIT(IRQ_ID_USART2);
+}
 
-void UART4_IRQHandler(void)
+uint8_t USART2_GetBuffer(uint8_t *buffer, uint8_t *cnt)
 {
-    static uint16_t cnt = 0;                                        // 接收字节数累计：每一帧数据已接收到的字节数
-    static uint8_t  RxTemp[U4_RX_BUF_SIZE];                         // 接收数据缓存数组：每新接收１个字节，先顺序存放到这里，当一帧接收完(发生空闲中断), 再转存到全局变量：xUSART.USARTxReceivedBuffer[xx]中；
+    uint16_t num;
+    if (UART_GetBuffer(UART_PORT_2, buffer, &num) == 0)
+        return 0;
+    *cnt = num;
+    return *cnt;
+}
 
-    // 接收中断
-    if (UART4->SR & (1 << 5))                                       // 检查RXNE(读数据寄存器非空标志位); RXNE中断清理方法：读DR时自动清理；
-    {
-        if ((cnt >= U4_RX_BUF_SIZE))//||xUSART.UART4ReceivedFlag==1 // 判断1: 当前帧已接收到的数据量，已满(缓存区), 为避免溢出，本包后面接收到的数据直接舍弃．
-        {
-            // 判断2: 如果之前接收好的数据包还没处理，就放弃新数据，即，新数据帧不能覆盖旧数据帧，直至旧数据帧被处理．缺点：数据传输过快于处理速度时会掉包；好处：机制清晰，易于调试
-            UART4->DR;                                              // 读取数据寄存器的数据，但不保存．主要作用：读DR时自动清理接收中断标志；
-            return;
-        }
-        RxTemp[cnt++] = UART4->DR ;                                 // 把新收到的字节数据，顺序存放到RXTemp数组中；注意：读取DR时自动清零中断位；
-    }
+void USART2_SendData(uint8_t *buf, uint16_t cnt)
+{
+    UART_SendData(UART_PORT_2, buf, cnt);
+}
 
-    // 空闲中断, 用于配合接收中断，以判断一帧数据的接收完成
-    if (UART4->SR & (1 << 4))                                       // 检查IDLE(空闲中断标志位); IDLE中断标志清理方法：序列清零，USART1 ->SR;  USART1 ->DR;
-    {
-        xUSART.UART4ReceivedNum  = 0;                               // 把接收到的数据字节数清0
-        memcpy(xUSART.UART4ReceivedBuffer, RxTemp, U4_RX_BUF_SIZE); // 把本帧接收到的数据，存放到全局变量xUSART.USARTxReceivedBuffer中, 等待处理; 注意：复制的是整个数组，包括0值，以方便字符串数据
-        xUSART.UART4ReceivedNum  = cnt;                             // 把接收到的字节数，存放到全局变量xUSART.USARTxReceivedCNT中；
-        cnt = 0;                                                    // 接收字节数累计器，清零; 准备下一次的接收
-        memset(RxTemp, 0, U4_RX_BUF_SIZE);                          // 接收数据缓存数组，清零; 准备下一次的接收
-        UART4 ->SR;
-        UART4 ->DR;                                  // 清零IDLE中断标志位!! 序列清零，顺序不能错!!
-    }
+void USART2_SendString(char *stringTemp)
+{
+    UART_SendString(UART_PORT_2, stringTemp);
+}
 
-    // 发送中断
-    if ((UART4->SR & 1 << 7) && (UART4->CR1 & 1 << 7))              // 检查TXE(发送数据寄存器空)、TXEIE(发送缓冲区空中断使能)
-    {
-        UART4->DR = U4TxBuffer[U4TxCounter++];                      // 读取数据寄存器值；注意：读取DR时自动清零中断位；
-        if (U4TxCounter == U4TxCount)
-            UART4->CR1 &= ~(1 << 7);                                // 已发送完成，关闭发送缓冲区空置中断 TXEIE
-    }
+
+
+//////////////////////////////////////////////////////////////   USART-3   //////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void USART3_Init(uint32_t baudrate)
+{
+    UART_Init(UART_PORT_3, baudrate);
 }
 
-/******************************************************************************
- * 函  数： vUART4_GetBuffer
- * 功  能： 获取UART所接收到的数据
- * 参  数： uint8_t* buffer   数据存放缓存地址
- *          uint8_t* cnt      接收到的字节数
- * 返回值： 0_没有接收到新数据， 非0_所接收到新数据的字节数
- ******************************************************************************/
-uint8_t UART4_GetBuffer(uint8_t *buffer, uint8_t *cnt)
+void USART3_IRQHandler(void)
 {
-    if (xUSART.UART4ReceivedNum > 0)                                         // 判断是否有新数据
-    {
-        memcpy(buffer, xUSART.UART4ReceivedBuffer, xUSART.UART4ReceivedNum); // 把新数据复制到指定位置
-        *cnt = xUSART.UART4ReceivedNum;                                      // 把新数据的字节数，存放指定变量
-        xUSART.UART4ReceivedNum = 0;                                         // 接收标记置0
-        return *cnt;                                                         // 返回所接收到新数据的字节数
-    }
-    return 0;                                                                // 返回0, 表示没有接收到新数据
+    IRQ_STATS_ENTER();
+    UART_IRQHandler(&xUartPorts[UART_PORT_3]);
+    IRQ_STATS_EXIT(IRQ_ID_USART3);
 }
 
-/******************************************************************************
- * 函  数： vUART4_SendData
- * 功  能： UART通过中断发送数据,适合各种数据类型
- *         【适合场景】本函数可发送各种数据，而不限于字符串，如int,char
- *         【不 适 合】注意环形缓冲区容量256字节，如果发送频率太高，注意波特率
- * 参  数： uint8_t* buffer   需发送数据的首地址
- *          uint8_t  cnt      发送的字节数 ，限于中断发送的缓存区大小，不能大于256个字节
- * 返回值：
- ******************************************************************************/
-void UART4_SendData(uint8_t *buf, uint8_t cnt)
+uint8_t USART3_GetBuffer(uint8_t *buffer, uint8_t *cnt)
 {
-    for (uint8_t i = 0; i < cnt; i++)
-        U4TxBuffer[U4TxCount++] = buf[i];
+    uint16_t num;
+    if (UART_GetBuffer(UART_PORT_3, buffer, &num) == 0)
+        return 0;
+    *cnt = num;
+    return *cnt;
+}
 
-    if ((UART4->CR1 & 1 << 7) == 0)       // 检查发送缓冲区空置中断(TXEIE)是否已打开
-        UART4->CR1 |= 1 << 7;
+void USART3_SendData(uint8_t *buf, uint16_t cnt)
+{
+    UART_SendData(UART_PORT_3, buf, cnt);
 }
 
-/******************************************************************************
- * 函  数： vUART4_SendString
- * 功  能： UART通过中断发送输出字符串,无需输入数据长度
- *         【适合场景】字符串，长度<=256字节
- *         【不 适 合】int,float等数据类型
- * 参  数： char* stringTemp   需发送数据的缓存首地址
- * 返回值： 元
- ******************************************************************************/
-void UART4_SendString(char *stringTemp)
+void USART3_SendString(char *stringTemp)
 {
-    u16 num = 0;                                 // 字符串长度
-    char *t = stringTemp ;                       // 用于配合计算发送的数量
-    while (*t++ != 0)  num++;                    // 计算要发送的数目，这步比较耗时，测试发现每多6个字节，增加1us，单位：8位
-    UART4_SendData((u8 *)stringTemp, num);       // 调用函数完成发送，num+1：字符串以0结尾，需多发一个:0
+    UART_SendString(UART_PORT_3, stringTemp);
 }
 
 
 
+#ifdef STM32F10X_HD  // STM32F103R，及以上，才有UART4和UART5
 
 //////////////////////////////////////////////////////////////   UART-4   //////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/******************************************************************************
- * 函  数： vUART5_Init
- * 功  能： 初始化USART的GPIO、通信参数配置、中断优先级
- *          (8位数据、无校验、1个停止位)
- * 参  数： uint32_t baudrate  通信波特率
- * 返回值： 无
- ******************************************************************************/
-void UART5_Init(uint32_t baudrate)
+void UART4_Init(uint32_t baudrate)
 {
-    GPIO_InitTypeDef  GPIO_InitStructure;
-    NVIC_InitTypeDef  NVIC_InitStructure;
-    USART_InitTypeDef USART_InitStructure;
-
-    // 时钟使能
-    RCC->APB1ENR |= RCC_APB1ENR_UART5EN;                            // 使能UART5时钟
-    RCC->APB2ENR |= RCC_APB2ENR_IOPDEN | RCC_APB2ENR_IOPCEN;        // 使能GPIO时钟
-
-    // GPIO_TX引脚配置
-    GPIO_InitStructure.GPIO_Pin   = GPIO_Pin_12;
-    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
-    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_AF_PP;                // TX引脚工作模式：复用推挽
-    GPIO_Init(GPIOC, &GPIO_InitStructure);
-    // GPIO_RX引脚配置
-    GPIO_InitStructure.GPIO_Pin   = GPIO_Pin_2;
-    GPIO_InitStructure.GPIO_Mode  = GPIO_Mode_IPU;                  // RX引脚工作模式：上拉输入; 如果使用浮空输入，引脚空置时可能产生误输入; 当电路上为一主多从电路时，可以使用复用开漏模式
-    GPIO_Init(GPIOD, &GPIO_InitStructure);
+    UART_Init(UART_PORT_4, baudrate);
+}
 
-    // NVIC_PriorityGroupConfig(NVIC_PriorityGroup_2);
-    // 中断配置
-    NVIC_InitStructure .NVIC_IRQChannel = UART5_IRQn;
-    NVIC_InitStructure .NVIC_IRQChannelPreemptionPriority = 2 ;     // 抢占优先级
-    NVIC_InitStructure .NVIC_IRQChannelSubPriority = 2;             // 子优先级
-    NVIC_InitStructure .NVIC_IRQChannelCmd = ENABLE;                // IRQ通道使能
-    NVIC_Init(&NVIC_InitStructure);
+void UART4_IRQHandler(void)
+{
+    IRQ_STATS_ENTER();
+    UART_IRQHandler(&xUartPorts[UART_PORT_4]);
+    IRQ_STATS_EXIT(IRQ_ID_UART4);
+}
 
-    //USART 初始化设置
-    USART_DeInit(UART5);
-    USART_InitStructure.USART_BaudRate   = baudrate;                // 串口波特率
-    USART_InitStructure.USART_WordLength = USART_WordLength_8b;     // 字长为8位数据格式
-    USART_InitStructure.USART_StopBits   = USART_StopBits_1;        // 一个停止位
-    USART_InitStructure.USART_Parity     = USART_Parity_No;         // 无奇偶校验位
-    USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx; // 使能收、发模式
-    USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
-    USART_Init(UART5, &USART_InitStructure);                        // 初始化串口
+uint8_t UART4_GetBuffer(uint8_t *buffer, uint8_t *cnt)
+{
+    uint16_t num;
+    if (UART_GetBuffer(UART_PORT_4, buffer, &num) == 0)
+        return 0;
+    *cnt = num;
+    return *cnt;
+}
 
-    USART_ITConfig(UART5, USART_IT_TXE, DISABLE);
-    USART_ITConfig(UART5, USART_IT_RXNE, ENABLE);                   // 使能接受中断
-    USART_ITConfig(UART5, USART_IT_IDLE, ENABLE);                   // 使能空闲中断
+void UART4_SendData(uint8_t *buf, uint16_t cnt)
+{
+    UART_SendData(UART_PORT_4, buf, cnt);
+}
 
-    USART_Cmd(UART5, ENABLE);                                       // 使能串口, 开始工作
+void UART4_SendString(char *stringTemp)
+{
+    UART_SendString(UART_PORT_4, stringTemp);
+}
 
-    UART5->SR = ~(0x00F0);                                          // 清理中断
 
-    xUSART.UART5InitFlag = 1;                                       // 标记初始化标志
-    xUSART.UART5ReceivedNum = 0;                                    // 接收字节数清零
 
-    printf("\rUART5 初始化配置      接收中断、空闲中断, 发送中断\r");
+//////////////////////////////////////////////////////////////   UART-5   //////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UART5_Init(uint32_t baudrate)
+{
+    UART_Init(UART_PORT_5, baudrate);
 }
 
-/******************************************************************************
- * 函  数： UART5_IRQHandler
- * 功  能： USART2的接收中断、空闲中断、发送中断
- * 参  数： 无
- * 返回值： 无
- ******************************************************************************/
-static uint8_t U5TxBuffer[256] ;    // 用于中断发送：环形缓冲区，256个字节
-static uint8_t U5TxCounter = 0 ;    // 用于中断发送：标记已发送的字节数(环形)
-static uint8_t U5TxCount   = 0 ;    // 用于中断发送：标记将要发送的字节数(环形)
-
 void UART5_IRQHandler(void)
 {
-    static uint16_t cnt = 0;                                        // 接收字节数累计：每一帧数据已接收到的字节数
-    static uint8_t  RxTemp[U5_RX_BUF_SIZE];                         // 接收数据缓存数组：每新接收１个字节，先顺序存放到这里，当一帧接收完(发生空闲中断), 再转存到全局变量：xUSART.USARTxReceivedBuffer[xx]中；
-
-    // 接收中断
-    if (UART5->SR & (1 << 5))                                       // 检查RXNE(读数据寄存器非空标志位); RXNE中断清理方法：读DR时自动清理；
-    {
-        if ((cnt >= U5_RX_BUF_SIZE))//||xUSART.UART5ReceivedFlag==1 // 判断1: 当前帧已接收到的数据量，已满(缓存区), 为避免溢出，本包后面接收到的数据直接舍弃．
-        {
-            // 判断2: 如果之前接收好的数据包还没处理，就放弃新数据，即，新数据帧不能覆盖旧数据帧，直至旧数据帧被处理．缺点：数据传输过快于处理速度时会掉包；好处：机制清晰，易于调试
-            UART5->DR;                                              // 读取数据寄存器的数据，但不保存．主要作用：读DR时自动清理接收中断标志；
-            return;
-        }
-        RxTemp[cnt++] = UART5->DR ;                                 // 把新收到的字节数据，顺序存放到RXTemp数组中；注意：读取DR时自动清零中断位；
-    }
-
-    // 空闲中断, 用于配合接收中断，以判断一帧数据的接收完成
-    if (UART5->SR & (1 << 4))                                       // 检查IDLE(空闲中断标志位); IDLE中断标志清理方法：序列清零，USART1 ->SR;  USART1 ->DR;
-    {
-        xUSART.UART5ReceivedNum  = 0;                               // 把接收到的数据字节数清0
-        memcpy(xUSART.UART5ReceivedBuffer, RxTemp, U5_RX_BUF_SIZE); // 把本帧接收到的数据，存放到全局变量xUSART.USARTxReceivedBuffer中, 等待处理; 注意：复制的是整个数组，包括0值，以方便字符串数据
-        xUSART.UART5ReceivedNum  = cnt;                             // 把接收到的字节数，存放到全局变量xUSART.USARTxReceivedCNT中；
-        cnt = 0;                                                    // 接收字节数累计器，清零; 准备下一次的接收
-        memset(RxTemp, 0, U5_RX_BUF_SIZE);                          // 接收数据缓存数组，清零; 准备下一次的接收
-        UART5 ->SR;
-        UART5 ->DR;                                  // 清零IDLE中断标志位!! 序列清零，顺序不能错!!
-    }
-
-    // 发送中断
-    if ((UART5->SR & 1 << 7) && (UART5->CR1 & 1 << 7))              // 检查TXE(发送数据寄存器空)、TXEIE(发送缓冲区空中断使能)
-    {
-        UART5->DR = U5TxBuffer[U5TxCounter++];                      // 读取数据寄存器值；注意：读取DR时自动清零中断位；
-        if (U5TxCounter == U5TxCount)
-            UART5->CR1 &= ~(1 << 7);                                // 已发送完成，关闭发送缓冲区空置中断 TXEIE
-    }
+    IRQ_STATS_ENTER();
+    UART_IRQHandler(&xUartPorts[UART_PORT_5]);
+    IRQ_STATS_EXIT(IRQ_ID_UART5);
 }
 
-/******************************************************************************
- * 函  数： vUART5_GetBuffer
- * 功  能： 获取UART所接收到的数据
- * 参  数： uint8_t* buffer   数据存放缓存地址
- *          uint8_t* cnt      接收到的字节数
- * 返回值： 0_没有接收到新数据， 非0_所接收到新数据的字节数
- ******************************************************************************/
 uint8_t UART5_GetBuffer(uint8_t *buffer, uint8_t *cnt)
 {
-    if (xUSART.UART5ReceivedNum > 0)                                         // 判断是否有新数据
-    {
-        memcpy(buffer, xUSART.UART5ReceivedBuffer, xUSART.UART5ReceivedNum); // 把新数据复制到指定位置
-        *cnt = xUSART.UART5ReceivedNum;                                      // 把新数据的字节数，存放指定变量
-        xUSART.UART5ReceivedNum = 0;                                         // 接收标记置0
-        return *cnt;                                                         // 返回所接收到新数据的字节数
-    }
-    return 0;                                                                // 返回0, 表示没有接收到新数据
+    uint16_t num;
+    if (UART_GetBuffer(UART_PORT_5, buffer, &num) == 0)
+        return 0;
+    *cnt = num;
+    return *cnt;
 }
 
-/******************************************************************************
- * 函  数： vUART5_SendData
- * 功  能： UART通过中断发送数据,适合各种数据类型
- *         【适合场景】本函数可发送各种数据，而不限于字符串，如int,char
- *         【不 适 合】注意环形缓冲区容量256字节，如果发送频率太高，注意波特率
- * 参  数： uint8_t* buffer   需发送数据的首地址
- *          uint8_t  cnt      发送的字节数 ，限于中断发送的缓存区大小，不能大于256个字节
- * 返回值：
- ******************************************************************************/
-void UART5_SendData(uint8_t *buf, uint8_t cnt)
+void UART5_SendData(uint8_t *buf, uint16_t cnt)
 {
-    for (uint8_t i = 0; i < cnt; i++)
-        U5TxBuffer[U5TxCount++] = buf[i];
-
-    if ((UART5->CR1 & 1 << 7) == 0)       // 检查发送缓冲区空置中断(TXEIE)是否已打开
-        UART5->CR1 |= 1 << 7;
+    UART_SendData(UART_PORT_5, buf, cnt);
 }
 
-/******************************************************************************
- * 函  数： vUART5_SendString
- * 功  能： UART通过中断发送输出字符串,无需输入数据长度
- *         【适合场景】字符串，长度<=256字节
- *         【不 适 合】int,float等数据类型
- * 参  数： char* stringTemp   需发送数据的缓存首地址
- * 返回值： 元
- ******************************************************************************/
 void UART5_SendString(char *stringTemp)
 {
-    u16 num = 0;                                 // 字符串长度
-    char *t = stringTemp ;                       // 用于配合计算发送的数量
-    while (*t++ != 0)  num++;                    // 计算要发送的数目，这步比较耗时，测试发现每多6个字节，增加1us，单位：8位
-    UART5_SendData((u8 *)stringTemp, num);       // 注意调用函数所需要的真实数据长度; 如果目标需要以0作结尾判断，需num+1：字符串以0结尾，即多发一个:0
+    UART_SendString(UART_PORT_5, stringTemp);
 }
 
 #endif
@@ -926,14 +964,16 @@ void UART5_SendString(char *stringTemp)
 
 
 
+////////////////////////////////////////////////////////////////  printf   //////////////////////////////////////////////////////////////
+/******************************************************************************
+ * 函  数： _write
+ * 功  能： printf重定向(GCC), 输出写入调试串口的发送环形缓冲区
+ *          主循环中: 缓冲区满时最多等待UART_DEBUG_TIMEOUT_MS; 中断中或关中断时: 不等待, 放不下的部分舍弃
+ *          调试串口未初始化时直接丢弃, 避免在配置前调用printf卡死
+ ******************************************************************************/
 int _write(int fd, char *pBuffer, int size)
 {
-    int i = 0;
-    for (i = 0; i < size; i++)
-    {
-        while (USART_GetFlagStatus(USART2, USART_FLAG_TXE) == RESET);
-        USART_SendData(USART2, (uint8_t) *pBuffer++);
-    }
+    UART_WriteTimeout(UART_DEBUG_PORT, pBuffer, (size_t)size, UART_DEBUG_TIMEOUT_MS);
     return size;
 }
 
@@ -977,4 +1017,3 @@ int _write(int fd, char *pBuffer, int size)
 //    return ch;
 //#endif
 //}
-
@@ -23,24 +23,39 @@
  **               3- USART3 PB10,PB11
  **               4- UART4  PC10,PC11
  **               5- UART5  PC12,PD2
+ **               调用UART_SetFlowControl()开启硬件流控时, 使用以下引脚(UART4、UART5不支持):
+ **               1- USART1 CTS=PA11, RTS=PA12
+ **               2- USART2 CTS=PA0,  RTS=PA1
+ **               3- USART3 CTS=PB13, RTS=PB14
  **
- ** 【代码说明】  本文件的收发机制, 经多次修改, 已比较完善. 
- **               初始化: 只需调用：USARTx_Init(波特率), 函数内已做好引脚及时钟配置; 
- **               发 送 : 方法1_发送任意长度字符串: USARTx_SendString (char* stringTemp); 
- **                       方法2_发送指定长度数据  : USARTx_SendData (uint8_t* buf, uint8_t cnt);
- **               接 收 : 方式1_通过全局函数: USARTx_GetBuffer (uint8_t* buffer, uint8_t* cnt);　// 当有数据时，返回1; 本函数已清晰地示例了接收机制; 
+ ** 【代码说明】  五个串口共用同一套驱动代码, 各串口的差异(寄存器、引脚、中断、DMA通道、缓存)全部写在bsp_usart.c的描述表xUartPorts[]中;
+ **               初始化: 只需调用：USARTx_Init(波特率), 或UART_Init(UART_PORT_x, 波特率), 函数内已做好引脚及时钟配置;
+ **               发 送 : 数据写入发送环形缓冲区后立即返回, 由DMA(UART5无DMA, 使用TXE中断)分段发出;
+ **                       方法1_发送任意长度字符串: USARTx_SendString (char* stringTemp);
+ **                       方法2_发送指定长度数据  : USARTx_SendData (uint8_t* buf, uint16_t cnt);
+ **                       方法3_需要知道写入了多少: UART_Write() 非阻塞, 返回已写入的字节数; UART_WriteTimeout() 阻塞等待, 带超时
+ **               接 收 : DMA接收(UART5使用RXNE中断), 空闲中断判断一帧结束, 两个接收缓存乒乓切换, 交付时只交换指针;
+ **                       帧模式(USART2~UART5): 每次空闲中断交付一帧; 应用程序持有上一帧时, 新数据继续累加, 待释放后再交付;
+ **                       流模式(USART1)      : 数据持续累加在同一缓存中, 每次空闲中断更新已接收字节数, 适合AT指令的多段应答;
+ **                       方式1_通过全局函数: USARTx_GetBuffer (uint8_t* buffer, uint8_t* cnt);　// 当有数据时，返回字节数, 并自动释放
  **                       方式2_通过判断xUSART.USARTxReceivedNum>0;
  **                              如在while中不断轮询，或在任何一个需要的地方判断这个接收字节长度变量值．示例：
  **                              while(1){
- **                                  if(xUSART1.USART1ReceivedNum>0)
+ **                                  if(xUSART.USART1ReceivedNum>0)
  **                                  {
- **                                      printf((char*)xUSART.USART1ReceivedBuffer);          // 示例1: 如何输出成字符串
+ **                                      printf((char*)xUSART.USART1ReceivedBuffer);          // 示例1: 如何输出成字符串(缓存已以0结尾)
  **                                      uint16_t GPS_Value = xUSART.USART1ReceivedBuffer[1]; // 示例2: 如何读写其中某个成员的数据
- **                                      xUSART1.USART1ReceivedNum= 0;                     // 重要：处理完数据后, 必须把接收到的字节数量值清0
- **                                  }  
- **                              }     
- **   
+ **                                      UART_RxRelease(UART_PORT_1);                         // 重要：处理完数据后, 必须释放, 才能交付下一帧
+ **                                  }
+ **                              }
+ **
  ** 【更新记录】
+ **              2026-10-19  增加UART_RxIdleCycles(): 读取最近一次空闲中断的时刻, 用于估算下行数据的到达时刻
+ **              2026-10-19  增加UART_RxConsume(): 流模式下只释放已处理的部分, 未接收完整的报文保留
+ **              2026-10-19  增加UART_SetBaudrate()、UART_SetFlowControl(): 运行中切换波特率, RTS/CTS硬件流控
+ **              2026-10-19  增加size_t长度的UART_Write()/UART_WriteTimeout(); USARTx_SendData()的长度改为uint16_t
+ **              2026-10-19  五个串口合并为一套描述表驱动: DMA接收+乒乓缓存, 环形缓冲区+DMA发送, USART1改为流模式; 释放数据改用UART_RxRelease()
+ **              2026-10-19  USART2~UART5接收改为乒乓缓存: xUSART.USARTxReceivedBuffer改为指针, 空闲中断中只交换指针, 不再复制整个缓存
  **              2021-12-16  完善接收机制：取消接收标志，判断接收字节数>0即为接收到新数据
  **              2021-11-03  完善接收函数返回值处理
  **              2021-08-14  增加宏定义：接收缓存区大小设定值，使空间占用更可控;
@@ -56,21 +71,27 @@
 #include "string.h"       // C标准库头文件: 字符数组常用：strcpy()、strncpy()、strcmp()、strlen()、strnset()
 
 
-// 定义一个标志位，当接收到一行完整的指令时，此标志位置1
-volatile uint8_t g_usart1_new_line_received = 0;
-
 
 /*****************************************************************************
  ** 移植配置
 ****************************************************************************/
 // 用哪个串口与上位机通信，可自行
 #define USARTx_DEBUG            USART2              // 用于重定向printf, 使printf通过USARTx发送数据
+#define UART_DEBUG_PORT         UART_PORT_2         // 与USARTx_DEBUG对应的串口编号
+#define UART_DEBUG_TIMEOUT_MS     100               // printf输出时, 发送缓冲区满的最长等待时间(ms)
+#define UART_DRAIN_TIMEOUT_MS     200               // 切换波特率、流控前, 等待发送缓冲区发完的最长时间(ms)
 // 数据接收缓冲区大小，可自行修改
-#define U1_RX_BUF_SIZE            1024              // 配置每个USARTx接收缓冲区的大小(字节数)，包括中断里的缓存大小，和xUSART结构体里的缓存区大小
-#define U2_RX_BUF_SIZE            1024              // --- 当每帧接收到的数据字节数，小于此值时，数据正常;剩余空间数据为: 0
-#define U3_RX_BUF_SIZE            1024              // --- 当每帧接收到的数据字节数，超过此值时，超出部分，将在中断中直接弃舍，直到接收结束(发生空闲中断); 
-#define U4_RX_BUF_SIZE            1024              // --- 有效区域：仅在各个USARTx的中断服务函数中工作;
-#define U5_RX_BUF_SIZE            1024              // --- 主要作用:  1:配合空闲中断接收数据帧;  2:灵活配置缓存大小;  3:防止数据溢出!!!!
+#define U1_RX_BUF_SIZE            1024              // 配置每个USARTx接收缓冲区的大小(字节数); 每个串口有两个这样大小的乒乓缓存
+#define U2_RX_BUF_SIZE            1024              // --- 当每帧接收到的数据字节数，小于此值时，数据正常;
+#define U3_RX_BUF_SIZE            1024              // --- 当每帧接收到的数据字节数，超过此值时，超出部分将被舍弃，直到接收结束(发生空闲中断);
+#define U4_RX_BUF_SIZE            1024              // --- 主要作用:  1:配合空闲中断接收数据帧;  2:灵活配置缓存大小;  3:防止数据溢出!!!!
+#define U5_RX_BUF_SIZE            1024
+// 数据发送环形缓冲区大小，可自行修改; 实际可存放的字节数比此值少1
+#define U1_TX_BUF_SIZE            4096              // USART1连接通信模组, AT指令较长
+#define U2_TX_BUF_SIZE            1024              // USART2用于printf调试输出
+#define U3_TX_BUF_SIZE             256
+#define U4_TX_BUF_SIZE             256
+#define U5_TX_BUF_SIZE             256
 
 #define DEBUG_USART   USART2            // 用于调试的串口，可自行修改
 
@@ -78,68 +99,91 @@ volatile uint8_t g_usart1_new_line_received = 0;
 /*****************************************************************************
  ** 全局变量 (无要修改)
 ****************************************************************************/
+// 串口编号, 用于通用函数UART_xxx()
+typedef enum
+{
+    UART_PORT_1 = 0,
+    UART_PORT_2,
+    UART_PORT_3,
+    UART_PORT_4,                                    // 仅STM32F103R及以上型号
+    UART_PORT_5,                                    // 仅STM32F103R及以上型号
+    UART_PORT_NUM                                   // 数量, 不是串口
+} UART_Port;
+
 typedef struct 
 {
     uint8_t   USART1InitFlag;                       // 初始化标记; 0=未初始化, 1=已初始化
-    uint16_t  USART1ReceivedNum;                    // 接收到多少个字节数据; 当等于0时，表示没有接收到数据; 当大于0时，表示已收到一帧新数据
-    uint8_t   USART1ReceivedBuffer[U1_RX_BUF_SIZE]; // 接收到数据的缓存
+    volatile uint16_t  USART1ReceivedNum;           // 已接收的字节数(流模式, 每次空闲中断更新); 当等于0时，表示没有接收到数据
+    uint8_t  *USART1ReceivedBuffer;                 // 指向正在累加接收的缓存(以0结尾); 处理完后调用UART_RxRelease(UART_PORT_1)清空
     
     uint8_t   USART2InitFlag;                       // 初始化标记; 0=未初始化, 1=已初始化
-    uint16_t  USART2ReceivedNum;                    // 接收到多少个字节数据; 当等于0时，表示没有接收到数据; 当大于0时，表示已收到一帧新数据
-    uint8_t   USART2ReceivedBuffer[U2_RX_BUF_SIZE]; // 接收到数据的缓存
+    volatile uint16_t  USART2ReceivedNum;           // 接收到多少个字节数据; 当等于0时，表示没有接收到数据; 当大于0时，表示已收到一帧新数据
+    uint8_t  *USART2ReceivedBuffer;                 // 指向已接收的一帧数据(乒乓缓存之一, 以0结尾); 处理完后调用UART_RxRelease()释放
     
     uint8_t   USART3InitFlag;                       // 初始化标记; 0=未初始化, 1=已初始化
-    uint16_t  USART3ReceivedNum;                    // 接收到多少个字节数据; 当等于0时，表示没有接收到数据; 当大于0时，表示已收到一帧新数据
-    uint8_t   USART3ReceivedBuffer[U3_RX_BUF_SIZE]; // 接收到数据的缓存 
+    volatile uint16_t  USART3ReceivedNum;           // 接收到多少个字节数据; 当等于0时，表示没有接收到数据; 当大于0时，表示已收到一帧新数据
+    uint8_t  *USART3ReceivedBuffer;                 // 指向已接收的一帧数据(乒乓缓存之一, 以0结尾); 处理完后调用UART_RxRelease()释放
     
     uint8_t   UART4InitFlag;                        // 初始化标记; 0=未初始化, 1=已初始化
-    uint16_t  UART4ReceivedNum;                     // 接收到多少个字节数据; 当等于0时，表示没有接收到数据; 当大于0时，表示已收到一帧新数据
-    uint8_t   UART4ReceivedBuffer[U4_RX_BUF_SIZE];  // 接收到数据的缓存
+    volatile uint16_t  UART4ReceivedNum;            // 接收到多少个字节数据; 当等于0时，表示没有接收到数据; 当大于0时，表示已收到一帧新数据
+    uint8_t  *UART4ReceivedBuffer;                  // 指向已接收的一帧数据(乒乓缓存之一, 以0结尾); 处理完后调用UART_RxRelease()释放
     
     uint8_t   UART5InitFlag;                        // 初始化标记; 0=未初始化, 1=已初始化
-    uint16_t  UART5ReceivedNum;                     // 接收到多少个字节数据; 当等于0时，表示没有接收到数据; 当大于0时，表示已收到一帧新数据
-    uint8_t   UART5ReceivedBuffer[U5_RX_BUF_SIZE];  // 接收到数据的缓存
+    volatile uint16_t  UART5ReceivedNum;            // 接收到多少个字节数据; 当等于0时，表示没有接收到数据; 当大于0时，表示已收到一帧新数据
+    uint8_t  *UART5ReceivedBuffer;                  // 指向已接收的一帧数据(乒乓缓存之一, 以0结尾); 处理完后调用UART_RxRelease()释放
     
     uint16_t  testCNT;                              // 仅用于测试
     
 }xUSATR_TypeDef;
 
 extern xUSATR_TypeDef  xUSART;                      // 声明为全局变量,方便记录信息、状态
+extern volatile uint8_t g_usart1_new_line_received; // 当接收到一行完整的指令时，此标志位置1
     
 
 
 
-
 /*****************************************************************************
  ** 声明全局函数 (无需修改)
 ****************************************************************************/
+// 通用函数, 适用于所有串口
+void     UART_Init (UART_Port port, uint32_t baudrate);                       // 按描述表初始化串口的GPIO、通信参数、DMA、中断
+size_t   UART_Write (UART_Port port, const void* data, size_t len);                           // 非阻塞发送, 返回实际写入发送缓冲区的字节数
+size_t   UART_WriteTimeout (UART_Port port, const void* data, size_t len, uint32_t timeout_ms); // 阻塞发送, 等待缓冲区空间, 直到全部写入或超时; 返回实际写入的字节数
+void     UART_SendData (UART_Port port, const uint8_t* buf, uint16_t cnt);    // 数据写入发送环形缓冲区; 空间不足时, 放不下的部分舍弃
+void     UART_SendString (UART_Port port, const char* stringTemp);            // 发送字符串
+uint16_t UART_GetBuffer (UART_Port port, uint8_t* buffer, uint16_t* cnt);     // 复制接收到的数据, 并释放; 返回字节数, 0=没有新数据
+void     UART_RxRelease (UART_Port port);                                     // 释放已处理的数据: 帧模式交付下一帧, 流模式清空缓存
+void     UART_RxConsume (UART_Port port, uint16_t len);                       // 流模式: 只释放开头的len字节, 其后的数据保留; 帧模式同UART_RxRelease()
+uint32_t UART_RxIdleCycles (UART_Port port);                                 // 最近一次空闲中断的时刻(DWT周期计数值)
+void     UART_SetBaudrate (UART_Port port, uint32_t baudrate);                // 运行中修改波特率, 先等待发送缓冲区发完
+uint32_t UART_GetBaudrate (UART_Port port);                                   // 读取当前波特率
+uint8_t  UART_SetFlowControl (UART_Port port, uint8_t enable);                // 开启/关闭RTS/CTS硬件流控; 返回0表示该串口不支持
 // USART1
 void    USART1_Init (uint32_t baudrate);                      // 初始化串口的GPIO、通信参数配置、中断优先级; (波特率可设、8位数据、无校验、1个停止位)
 uint8_t USART1_GetBuffer (uint8_t* buffer, uint8_t* cnt);     // 获取接收到的数据
-void    USART1_SendData (uint8_t* buf, uint8_t cnt);          // 通过中断发送数据，适合各种数据
-void    USART1_SendString (char* stringTemp);                 // 通过中断发送字符串，适合字符串，长度在4096个长度内的
-void    USART1_printfForDMA (char* stringTemp) ;              // 通过DMA发送数据，适合一次过发送数据量特别大的字符串，省了占用中断的时间
+void    USART1_SendData (uint8_t* buf, uint16_t cnt);         // 通过DMA发送数据，适合各种数据
+void    USART1_SendString (char* stringTemp);                 // 通过DMA发送字符串，长度在4095个字节内
+void    USART1_SendStringForDMA (char* stringTemp);           // 与USART1_SendString相同, 保留以兼容旧代码
 // USART2
 void    USART2_Init (uint32_t baudrate);                      // 初始化串口的GPIO、通信参数配置、中断优先级; (波特率可设、8位数据、无校验、1个停止位)
 uint8_t USART2_GetBuffer (uint8_t* buffer, uint8_t* cnt);     // 获取接收到的数据
-void    USART2_SendData (uint8_t* buf, uint8_t cnt);          // 通过中断发送数据，适合各种数据
-void    USART2_SendString (char* stringTemp);                 // 通过中断发送字符串，适合字符串，长度在256个长度内的
+void    USART2_SendData (uint8_t* buf, uint16_t cnt);         // 通过DMA发送数据，适合各种数据
+void    USART2_SendString (char* stringTemp);                 // 通过DMA发送字符串，长度在1023个字节内
 // USART3
 void    USART3_Init (uint32_t baudrate);                      // 初始化串口的GPIO、通信参数配置、中断优先级; (波特率可设、8位数据、无校验、1个停止位)
 uint8_t USART3_GetBuffer (uint8_t* buffer, uint8_t* cnt);     // 获取接收到的数据
-void    USART3_SendData (uint8_t* buf, uint8_t cnt);          // 通过中断发送数据，适合各种数据
-void    USART3_SendString (char* stringTemp);                 // 通过中断发送字符串，适合字符串，长度在256个长度内的
+void    USART3_SendData (uint8_t* buf, uint16_t cnt);         // 通过DMA发送数据，适合各种数据
+void    USART3_SendString (char* stringTemp);                 // 通过DMA发送字符串，长度在255个字节内
 // USART4
 void    UART4_Init (uint32_t baudrate);                       // 初始化串口的GPIO、通信参数配置、中断优先级; (波特率可设、8位数据、无校验、1个停止位)
 uint8_t UART4_GetBuffer (uint8_t* buffer, uint8_t* cnt);      // 获取接收到的数据
-void    UART4_SendData (uint8_t* buf, uint8_t cnt);           // 通过中断发送数据，适合各种数据
-void    UART4_SendString (char* stringTemp);                  // 通过中断发送字符串，适合字符串，长度在256个长度内的
+void    UART4_SendData (uint8_t* buf, uint16_t cnt);          // 通过DMA发送数据，适合各种数据
+void    UART4_SendString (char* stringTemp);                  // 通过DMA发送字符串，长度在255个字节内
 // USART5
 void    UART5_Init (uint32_t baudrate);                       // 初始化串口的GPIO、通信参数配置、中断优先级; (波特率可设、8位数据、无校验、1个停止位)
 uint8_t UART5_GetBuffer (uint8_t* buffer, uint8_t* cnt);      // 获取接收到的数据
-void    UART5_SendData (uint8_t* buf, uint8_t cnt);           // 通过中断发送数据，适合各种数据
-void    UART5_SendString (char* stringTemp);                  // 通过中断发送字符串，适合字符串，长度在256个长度内的
+void    UART5_SendData (uint8_t* buf, uint16_t cnt);          // 通过中断发送数据，适合各种数据
+void    UART5_SendString (char* stringTemp);                  // 通过中断发送字符串，长度在255个字节内
 
 
 #endif
-
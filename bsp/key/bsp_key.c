@@ -1,5 +1,6 @@
 #include "bsp_key.h"
 #include "bsp_led.h"
+#include "irq_stats.h"
 
 
 
@@ -85,12 +86,16 @@ void Key_Init(void)
 // KEY_1 中断服务函数
 void KEY_1_IRQHANDLER(void)                        // 提示：这个函数名，是h文件中的宏定义，在编译过程中，会被替换成宏定义的值
 {
+    IRQ_STATS_ENTER();                             // 中断负载统计: 入口
+
     if (EXTI->PR & KEY_1_PIN)                      // 板子上的按键已使用电容作简单的硬件消抖,无需再使用软件延时消抖
     {
         EXTI->PR |= KEY_1_PIN  ;                   // 清理中断标示
         printf("第 1 个按键被按下, 蓝灯反转\r");   // 重要提示：printf是不可重入函数，中断服务函数中使用，可能会产生不可预测的错误。这里使用printf，只用代码测试使用！！
         
     }
+
+    IRQ_STATS_EXIT(IRQ_ID_EXTI0);
 }
 
 
@@ -98,12 +103,16 @@ void KEY_1_IRQHANDLER(void)                        // 提示：这个函数名
 // KEY_2 中断服务函数
 void KEY_2_IRQHANDLER(void)                        // 提示：这个函数名，是h文件中的宏定义，在编译过程中，会被替换成宏定义的值
 {
+    IRQ_STATS_ENTER();                             // 中断负载统计: 入口
+
     if (EXTI->PR & KEY_2_PIN)                      // 板子上的按键已使用电容作简单的硬件消抖,无需再使用软件延时消抖
     {
         EXTI->PR |= KEY_2_PIN  ;                   // 清理中断标示
         printf("第 2 个按键被按下, 蓝灯反转\r");   // 重要提示：printf是不可重入函数，中断服务函数中使用，可能会产生不可预测的错误。这里使用printf，只用代码测试使用！！      // 魔女开发板的按键使用电容进行硬件消抖,无需再使用软件延时消抖
    
     }
+
+    IRQ_STATS_EXIT(IRQ_ID_EXTI1);
 }
 
 
@@ -111,11 +120,15 @@ void KEY_2_IRQHANDLER(void)                        // 提示：这个函数名
 // KEY_3 中断服务函数
 void KEY_3_IRQHANDLER(void)                        // 提示：这个函数名，是h文件中的宏定义，在编译过程中，会被替换成宏定义的值
 {
+    IRQ_STATS_ENTER();                             // 中断负载统计: 入口
+
     if (EXTI->PR & KEY_3_PIN)                      // 板子上的按键已使用电容作简单的硬件消抖,无需再使用软件延时消抖
     {
         EXTI->PR |= KEY_3_PIN  ;                   // 清理中断标示
         printf("第 3 个按键被按下, 蓝灯反转\r");   // 重要提示：printf是不可重入函数，中断服务函数中使用，可能会产生不可预测的错误。这里使用printf，只用代码测试使用！！      // 魔女开发板的按键使用电容进行硬件消抖,无需再使用软件延时消抖
     }
+
+    IRQ_STATS_EXIT(IRQ_ID_EXTI4);
 }
 
 
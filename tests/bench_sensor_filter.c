@@ -0,0 +1,328 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  bench_sensor_filter.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  bsp/ADC/sensor_filter.c 的主机测试和基准: 同一组合成数据块分别送入整数流水线和浮点参考实现
+ **               (3点中值、求平均、logf按B值方程换算NTC温度), 比较结果并输出两者的耗时
+ **
+ ** 【使用说明】  make test; 温度通道相差超过 BENCH_TEMP_TOL_C 或湿度相差超过 BENCH_RH_TOL, 或传感器故障判断错误时返回非0
+ **
+ ** 【实现说明】  1- AdcSampler_Get()/AdcSampler_Done()由本文件实现, 依次返回合成的数据块; 可以指定某个数据块"处理期间被覆盖";
+ **               2- 合成数据: 按设定温度由B值方程算出12位码值, 叠加±4的均匀噪声, 每37个采样一个+600的尖峰(应被中值滤掉),
+ **                  设定温度随数据块缓慢变化, 覆盖霜冻判断关心的-20~50°C;
+ **               3- 耗时在主机上测量, 只说明两者的相对开销; Cortex-M3没有FPU, 浮点实现在目标板上的开销更大
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "sensor_filter.h"
+#include <math.h>
+#include <time.h>
+
+
+
+/*****************************************************************************
+ ** 本地定义
+ *****************************************************************************/
+#define BENCH_TEMP_TOL_C        0.05f               // 温度通道允许的偏差(°C)
+#define BENCH_RH_TOL            0.10f               // 湿度通道允许的偏差(%RH)
+#define BENCH_BLOCKS            600                 // 比较的数据块数
+#define BENCH_OVERRUN_BLOCK     20                  // 这个数据块模拟处理期间被覆盖, 两种实现都应丢弃
+#define BENCH_TIMED_PASSES      20000               // 计时的数据块数
+#define BENCH_POOL              64                  // 计时用的预先生成的数据块数
+
+#define NTC_R0                  10000.0f            // 与SENSOR_LUT_TEMPx(xSensorLut_NTC10K_B3950)一致
+#define NTC_BETA                3950.0f
+#define NTC_R_PULL              10000.0f
+#define VREFINT_RAW             1489                // 1.2V, VDDA=3.3V
+#define HUMIDITY_RAW            1650                // 约1.33V
+
+static const float fBaseTemp[5] = { -15.0f, -2.5f, 0.3f, 12.0f, 35.0f };   // 各温度通道的设定温度(°C)
+
+
+
+/*****************************************************************************
+ ** 替身: 合成的ADC数据块
+ *****************************************************************************/
+uint32_t SystemCoreClock = 72000000;
+
+static AdcSampler_Scan  xPool[BENCH_POOL][ADC_BLOCK_SCANS];
+static const AdcSampler_Scan *pxNext = NULL;        // AdcSampler_Get()返回的数据块; NULL=没有
+static uint32_t ulSeq = 0;
+static bool     bOverrun = false;                   // 本数据块处理期间被覆盖
+static uint32_t ulRand = 12345;
+
+bool AdcSampler_Get(AdcSampler_Block *block)
+{
+    if (pxNext == NULL)
+        return false;
+    block->scans = pxNext;
+    block->seq   = ++ulSeq;
+    pxNext = NULL;
+    return true;
+}
+
+bool AdcSampler_Done(void)
+{
+    return !bOverrun;
+}
+
+uint32_t AdcSampler_ToMillivolts(uint32_t code, uint32_t vrefCode)     // 与bsp_adc.c相同
+{
+    if (vrefCode == 0)
+        return 0;
+    return (uint32_t)(((uint64_t)code * ADC_VREFINT_MV + vrefCode / 2) / vrefCode);
+}
+
+static int Noise(int amplitude)
+{
+    ulRand = ulRand * 1103515245u + 12345u;
+    return (int)((ulRand >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+// 设定温度 -> 12位码值(浮点)
+static float TempToRaw(float t)
+{
+    float r = NTC_R0 * expf(NTC_BETA * (1.0f / (t + 273.15f) - 1.0f / 298.15f));
+    return 4096.0f * r / (r + NTC_R_PULL);
+}
+
+// 第k个数据块中温度通道ch的设定温度
+static float SetPoint(uint32_t k, int ch)
+{
+    return fBaseTemp[ch] + 12.0f * sinf(6.2831853f * (float)k / 400.0f + (float)ch);
+}
+
+static void Synthesize(AdcSampler_Scan *scans, uint32_t k)
+{
+    for (int i = 0; i < ADC_BLOCK_SCANS; i++)
+    {
+        for (int ch = 0; ch < ADC_CH_NUM; ch++)
+        {
+            float ideal = (ch <= ADC_CH_AMBIENT) ? TempToRaw(SetPoint(k, ch))
+                        : (ch == ADC_CH_HUMIDITY ? HUMIDITY_RAW : VREFINT_RAW);
+            int v = (int)lrintf(ideal) + Noise(4);
+            if ((k * ADC_BLOCK_SCANS + (uint32_t)i + (uint32_t)ch * 11) % 37 == 0)
+                v += 600;                           // 单点尖峰
+            scans[i][ch] = (uint16_t)(v < 0 ? 0 : (v > 4095 ? 4095 : v));
+        }
+    }
+}
+
+
+
+/*****************************************************************************
+ ** 浮点参考实现
+ *****************************************************************************/
+#define REF_WINDOW   (1 << SENSOR_MOVSUM_LOG2)
+
+typedef struct
+{
+    float hist[2];
+    float window[REF_WINDOW];
+    float out;                                      // °C 或 %RH; VREFINT为平均码值
+} Ref_State;
+
+static Ref_State xRef[ADC_CH_NUM];
+static int iRefCount = 0, iRefPos = 0;
+
+static float Median3f(float a, float b, float c)
+{
+    float t[3] = { a, b, c };
+    for (int i = 0; i < 2; i++)                     // 排序后取中间
+        for (int j = 0; j < 2 - i; j++)
+            if (t[j] > t[j + 1]) { float s = t[j]; t[j] = t[j + 1]; t[j + 1] = s; }
+    return t[1];
+}
+
+// 处理一个数据块; 返回true=输出已更新(与SensorFilter_Task相同的时机)
+static bool Ref_Task(const AdcSampler_Scan *scans, bool overrun)
+{
+    float mean[ADC_CH_NUM], tail[ADC_CH_NUM][2];
+    for (int ch = 0; ch < ADC_CH_NUM; ch++)
+    {
+        float a = xRef[ch].hist[0], b = xRef[ch].hist[1];
+        if (iRefCount == 0)
+            a = b = scans[0][ch];
+        float sum = 0.0f;
+        for (int i = 0; i < ADC_BLOCK_SCANS; i++)
+        {
+            float c = scans[i][ch];
+            sum += Median3f(a, b, c);
+            a = b;
+            b = c;
+        }
+        mean[ch] = sum / ADC_BLOCK_SCANS;
+        tail[ch][0] = a;
+        tail[ch][1] = b;
+    }
+    if (overrun)
+        return false;
+
+    for (int ch = 0; ch < ADC_CH_NUM; ch++)
+    {
+        xRef[ch].hist[0] = tail[ch][0];
+        xRef[ch].hist[1] = tail[ch][1];
+        xRef[ch].window[iRefPos] = mean[ch];
+    }
+    iRefPos = (iRefPos + 1) % REF_WINDOW;
+    if (iRefCount < REF_WINDOW && ++iRefCount < REF_WINDOW)
+        return false;
+
+    float avg[ADC_CH_NUM];
+    for (int ch = 0; ch < ADC_CH_NUM; ch++)
+    {
+        float s = 0.0f;
+        for (int i = 0; i < REF_WINDOW; i++)
+            s += xRef[ch].window[i];
+        avg[ch] = s / REF_WINDOW;
+    }
+    for (int ch = 0; ch <= ADC_CH_AMBIENT; ch++)    // NTC: 分压比 -> 电阻 -> B值方程
+    {
+        float x = avg[ch] / 4096.0f;
+        float r = NTC_R_PULL * x / (1.0f - x);
+        xRef[ch].out = 1.0f / (1.0f / 298.15f + logf(r / NTC_R0) / NTC_BETA) - 273.15f;
+    }
+    float mv = avg[ADC_CH_HUMIDITY] * ADC_VREFINT_MV / avg[ADC_CH_VREFINT];
+    xRef[ADC_CH_HUMIDITY].out = (mv - SENSOR_HUMIDITY_MV_0) * 100.0f / (SENSOR_HUMIDITY_MV_100 - SENSOR_HUMIDITY_MV_0);
+    xRef[ADC_CH_VREFINT].out  = avg[ADC_CH_VREFINT];
+    return true;
+}
+
+static void Ref_Init(void)
+{
+    memset(xRef, 0, sizeof(xRef));
+    iRefCount = iRefPos = 0;
+}
+
+
+
+/*****************************************************************************
+ ** 测试
+ *****************************************************************************/
+// 比较两种实现的结果; 返回不满足的次数
+static int Compare(void)
+{
+    static AdcSampler_Scan scans[ADC_BLOCK_SCANS];
+    float worst[ADC_CH_NUM] = { 0 };
+    int   failures = 0, updates = 0;
+
+    SensorFilter_Init();
+    Ref_Init();
+    for (uint32_t k = 0; k < BENCH_BLOCKS; k++)
+    {
+        Synthesize(scans, k);
+        bOverrun = (k == BENCH_OVERRUN_BLOCK);
+        pxNext = scans;
+        bool updated    = SensorFilter_Task();
+        bool refUpdated = Ref_Task(scans, bOverrun);
+        if (updated != refUpdated)
+        {
+            printf("block %lu: integer updated=%d, float updated=%d\n", (unsigned long)k, updated, refUpdated);
+            failures++;
+            continue;
+        }
+        if (!updated)
+            continue;
+        updates++;
+        for (int ch = 0; ch <= ADC_CH_HUMIDITY; ch++)
+        {
+            float err = fabsf(SensorFilter_GetCenti((AdcSampler_Channel)ch) / 100.0f - xRef[ch].out);
+            float tol = (ch == ADC_CH_HUMIDITY) ? BENCH_RH_TOL : BENCH_TEMP_TOL_C;
+            if (err > worst[ch])
+                worst[ch] = err;
+            if (err > tol)
+            {
+                if (failures < 10)
+                    printf("block %lu ch %d: integer %.2f, float %.3f\n", (unsigned long)k, ch,
+                           SensorFilter_GetCenti((AdcSampler_Channel)ch) / 100.0, xRef[ch].out);
+                failures++;
+            }
+        }
+    }
+    bOverrun = false;
+
+    if (updates != BENCH_BLOCKS - REF_WINDOW)       // 前REF_WINDOW-1个数据块填充窗口, 另有一个被丢弃
+    {
+        printf("expected %d updates, got %d\n", BENCH_BLOCKS - REF_WINDOW, updates);
+        failures++;
+    }
+    printf("max |integer - float|: temp1..4 %.3f %.3f %.3f %.3f, ambient %.3f C, humidity %.3f %%RH\n",
+           worst[0], worst[1], worst[2], worst[3], worst[4], worst[ADC_CH_HUMIDITY]);
+    return failures;
+}
+
+// 传感器故障: 开路(原始值满量程)、短路(原始值0)的温度通道无效, 其余通道不受影响
+static int Faults(void)
+{
+    static AdcSampler_Scan scans[ADC_BLOCK_SCANS];
+    int failures = 0;
+
+    SensorFilter_Init();
+    for (uint32_t k = 0; k < REF_WINDOW; k++)
+    {
+        Synthesize(scans, k);
+        for (int i = 0; i < ADC_BLOCK_SCANS; i++)
+        {
+            scans[i][ADC_CH_TEMP2]   = 4095;        // 开路
+            scans[i][ADC_CH_AMBIENT] = 0;           // 短路
+        }
+        pxNext = scans;
+        SensorFilter_Task();
+    }
+    for (int ch = 0; ch < ADC_CH_NUM; ch++)
+    {
+        bool expect = (ch != ADC_CH_TEMP2 && ch != ADC_CH_AMBIENT);
+        if (SensorFilter_Valid((AdcSampler_Channel)ch) != expect)
+        {
+            printf("ch %d: valid=%d, expected %d (centi %d)\n", ch, !expect, expect,
+                   SensorFilter_GetCenti((AdcSampler_Channel)ch));
+            failures++;
+        }
+    }
+    printf("open temp2 -> %.2f C, shorted ambient -> %.2f C: %s\n", SensorFilter_GetCenti(ADC_CH_TEMP2) / 100.0,
+           SensorFilter_GetCenti(ADC_CH_AMBIENT) / 100.0, failures ? "not detected" : "flagged invalid");
+    return failures;
+}
+
+// 两种实现处理同一组数据块的耗时(每个数据块的微秒数)
+static void Benchmark(void)
+{
+    volatile float sink = 0.0f;
+    for (uint32_t k = 0; k < BENCH_POOL; k++)
+        Synthesize(xPool[k], k * 7);
+
+    SensorFilter_Init();
+    clock_t t0 = clock();
+    for (uint32_t k = 0; k < BENCH_TIMED_PASSES; k++)
+    {
+        pxNext = xPool[k % BENCH_POOL];
+        SensorFilter_Task();
+        sink += SensorFilter_GetCenti(ADC_CH_TEMP1);
+    }
+    clock_t t1 = clock();
+
+    Ref_Init();
+    for (uint32_t k = 0; k < BENCH_TIMED_PASSES; k++)
+    {
+        Ref_Task(xPool[k % BENCH_POOL], false);
+        sink += xRef[ADC_CH_TEMP1].out;
+    }
+    clock_t t2 = clock();
+
+    double usInt   = (double)(t1 - t0) * 1e6 / CLOCKS_PER_SEC / BENCH_TIMED_PASSES;
+    double usFloat = (double)(t2 - t1) * 1e6 / CLOCKS_PER_SEC / BENCH_TIMED_PASSES;
+    printf("cost per block (host): integer %.2f us, float %.2f us, float/integer %.1fx\n",
+           usInt, usFloat, usInt > 0 ? usFloat / usInt : 0.0);
+    (void)sink;
+}
+
+
+
+int main(void)
+{
+    int failures = Compare();
+    failures += Faults();
+    Benchmark();
+    printf("bench_sensor_filter: %d failed\n", failures);
+    return failures ? 1 : 0;
+}
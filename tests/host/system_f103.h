@@ -0,0 +1,38 @@
+#ifndef __SYSTEM_F103_H
+#define __SYSTEM_F103_H
+/***********************************************************************************************************************************
+ ** 【文件名称】  tests/host/system_f103.h
+ ***********************************************************************************************************************************
+ ** 【功能描述】  主机测试用的 system_f103.h 替身: 只提供被测模块用到的类型和函数, 不包含任何寄存器定义
+ **
+ ** 【使用说明】  编译被测文件时用 -include tests/host/system_f103.h 强制包含, 与真实文件的包含保护宏相同,
+ **               被测文件再包含 "system_f103.h" 时不会展开真实文件;
+ **               System_GetCycles()、SystemCoreClock、System_GetTimeMs() 由测试程序定义, 用于控制时间
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+
+
+typedef   int8_t    s8;
+typedef  int16_t   s16;
+typedef  int32_t   s32;
+typedef  int64_t   s64;
+typedef  uint8_t    u8;
+typedef uint16_t   u16;
+typedef uint32_t   u32;
+typedef uint64_t   u64;
+
+extern uint32_t SystemCoreClock;                    // 内核时钟频率(Hz)
+uint32_t System_GetCycles(void);                    // 真实文件中为读取DWT_CYCCNT的宏
+u64      System_GetTimeMs(void);
+
+
+
+#endif
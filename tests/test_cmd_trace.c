@@ -0,0 +1,219 @@
+/***********************************************************************************************************************************
+ ** 【文件名称】  test_cmd_trace.c
+ ***********************************************************************************************************************************
+ ** 【功能描述】  System/cmd_trace.c 的主机测试: 环形缓冲区写满覆盖、Begin/Mark/End的顺序、导出时跳过已覆盖的记录、
+ **               周期数到微秒的换算(含CYCCNT溢出)
+ **
+ ** 【使用说明】  make test; 失败时输出不满足的检查并返回非0
+ **
+ ** 【实现说明】  1- System_GetCycles()返回 ulFakeCycles, 由测试设置;
+ **               2- cmd_trace.c 编译时 -Dprintf=Test_Printf, 导出的内容追加到 cOut 中, 由测试比较;
+ **               3- 被测模块的状态是静态的, 各测试按顺序运行, 期望的序号接着上一个测试计算
+ **
+ ** 【更新记录】
+ **
+***********************************************************************************************************************************/
+#include "cmd_trace.h"
+#include <stdarg.h>
+
+
+
+/*****************************************************************************
+ ** 替身与检查
+ *****************************************************************************/
+uint32_t SystemCoreClock = 72000000;
+static uint32_t ulFakeCycles = 0;
+static char     cOut[8192];
+static size_t   xOutLen = 0;
+static int      iChecks = 0;
+static int      iFailures = 0;
+
+uint32_t System_GetCycles(void)
+{
+    return ulFakeCycles;
+}
+
+u64 System_GetTimeMs(void)
+{
+    return 0;
+}
+
+int Test_Printf(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(cOut + xOutLen, sizeof(cOut) - xOutLen, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        xOutLen += ((size_t)n < sizeof(cOut) - xOutLen) ? (size_t)n : sizeof(cOut) - xOutLen - 1;
+    return n;
+}
+
+#define CHECK(cond)                                                                      \
+    do {                                                                                 \
+        iChecks++;                                                                       \
+        if (!(cond)) {                                                                   \
+            iFailures++;                                                                 \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);     \
+        }                                                                                \
+    } while (0)
+
+// 导出并返回输出的内容
+static const char *Export(void)
+{
+    xOutLen = 0;
+    cOut[0] = '\0';
+    CmdTrace_Export();
+    return cOut;
+}
+
+// 导出内容的行数
+static int Lines(const char *text)
+{
+    int n = 0;
+    for (; *text; text++)
+        n += (*text == '\n');
+    return n;
+}
+
+// 在 ulFakeCycles 时刻标记一个追踪点
+static void MarkAt(CmdTrace_Stage stage, uint32_t cycles)
+{
+    ulFakeCycles = cycles;
+    CmdTrace_Mark(stage);
+}
+
+// 产生一条完整的记录
+static void Record(uint16_t msgid)
+{
+    CmdTrace_Begin(msgid, 1000, 2000);
+    MarkAt(CMD_TRACE_PARSED, 3000);
+    CmdTrace_End();
+}
+
+
+
+/*****************************************************************************
+ ** 测试
+ *****************************************************************************/
+// Begin/Mark/End的顺序: 没有进行中的记录时Mark无效; 未结束的记录不能读取; 新的Begin结束上一条
+static void Test_Order(void)
+{
+    CmdTrace_Record r;
+
+    MarkAt(CMD_TRACE_PARSED, 50);                   // Begin之前: 无效
+    CmdTrace_Tag("early");
+    CHECK(!CmdTrace_Get(0, &r));
+
+    CmdTrace_Begin(1, 100, 200);                    // seq=1
+    CHECK(!CmdTrace_Get(0, &r));                    // 未结束
+    ulFakeCycles = 300;
+    CmdTrace_Tag("set");
+    MarkAt(CMD_TRACE_PARSED, 400);
+    MarkAt(CMD_TRACE_STAGE_NUM, 450);               // 越界的追踪点: 无效
+    CmdTrace_End();
+
+    CHECK(CmdTrace_Get(0, &r));
+    CHECK(r.seq == 1 && r.msgid == 1 && r.done);
+    CHECK(r.tag != NULL && strcmp(r.tag, "set") == 0);
+    CHECK(r.marked == ((1U << CMD_TRACE_FIRST_BYTE) | (1U << CMD_TRACE_FRAME_COMPLETE) |
+                       (1U << CMD_TRACE_CLASSIFIED) | (1U << CMD_TRACE_PARSED)));
+    CHECK(r.cycles[CMD_TRACE_FIRST_BYTE] == 100 && r.cycles[CMD_TRACE_FRAME_COMPLETE] == 200);
+    CHECK(r.cycles[CMD_TRACE_CLASSIFIED] == 300 && r.cycles[CMD_TRACE_PARSED] == 400);
+
+    MarkAt(CMD_TRACE_ACTUATED, 500);                // End之后: 无效
+    CHECK(CmdTrace_Get(0, &r) && !(r.marked & (1U << CMD_TRACE_ACTUATED)));
+
+    CmdTrace_Begin(2, 600, 700);                    // seq=2, 不调用End
+    CmdTrace_Begin(3, 800, 900);                    // seq=3, 结束seq=2
+    CHECK(!CmdTrace_Get(0, &r));                    // seq=3 进行中
+    CHECK(CmdTrace_Get(1, &r) && r.seq == 2 && r.done);
+    CHECK(CmdTrace_Get(2, &r) && r.seq == 1);
+
+    const char *out = Export();                     // 只导出到进行中的记录之前
+    CHECK(Lines(out) == 2);
+    const char *s1 = strstr(out, "seq=1 "), *s2 = strstr(out, "seq=2 ");
+    CHECK(s1 != NULL && s2 != NULL && s1 < s2);
+    CHECK(strstr(out, "seq=3 ") == NULL);
+
+    CmdTrace_End();
+    out = Export();                                 // 结束后继续导出, 不重复
+    CHECK(Lines(out) == 1 && strstr(out, "seq=3 msgid=3 ") != NULL);
+    CHECK(Lines(Export()) == 0);
+}
+
+// 周期数到微秒的换算: 相对首字节, 按SystemCoreClock换算, CYCCNT溢出后相减仍正确
+static void Test_Microseconds(void)
+{
+    const uint32_t first = 0xFFFFFF00;              // 记录过程中CYCCNT溢出
+    SystemCoreClock = 72000000;
+
+    CmdTrace_Begin(7, first, first + 72 * 1850);    // seq=4
+    ulFakeCycles = first + 72 * 2210;
+    CmdTrace_Tag("invoke");
+    MarkAt(CMD_TRACE_PARSED, first + 72 * 2264);
+    MarkAt(CMD_TRACE_ACTUATED, first + 72 * 2410 + 71);   // 不足1微秒的部分舍去
+    MarkAt(CMD_TRACE_REPLY_CONFIRMED, first + 72 * 14020);
+    CmdTrace_End();
+
+    SystemCoreClock = 0;                            // 时钟未知: 不导出, 也不跳过
+    CHECK(Lines(Export()) == 0);
+
+    SystemCoreClock = 72000000;
+    CHECK(strcmp(Export(), "CMDTRACE: seq=4 msgid=7 tag=invoke first=0 frame=1850 class=2210 parse=2264 "
+                           "act=2410 queued=- confirmed=14020\r\n") == 0);
+
+    SystemCoreClock = 8000000;                      // 其它时钟频率
+    CmdTrace_Begin(8, 0, 8 * 125);                  // seq=5
+    CmdTrace_End();
+    CHECK(strcmp(Export(), "CMDTRACE: seq=5 msgid=8 tag=- first=0 frame=125 class=- parse=- "
+                           "act=- queued=- confirmed=-\r\n") == 0);
+    SystemCoreClock = 72000000;
+}
+
+// 写满后覆盖最旧的记录; 导出时跳过已被覆盖的记录, 按序号输出剩下的
+static void Test_WrapAndExport(void)
+{
+    CmdTrace_Record r;
+    const uint32_t base = 6;                        // 本测试第一条记录的序号
+    const uint32_t total = CMD_TRACE_RING_SIZE + 5;
+
+    for (uint32_t i = 0; i < total; i++)
+        Record((uint16_t)(100 + i));
+    const uint32_t newest = base + total - 1;
+
+    CHECK(CmdTrace_Get(0, &r) && r.seq == newest && r.msgid == 100 + total - 1);
+    CHECK(CmdTrace_Get(CMD_TRACE_RING_SIZE - 1, &r) && r.seq == newest - CMD_TRACE_RING_SIZE + 1);
+    CHECK(!CmdTrace_Get(CMD_TRACE_RING_SIZE, &r));  // 超出缓冲区
+    CHECK(!CmdTrace_Get(255, &r));
+
+    const char *out = Export();
+    CHECK(Lines(out) == CMD_TRACE_RING_SIZE);
+    char first[32], last[32];
+    snprintf(first, sizeof(first), "CMDTRACE: seq=%lu ", (unsigned long)(newest - CMD_TRACE_RING_SIZE + 1));
+    snprintf(last, sizeof(last), "seq=%lu ", (unsigned long)newest);
+    CHECK(strncmp(out, first, strlen(first)) == 0); // 从未被覆盖的最旧一条开始
+    CHECK(strstr(out, last) != NULL);
+    char gone[32];
+    snprintf(gone, sizeof(gone), "seq=%lu ", (unsigned long)(newest - CMD_TRACE_RING_SIZE));
+    CHECK(strstr(out, gone) == NULL);               // 已被覆盖
+
+    CmdTrace_Begin(200, 0, 0);                      // 进行中的记录占用了最旧的位置
+    CHECK(Lines(Export()) == 0);
+    CHECK(CmdTrace_Get(1, &r) && r.seq == newest);
+    CmdTrace_End();
+    out = Export();
+    CHECK(Lines(out) == 1 && strstr(out, "msgid=200 ") != NULL);
+}
+
+
+
+int main(void)
+{
+    Test_Order();
+    Test_Microseconds();
+    Test_WrapAndExport();
+
+    printf("test_cmd_trace: %d checks, %d failed\n", iChecks, iFailures);
+    return iFailures ? 1 : 0;
+}
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+【文件名称】  decode_telemetry.py
+【功能描述】  CBOR遥测消息(main.c 的 MQTT_Publish_Telemetry_Cbor)的参考解码器: 解码后换算成与物模型JSON相同的属性名和单位,
+              供平台侧解析脚本、抓包分析对照; 只用标准库, 不依赖cbor2等第三方包
+【使用说明】  python3 tools/decode_telemetry.py a5000101...            # 十六进制字符串(可含空格)
+              python3 tools/decode_telemetry.py -f payload.bin         # 原始二进制文件
+              python3 tools/decode_telemetry.py --stats a5000101...    # 同时输出与等效JSON的字节数对比
+【注意事项】  1- 格式变化时同步修改 main.c 的 TELEM_CBOR_VERSION 和本文件的 VERSION、PROPS;
+              2- 数值在消息中为0.01单位的整数, 解码后为保留两位小数的浮点数
+"""
+import argparse
+import json
+import struct
+import sys
+
+VERSION = 1
+PROPS = ['temp1', 'temp2', 'temp3', 'temp4', 'ambient_temp', 'humidity']     # 顺序同 TelemAgg_Prop
+FROST_LEVELS = ['none', 'watch', 'alert']
+
+
+class CborError(ValueError):
+    pass
+
+
+def cbor_decode(data, pos=0):
+    """解码一个数据项, 返回 (值, 下一个位置); 支持整数、字节串、文本、数组、映射、布尔、null、浮点"""
+    if pos >= len(data):
+        raise CborError('truncated at %d' % pos)
+    ib = data[pos]
+    major, info = ib >> 5, ib & 0x1F
+    pos += 1
+    if info < 24:
+        val = info
+    elif info in (24, 25, 26, 27):
+        n = 1 << (info - 24)
+        if pos + n > len(data):
+            raise CborError('truncated argument at %d' % pos)
+        if major == 7 and info >= 25:
+            fmt = {2: '>e', 4: '>f', 8: '>d'}[n]
+            return struct.unpack(fmt, data[pos:pos + n])[0], pos + n
+        val = int.from_bytes(data[pos:pos + n], 'big')
+        pos += n
+    else:
+        raise CborError('indefinite length / reserved info %d at %d' % (info, pos - 1))
+
+    if major == 0:
+        return val, pos
+    if major == 1:
+        return -1 - val, pos
+    if major in (2, 3):
+        if pos + val > len(data):
+            raise CborError('truncated string at %d' % pos)
+        raw = bytes(data[pos:pos + val])
+        return (raw if major == 2 else raw.decode('utf-8')), pos + val
+    if major == 4:
+        items = []
+        for _ in range(val):
+            item, pos = cbor_decode(data, pos)
+            items.append(item)
+        return items, pos
+    if major == 5:
+        result = {}
+        for _ in range(val):
+            key, pos = cbor_decode(data, pos)
+            result[key], pos = cbor_decode(data, pos)
+        return result, pos
+    if major == 7:
+        simple = {20: False, 21: True, 22: None}
+        if val in simple:
+            return simple[val], pos
+        raise CborError('unsupported simple value %d' % val)
+    raise CborError('unsupported major type %d' % major)
+
+
+def centi(v):
+    return round(v / 100.0, 2)
+
+
+def decode_telemetry(data):
+    """CBOR遥测 -> 字典, 键名与物模型属性一致"""
+    msg, end = cbor_decode(data)
+    if end != len(data):
+        raise CborError('%d trailing bytes' % (len(data) - end))
+    if not isinstance(msg, dict) or msg.get(0) != VERSION:
+        raise CborError('not a telemetry message of version %d' % VERSION)
+
+    out = {'id': str(msg[1])}
+    for name, (last, lo, hi, avg) in zip(PROPS, msg[2]):
+        out[name] = centi(last)
+        out[name + '_stat'] = {'min': centi(lo), 'max': centi(hi), 'avg': centi(avg)}
+
+    status, fan_power, avail, frost = msg[3]
+    out['intervention_status'] = status
+    out['fan_power'] = fan_power
+    out['sprinklers_available'] = bool(avail & 1)
+    out['fans_available'] = bool(avail & 2)
+    out['heaters_available'] = bool(avail & 4)
+    out['frost_level'] = FROST_LEVELS[frost] if frost < len(FROST_LEVELS) else frost
+
+    if 4 in msg:
+        prop, period, values = msg[4]
+        out['temp_burst'] = {'point': PROPS[prop], 'period': period, 'values': [centi(v) for v in values]}
+    return out
+
+
+def json_equivalent_size(decoded, window=15):
+    """同样内容以JSON上报时的负载字节数: 物模型点值(MQTT_Publish_Telemetry_Points)、
+    自定义主题上的统计摘要(MQTT_Publish_Telemetry_Summary)和原始样本(MQTT_Publish_Telemetry_Burst)"""
+    def size(obj):
+        return len(json.dumps(obj, separators=(',', ':')))
+
+    total = size({'id': decoded['id'], 'version': '1.0', 'params': {name: {'value': decoded[name]} for name in PROPS}})
+    total += size({'id': decoded['id'], 'window': window, 'stat': {name: decoded[name + '_stat'] for name in PROPS}})
+    if 'temp_burst' in decoded:
+        total += size({'id': decoded['id'], 'burst': decoded['temp_burst']})
+    return total
+
+
+def main():
+    ap = argparse.ArgumentParser(description='decode CBOR telemetry published by the tower')
+    ap.add_argument('hex', nargs='*', help='payload as hex string')
+    ap.add_argument('-f', '--file', help='read raw payload bytes from file')
+    ap.add_argument('--stats', action='store_true', help='compare with the equivalent JSON size')
+    args = ap.parse_args()
+
+    if args.file:
+        with open(args.file, 'rb') as f:
+            data = f.read()
+    elif args.hex:
+        data = bytes.fromhex(''.join(args.hex))
+    else:
+        ap.error('no payload given')
+
+    try:
+        decoded = decode_telemetry(data)
+    except (CborError, KeyError, TypeError, ValueError) as e:
+        print('decode_telemetry: %s' % e, file=sys.stderr)
+        return 1
+
+    print(json.dumps(decoded, ensure_ascii=False, indent=2))
+    if args.stats:
+        size = json_equivalent_size(decoded)
+        print('cbor %d bytes, json %d bytes, ratio %.1fx' % (len(data), size, size / len(data)), file=sys.stderr)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+【文件名称】  gen_sensor_lut.py
+【功能描述】  生成温度传感器查找表 bsp/ADC/sensor_lut.c、sensor_lut.h: 16位ADC码值 -> 0.01°C,
+              表项放在flash中(const), 运行时只需查表和一次线性插值, 不再调用logf等浮点函数
+【使用说明】  python3 tools/gen_sensor_lut.py                 # 按下方 SENSORS 重新生成, 并校验插值误差
+              python3 tools/gen_sensor_lut.py --check         # 只校验, 不写文件
+              增加、修改传感器: 编辑 SENSORS 后重新运行, 再在 sensor_filter.c 的通道定义表中选用
+【注意事项】  1- 电路假定为: 传感器接地, 上拉电阻接VDDA(与ADC参考同源), 码值 = 65536 * R / (R + R上拉);
+              2- 校验按C代码相同的整数算法逐个码值计算, 与精确公式比较, 在有效温度范围内误差超过 max_err 时返回非0;
+              3- 生成的文件不要手工修改
+"""
+import argparse
+import math
+import os
+import sys
+
+# 传感器定义
+#   kind = 'beta'      : NTC, B值方程, 参数 r0(25°C阻值), beta
+#          'steinhart' : NTC, Steinhart-Hart方程 1/T = a + b*ln(R) + c*ln(R)^3
+#          'rtd'       : 铂电阻, Callendar-Van Dusen方程, 参数 r0(0°C阻值)
+#   r_pull      : 上拉电阻(Ω)
+#   t_min/t_max : 表项限制范围(°C), 超出范围的码值取端点值(开路、短路时也是端点值)
+#   max_err     : 有效范围内允许的最大插值误差(°C)
+SENSORS = [
+    dict(name='NTC10K_B3950', desc='NTC 10k B3950, 上拉10k', kind='beta',
+         r0=10000.0, beta=3950.0, r_pull=10000.0, t_min=-40.0, t_max=125.0, max_err=0.1),
+    dict(name='NTC10K_B3435', desc='NTC 10k B3435, 上拉10k', kind='beta',
+         r0=10000.0, beta=3435.0, r_pull=10000.0, t_min=-40.0, t_max=125.0, max_err=0.1),
+    dict(name='NTC10K_SH', desc='NTC 10k Steinhart-Hart(常见3950料号系数), 上拉10k', kind='steinhart',
+         a=1.009249522e-03, b=2.378405444e-04, c=2.019202697e-07, r_pull=10000.0, t_min=-40.0, t_max=125.0,
+         max_err=0.1),
+    dict(name='PT1000', desc='PT1000, 上拉1k', kind='rtd',
+         r0=1000.0, r_pull=1000.0, t_min=-40.0, t_max=125.0, max_err=0.1),
+]
+
+STEP_LOG2 = 8                           # 码值每256一格, 257个表项
+POINTS = (65536 >> STEP_LOG2) + 1
+CVD_A, CVD_B, CVD_C = 3.9083e-3, -5.775e-7, -4.183e-12   # IEC 60751
+
+
+def resistance_to_temp(s, r):
+    """精确公式: 电阻 -> 温度(°C)"""
+    if s['kind'] == 'beta':
+        return 1.0 / (1.0 / 298.15 + math.log(r / s['r0']) / s['beta']) - 273.15
+    if s['kind'] == 'steinhart':
+        ln = math.log(r)
+        return 1.0 / (s['a'] + s['b'] * ln + s['c'] * ln ** 3) - 273.15
+    if s['kind'] == 'rtd':
+        ratio = r / s['r0']
+        if ratio >= 1.0:                # 0°C以上: R = R0(1 + A*t + B*t^2), 解二次方程; 超出方程范围时视为极高温
+            disc = CVD_A ** 2 - 4 * CVD_B * (1 - ratio)
+            return (-CVD_A + math.sqrt(disc)) / (2 * CVD_B) if disc >= 0 else 1e6
+        t = (ratio - 1) / CVD_A         # 0°C以下含C项, 用牛顿迭代
+        for _ in range(20):
+            f = 1 + CVD_A * t + CVD_B * t * t + CVD_C * (t - 100) * t ** 3 - ratio
+            df = CVD_A + 2 * CVD_B * t + CVD_C * (4 * t ** 3 - 300 * t * t)
+            t -= f / df
+        return t
+    raise ValueError('unknown kind %s' % s['kind'])
+
+
+def code_to_temp(s, code):
+    """精确公式: 16位码值 -> 温度(°C), 超出范围时取端点值"""
+    if code <= 0:
+        return s['t_max'] if s['kind'] != 'rtd' else s['t_min']
+    if code >= 65536:
+        return s['t_min'] if s['kind'] != 'rtd' else s['t_max']
+    x = code / 65536.0
+    t = resistance_to_temp(s, s['r_pull'] * x / (1.0 - x))
+    return min(max(t, s['t_min']), s['t_max'])
+
+
+def build(s):
+    return [int(round(code_to_temp(s, i << STEP_LOG2) * 100)) for i in range(POINTS)]
+
+
+def interpolate(table, code):
+    """与sensor_lut.c中SensorLut_Convert()相同的整数算法"""
+    idx, frac = code >> STEP_LOG2, code & ((1 << STEP_LOG2) - 1)
+    t0 = table[idx]
+    return t0 + (((table[idx + 1] - t0) * frac) >> STEP_LOG2)     # python的>>与C的算术右移一致(向下取整)
+
+
+def check(s, table):
+    """逐个码值比较插值结果与精确公式; 只统计两端表项都未限幅的格, 含限幅点的格在范围边缘, 不计入"""
+    worst, worst_code = 0.0, 0
+    lo, hi = s['t_min'] * 100, s['t_max'] * 100
+    for code in range(65536):
+        idx = code >> STEP_LOG2
+        if not all(lo < table[i] < hi for i in (idx, idx + 1)):
+            continue
+        exact = code_to_temp(s, code)
+        err = abs(interpolate(table, code) / 100.0 - exact)
+        if err > worst:
+            worst, worst_code = err, code
+    return worst, worst_code
+
+
+def emit(tables, out_dir):
+    h = ['#ifndef __SENSOR_LUT_H', '#define __SENSOR_LUT_H',
+         '/' + '*' * 131,
+         ' ** 【文件名称】  sensor_lut.h',
+         ' ' + '*' * 131,
+         ' ** 【功能描述】  温度传感器查找表: 16位码值 -> 0.01°C, 由 tools/gen_sensor_lut.py 生成, 不要手工修改',
+         ' **',
+         ' ** 【使用说明】  int16_t centi = SensorLut_Convert(&xSensorLut_NTC10K_B3950, code);   // 2350 = 23.50°C',
+         ' **',
+         '*' * 131 + '/',
+         '#include <stdint.h>', '', '', '',
+         '#define SENSOR_LUT_STEP_LOG2      %d                 // 码值每%d一格' % (STEP_LOG2, 1 << STEP_LOG2),
+         '#define SENSOR_LUT_POINTS       %d                 // 表项数' % POINTS,
+         '', 'typedef struct', '{',
+         '    const char *name;',
+         '    int16_t     centi[SENSOR_LUT_POINTS];       // 码值 i << SENSOR_LUT_STEP_LOG2 对应的温度(0.01°C)',
+         '} SensorLut;', '', '']
+    for s, _, worst in tables:
+        h.append('extern const SensorLut xSensorLut_%s;%s// %s, 插值误差 <= %.3f°C'
+                 % (s['name'], ' ' * max(1, 24 - len(s['name'])), s['desc'], worst))
+    h += ['', 'int16_t SensorLut_Convert(const SensorLut *lut, uint16_t code);   // 查表并线性插值', '', '', '',
+          '#endif', '']
+
+    c = ['/' + '*' * 131,
+         ' ** 【文件名称】  sensor_lut.c',
+         ' ' + '*' * 131,
+         ' ** 【功能描述】  温度传感器查找表, 由 tools/gen_sensor_lut.py 生成, 不要手工修改',
+         ' **',
+         '*' * 131 + '/',
+         '#include "sensor_lut.h"', '', '', '']
+    for s, table, worst in tables:
+        c.append('// %s: %.0f~%.0f°C, 插值误差 <= %.3f°C' % (s['desc'], s['t_min'], s['t_max'], worst))
+        c.append('const SensorLut xSensorLut_%s =' % s['name'])
+        c.append('{')
+        c.append('    "%s",' % s['name'])
+        c.append('    {')
+        for i in range(0, POINTS, 12):
+            c.append('        ' + ' '.join('%6d,' % v for v in table[i:i + 12]))
+        c.append('    }')
+        c.append('};')
+        c.append('')
+    c += ['', '',
+          '/' + '*' * 78,
+          ' * 函  数： SensorLut_Convert',
+          ' * 功  能： 查表并线性插值, 约十几个周期',
+          ' * 参  数： const SensorLut *lut  查找表',
+          ' *          uint16_t code         16位码值, 0~65535对应0~VDDA',
+          ' * 返回值： 温度(0.01°C)',
+          ' ' + '*' * 78 + '/',
+          'int16_t SensorLut_Convert(const SensorLut *lut, uint16_t code)',
+          '{',
+          '    uint32_t idx  = code >> SENSOR_LUT_STEP_LOG2;',
+          '    int32_t  frac = code & ((1U << SENSOR_LUT_STEP_LOG2) - 1);',
+          '    int32_t  t0   = lut->centi[idx];',
+          '    return (int16_t)(t0 + (((int32_t)lut->centi[idx + 1] - t0) * frac >> SENSOR_LUT_STEP_LOG2));',
+          '}', '']
+
+    for name, lines in (('sensor_lut.h', h), ('sensor_lut.c', c)):
+        with open(os.path.join(out_dir, name), 'w', encoding='utf-8', newline='\n') as f:
+            f.write('\n'.join(lines))
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    ap = argparse.ArgumentParser(description='generate flash-resident sensor lookup tables')
+    ap.add_argument('--out', default=os.path.join(root, 'bsp', 'ADC'), help='output directory')
+    ap.add_argument('--check', action='store_true', help='verify only, do not write files')
+    args = ap.parse_args()
+
+    tables, failed = [], False
+    for s in SENSORS:
+        table = build(s)
+        worst, code = check(s, table)
+        ok = worst <= s['max_err']
+        failed |= not ok
+        print('%-14s max error %.4f C at code %5d (limit %.2f)%s' % (s['name'], worst, code, s['max_err'],
+                                                                     '' if ok else '  FAILED'))
+        tables.append((s, table, worst))
+
+    if failed:
+        print('gen_sensor_lut: FAILED')
+        return 1
+    if not args.check:
+        emit(tables, args.out)
+        print('written %s' % os.path.join(args.out, 'sensor_lut.[ch]'))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+【文件名称】  stack_usage.py
+【功能描述】  静态栈深度分析: 读取GCC -fstack-usage -fcallgraph-info=su 生成的 *.ci 调用图,
+              计算每个入口(main、各中断服务函数)的最坏栈深度, 超过预算时返回非0, 使make失败
+【使用说明】  python3 tools/stack_usage.py --ldscript STM32F103RCTx_FLASH.ld build
+              预算默认取链接脚本中的 _Min_Stack_Size, 也可用 --budget 指定
+【注意事项】  1- 库函数(newlib-nano)没有调用图, 使用下方 LIB_STACK 中的保守估计值; 未列出的外部函数按0计, 并列出提示;
+              2- 最坏情况 = main的最坏深度 + 每个抢占优先级中最深的一个中断(各含一次硬件压栈): 高优先级的中断可以打断低优先级的,
+                 各级可以逐级嵌套; 同一抢占优先级的中断不会互相嵌套. 抢占优先级取自 IRQ_PRIORITY, 修改NVIC配置时同步修改,
+                 也可用 --priority 名称=级别 临时指定; 没有优先级的中断按错误处理;
+              3- 递归、函数指针调用、动态栈(VLA/alloca)无法静态确定深度, 按错误处理
+"""
+import argparse
+import glob
+import os
+import re
+import sys
+
+# newlib-nano库函数的栈用量估计(字节, Cortex-M3, -Os), 包含其内部调用
+LIB_STACK = {
+    'printf': 360, 'vprintf': 360, 'sprintf': 360, 'snprintf': 360, 'vsnprintf': 360,
+    'sscanf': 320, 'strtod': 120, 'atof': 120, 'strtoul': 40, 'strtol': 40, 'atoi': 40,
+    'strstr': 24, 'strchr': 8, 'strlen': 8, 'strcpy': 8, 'strncpy': 16, 'strcmp': 8, 'strncmp': 16,
+    'memset': 8, 'memchr': 8, 'memcpy': 16, 'memmove': 16, 'memcmp': 16, 'rand': 16, 'srand': 8,
+    'puts': 64, 'putchar': 32, 'isspace': 0, 'isdigit': 0, '__aeabi_d2f': 16, '__aeabi_f2d': 16,
+}
+# 库函数内部回调到工程代码的函数(printf最终调用_write)
+LIB_CALLS = {
+    'printf': ['_write'], 'vprintf': ['_write'], 'puts': ['_write'], 'putchar': ['_write'],
+}
+EXC_FRAME = 32          # 进入中断时硬件自动压栈 8个寄存器
+# 各中断的抢占优先级(NVIC_PriorityGroup_2), 数值小的可以打断数值大的; 与各文件的NVIC配置保持一致
+IRQ_PRIORITY = {
+    'NMI_Handler': -2, 'HardFault_Handler': -1,                         # 固定优先级
+    'MemManage_Handler': 0, 'BusFault_Handler': 0, 'UsageFault_Handler': 0,
+    'SVC_Handler': 0, 'DebugMon_Handler': 0, 'PendSV_Handler': 0,
+    'SysTick_Handler': 0,                                               # system_f103.c: 未设置, 复位值0
+    'EXTI0_IRQHandler': 1, 'EXTI1_IRQHandler': 1, 'EXTI4_IRQHandler': 1,   # bsp_key.c
+    'USART1_IRQHandler': 2, 'USART2_IRQHandler': 2, 'USART3_IRQHandler': 2,
+    'UART4_IRQHandler': 2, 'UART5_IRQHandler': 2,                       # bsp_usart.c
+    'DMA1_Channel1_IRQHandler': 3,                                      # bsp_adc.c
+}
+
+RE_NODE = re.compile(r'node:\s*\{\s*title:\s*"([^"]+)"\s*label:\s*"([^"]*)"')
+RE_EDGE = re.compile(r'edge:\s*\{\s*sourcename:\s*"([^"]+)"\s*targetname:\s*"([^"]+)"')
+RE_FRAME = re.compile(r'(\d+) bytes \(([a-z,]+)\)')
+RE_ENTRY = re.compile(r'^(main|\w+_IRQHandler|\w+_Handler)$')
+
+
+def short(title):
+    """静态函数的标题为 '文件:函数', 只保留函数名用于显示"""
+    return title.rsplit(':', 1)[-1]
+
+
+def load(build_dir):
+    frames, quals, edges = {}, {}, {}
+    files = glob.glob(os.path.join(build_dir, '*.ci'))
+    if not files:
+        sys.exit('stack_usage: no *.ci files in %s (build with -fcallgraph-info=su)' % build_dir)
+    for path in files:
+        with open(path, encoding='utf-8', errors='replace') as f:
+            text = f.read()
+        for title, label in RE_NODE.findall(text):
+            m = RE_FRAME.search(label)
+            if m:
+                frames[title] = int(m.group(1))
+                quals[title] = m.group(2)
+        for src, dst in RE_EDGE.findall(text):
+            edges.setdefault(src, []).append(dst)
+    return frames, quals, edges
+
+
+def analyse(frames, quals, edges):
+    depth, path, errors, unknown = {}, {}, [], set()
+    active = set()
+
+    def visit(node):
+        if node in depth:
+            return depth[node]
+        if node in active:
+            errors.append('recursion through %s' % short(node))
+            return 0
+        if node not in frames:                          # 外部函数(库)
+            name = short(node)
+            if name == '__indirect_call':
+                errors.append('indirect call (function pointer), depth unknown')
+            elif name not in LIB_STACK:
+                unknown.add(name)
+            own, callees = LIB_STACK.get(name, 0), LIB_CALLS.get(name, [])
+        else:
+            own, callees = frames[node], edges.get(node, [])
+            if 'dynamic' in quals[node] and 'bounded' not in quals[node]:
+                errors.append('unbounded dynamic stack in %s' % short(node))
+
+        active.add(node)
+        best, best_path = 0, []
+        for callee in set(callees):
+            d = visit(callee)
+            if d > best:
+                best, best_path = d, path.get(callee, [callee])
+        active.discard(node)
+
+        depth[node] = own + best
+        path[node] = [node] + best_path
+        return depth[node]
+
+    entries = sorted(t for t in frames if RE_ENTRY.match(t))
+    for e in entries:
+        visit(e)
+    return entries, depth, path, errors, unknown
+
+
+def budget_from_ldscript(ldscript):
+    with open(ldscript, encoding='utf-8', errors='replace') as f:
+        m = re.search(r'_Min_Stack_Size\s*=\s*(0x[0-9a-fA-F]+|\d+)', f.read())
+    if not m:
+        sys.exit('stack_usage: _Min_Stack_Size not found in %s' % ldscript)
+    return int(m.group(1), 0)
+
+
+def priority_arg(text):
+    name, sep, level = text.partition('=')
+    if not sep:
+        raise argparse.ArgumentTypeError('expected NAME=LEVEL, got %r' % text)
+    return name, int(level, 0)
+
+
+def nest_levels(entries, depth, priority, errors):
+    """每个抢占优先级取最深的一个中断, 加一次硬件压栈; 返回 [(级别, 中断, 深度)], 按优先级从低到高"""
+    levels = {}
+    for e in entries:
+        name = short(e)
+        if name == 'main':
+            continue
+        if name not in priority:
+            errors.append('no preemption priority for %s (add to IRQ_PRIORITY or use --priority)' % name)
+            continue
+        level = priority[name]
+        if level not in levels or depth[e] > depth[levels[level]]:
+            levels[level] = e
+    return [(lv, short(levels[lv]), depth[levels[lv]] + EXC_FRAME) for lv in sorted(levels, reverse=True)]
+
+
+def main():
+    ap = argparse.ArgumentParser(description='worst-case stack depth per entry point')
+    ap.add_argument('build_dir')
+    ap.add_argument('--ldscript', help='linker script providing _Min_Stack_Size')
+    ap.add_argument('--budget', type=lambda v: int(v, 0), help='stack budget in bytes')
+    ap.add_argument('--priority', type=priority_arg, action='append', default=[], metavar='NAME=LEVEL',
+                    help='preemption priority of a handler, overrides IRQ_PRIORITY (repeatable)')
+    args = ap.parse_args()
+    priority = dict(IRQ_PRIORITY)
+    priority.update(args.priority)
+
+    budget = args.budget if args.budget is not None else (
+        budget_from_ldscript(args.ldscript) if args.ldscript else None)
+    frames, quals, edges = load(args.build_dir)
+    entries, depth, path, errors, unknown = analyse(frames, quals, edges)
+
+    print('stack usage (worst case per entry point):')
+    for e in sorted(entries, key=lambda t: -depth[t]):
+        chain = ' > '.join(short(n) for n in path[e])
+        print('  %6d  %-24s %s' % (depth[e], short(e), chain))
+
+    main_depth = max((depth[e] for e in entries if short(e) == 'main'), default=0)
+    levels = nest_levels(entries, depth, priority, errors)
+    total = main_depth + sum(d for _, _, d in levels)
+    print('worst-case nesting (deepest handler per preemption level, +%d bytes exception frame each):' % EXC_FRAME)
+    print('  %6d  main' % main_depth)
+    for level, name, d in levels:
+        print('  %6d  level %-3d %s' % (d, level, name))
+    print('  total %d bytes' % total, end='')
+    print(', budget %d bytes' % budget if budget is not None else '')
+
+    if unknown:
+        print('  note: no estimate for external %s (counted as 0)' % ', '.join(sorted(unknown)))
+    for msg in sorted(set(errors)):
+        print('  error: %s' % msg)
+
+    if errors or (budget is not None and total > budget):
+        print('stack_usage: FAILED')
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())